@@ -0,0 +1,50 @@
+#version 330 core
+
+// Bloom's blur over a chain of ever smaller targets (see PostProcess.hpp): each level is a 4x4 box
+// downsample of the one above, then the levels are added back up with a 3x3 tent filter
+// Features: PREFILTER - the first downsample, from the scene: keeps what's brighter than `threshold`,
+//                       with a soft knee
+//           UPSAMPLE - the tent filtered smaller level, added to `base` (the level of this size)
+
+out vec4 fragColor;
+
+in vec2 uv;
+
+// Read in the lower left `uvScale` part (the rendered part of the scene, else all of it)
+uniform sampler2D source;
+uniform vec2 uvScale;
+uniform vec2 texelSize;
+#ifdef PREFILTER
+uniform float threshold;
+uniform float knee;
+#endif
+#ifdef UPSAMPLE
+uniform sampler2D base;
+#endif
+
+vec3 fetch(vec2 p) {
+	return texture(source, clamp(p, texelSize * .5f, uvScale - texelSize * .5f)).rgb;
+}
+
+void main() {
+	vec2 p = uv * uvScale;
+#ifdef UPSAMPLE
+	vec3 color = fetch(p) * 4.f;
+	color += (fetch(p + vec2(texelSize.x, 0.f)) + fetch(p - vec2(texelSize.x, 0.f)) +
+						fetch(p + vec2(0.f, texelSize.y)) + fetch(p - vec2(0.f, texelSize.y))) * 2.f;
+	color += fetch(p + texelSize) + fetch(p - texelSize) +
+					 fetch(p + vec2(texelSize.x, -texelSize.y)) + fetch(p + vec2(-texelSize.x, texelSize.y));
+	color = color / 16.f + texture(base, uv).rgb;
+#else
+	// Four bilinear taps between texels average 4x4 of them
+	vec3 color = (fetch(p + texelSize) + fetch(p - texelSize) +
+								fetch(p + vec2(texelSize.x, -texelSize.y)) + fetch(p + vec2(-texelSize.x, texelSize.y))) * .25f;
+#endif
+#ifdef PREFILTER
+	float brightness = max(color.r, max(color.g, color.b));
+	float soft = clamp(brightness - threshold + knee, 0.f, 2.f * knee);
+	soft = soft * soft / (4.f * knee + 1e-4f);
+	color *= max(soft, brightness - threshold) / max(brightness, 1e-4f);
+#endif
+	fragColor = vec4(color, 1.f);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// Fullscreen triangle made from gl_VertexID, drawn without vertex buffers
+
+out vec2 uv;
+
+void main() {
+	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	uv = position;
+	gl_Position = vec4(position * 2.f - 1.f, 0.f, 1.f);
+}
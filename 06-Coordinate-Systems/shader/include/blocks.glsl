@@ -0,0 +1,34 @@
+// Uniform blocks shared by the shaders, mirrored by src/UniformBlocks.hpp
+
+layout (std140) uniform Camera {
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	vec3 cameraPosition;
+	float time;
+};
+
+layout (std140) uniform Draw {
+	mat4 model;
+};
+
+layout (std140) uniform Material {
+	vec4 baseColorFactor;
+	float metallicFactor;
+	float roughnessFactor;
+};
+
+layout (std140) uniform Lights {
+	mat4 clusterView;
+	vec4 clusterScale;
+	uint clusterTilesX;
+	uint clusterTilesY;
+	uint clusterSlices;
+	uint lightCount;
+	uint lightDataOffset;
+	uint lightClustersOffset;
+	uint lightIndicesOffset;
+	uint lightsPadding0;
+	vec3 ambient;
+	float lightsPadding;
+};
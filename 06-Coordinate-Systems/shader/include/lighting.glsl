@@ -0,0 +1,45 @@
+// Clustered lights (see src/Lighting.hpp), needs blocks.glsl before it
+
+// Views of the whole light stream; this frame's data starts at the offsets of the Lights block.
+// 3 texels per light: position and radius, color and outer cone cosine, direction and inner cone cosine
+uniform samplerBuffer lightData;
+// Offset and count into the frame's lightIndices per cluster
+uniform usamplerBuffer lightClusters;
+uniform usamplerBuffer lightIndices;
+
+// Light reaching a surface from the lights of it's cluster, ambient included
+vec3 clusteredLighting(vec3 position, vec3 normal) {
+	vec3 light = ambient;
+	if(lightCount==0u)
+		return light;
+
+	// Cluster: tiles uniform in x and y of the projection, slices exponential in depth
+	vec3 view = (clusterView * vec4(position, 1.f)).xyz;
+	float depth = max(-view.z, clusterScale.z);
+	vec2 ndc = view.xy / (depth * clusterScale.xy);
+	uvec3 tiles = uvec3(clusterTilesX, clusterTilesY, clusterSlices);
+	uvec3 cluster = uvec3(clamp(vec3(floor((ndc * .5f + .5f) * vec2(tiles.xy)), floor(log(depth / clusterScale.z) * clusterScale.w)),
+															vec3(0.f), vec3(tiles - 1u)));
+	uvec2 list = texelFetch(lightClusters, int(lightClustersOffset + cluster.x + tiles.x * (cluster.y + tiles.y * cluster.z))).xy;
+
+	bool hasNormal = dot(normal, normal) > 0.f;
+	vec3 n = hasNormal ? normalize(normal) : vec3(0.f);
+	for(uint i = 0u; i < list.y; ++i) {
+		int index = int(lightDataOffset + texelFetch(lightIndices, int(lightIndicesOffset + list.x + i)).x * 3u);
+		vec4 positionRadius = texelFetch(lightData, index);
+		vec4 colorOuter = texelFetch(lightData, index + 1);
+		vec4 directionInner = texelFetch(lightData, index + 2);
+
+		vec3 toLight = positionRadius.xyz - position;
+		float dist = length(toLight);
+		vec3 l = toLight / max(dist, 1e-4f);
+		// Inverse square, windowed to reach 0 at the radius
+		float window = clamp(1.f - pow(dist / positionRadius.w, 4.f), 0.f, 1.f);
+		float attenuation = window * window / (dist * dist + 1.f);
+		if(colorOuter.w > -1.f)
+			attenuation *= smoothstep(colorOuter.w, directionInner.w, dot(-l, directionInner.xyz));
+		float lambert = hasNormal ? max(dot(n, l), 0.f) : 1.f;
+		light += colorOuter.rgb * (lambert * attenuation);
+	}
+	return light;
+}
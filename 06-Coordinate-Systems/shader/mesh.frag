@@ -0,0 +1,25 @@
+#version 330 core
+
+// Features: BASE_COLOR_TEXTURE - the material has a base color texture on texture0
+
+out vec4 fragColor;
+
+in vec4 myColor;
+in vec2 TexCoord;
+in vec3 worldPosition;
+in vec3 worldNormal;
+
+#include "include/blocks.glsl"
+#include "include/lighting.glsl"
+
+#ifdef BASE_COLOR_TEXTURE
+uniform sampler2D texture0;
+#endif
+
+void main() {
+	vec4 base = baseColorFactor * myColor;
+#ifdef BASE_COLOR_TEXTURE
+	base *= texture(texture0, TexCoord);
+#endif
+	fragColor = vec4(base.rgb * clusteredLighting(worldPosition, worldNormal), base.a);
+}
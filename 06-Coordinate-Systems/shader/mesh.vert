@@ -0,0 +1,23 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec4 aColor;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec3 aNormal;
+
+out vec4 myColor;
+out vec2 TexCoord;
+out vec3 worldPosition;
+out vec3 worldNormal;
+
+#include "include/blocks.glsl"
+
+void main() {
+	vec4 position = model * vec4(aPos, 1.f);
+	gl_Position = viewProjection * position;
+	myColor = aColor;
+	TexCoord = aTexCoord;
+	worldPosition = position.xyz;
+	// Meshes without normals read 0s: lit from every direction
+	worldNormal = mat3(model) * aNormal;
+}
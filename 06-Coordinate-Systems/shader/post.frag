@@ -0,0 +1,69 @@
+#version 330 core
+
+// Fused post-processing: every enabled effect in one fullscreen pass (see PostProcess.hpp)
+// Features: SHARPEN - unsharp mask against the 4 neighbours, by `sharpness`
+//           BLOOM - adds the blurred bright parts in `bloom`, by `bloomIntensity`
+//           TONEMAP - `exposure` and a filmic curve (ACES fit) from HDR to [0, 1]
+//           VIGNETTE - darkens towards the corners, by `vignetteStrength`
+//           COLOR_GRADE - `saturation`, `contrast` and `tint`
+
+out vec4 fragColor;
+
+in vec2 uv;
+
+// Rendered frame in the lower left `uvScale` part of the source
+uniform sampler2D source;
+uniform vec2 uvScale;
+uniform vec2 texelSize;
+#ifdef SHARPEN
+uniform float sharpness;
+#endif
+#ifdef BLOOM
+uniform sampler2D bloom;
+uniform float bloomIntensity;
+#endif
+#ifdef TONEMAP
+uniform float exposure;
+#endif
+#ifdef VIGNETTE
+uniform float vignetteStrength;
+#endif
+#ifdef COLOR_GRADE
+uniform float saturation;
+uniform float contrast;
+uniform vec3 tint;
+#endif
+
+vec3 fetch(vec2 p) {
+	// Bilinear taps stay half a texel inside the rendered part
+	return texture(source, clamp(p, texelSize * .5f, uvScale - texelSize * .5f)).rgb;
+}
+
+void main() {
+	vec2 p = uv * uvScale;
+	vec3 color = fetch(p);
+#ifdef SHARPEN
+	vec3 blur = (fetch(p + vec2(texelSize.x, 0.f)) + fetch(p - vec2(texelSize.x, 0.f)) +
+							 fetch(p + vec2(0.f, texelSize.y)) + fetch(p - vec2(0.f, texelSize.y))) * .25f;
+	color = max(color + (color - blur) * sharpness, 0.f);
+#endif
+#ifdef BLOOM
+	// The bloom chain covers the whole target
+	color += texture(bloom, uv).rgb * bloomIntensity;
+#endif
+#ifdef TONEMAP
+	color *= exposure;
+	color = clamp(color * (2.51f * color + .03f) / (color * (2.43f * color + .59f) + .14f), 0.f, 1.f);
+#endif
+#ifdef VIGNETTE
+	vec2 d = uv - .5f;
+	color *= 1.f - vignetteStrength * smoothstep(.2f, .7f, dot(d, d) * 2.f);
+#endif
+#ifdef COLOR_GRADE
+	float luma = dot(color, vec3(.2126f, .7152f, .0722f));
+	color = mix(vec3(luma), color, saturation);
+	color = (color - .5f) * contrast + .5f;
+	color = clamp(color * tint, 0.f, 1.f);
+#endif
+	fragColor = vec4(color, 1.f);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+// Features: MIX_TEXTURE1 - blend texture1 over texture0 by MIX_FACTOR
+
+out vec4 fragColor;
+
+in vec3 myColor;
+in vec2 TexCoord;
+
+uniform sampler2D texture0;
+
+#ifdef MIX_TEXTURE1
+uniform sampler2D texture1;
+#ifndef MIX_FACTOR
+#define MIX_FACTOR 0.2
+#endif
+#endif
+
+void main() {
+#ifdef MIX_TEXTURE1
+	fragColor = mix(texture(texture0, TexCoord), texture(texture1, TexCoord), MIX_FACTOR);
+#else
+	fragColor = texture(texture0, TexCoord);
+#endif
+}
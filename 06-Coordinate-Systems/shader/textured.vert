@@ -1,5 +1,7 @@
 #version 330 core
 
+// Features: TRANSFORM - place the vertices with the transform matrix
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aColor;
 layout (location = 2) in vec2 aTexCoord;
@@ -7,11 +9,16 @@ layout (location = 2) in vec2 aTexCoord;
 out vec3 myColor;
 out vec2 TexCoord;
 
+#ifdef TRANSFORM
 uniform mat4 transform;
+#endif
 
 void main() {
+#ifdef TRANSFORM
 	gl_Position = transform * vec4(aPos, 1.f);
+#else
+	gl_Position = vec4(aPos, 1.f);
+#endif
 	myColor = aColor;
 	TexCoord = aTexCoord;
 }
-
@@ -1,14 +0,0 @@
-#version 330 core
-
-out vec4 fragColor;
-
-in vec3 myColor;
-in vec2 TexCoord;
-
-uniform sampler2D texture0;
-uniform sampler2D texture1;
-
-void main() {
-	fragColor = mix(texture(texture0, TexCoord), texture(texture1, TexCoord), 0.2);
-}
-
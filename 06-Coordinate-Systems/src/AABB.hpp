@@ -0,0 +1,92 @@
+/*
+ * Axis aligned bounding box and ray, shared by the spatial structures.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef AABB_HPP
+#define AABB_HPP
+
+#include <cstdint>
+#include <limits>
+
+#include <glm/glm.hpp>
+
+struct AABB {
+	glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+	glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+	AABB() = default;
+	AABB(const glm::vec3 & min, const glm::vec3 & max) : min(min), max(max) {}
+
+	static AABB merge(const AABB & a, const AABB & b) {
+		return AABB(glm::min(a.min, b.min), glm::max(a.max, b.max));
+	}
+
+	void grow(const AABB & other) {
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	void grow(const glm::vec3 & point) {
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	bool isEmpty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+
+	glm::vec3 center() const { return (min + max) * .5f; }
+	glm::vec3 extent() const { return (max - min) * .5f; }
+
+	float surfaceArea() const {
+		if(isEmpty())
+			return 0.f;
+		glm::vec3 d = max - min;
+		return 2.f * (d.x*d.y + d.y*d.z + d.z*d.x);
+	}
+
+	bool contains(const AABB & other) const {
+		return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+			max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+	}
+
+	bool overlaps(const AABB & other) const {
+		return min.x <= other.max.x && max.x >= other.min.x &&
+			min.y <= other.max.y && max.y >= other.min.y &&
+			min.z <= other.max.z && max.z >= other.min.z;
+	}
+};
+
+struct Ray {
+	glm::vec3 origin;
+	glm::vec3 direction;
+
+	// Slab test; on hit t is the entry distance (0 if the origin is inside)
+	bool intersects(const AABB & box, float maxT, float & t) const {
+		float tMin = 0.f, tMax = maxT;
+		for(int axis = 0; axis < 3; ++axis) {
+			float inv = 1.f / direction[axis];
+			float t1 = (box.min[axis] - origin[axis]) * inv;
+			float t2 = (box.max[axis] - origin[axis]) * inv;
+			if(t1 > t2) {
+				float tmp = t1;
+				t1 = t2;
+				t2 = tmp;
+			}
+			tMin = t1 > tMin ? t1 : tMin;
+			tMax = t2 < tMax ? t2 : tMax;
+			if(tMin > tMax)
+				return false;
+		}
+		t = tMin;
+		return true;
+	}
+};
+
+struct RayHit {
+	uint32_t object = UINT32_MAX;
+	float t = std::numeric_limits<float>::max();
+};
+
+#endif /* AABB_HPP */
@@ -0,0 +1,469 @@
+#include "BVH.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define BVH_SSE
+#endif
+
+namespace {
+	constexpr int NUM_BINS = 12;
+	// Relative costs of a node traversal and of a primitive test
+	constexpr float TRAVERSAL_COST = 1.f;
+	constexpr float INTERSECTION_COST = 1.f;
+
+	// Traversal stack, reused between queries of a thread
+	thread_local std::vector<int32_t> stack;
+}
+
+void BVH::build(const std::vector<AABB> & boxes, const std::vector<uint32_t> & objects) {
+	this->boxes = boxes;
+	this->objects = objects;
+	nodes.clear();
+	primitives.resize(boxes.size());
+	if(boxes.empty())
+		return;
+
+	std::vector<PrimRef> refs(boxes.size());
+	for(uint32_t i = 0; i < refs.size(); ++i)
+		refs[i] = PrimRef{boxes[i], boxes[i].center(), i};
+
+	std::vector<BuildNode> binary;
+	binary.reserve(2 * boxes.size());
+	AABB bounds, centroidBounds;
+	computeBounds(refs, 0, (uint32_t)refs.size(), bounds, centroidBounds);
+	buildBinary(binary, refs, 0, (uint32_t)refs.size(), bounds, centroidBounds);
+
+	for(size_t i = 0; i < refs.size(); ++i)
+		primitives[i] = refs[i].index;
+
+	nodes.reserve(binary.size() / 3 + 1);
+	collapse(binary, 0);
+}
+
+void BVH::computeBounds(const std::vector<PrimRef> & refs, uint32_t first, uint32_t count,
+												AABB & bounds, AABB & centroidBounds) {
+	bounds = AABB();
+	centroidBounds = AABB();
+	for(uint32_t i = first; i < first + count; ++i) {
+		bounds.grow(refs[i].box);
+		centroidBounds.grow(refs[i].centroid);
+	}
+}
+
+int32_t BVH::buildBinary(std::vector<BuildNode> & out, std::vector<PrimRef> & refs,
+												 uint32_t first, uint32_t count, const AABB & bounds, const AABB & centroidBounds) {
+	int32_t index = (int32_t)out.size();
+	out.emplace_back();
+
+	out[index].bounds = bounds;
+	out[index].first = first;
+	out[index].count = count;
+	if(count <= 1)
+		return index;
+
+	// Split along the axis of the largest centroid extent
+	glm::vec3 size = centroidBounds.max - centroidBounds.min;
+	int axis = (size.x > size.y && size.x > size.z) ? 0 : (size.y > size.z ? 1 : 2);
+	float lo = centroidBounds.min[axis];
+	float extent = size[axis];
+
+	uint32_t mid = first + count/2;
+	// Children bounds come from the bins; only the median fallback has to scan again
+	AABB leftBounds, leftCentroids, rightBounds, rightCentroids;
+	bool childBoundsKnown = false;
+	if(extent > 0.f) {
+		// Binned SAH: bounds and counts per bin, then sweep for the cheapest split
+		AABB binBounds[NUM_BINS], binCentroids[NUM_BINS];
+		uint32_t binCounts[NUM_BINS] = {};
+		float scale = NUM_BINS / extent;
+		auto binOf = [&](const PrimRef & ref) {
+			return std::min(NUM_BINS-1, (int)((ref.centroid[axis] - lo) * scale));
+		};
+		for(uint32_t i = first; i < first + count; ++i) {
+			int b = binOf(refs[i]);
+			binBounds[b].grow(refs[i].box);
+			binCentroids[b].grow(refs[i].centroid);
+			++binCounts[b];
+		}
+
+		float rightArea[NUM_BINS];
+		uint32_t rightCount[NUM_BINS];
+		AABB acc;
+		uint32_t n = 0;
+		for(int b = NUM_BINS-1; b > 0; --b) {
+			acc.grow(binBounds[b]);
+			n += binCounts[b];
+			rightArea[b] = acc.surfaceArea();
+			rightCount[b] = n;
+		}
+
+		float bestCost = std::numeric_limits<float>::max();
+		int bestSplit = -1;
+		acc = AABB();
+		n = 0;
+		for(int b = 0; b < NUM_BINS-1; ++b) {
+			acc.grow(binBounds[b]);
+			n += binCounts[b];
+			if(n==0 || rightCount[b+1]==0)
+				continue;
+			float cost = acc.surfaceArea() * n + rightArea[b+1] * rightCount[b+1];
+			if(cost < bestCost) {
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		float leafCost = INTERSECTION_COST * count;
+		float splitCost = TRAVERSAL_COST + INTERSECTION_COST * bestCost / bounds.surfaceArea();
+		if(count <= MAX_LEAF_SIZE && (bestSplit < 0 || splitCost >= leafCost))
+			return index;
+
+		if(bestSplit >= 0) {
+			auto it = std::partition(refs.begin() + first, refs.begin() + first + count,
+				[&](const PrimRef & ref) { return binOf(ref) <= bestSplit; });
+			mid = (uint32_t)(it - refs.begin());
+			for(int b = 0; b < NUM_BINS; ++b) {
+				(b <= bestSplit ? leftBounds : rightBounds).grow(binBounds[b]);
+				(b <= bestSplit ? leftCentroids : rightCentroids).grow(binCentroids[b]);
+			}
+			childBoundsKnown = true;
+		}
+		else {
+			// All centroids in one bin; fall back to a median split
+			std::nth_element(refs.begin() + first, refs.begin() + mid, refs.begin() + first + count,
+				[axis](const PrimRef & a, const PrimRef & b) { return a.centroid[axis] < b.centroid[axis]; });
+		}
+	}
+	else if(count <= MAX_LEAF_SIZE)
+		// Coincident centroids: nothing to gain from splitting a small leaf
+		return index;
+
+	if(!childBoundsKnown) {
+		computeBounds(refs, first, mid - first, leftBounds, leftCentroids);
+		computeBounds(refs, mid, first + count - mid, rightBounds, rightCentroids);
+	}
+	int32_t left = buildBinary(out, refs, first, mid - first, leftBounds, leftCentroids);
+	int32_t right = buildBinary(out, refs, mid, first + count - mid, rightBounds, rightCentroids);
+	out[index].left = left;
+	out[index].right = right;
+	return index;
+}
+
+int32_t BVH::collapse(const std::vector<BuildNode> & binary, int32_t binaryNode) {
+	int32_t index = (int32_t)nodes.size();
+	nodes.emplace_back();
+
+	// Pull grandchildren up until there are 4 children or only leaves are left
+	int32_t children[4];
+	int numChildren = 0;
+	const BuildNode & root = binary[binaryNode];
+	if(root.left < 0)
+		children[numChildren++] = binaryNode;
+	else {
+		children[numChildren++] = root.left;
+		children[numChildren++] = root.right;
+	}
+	while(numChildren < 4) {
+		int best = -1;
+		float bestArea = -1.f;
+		for(int i = 0; i < numChildren; ++i) {
+			const BuildNode & c = binary[children[i]];
+			if(c.left >= 0 && c.bounds.surfaceArea() > bestArea) {
+				bestArea = c.bounds.surfaceArea();
+				best = i;
+			}
+		}
+		if(best < 0)
+			break;
+		int32_t expanded = children[best];
+		children[best] = binary[expanded].left;
+		children[numChildren++] = binary[expanded].right;
+	}
+
+	for(int slot = 0; slot < 4; ++slot) {
+		if(slot >= numChildren) {
+			setChild(nodes[index], slot, AABB());
+			nodes[index].child[slot] = -1;
+			nodes[index].count[slot] = 0;
+			continue;
+		}
+		const BuildNode & c = binary[children[slot]];
+		int32_t child;
+		uint32_t count;
+		if(c.left < 0) {
+			child = (int32_t)c.first;
+			count = c.count;
+		}
+		else {
+			// nodes may reallocate here, so index it again afterwards
+			child = collapse(binary, children[slot]);
+			count = 0;
+		}
+		setChild(nodes[index], slot, c.bounds);
+		nodes[index].child[slot] = child;
+		nodes[index].count[slot] = count;
+	}
+	return index;
+}
+
+void BVH::setChild(Node & node, int slot, const AABB & bounds) {
+	node.minX[slot] = bounds.min.x;
+	node.minY[slot] = bounds.min.y;
+	node.minZ[slot] = bounds.min.z;
+	node.maxX[slot] = bounds.max.x;
+	node.maxY[slot] = bounds.max.y;
+	node.maxZ[slot] = bounds.max.z;
+}
+
+AABB BVH::childBounds(const Node & node, int slot) const {
+	return AABB(glm::vec3(node.minX[slot], node.minY[slot], node.minZ[slot]),
+							glm::vec3(node.maxX[slot], node.maxY[slot], node.maxZ[slot]));
+}
+
+void BVH::refit() {
+	// Children always come after their parent, so walk backwards
+	for(size_t n = nodes.size(); n-- > 0;) {
+		Node & node = nodes[n];
+		for(int slot = 0; slot < 4; ++slot) {
+			if(node.isEmpty(slot))
+				continue;
+			AABB bounds;
+			if(node.isLeaf(slot)) {
+				for(uint32_t i = 0; i < node.count[slot]; ++i)
+					bounds.grow(boxes[primitives[node.child[slot] + i]]);
+			}
+			else {
+				const Node & child = nodes[node.child[slot]];
+				for(int s = 0; s < 4; ++s)
+					if(!child.isEmpty(s))
+						bounds.grow(childBounds(child, s));
+			}
+			setChild(node, slot, bounds);
+		}
+	}
+}
+
+AABB BVH::getBounds() const {
+	AABB bounds;
+	if(!nodes.empty())
+		for(int slot = 0; slot < 4; ++slot)
+			if(!nodes[0].isEmpty(slot))
+				bounds.grow(childBounds(nodes[0], slot));
+	return bounds;
+}
+
+#ifdef BVH_SSE
+
+namespace {
+	// Bit i set when child i of the node intersects the frustum
+	inline unsigned frustumMask(const BVH::Node & node, const __m128 * planes) {
+		__m128 half = _mm_set1_ps(.5f);
+		__m128 minX = _mm_load_ps(node.minX), maxX = _mm_load_ps(node.maxX);
+		__m128 minY = _mm_load_ps(node.minY), maxY = _mm_load_ps(node.maxY);
+		__m128 minZ = _mm_load_ps(node.minZ), maxZ = _mm_load_ps(node.maxZ);
+		__m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half), ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+		__m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half), ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+		__m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half), ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+		__m128 outside = _mm_setzero_ps();
+		for(int p = 0; p < 6; ++p) {
+			const __m128 * pl = planes + 7*p;
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl[0], cx), _mm_mul_ps(pl[1], cy)),
+														_mm_add_ps(_mm_mul_ps(pl[2], cz), pl[3]));
+			__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(pl[4], ex), _mm_mul_ps(pl[5], ey)), _mm_mul_ps(pl[6], ez));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+		}
+		return ~(unsigned)_mm_movemask_ps(outside) & 0xF;
+	}
+
+	inline unsigned regionMask(const BVH::Node & node, const AABB & region) {
+		__m128 outside = _mm_cmpgt_ps(_mm_load_ps(node.minX), _mm_set1_ps(region.max.x));
+		outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_load_ps(node.minY), _mm_set1_ps(region.max.y)));
+		outside = _mm_or_ps(outside, _mm_cmpgt_ps(_mm_load_ps(node.minZ), _mm_set1_ps(region.max.z)));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_load_ps(node.maxX), _mm_set1_ps(region.min.x)));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_load_ps(node.maxY), _mm_set1_ps(region.min.y)));
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_load_ps(node.maxZ), _mm_set1_ps(region.min.z)));
+		return ~(unsigned)_mm_movemask_ps(outside) & 0xF;
+	}
+
+	// Slab test of the 4 children; entry distances go to tEntry
+	inline unsigned rayMask(const BVH::Node & node, const __m128 * origin, const __m128 * invDir, float maxT, float * tEntry) {
+		__m128 tMin = _mm_setzero_ps();
+		__m128 tMax = _mm_set1_ps(maxT);
+		const float * mins[3] = {node.minX, node.minY, node.minZ};
+		const float * maxs[3] = {node.maxX, node.maxY, node.maxZ};
+		for(int axis = 0; axis < 3; ++axis) {
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(mins[axis]), origin[axis]), invDir[axis]);
+			__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(maxs[axis]), origin[axis]), invDir[axis]);
+			tMin = _mm_max_ps(tMin, _mm_min_ps(t1, t2));
+			tMax = _mm_min_ps(tMax, _mm_max_ps(t1, t2));
+		}
+		_mm_storeu_ps(tEntry, tMin);
+		return (unsigned)_mm_movemask_ps(_mm_cmple_ps(tMin, tMax));
+	}
+}
+
+#else
+
+namespace {
+	inline unsigned frustumMask(const BVH::Node & node, const Frustum & frustum) {
+		unsigned mask = 0;
+		for(int i = 0; i < 4; ++i) {
+			glm::vec3 min(node.minX[i], node.minY[i], node.minZ[i]), max(node.maxX[i], node.maxY[i], node.maxZ[i]);
+			if(frustum.intersects((min + max) * .5f, (max - min) * .5f))
+				mask |= 1u << i;
+		}
+		return mask;
+	}
+
+	inline unsigned regionMask(const BVH::Node & node, const AABB & region) {
+		unsigned mask = 0;
+		for(int i = 0; i < 4; ++i)
+			if(region.overlaps(AABB(glm::vec3(node.minX[i], node.minY[i], node.minZ[i]),
+															glm::vec3(node.maxX[i], node.maxY[i], node.maxZ[i]))))
+				mask |= 1u << i;
+		return mask;
+	}
+}
+
+#endif
+
+void BVH::queryFrustum(const Frustum & frustum, std::vector<uint32_t> & out) const {
+	if(nodes.empty())
+		return;
+
+#ifdef BVH_SSE
+	// Plane components broadcast: nx, ny, nz, w, |nx|, |ny|, |nz|
+	__m128 planes[6*7];
+	for(int p = 0; p < 6; ++p) {
+		const glm::vec4 & pl = frustum.planes[p];
+		float v[7] = {pl.x, pl.y, pl.z, pl.w, std::fabs(pl.x), std::fabs(pl.y), std::fabs(pl.z)};
+		for(int i = 0; i < 7; ++i)
+			planes[7*p + i] = _mm_set1_ps(v[i]);
+	}
+#else
+	const Frustum & planes = frustum;
+#endif
+
+	stack.clear();
+	stack.push_back(0);
+	while(!stack.empty()) {
+		const Node & node = nodes[stack.back()];
+		stack.pop_back();
+		unsigned mask = frustumMask(node, planes);
+		for(; mask; mask &= mask-1) {
+			int slot = __builtin_ctz(mask);
+			if(node.isEmpty(slot))
+				continue;
+			if(node.isLeaf(slot)) {
+				for(uint32_t i = 0; i < node.count[slot]; ++i) {
+					uint32_t prim = primitives[node.child[slot] + i];
+					if(frustum.intersects(boxes[prim].center(), boxes[prim].extent()))
+						out.push_back(objects[prim]);
+				}
+			}
+			else
+				stack.push_back(node.child[slot]);
+		}
+	}
+}
+
+void BVH::queryRegion(const AABB & region, std::vector<uint32_t> & out) const {
+	if(nodes.empty())
+		return;
+
+	stack.clear();
+	stack.push_back(0);
+	while(!stack.empty()) {
+		const Node & node = nodes[stack.back()];
+		stack.pop_back();
+		unsigned mask = regionMask(node, region);
+		for(; mask; mask &= mask-1) {
+			int slot = __builtin_ctz(mask);
+			if(node.isEmpty(slot))
+				continue;
+			if(node.isLeaf(slot)) {
+				for(uint32_t i = 0; i < node.count[slot]; ++i) {
+					uint32_t prim = primitives[node.child[slot] + i];
+					if(region.overlaps(boxes[prim]))
+						out.push_back(objects[prim]);
+				}
+			}
+			else
+				stack.push_back(node.child[slot]);
+		}
+	}
+}
+
+bool BVH::raycast(const Ray & ray, float maxT, RayHit & hit) const {
+	if(nodes.empty())
+		return false;
+
+	float best = maxT;
+	uint32_t bestObject = UINT32_MAX;
+
+#ifdef BVH_SSE
+	__m128 origin[3], invDir[3];
+	for(int axis = 0; axis < 3; ++axis) {
+		origin[axis] = _mm_set1_ps(ray.origin[axis]);
+		invDir[axis] = _mm_set1_ps(1.f / ray.direction[axis]);
+	}
+#endif
+
+	stack.clear();
+	stack.push_back(0);
+	while(!stack.empty()) {
+		const Node & node = nodes[stack.back()];
+		stack.pop_back();
+		float tEntry[4];
+#ifdef BVH_SSE
+		unsigned mask = rayMask(node, origin, invDir, best, tEntry);
+#else
+		unsigned mask = 0;
+		for(int i = 0; i < 4; ++i)
+			if(!node.isEmpty(i) && ray.intersects(childBounds(node, i), best, tEntry[i]))
+				mask |= 1u << i;
+#endif
+		// Push far children first so near ones are visited first and shrink `best` early
+		int order[4];
+		int n = 0;
+		for(; mask; mask &= mask-1) {
+			int slot = __builtin_ctz(mask);
+			if(!node.isEmpty(slot))
+				order[n++] = slot;
+		}
+		// Insertion sort of at most 4 slots, farthest first
+		for(int k = 1; k < n; ++k) {
+			int slot = order[k];
+			int j = k;
+			for(; j > 0 && tEntry[order[j-1]] < tEntry[slot]; --j)
+				order[j] = order[j-1];
+			order[j] = slot;
+		}
+
+		for(int k = 0; k < n; ++k) {
+			int slot = order[k];
+			if(tEntry[slot] > best)
+				continue;
+			if(node.isLeaf(slot)) {
+				for(uint32_t i = 0; i < node.count[slot]; ++i) {
+					uint32_t prim = primitives[node.child[slot] + i];
+					float t;
+					if(ray.intersects(boxes[prim], best, t) && t < best) {
+						best = t;
+						bestObject = objects[prim];
+					}
+				}
+			}
+			else
+				stack.push_back(node.child[slot]);
+		}
+	}
+
+	if(bestObject==UINT32_MAX)
+		return false;
+	hit.object = bestObject;
+	hit.t = best;
+	return true;
+}
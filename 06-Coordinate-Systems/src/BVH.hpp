@@ -0,0 +1,106 @@
+/*
+ * Bounding volume hierarchy for static scene content.
+ *
+ * The tree is built top-down with the surface area heuristic (binned SAH)
+ * as a binary tree and then collapsed into 4-wide nodes. A node stores the
+ * bounds of it's 4 children as structure of arrays (minX[4], minY[4], ...),
+ * so one SSE register tests all children of a node against a plane, a ray
+ * slab or a box at once. Nodes are laid out depth first, parents before
+ * children, in a single 128 byte aligned array.
+ *
+ * Objects may move a bit after the build: setBox() and then refit() updates
+ * all node bounds bottom-up without changing the topology. Objects which move
+ * a lot belong to the DynamicAABBTree instead.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "AABB.hpp"
+#include "Frustum.hpp"
+
+class BVH {
+public:
+	// Max number of objects in a leaf
+	static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+	struct alignas(128) Node {
+		float minX[4], minY[4], minZ[4];
+		float maxX[4], maxY[4], maxZ[4];
+		// Inner child: index of the child node (count == 0)
+		// Leaf child: first index into the primitive list (count > 0)
+		// Empty slot: -1 (count == 0)
+		int32_t child[4];
+		uint32_t count[4];
+
+		bool isEmpty(int i) const { return count[i]==0 && child[i] < 0; }
+		bool isLeaf(int i) const { return count[i] > 0; }
+	};
+
+	BVH() = default;
+
+	// Delete copy and assignment constructors
+	BVH(const BVH &) = delete;
+	BVH & operator=(const BVH &) = delete;
+
+	// Build over the boxes; objects[i] is the user ID reported for boxes[i]
+	void build(const std::vector<AABB> & boxes, const std::vector<uint32_t> & objects);
+
+	// Change the box of the i-th primitive (as passed to build); call refit() afterwards
+	void setBox(size_t primitive, const AABB & box) { boxes[primitive] = box; }
+
+	// Recompute node bounds bottom-up, topology stays the same
+	void refit();
+
+	// Append IDs of objects intersecting the frustum / the region
+	void queryFrustum(const Frustum & frustum, std::vector<uint32_t> & objects) const;
+	void queryRegion(const AABB & region, std::vector<uint32_t> & objects) const;
+
+	// Closest object hit by the ray within maxT; false if none
+	bool raycast(const Ray & ray, float maxT, RayHit & hit) const;
+
+	size_t getNumNodes() const { return nodes.size(); }
+	size_t getNumPrimitives() const { return boxes.size(); }
+	AABB getBounds() const;
+
+private:
+	std::vector<Node> nodes;
+	std::vector<AABB> boxes;
+	std::vector<uint32_t> objects;
+	// Primitive indices ordered so each leaf references a contiguous range
+	std::vector<uint32_t> primitives;
+
+	// Binary tree produced by the SAH build, before collapsing
+	struct BuildNode {
+		AABB bounds;
+		int32_t left = -1;
+		int32_t right = -1;
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+
+	// Primitive as seen by the build; partitioned in place so the build streams through memory
+	struct PrimRef {
+		AABB box;
+		glm::vec3 centroid;
+		uint32_t index;
+	};
+
+	// bounds/centroidBounds: of refs in [first, first+count), known by the caller
+	int32_t buildBinary(std::vector<BuildNode> & out, std::vector<PrimRef> & refs,
+											uint32_t first, uint32_t count, const AABB & bounds, const AABB & centroidBounds);
+	static void computeBounds(const std::vector<PrimRef> & refs, uint32_t first, uint32_t count,
+														AABB & bounds, AABB & centroidBounds);
+	int32_t collapse(const std::vector<BuildNode> & binary, int32_t binaryNode);
+	void setChild(Node & node, int slot, const AABB & bounds);
+	AABB childBounds(const Node & node, int slot) const;
+};
+
+#endif /* BVH_HPP */
@@ -0,0 +1,868 @@
+#include "Benchmark.hpp"
+
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include <utility>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include "SceneGraph.hpp"
+#include "ECS.hpp"
+#include "Components.hpp"
+#include "Frustum.hpp"
+#include "Culling.hpp"
+#include "SpatialIndex.hpp"
+#include "Occlusion.hpp"
+#include "LOD.hpp"
+#include "Meshlets.hpp"
+#include "GeometryPool.hpp"
+#include "StaticGeometry.hpp"
+#include "Jobs.hpp"
+#include "RenderQueue.hpp"
+#include "CommandBuffer.hpp"
+#include "Input.hpp"
+#include "DynamicResolution.hpp"
+#include "FrameGraph.hpp"
+#include "Lighting.hpp"
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsedMs(Clock::time_point since) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+	}
+
+	float randomFloat(float lo, float hi) {
+		return lo + (hi-lo) * ((float)rand() / (float)RAND_MAX);
+	}
+}
+
+void bench::run() {
+	std::cout << "----- Benchmarks -----\n";
+	sceneGraph();
+	entities();
+	culling();
+	spatialIndex();
+	occlusion();
+	levelsOfDetail();
+	meshlets();
+	geometryPool();
+	jobs();
+	drawPackets();
+	commandBuffers();
+	inputEvents();
+	dynamicResolution();
+	frameGraph();
+	lightBinning();
+	std::cout << "----------------------\n";
+}
+
+void bench::sceneGraph() {
+	const size_t numNodes = 1000000;
+	const size_t fanout = 8;
+
+	// A broad hierarchy: 1000 roots, every other node has up to `fanout` children
+	SceneGraph graph(numNodes);
+	for(size_t i = 0; i < 1000; ++i)
+		graph.createNode();
+	for(size_t i = 1000; i < numNodes; ++i)
+		graph.createNode((SceneGraph::NodeID)((i-1000) / fanout));
+	for(size_t i = 0; i < numNodes; ++i) {
+		SceneGraph::NodeID node = (SceneGraph::NodeID)i;
+		graph.setTranslation(node, glm::vec3(randomFloat(-1.f, 1.f), randomFloat(-1.f, 1.f), randomFloat(-1.f, 1.f)));
+		graph.setRotation(node, glm::angleAxis(randomFloat(0.f, 6.28f), glm::vec3(0.f, 1.f, 0.f)));
+	}
+
+	auto start = Clock::now();
+	graph.update();
+	double ms = elapsedMs(start);
+	std::cout << "SceneGraph full update: " << graph.getLastUpdateCount() << " nodes, "
+						<< ms << " ms, " << ms*1e6 / graph.getLastUpdateCount() << " ns/node\n";
+
+	// Leaves only (no subtrees), so the updated count equals the changed count
+	for(size_t changed : {100, 10000, 100000}) {
+		for(size_t i = 0; i < changed; ++i)
+			graph.setTranslation((SceneGraph::NodeID)(numNodes - 1 - i), glm::vec3(randomFloat(-1.f, 1.f)));
+		start = Clock::now();
+		graph.update();
+		ms = elapsedMs(start);
+		std::cout << "SceneGraph partial update: " << graph.getLastUpdateCount() << " nodes, "
+							<< ms << " ms, " << ms*1e6 / graph.getLastUpdateCount() << " ns/node\n";
+	}
+
+	// Unchanged graph costs nothing
+	start = Clock::now();
+	graph.update();
+	std::cout << "SceneGraph clean update: " << elapsedMs(start) << " ms\n";
+}
+
+void bench::entities() {
+	const size_t numEntities = 200000;
+
+	SceneGraph scene(numEntities);
+	ecs::World world;
+	auto start = Clock::now();
+	for(size_t i = 0; i < numEntities; ++i) {
+		SceneGraph::NodeID node = scene.createNode();
+		scene.setTranslation(node, glm::vec3(randomFloat(-100.f, 100.f), randomFloat(-100.f, 100.f), randomFloat(-100.f, 100.f)));
+		world.create(ecs::Transform{node}, ecs::MeshRef{1, 0}, ecs::MaterialRef{(u64)(i % 16)},
+								 ecs::Bounds{glm::vec3(-1.f), glm::vec3(1.f), glm::vec3(0.f), glm::vec3(0.f)});
+	}
+	double ms = elapsedMs(start);
+	std::cout << "ECS create: " << numEntities << " entities, " << ms << " ms\n";
+	scene.update();
+
+	// Sequential query touching two columns
+	start = Clock::now();
+	size_t visited = 0;
+	float checksum = 0.f;
+	world.each<ecs::MeshRef, ecs::Bounds>([&](ecs::MeshRef & mesh, ecs::Bounds & bounds) {
+		checksum += bounds.localMax.x;
+		visited += mesh.primitive + 1;
+	});
+	ms = elapsedMs(start);
+	std::cout << "ECS query: " << visited << " entities, " << ms << " ms, "
+						<< ms*1e6 / visited << " ns/entity (checksum " << checksum << ")\n";
+
+	start = Clock::now();
+	ecs::updateBounds(world, scene);
+	ms = elapsedMs(start);
+	std::cout << "ECS parallel bounds update: " << ms << " ms, " << ms*1e6 / numEntities << " ns/entity\n";
+}
+
+void bench::culling() {
+	std::cout << "Culling SIMD: " << cull::simdName() << '\n';
+
+	// Camera at the origin looking down -z into a cube of randomly placed objects
+	glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f/9.f, .1f, 500.f);
+	Frustum frustum = Frustum::fromMatrix(projection);
+
+	const size_t maxObjects = 4000000;
+	cull::AABBArray boxes;
+	cull::SphereArray spheres;
+	boxes.reserve(maxObjects);
+	spheres.reserve(maxObjects);
+	for(size_t i = 0; i < maxObjects; ++i) {
+		glm::vec3 c(randomFloat(-500.f, 500.f), randomFloat(-500.f, 500.f), randomFloat(-500.f, 500.f));
+		glm::vec3 e(randomFloat(.5f, 2.f), randomFloat(.5f, 2.f), randomFloat(.5f, 2.f));
+		boxes.push(c - e, c + e);
+		spheres.push(c, glm::length(e));
+	}
+
+	std::vector<uint32_t> visible;
+	unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	// Linear scaling with the object count (all threads)
+	for(size_t n : {250000, 1000000, 4000000}) {
+		cull::AABBArray subset;
+		for(auto [dst, src] : {std::pair{&subset.centerX, &boxes.centerX}, {&subset.centerY, &boxes.centerY},
+				{&subset.centerZ, &boxes.centerZ}, {&subset.extentX, &boxes.extentX},
+				{&subset.extentY, &boxes.extentY}, {&subset.extentZ, &boxes.extentZ}})
+			dst->assign(src->begin(), src->begin() + n);
+		cull::Stats stats = cull::frustumAABBs(frustum, subset, visible, maxThreads);
+		std::cout << "Culling AABBs, " << maxThreads << " threads: " << stats << '\n';
+	}
+
+	// Scaling with the thread count (all objects)
+	for(unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+		cull::Stats stats = cull::frustumAABBs(frustum, boxes, visible, threads);
+		std::cout << "Culling AABBs, " << threads << " threads: " << stats << '\n';
+	}
+	for(unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+		cull::Stats stats = cull::frustumSpheres(frustum, spheres, visible, threads);
+		std::cout << "Culling spheres, " << threads << " threads: " << stats << '\n';
+	}
+}
+
+void bench::spatialIndex() {
+	const size_t numStatic = 1000000;
+	const size_t numDynamic = 100000;
+
+	std::vector<AABB> boxes(numStatic);
+	std::vector<uint32_t> ids(numStatic);
+	for(size_t i = 0; i < numStatic; ++i) {
+		glm::vec3 c(randomFloat(-1000.f, 1000.f), randomFloat(-50.f, 50.f), randomFloat(-1000.f, 1000.f));
+		glm::vec3 e(randomFloat(.5f, 4.f), randomFloat(.5f, 8.f), randomFloat(.5f, 4.f));
+		boxes[i] = AABB(c - e, c + e);
+		ids[i] = (uint32_t)i;
+	}
+
+	SpatialIndex index;
+	auto start = Clock::now();
+	index.buildStatic(boxes, ids);
+	std::cout << "BVH build: " << numStatic << " objects, " << index.getStatic().getNumNodes()
+						<< " nodes, " << elapsedMs(start) << " ms\n";
+
+	for(size_t i = 0; i < numStatic; i += 100)
+		index.updateStatic(i, AABB(boxes[i].min + glm::vec3(.1f), boxes[i].max + glm::vec3(.1f)));
+	start = Clock::now();
+	index.refitStatic();
+	std::cout << "BVH refit: " << elapsedMs(start) << " ms\n";
+
+	std::vector<DynamicAABBTree::ProxyID> proxies(numDynamic);
+	std::vector<AABB> dynamicBoxes(numDynamic);
+	start = Clock::now();
+	for(size_t i = 0; i < numDynamic; ++i) {
+		glm::vec3 c(randomFloat(-1000.f, 1000.f), randomFloat(-50.f, 50.f), randomFloat(-1000.f, 1000.f));
+		dynamicBoxes[i] = AABB(c - glm::vec3(1.f), c + glm::vec3(1.f));
+		proxies[i] = index.insertDynamic((uint32_t)(numStatic + i), dynamicBoxes[i]);
+	}
+	double ms = elapsedMs(start);
+	std::cout << "Dynamic tree insert: " << numDynamic << " objects, " << ms << " ms, height "
+						<< index.getDynamic().getHeight() << '\n';
+
+	// Every dynamic object moves a bit; only those leaving their fat boxes touch the tree
+	for(int frame = 0; frame < 3; ++frame) {
+		size_t reinserted = 0;
+		start = Clock::now();
+		for(size_t i = 0; i < numDynamic; ++i) {
+			glm::vec3 d(randomFloat(-.2f, .2f), 0.f, randomFloat(-.2f, .2f));
+			dynamicBoxes[i] = AABB(dynamicBoxes[i].min + d, dynamicBoxes[i].max + d);
+			reinserted += index.moveDynamic(proxies[i], dynamicBoxes[i], d);
+		}
+		ms = elapsedMs(start);
+		std::cout << "Dynamic tree move: " << numDynamic << " moved, " << reinserted << " reinserted, "
+							<< ms << " ms, height " << index.getDynamic().getHeight() << '\n';
+	}
+
+	// Frustum query: camera above the scene looking along +x
+	glm::mat4 view = glm::lookAt(glm::vec3(-900.f, 20.f, 0.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+	Frustum frustum = Frustum::fromMatrix(glm::perspective(glm::radians(60.f), 16.f/9.f, .1f, 600.f) * view);
+	std::vector<uint32_t> found;
+	start = Clock::now();
+	index.queryFrustum(frustum, found);
+	std::cout << "Spatial index frustum query: " << found.size() << " visible, " << elapsedMs(start) << " ms\n";
+
+	const size_t numRays = 10000;
+	size_t hits = 0;
+	start = Clock::now();
+	for(size_t i = 0; i < numRays; ++i) {
+		Ray ray{glm::vec3(randomFloat(-1000.f, 1000.f), 100.f, randomFloat(-1000.f, 1000.f)),
+			glm::normalize(glm::vec3(randomFloat(-1.f, 1.f), -1.f, randomFloat(-1.f, 1.f)))};
+		RayHit hit;
+		hits += index.raycast(ray, 1000.f, hit);
+	}
+	ms = elapsedMs(start);
+	std::cout << "Spatial index ray casts: " << numRays << " rays, " << hits << " hits, "
+						<< ms*1e3 / numRays << " us/ray\n";
+
+	const size_t numRegions = 10000;
+	found.clear();
+	start = Clock::now();
+	for(size_t i = 0; i < numRegions; ++i) {
+		glm::vec3 c(randomFloat(-1000.f, 1000.f), 0.f, randomFloat(-1000.f, 1000.f));
+		index.queryRegion(AABB(c - glm::vec3(10.f), c + glm::vec3(10.f)), found);
+	}
+	ms = elapsedMs(start);
+	std::cout << "Spatial index region queries: " << numRegions << " queries, " << found.size() << " found, "
+						<< ms*1e3 / numRegions << " us/query\n";
+}
+
+void bench::occlusion() {
+	// Unit cube, 12 triangles
+	cull::OccluderMesh cube;
+	for(int i = 0; i < 8; ++i)
+		cube.vertices.push_back(glm::vec3((i & 1) ? .5f : -.5f, (i & 2) ? .5f : -.5f, (i & 4) ? .5f : -.5f));
+	cube.indices = {
+		0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+		0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+		0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5,
+	};
+
+	// City blocks: 40x40 buildings on a 20 unit grid with 8 unit wide streets
+	std::vector<glm::mat4> buildings;
+	for(int x = -20; x < 20; ++x)
+		for(int z = -20; z < 20; ++z) {
+			float h = randomFloat(10.f, 60.f);
+			glm::mat4 m = glm::translate(glm::mat4(1.f), glm::vec3(x*20.f + 10.f, h*.5f, z*20.f + 10.f));
+			buildings.push_back(glm::scale(m, glm::vec3(12.f, h, 12.f)));
+		}
+
+	// Small objects along the streets and on the roofs
+	const size_t numObjects = 200000;
+	cull::AABBArray boxes;
+	boxes.reserve(numObjects);
+	for(size_t i = 0; i < numObjects; ++i) {
+		glm::vec3 c(randomFloat(-400.f, 400.f), randomFloat(0.f, 20.f), randomFloat(-400.f, 400.f));
+		boxes.push(c - glm::vec3(.5f), c + glm::vec3(.5f));
+	}
+
+	// Pedestrian camera in a street looking along -z
+	glm::mat4 view = glm::lookAt(glm::vec3(0.f, 2.f, 300.f), glm::vec3(0.f, 2.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+	glm::mat4 viewProjection = glm::perspective(glm::radians(60.f), 2.f, .1f, 1000.f) * view;
+	Frustum frustum = Frustum::fromMatrix(viewProjection);
+
+	std::vector<uint32_t> frustumVisible;
+	cull::frustumAABBs(frustum, boxes, frustumVisible);
+
+	cull::OcclusionBuffer buffer;
+	std::vector<uint32_t> visible;
+	unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for(unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+		buffer.begin(viewProjection);
+		for(const glm::mat4 & m : buildings)
+			buffer.addOccluder(cube, m);
+		buffer.rasterize(threads);
+		visible = frustumVisible;
+		buffer.test(boxes, visible, threads);
+		std::cout << "Occlusion " << buffer.getWidth() << 'x' << buffer.getHeight() << ", "
+							<< threads << " threads: " << buffer.getStats() << ", ms:" << buffer.getStats().ms() << '\n';
+	}
+}
+
+void bench::levelsOfDetail() {
+	// UV sphere of radius 1 with a texture coordinate seam and 160k triangles
+	const int rings = 200, segments = 400;
+	std::vector<glm::vec3> positions;
+	std::vector<float> texCoords;
+	std::vector<uint32_t> indices;
+	for(int r = 0; r <= rings; ++r)
+		for(int s = 0; s <= segments; ++s) {
+			float theta = 3.14159265f * r / rings, phi = 6.2831853f * s / segments;
+			positions.push_back(glm::vec3(sinf(theta)*cosf(phi), cosf(theta), sinf(theta)*sinf(phi)));
+			texCoords.push_back((float)s / segments);
+			texCoords.push_back((float)r / rings);
+		}
+	for(int r = 0; r < rings; ++r)
+		for(int s = 0; s < segments; ++s) {
+			uint32_t a = r*(segments+1) + s, b = a + segments+1;
+			indices.insert(indices.end(), {a, b, a+1, a+1, b, b+1});
+		}
+
+	lod::Geometry geometry;
+	geometry.positions = positions.data();
+	geometry.numVertices = positions.size();
+	geometry.attributes = texCoords.data();
+	geometry.attributeCount = 2;
+	auto start = Clock::now();
+	std::vector<lod::Level> chain = lod::buildChain(geometry, indices, 6);
+	std::cout << "LOD chain: " << chain.size() << " levels in " << elapsedMs(start) << " ms\n";
+
+	std::vector<Mesh::LOD> levels;
+	for(const lod::Level & level : chain) {
+		// Largest distance of a triangle's center from the sphere surface
+		float deviation = 0.f;
+		for(size_t i = 0; i < level.indices.size(); i += 3) {
+			glm::vec3 c = (positions[level.indices[i]] + positions[level.indices[i+1]] + positions[level.indices[i+2]]) / 3.f;
+			deviation = std::max(deviation, 1.f - glm::length(c));
+		}
+		std::cout << "LOD level " << levels.size() << ": " << level.indices.size()/3 << " triangles, error "
+							<< level.error << ", measured deviation " << deviation << '\n';
+		levels.push_back(Mesh::LOD{(GLsizei)level.indices.size(), 0, level.error});
+	}
+
+	// Spheres scattered up to 1000 units away
+	const size_t numObjects = 200000;
+	SceneGraph scene(numObjects);
+	ecs::World world;
+	for(size_t i = 0; i < numObjects; ++i) {
+		SceneGraph::NodeID node = scene.createNode();
+		glm::vec3 p(randomFloat(-1000.f, 1000.f), randomFloat(-10.f, 10.f), randomFloat(-1000.f, 1000.f));
+		scene.setTranslation(node, p);
+		world.create(ecs::Transform{node}, ecs::MeshRef{0, 0}, ecs::Bounds{glm::vec3(-1.f), glm::vec3(1.f), p - 1.f, p + 1.f},
+								 ecs::LODRanges{levels.data(), (uint32_t)levels.size()});
+	}
+	scene.update();
+
+	lod::Settings settings;
+	settings.pixelsPerUnit = 1080.f / (2.f * tanf(glm::radians(30.f)));
+	for(int frame = 0; frame < 3; ++frame) {
+		// The camera creeps forward; hysteresis keeps most objects where they were
+		settings.cameraPosition = glm::vec3(0.f, 0.f, -frame * .5f);
+		std::vector<uint32_t> previous;
+		world.each<ecs::MeshRef>([&](ecs::MeshRef & m) { previous.push_back(m.lod); });
+
+		start = Clock::now();
+		ecs::selectLODs(world, scene, settings);
+		double ms = elapsedMs(start);
+
+		size_t triangles = 0, changed = 0, i = 0;
+		std::vector<size_t> histogram(levels.size(), 0);
+		world.each<ecs::MeshRef>([&](ecs::MeshRef & m) {
+			triangles += levels[m.lod].count / 3;
+			++histogram[m.lod];
+			changed += m.lod!=previous[i++];
+		});
+		std::cout << "LOD selection: " << numObjects << " objects, " << ms << " ms, "
+							<< ms*1e6 / numObjects << " ns/object, " << changed << " switched, "
+							<< triangles << " triangles (" << numObjects * (indices.size()/3) << " at full detail), levels:";
+		for(size_t count : histogram)
+			std::cout << ' ' << count;
+		std::cout << '\n';
+	}
+}
+
+void bench::meshlets() {
+	// Bumpy sphere of radius 1 with 1M triangles, like a scanned or tessellated CAD part
+	const int rings = 500, segments = 1000;
+	std::vector<glm::vec3> positions;
+	std::vector<uint32_t> indices;
+	for(int r = 0; r <= rings; ++r)
+		for(int s = 0; s <= segments; ++s) {
+			float theta = 3.14159265f * r / rings, phi = 6.2831853f * s / segments;
+			float bump = 1.f + .02f * sinf(theta * 40.f) * sinf(phi * 40.f);
+			positions.push_back(bump * glm::vec3(sinf(theta)*cosf(phi), cosf(theta), sinf(theta)*sinf(phi)));
+		}
+	for(int r = 0; r < rings; ++r)
+		for(int s = 0; s < segments; ++s) {
+			uint32_t a = r*(segments+1) + s, b = a + segments+1;
+			indices.insert(indices.end(), {a, a+1, b, a+1, b+1, b});
+		}
+
+	auto start = Clock::now();
+	meshlet::Set set = meshlet::build(positions.data(), positions.size(), indices);
+	std::cout << "Meshlets build: " << indices.size()/3 << " triangles, " << set.size() << " meshlets, "
+						<< (double)set.numTriangles() / set.size() << " triangles/meshlet, " << elapsedMs(start) << " ms\n";
+
+	// Close up from the side: half the clusters face away, most are off screen
+	glm::vec3 camera(0.f, 0.f, 2.f);
+	glm::mat4 viewProjection = glm::perspective(glm::radians(45.f), 16.f/9.f, .1f, 100.f)
+		* glm::lookAt(camera, glm::vec3(.5f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+	Frustum frustum = Frustum::fromMatrix(viewProjection);
+
+	std::vector<uint32_t> visible, streamed;
+	unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for(unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+		cull::Stats stats = meshlet::cull(set, frustum, camera, visible, threads);
+		std::cout << "Meshlets culling, " << threads << " threads: " << stats << '\n';
+	}
+	start = Clock::now();
+	streamed.clear();
+	size_t count = meshlet::writeIndices(set, visible, streamed);
+	std::cout << "Meshlets index compaction: " << count/3 << " of " << indices.size()/3 << " triangles, "
+						<< elapsedMs(start) << " ms\n";
+}
+
+void bench::geometryPool() {
+	// Streaming-like churn: meshes of random size come and go in a 4M element range
+	GeometryPool::RangeAllocator allocator(1u << 22);
+	std::vector<std::pair<uint32_t, uint32_t>> live;
+	const size_t numOps = 1000000;
+	size_t failed = 0;
+	auto start = Clock::now();
+	for(size_t op = 0; op < numOps; ++op) {
+		if(!live.empty() && (live.size() > 2000 || rand() % 2)) {
+			size_t k = rand() % live.size();
+			allocator.release(live[k].first, live[k].second);
+			live[k] = live.back();
+			live.pop_back();
+		}
+		else {
+			uint32_t size = 32 + rand() % 4096, first;
+			if(allocator.allocate(size, first))
+				live.emplace_back(first, size);
+			else
+				++failed;
+		}
+	}
+	double ms = elapsedMs(start);
+	uint32_t largest = 0;
+	for(const auto & [first, size] : allocator.free)
+		largest = std::max(largest, size);
+	std::cout << "Geometry pool allocator: " << numOps << " allocations/frees, " << ms*1e6 / numOps << " ns/op, "
+						<< failed << " failed, " << allocator.free.size() << " free ranges, largest " << largest << '\n';
+
+	// Static scenery: 100x100 objects of 16 materials, laid out per material as StaticGeometry::build() does
+	const int side = 100, numMaterials = 16;
+	std::vector<StaticGeometry::Range> ranges;
+	cull::AABBArray bounds;
+	std::vector<uint32_t> batchEnd;
+	uint32_t firstIndex = 0;
+	for(int m = 0; m < numMaterials; ++m) {
+		for(int i = m; i < side*side; i += numMaterials) {
+			glm::vec3 center((float)(i % side) - side*.5f, 0.f, -(float)(i / side));
+			bounds.push(center - glm::vec3(.4f), center + glm::vec3(.4f));
+			uint32_t count = 3 * (64 + rand() % 512);
+			ranges.push_back(StaticGeometry::Range{firstIndex, count});
+			firstIndex += count;
+		}
+		batchEnd.push_back((uint32_t)ranges.size());
+	}
+
+	glm::mat4 viewProjection = glm::perspective(glm::radians(60.f), 16.f/9.f, .1f, 60.f)
+		* glm::lookAt(glm::vec3(0.f, 5.f, 5.f), glm::vec3(10.f, 0.f, -20.f), glm::vec3(0.f, 1.f, 0.f));
+	std::vector<uint32_t> visible, listed;
+	std::vector<GLsizei> counts;
+	std::vector<const void *> offsets;
+	const int frames = 100;
+	size_t drawCalls = 0, numRanges = 0;
+	cull::Stats cullStats;
+	start = Clock::now();
+	for(int f = 0; f < frames; ++f) {
+		cullStats = cull::frustumAABBs(Frustum::fromMatrix(viewProjection), bounds, visible);
+		drawCalls = numRanges = 0;
+		size_t v = 0;
+		for(uint32_t end : batchEnd) {
+			listed.clear();
+			for(; v < visible.size() && visible[v] < end; ++v)
+				listed.push_back(visible[v]);
+			if(listed.empty())
+				continue;
+			counts.clear();
+			offsets.clear();
+			numRanges += StaticGeometry::gatherRanges(ranges.data(), listed.data(), listed.size(), counts, offsets);
+			++drawCalls;
+		}
+	}
+	std::cout << "Static geometry: " << ranges.size() << " objects, " << cullStats.visible << " visible -> "
+						<< drawCalls << " multi-draw calls over " << numRanges << " merged ranges (instead of "
+						<< cullStats.visible << " draw calls), " << elapsedMs(start) / frames << " ms/frame\n";
+}
+
+void bench::jobs() {
+	std::cout << "Jobs: " << std::max(1u, std::thread::hardware_concurrency()) << " hardware threads\n";
+
+	// Work for the systems: a compute kernel, culling and world bounds of entities
+	const size_t numValues = 4000000;
+	std::vector<float> values(numValues);
+	for(size_t i = 0; i < numValues; ++i)
+		values[i] = randomFloat(0.f, 100.f);
+
+	glm::mat4 projection = glm::perspective(glm::radians(60.f), 16.f/9.f, .1f, 500.f);
+	Frustum frustum = Frustum::fromMatrix(projection);
+	const size_t numBoxes = 2000000;
+	cull::AABBArray boxes;
+	boxes.reserve(numBoxes);
+	for(size_t i = 0; i < numBoxes; ++i) {
+		glm::vec3 c(randomFloat(-500.f, 500.f), randomFloat(-500.f, 500.f), randomFloat(-500.f, 500.f));
+		boxes.push(c - glm::vec3(1.f), c + glm::vec3(1.f));
+	}
+	std::vector<uint32_t> visible;
+
+	const size_t numEntities = 200000;
+	SceneGraph scene(numEntities);
+	ecs::World world;
+	for(size_t i = 0; i < numEntities; ++i) {
+		SceneGraph::NodeID node = scene.createNode();
+		scene.setTranslation(node, glm::vec3(randomFloat(-100.f, 100.f), randomFloat(-100.f, 100.f), randomFloat(-100.f, 100.f)));
+		world.create(ecs::Transform{node}, ecs::Bounds{glm::vec3(-1.f), glm::vec3(1.f), glm::vec3(0.f), glm::vec3(0.f)});
+	}
+	scene.update();
+
+	double baseKernelMs = 0.;
+	for(unsigned threads = 1; threads <= 32; threads *= 2) {
+		job::setThreads(threads);
+		job::Scheduler & pool = job::global();
+
+		// Overhead: a million empty pieces, every one a job of it's own
+		const size_t numJobs = 1000000;
+		std::atomic<size_t> done(0);
+		pool.resetStats();
+		auto start = Clock::now();
+		job::parallelFor(0, numJobs, 1, [&](size_t first, size_t last) {
+			done.fetch_add(last - first, std::memory_order_relaxed);
+		});
+		double overheadMs = elapsedMs(start);
+		job::Scheduler::Stats stats = pool.getStats();
+
+		// Compute bound kernel, automatic grain
+		start = Clock::now();
+		job::parallelFor(0, numValues, 0, [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i)
+				values[i] = std::sqrt(values[i] * values[i] + 1.f) * .5f + std::sin(values[i]) * .25f;
+		});
+		double kernelMs = elapsedMs(start);
+		if(threads==1)
+			baseKernelMs = kernelMs;
+
+		cull::Stats cullStats = cull::frustumAABBs(frustum, boxes, visible, threads);
+
+		start = Clock::now();
+		ecs::updateBounds(world, scene);
+		double boundsMs = elapsedMs(start);
+
+		// A pool of one runs the pieces inline, without jobs
+		std::cout << "Jobs, " << threads << " threads: " << overheadMs*1e6 / numJobs << " ns/piece ("
+							<< stats.jobs << " jobs, " << stats.steals << " steals, " << done.load() << " items), kernel "
+							<< kernelMs << " ms (x" << baseKernelMs / kernelMs << "), culling " << cullStats.ms
+							<< " ms, bounds " << boundsMs << " ms\n";
+	}
+	job::setThreads(0);
+}
+
+void bench::drawPackets() {
+	const size_t numObjects = 100000;
+
+	// Objects all around the camera, 64 materials over 8 shaders, 32 meshes of 4 primitives, 4 levels
+	SceneGraph scene(numObjects);
+	ecs::World world;
+	for(size_t i = 0; i < numObjects; ++i) {
+		SceneGraph::NodeID node = scene.createNode();
+		scene.setTranslation(node, glm::vec3(randomFloat(-200.f, 200.f), randomFloat(-20.f, 20.f), randomFloat(-200.f, 200.f)));
+		u64 material = 1 + rand() % 64;
+		uint64_t sortKey = ((material % 8) << 48) | ((material * 2654435761u & 0xFFFFFF) << 24) | material;
+		world.create(ecs::Transform{node}, ecs::MeshRef{(u64)(100 + rand() % 32), (uint32_t)(rand() % 4), (uint32_t)(rand() % 4)},
+								 ecs::MaterialRef{material, sortKey}, ecs::Bounds{glm::vec3(-1.f), glm::vec3(1.f), glm::vec3(0.f), glm::vec3(0.f)});
+	}
+	scene.update();
+	ecs::updateBounds(world, scene);
+	// Wide enough to keep most objects
+	Frustum frustum = Frustum::fromMatrix(glm::perspective(glm::radians(150.f), 16.f/9.f, .1f, 500.f));
+
+	std::vector<RenderQueue::Item> reference;
+	const int frames = 20;
+	for(unsigned threads = 1; threads <= 16; threads *= 2) {
+		job::setThreads(threads);
+		RenderQueue queue;
+		RenderQueue::BuildStats sum;
+		for(int f = 0; f < frames; ++f) {
+			queue.build(world, frustum, threads);
+			const RenderQueue::BuildStats & s = queue.getBuildStats();
+			sum.gatherMs += s.gatherMs / frames;
+			sum.cullMs += s.cullMs / frames;
+			sum.recordMs += s.recordMs / frames;
+			sum.sortMs += s.sortMs / frames;
+			sum.ms += s.ms / frames;
+		}
+		sum.candidates = queue.getBuildStats().candidates;
+		sum.packets = queue.getBuildStats().packets;
+
+		// The draw order must not depend on the thread count
+		const std::vector<RenderQueue::Item> & items = queue.getItems();
+		if(threads==1)
+			reference = items;
+		bool same = items.size()==reference.size();
+		for(size_t i = 0; same && i < items.size(); ++i)
+			same = items[i].node==reference[i].node && items[i].material==reference[i].material;
+		std::cout << "Draw packets, " << threads << " threads: " << sum << (same ? " same order" : " ORDER DIFFERS") << '\n';
+	}
+	job::setThreads(0);
+
+	// The sort alone against std::sort on the same keys
+	std::vector<RenderQueue::Packet> packets(numObjects), scratch;
+	for(size_t i = 0; i < numObjects; ++i)
+		packets[i] = RenderQueue::Packet{((uint64_t)rand() << 32) | (uint64_t)rand(), (uint32_t)i};
+	std::vector<RenderQueue::Packet> copy = packets;
+	auto start = Clock::now();
+	RenderQueue::sortPackets(copy, scratch);
+	double radixMs = elapsedMs(start);
+	start = Clock::now();
+	std::stable_sort(packets.begin(), packets.end(), [](const RenderQueue::Packet & a, const RenderQueue::Packet & b) {
+		return a.key < b.key;
+	});
+	double stdMs = elapsedMs(start);
+	bool sorted = true;
+	for(size_t i = 0; sorted && i < numObjects; ++i)
+		sorted = copy[i].index==packets[i].index;
+	std::cout << "Packet sort: " << numObjects << " packets, radix " << radixMs << " ms, std::stable_sort " << stdMs
+						<< " ms" << (sorted ? "" : " MISMATCH") << '\n';
+}
+
+void bench::commandBuffers() {
+	// A frame like the demo's: a few thousand small commands and a snapshot of a 100k item draw list
+	const size_t numCommands = 4000;
+	const size_t numItems = 100000;
+	const int numFrames = 50;
+	std::vector<RenderQueue::Item> items(numItems);
+	std::vector<glm::mat4> models(numItems);
+	for(size_t i = 0; i < numItems; ++i) {
+		items[i] = RenderQueue::Item{i, i % 64, i % 256, 0, 0, (SceneGraph::NodeID)i};
+		models[i] = glm::translate(glm::mat4(1.f), glm::vec3(randomFloat(-100.f, 100.f)));
+	}
+
+	CommandBuffer commands;
+	float sum = 0.f;
+	float * out = &sum;
+	double recordMs = 0., executeMs = 0.;
+	size_t bytes = 0;
+	for(int frame = 0; frame < numFrames; ++frame) {
+		auto start = Clock::now();
+		for(size_t i = 0; i < numCommands; ++i) {
+			glm::mat4 transform = models[i];
+			commands.record([=]() { *out += transform[3][0]; });
+		}
+		RenderQueue::Item * drawItems = commands.allocate<RenderQueue::Item>(numItems);
+		glm::mat4 * drawModels = commands.allocate<glm::mat4>(numItems);
+		std::copy(items.begin(), items.end(), drawItems);
+		std::copy(models.begin(), models.end(), drawModels);
+		size_t count = numItems;
+		commands.record([=]() {
+			for(size_t i = 0; i < count; ++i)
+				*out += drawModels[i][3][1] + (float)drawItems[i].mesh;
+		});
+		recordMs += elapsedMs(start);
+		bytes = commands.getBytes();
+
+		start = Clock::now();
+		commands.execute();
+		executeMs += elapsedMs(start);
+		commands.reset();
+	}
+	std::cout << "CommandBuffer: " << numCommands + 1 << " commands + " << numItems << " item snapshot, "
+						<< bytes / 1024 << " KiB/frame, record " << recordMs / numFrames << " ms, execute "
+						<< executeMs / numFrames << " ms (" << (sum!=0.f) << ")\n";
+}
+
+void bench::inputEvents() {
+	// Producers push as fast as they can while one consumer drains, like a frame draining GLFW events
+	const size_t numEvents = 2000000;
+	for(unsigned producers : {1u, 2u, 4u}) {
+		input::EventQueue queue;
+		std::vector<std::thread> threads;
+		auto start = Clock::now();
+		for(unsigned p = 0; p < producers; ++p)
+			threads.emplace_back([&, p]() {
+				for(size_t i = 0; i < numEvents / producers; ++i) {
+					input::Event event{input::EventType::CursorPos, (int32_t)p, 0, 0, (double)i, 0., 0.};
+					while(!queue.push(event))
+						std::this_thread::yield();
+				}
+			});
+
+		// Events of every producer must come out in the order it pushed them
+		std::vector<input::Event> events;
+		std::vector<double> last(producers, -1.);
+		size_t received = 0;
+		bool ordered = true;
+		while(received < numEvents / producers * producers) {
+			events.clear();
+			if(!queue.drain(events))
+				std::this_thread::yield();
+			for(const input::Event & event : events) {
+				ordered = ordered && event.x > last[event.code];
+				last[event.code] = event.x;
+			}
+			received += events.size();
+		}
+		for(auto & thread : threads)
+			thread.join();
+		double ms = elapsedMs(start);
+		std::cout << "EventQueue: " << producers << " producers, " << received << " events, " << ms << " ms, "
+							<< ms*1e6 / received << " ns/event, dropped (retried): " << queue.getDropped()
+							<< (ordered ? "" : ", OUT OF ORDER") << '\n';
+	}
+}
+
+void bench::dynamicResolution() {
+	// GPU time of a frame: a part independent of the resolution and one of the pixel count, +-5% noise.
+	// The load jumps from light to heavy and back; results reach the controller two frames late, like
+	// timer queries do
+	const size_t framesPerPhase = 300, delay = 2;
+	const double fixedMs = 1.5, pixelMs[] = {8., 24., 8.};
+	for(float hysteresis : {0.f, .1f}) {
+		DynamicResolution::Settings settings;
+		settings.hysteresis = hysteresis;
+		DynamicResolution::Controller controller(settings);
+		// GPU time and scale of the frames whose results didn't arrive yet
+		std::vector<std::pair<double, float>> inFlight;
+		srand(7);
+		std::cout << "DynamicResolution: target " << settings.targetMs << " ms, hysteresis " << hysteresis;
+		for(double phaseMs : pixelMs) {
+			size_t settled = 0, changes = 0, over = 0;
+			double sumMs = 0.;
+			for(size_t frame = 0; frame < framesPerPhase; ++frame) {
+				float scale = controller.getScale();
+				double gpuMs = (fixedMs + phaseMs * scale * scale) * randomFloat(.95f, 1.05f);
+				inFlight.push_back({gpuMs, scale});
+				size_t before = controller.getChanges();
+				if(inFlight.size() > delay) {
+					controller.update(inFlight.front().first, inFlight.front().second);
+					inFlight.erase(inFlight.begin());
+				}
+				// Settled with the last change of the first half; the second half shows how steady it stays
+				bool changed = controller.getChanges()!=before;
+				if(frame < framesPerPhase / 2) {
+					if(changed)
+						settled = frame + 1;
+				}
+				else {
+					changes += changed;
+					sumMs += gpuMs;
+					over += gpuMs > settings.targetMs * (1. + settings.hysteresis);
+				}
+			}
+			std::cout << " | load " << phaseMs << " ms: scale " << controller.getScale() << ", settled in " << settled
+								<< " frames, steady " << sumMs / (framesPerPhase / 2) << " ms, " << changes << " changes, "
+								<< over << " frames over";
+		}
+		std::cout << '\n';
+	}
+}
+
+void bench::frameGraph() {
+	// G-buffer, SSAO, lighting, a 4 level bloom chain, tone mapping and FXAA; plus two debug passes whose
+	// output nobody reads, culled
+	auto declare = [](FrameGraph & graph) {
+		auto none = [](CommandBuffer &) {};
+		graph.reset();
+		FrameGraph::TextureID albedo = graph.create("albedo", RenderTargetDesc{1.f, 0, 0, GL_RGBA8});
+		FrameGraph::TextureID normal = graph.create("normal", RenderTargetDesc{1.f, 0, 0, GL_RGBA16F});
+		FrameGraph::TextureID depth = graph.create("depth", RenderTargetDesc{1.f, 0, 0, GL_DEPTH24_STENCIL8});
+		FrameGraph::TextureID ao = graph.create("ao", RenderTargetDesc{.5f, 0, 0, GL_RGBA8});
+		FrameGraph::TextureID aoBlurred = graph.create("ao blurred", RenderTargetDesc{.5f, 0, 0, GL_RGBA8});
+		FrameGraph::TextureID hdr = graph.create("hdr", RenderTargetDesc{1.f, 0, 0, GL_RGBA16F});
+		graph.addPass("gbuffer", {}, {albedo, normal, depth}, none);
+		graph.addPass("ssao", {normal, depth}, {ao}, none);
+		graph.addPass("ssao blur", {ao}, {aoBlurred}, none);
+		graph.addPass("lighting", {albedo, normal, depth, aoBlurred}, {hdr}, none);
+		FrameGraph::TextureID down[4], up[4];
+		FrameGraph::TextureID source = hdr;
+		for(int i = 0; i < 4; ++i) {
+			down[i] = graph.create("bloom down", RenderTargetDesc{1.f / (2 << i), 0, 0, GL_RGBA16F});
+			graph.addPass("bloom down", {source}, {down[i]}, none);
+			source = down[i];
+		}
+		for(int i = 2; i >= 0; --i) {
+			up[i] = graph.create("bloom up", RenderTargetDesc{1.f / (2 << i), 0, 0, GL_RGBA16F});
+			graph.addPass("bloom up", {source, down[i]}, {up[i]}, none);
+			source = up[i];
+		}
+		FrameGraph::TextureID ldr = graph.create("ldr", RenderTargetDesc{1.f, 0, 0, GL_RGBA8});
+		graph.addPass("tone map", {hdr, source}, {ldr}, none);
+		graph.addPass("fxaa", {ldr}, {FrameGraph::Backbuffer}, none);
+		FrameGraph::TextureID debug = graph.create("debug", RenderTargetDesc{1.f, 0, 0, GL_RGBA8});
+		FrameGraph::TextureID debugView = graph.create("debug view", RenderTargetDesc{1.f, 0, 0, GL_RGBA8});
+		graph.addPass("debug", {normal}, {debug}, none);
+		graph.addPass("debug view", {debug}, {debugView}, none);
+	};
+
+	FrameGraph graph;
+	const int frames = 10000;
+	auto start = Clock::now();
+	for(int i = 0; i < frames; ++i) {
+		declare(graph);
+		graph.compile(1920, 1080);
+	}
+	double ms = elapsedMs(start);
+	std::cout << "FrameGraph: declare+compile " << ms*1e3 / frames << " us/frame, " << graph.getStats()
+						<< ", debug culled: " << (graph.isCulled("debug") && graph.isCulled("debug view") ? "yes" : "NO") << '\n';
+}
+
+void bench::lightBinning() {
+	// Camera at the origin looking down -z at lights spread over the view's depth, 16x9x24 clusters
+	const float fovY = glm::radians(45.f), aspect = 16.f/9.f, zNear = .1f, zFar = 100.f;
+	std::vector<light::Light> lights;
+	for(size_t i = 0; i < 16384; ++i) {
+		glm::vec3 p(randomFloat(-40.f, 40.f), randomFloat(-25.f, 25.f), randomFloat(-100.f, 5.f));
+		lights.push_back(light::point(p, randomFloat(1.f, 4.f), glm::vec3(1.f)));
+	}
+	light::ClusterGrid grid(light::Settings{});
+	unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	const int builds = 50;
+
+	auto measure = [&](const std::vector<light::Light> & subset, unsigned threads) {
+		grid.build(subset, glm::mat4(1.f), fovY, aspect, zNear, zFar, threads);
+		auto start = Clock::now();
+		for(int i = 0; i < builds; ++i)
+			grid.build(subset, glm::mat4(1.f), fovY, aspect, zNear, zFar, threads);
+		return elapsedMs(start) / builds;
+	};
+
+	// Scaling with the light count (all threads)
+	for(size_t n : {64, 256, 1024, 4096, 16384}) {
+		std::vector<light::Light> subset(lights.begin(), lights.begin() + n);
+		double ms = measure(subset, maxThreads);
+		std::cout << "Light binning, " << n << " lights, " << maxThreads << " threads: " << ms << " ms, " << grid.getStats() << '\n';
+	}
+	// Scaling with the thread count (4096 lights)
+	std::vector<light::Light> subset(lights.begin(), lights.begin() + 4096);
+	for(unsigned threads = 1; threads <= maxThreads; threads *= 2)
+		std::cout << "Light binning, 4096 lights, " << threads << " threads: " << measure(subset, threads) << " ms\n";
+}
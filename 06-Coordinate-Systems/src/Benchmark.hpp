@@ -0,0 +1,62 @@
+/*
+ * Headless benchmarks of the CPU side systems (run with `./app --bench`).
+ * They don't need a window nor an OpenGL context; results are printed to stdout.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+namespace bench {
+	// Run all benchmarks
+	void run();
+
+	// Scene graph: full and partial (dirty subtree) world matrix updates
+	void sceneGraph();
+
+	// ECS: creation and (parallel) iteration over renderable entities
+	void entities();
+
+	// Frustum culling of SoA bounding volumes: scaling with object and thread count
+	void culling();
+
+	// Spatial index: BVH build/refit/queries and dynamic tree updates
+	void spatialIndex();
+
+	// Software occlusion culling: occluder rasterization and box tests in a city-like scene
+	void occlusion();
+
+	// Levels of detail: simplifier speed and quality, per object selection and triangle counts
+	void levelsOfDetail();
+
+	// Meshlets: splitting a big mesh, cluster culling over threads and index compaction
+	void meshlets();
+
+	// Geometry pool: range allocator churn and draw range merging of static objects
+	void geometryPool();
+
+	// Job system: per-job overhead and scaling of parallel systems from 1 to 32 pool threads
+	void jobs();
+
+	// Draw packets: parallel recording and radix sort of a 100k object render queue over thread counts
+	void drawPackets();
+
+	// Command buffers: recording and replaying frames of small commands and a draw list snapshot
+	void commandBuffers();
+
+	// Input events: lock-free queue throughput with one and several producer threads
+	void inputEvents();
+
+	// Dynamic resolution: the scale controller against a simulated GPU, settling and oscillation
+	void dynamicResolution();
+
+	// Frame graph: declaring and compiling a deferred pipeline with bloom, culling and aliasing savings
+	void frameGraph();
+
+	// Clustered lighting: binning lights into the clusters of a view over light and thread counts
+	void lightBinning();
+}
+
+#endif /* BENCHMARK_HPP */
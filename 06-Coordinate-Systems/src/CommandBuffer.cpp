@@ -0,0 +1,35 @@
+#include "CommandBuffer.hpp"
+
+#include <algorithm>
+
+void CommandBuffer::execute() const {
+	for(const Command & command : commands)
+		command.function(command.data);
+}
+
+void CommandBuffer::reset() {
+	commands.clear();
+	currentBlock = 0;
+	used = 0;
+	bytes = 0;
+}
+
+void * CommandBuffer::allocate(size_t size, size_t alignment) {
+	bytes += size;
+	// First block (from the current one on) with room for it; blocks are only added, never moved
+	for(; currentBlock < blocks.size(); ++currentBlock, used = 0) {
+		Block & block = blocks[currentBlock];
+		uintptr_t base = (uintptr_t)block.memory.get();
+		uintptr_t aligned = (base + used + alignment - 1) & ~(uintptr_t)(alignment - 1);
+		if(aligned + size <= base + block.size) {
+			used = aligned - base + size;
+			return (void *)aligned;
+		}
+	}
+	size_t blockSize = std::max(BlockSize, size + alignment);
+	blocks.push_back(Block{std::make_unique<unsigned char[]>(blockSize), blockSize});
+	uintptr_t base = (uintptr_t)blocks.back().memory.get();
+	uintptr_t aligned = (base + alignment - 1) & ~(uintptr_t)(alignment - 1);
+	used = aligned - base + size;
+	return (void *)aligned;
+}
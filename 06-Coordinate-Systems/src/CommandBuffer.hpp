@@ -0,0 +1,89 @@
+/*
+ * Recorded frame of render commands, executed later (possibly on another
+ * thread).
+ *
+ * A command is a trivially copyable callable (a lambda capturing by value,
+ * or a struct with operator()) copied into the buffer's memory together
+ * with a function pointer that calls it. Commands capture what they draw
+ * with: pointers to long lived objects (resources, shaders, systems) and
+ * copies of everything the simulation may change while the frame waits to
+ * be executed (matrices, sizes, draw lists). Bigger data, like a snapshot
+ * of a draw list, is copied into arrays allocated from the same memory.
+ *
+ * Memory comes from blocks that are never moved or freed by reset(), so
+ * pointers into a recorded frame stay valid until it's reset, and after the
+ * first few frames recording doesn't allocate.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef COMMAND_BUFFER_HPP
+#define COMMAND_BUFFER_HPP
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+class CommandBuffer {
+public:
+	typedef void (*Function)(const void * data);
+
+	CommandBuffer() = default;
+
+	// Delete copy and assignment constructors
+	CommandBuffer(const CommandBuffer &) = delete;
+	CommandBuffer & operator=(const CommandBuffer &) = delete;
+
+	// Append a copy of f, called by execute()
+	template<typename F>
+	void record(const F & f) {
+		static_assert(std::is_trivially_copyable<F>::value,
+									"Commands must be trivially copyable (capture by value, pointers to long lived objects)");
+		void * data = allocate(sizeof(F), alignof(F));
+		new(data) F(f);
+		commands.push_back(Command{[](const void * data) { (*static_cast<const F *>(data))(); }, data});
+	}
+
+	// Uninitialized array of count Ts living until reset(), for data referenced by commands
+	template<typename T>
+	T * allocate(size_t count) {
+		static_assert(std::is_trivially_copyable<T>::value, "Command data must be trivially copyable");
+		return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+	}
+
+	// Call the commands in recording order
+	void execute() const;
+
+	// Drop all commands; memory is kept for the next frame
+	void reset();
+
+	size_t getNumCommands() const { return commands.size(); }
+	// Bytes of commands and their data recorded since the last reset
+	size_t getBytes() const { return bytes; }
+
+private:
+	struct Command {
+		Function function;
+		const void * data;
+	};
+	struct Block {
+		std::unique_ptr<unsigned char[]> memory;
+		size_t size;
+	};
+	static constexpr size_t BlockSize = 64 << 10;
+
+	std::vector<Command> commands;
+	std::vector<Block> blocks;
+	// Block being filled and the offset of it's free space
+	size_t currentBlock = 0;
+	size_t used = 0;
+	size_t bytes = 0;
+
+	void * allocate(size_t size, size_t alignment);
+};
+
+#endif /* COMMAND_BUFFER_HPP */
@@ -0,0 +1,52 @@
+#include "Components.hpp"
+
+#include <algorithm>
+
+void ecs::updateBounds(World & world, const SceneGraph & scene) {
+	world.parallelEachChunk<Transform, Bounds>([&scene](size_t count, Entity *, Transform * transforms, Bounds * bounds) {
+		for(size_t i = 0; i < count; ++i) {
+			const glm::mat4 & m = scene.getWorldMatrix(transforms[i].node);
+			Bounds & b = bounds[i];
+
+			// Transform the box center, extend the extents by the absolute rotation-scale part
+			glm::vec3 center = (b.localMin + b.localMax) * .5f;
+			glm::vec3 extent = (b.localMax - b.localMin) * .5f;
+			glm::vec3 worldCenter = glm::vec3(m * glm::vec4(center, 1.f));
+			glm::vec3 worldExtent =
+				glm::abs(glm::vec3(m[0])) * extent.x +
+				glm::abs(glm::vec3(m[1])) * extent.y +
+				glm::abs(glm::vec3(m[2])) * extent.z;
+			b.worldMin = worldCenter - worldExtent;
+			b.worldMax = worldCenter + worldExtent;
+		}
+	});
+}
+
+void ecs::selectLODs(World & world, const SceneGraph & scene, const lod::Settings & settings) {
+	float errorPerDistance = settings.pixelTolerance / settings.pixelsPerUnit;
+	float errorPerDistanceSq = errorPerDistance * errorPerDistance;
+	float hysteresisSq = (1.f + settings.hysteresis) * (1.f + settings.hysteresis);
+	world.parallelEachChunk<Transform, MeshRef, Bounds, LODRanges>(
+		[&](size_t count, Entity *, Transform * transforms, MeshRef * meshes, Bounds * bounds, LODRanges * ranges) {
+			for(size_t i = 0; i < count; ++i) {
+				if(ranges[i].numLevels < 2)
+					continue;
+				// Distance to the nearest point of the world bounds; object space errors grow with the largest scale
+				glm::vec3 nearest = glm::clamp(settings.cameraPosition, bounds[i].worldMin, bounds[i].worldMax);
+				glm::vec3 d = nearest - settings.cameraPosition;
+				const glm::mat4 & m = scene.getWorldMatrix(transforms[i].node);
+				float scaleSq = std::max({glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+					glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2]))});
+				float allowedErrorSq = glm::dot(d, d) * errorPerDistanceSq / std::max(scaleSq, 1e-12f);
+				meshes[i].lod = lod::select(ranges[i].levels, ranges[i].numLevels, meshes[i].lod, allowedErrorSq, hysteresisSq);
+			}
+		});
+}
+
+void ecs::addOccluders(World & world, const SceneGraph & scene, cull::OcclusionBuffer & occlusion) {
+	world.eachChunk<Transform, Occluder>([&](size_t count, Entity *, Transform * transforms, Occluder * occluders) {
+		for(size_t i = 0; i < count; ++i)
+			if(occluders[i].mesh)
+				occlusion.addOccluder(*occluders[i].mesh, scene.getWorldMatrix(transforms[i].node));
+	});
+}
@@ -0,0 +1,72 @@
+/*
+ * Per-object components of renderable entities (see ECS.hpp)
+ * and the systems updating them.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef COMPONENTS_HPP
+#define COMPONENTS_HPP
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "Resource.hpp"
+#include "SceneGraph.hpp"
+#include "ECS.hpp"
+#include "Occlusion.hpp"
+#include "Mesh.hpp"
+#include "LOD.hpp"
+
+namespace ecs {
+	// Node of the SceneGraph holding the object's world matrix
+	struct Transform {
+		SceneGraph::NodeID node;
+	};
+
+	// Mesh resID, which of it's primitives this object draws and at what level of detail
+	struct MeshRef {
+		u64 mesh;
+		uint32_t primitive;
+		uint32_t lod = 0;
+	};
+
+	// Level of detail chain of the primitive, owned by the Mesh (see LOD.hpp)
+	struct LODRanges {
+		const Mesh::LOD * levels;
+		uint32_t numLevels;
+	};
+
+	// Material resID (0 means default look) and it's Material::getSortKey(), taken once
+	// the material's shader is chosen; draws are ordered by the key
+	struct MaterialRef {
+		u64 material;
+		uint64_t sortKey = 0;
+	};
+
+	// Object space bounds of the primitive and their world space AABB
+	struct Bounds {
+		glm::vec3 localMin;
+		glm::vec3 localMax;
+		glm::vec3 worldMin;
+		glm::vec3 worldMax;
+	};
+
+	// Object space geometry rasterized into the occlusion buffer; the mesh is owned elsewhere
+	struct Occluder {
+		const cull::OccluderMesh * mesh;
+	};
+
+	// Recompute world AABBs from the scene graph's world matrices (chunks in parallel)
+	void updateBounds(World & world, const SceneGraph & scene);
+
+	// Pick MeshRef::lod of objects with a LOD chain from their distance to the camera (chunks in parallel)
+	void selectLODs(World & world, const SceneGraph & scene, const lod::Settings & settings);
+
+	// Queue all occluders of the world with their world matrices (after OcclusionBuffer::begin())
+	void addOccluders(World & world, const SceneGraph & scene, cull::OcclusionBuffer & occlusion);
+}
+
+#endif /* COMPONENTS_HPP */
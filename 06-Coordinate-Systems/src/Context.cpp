@@ -1,11 +1,15 @@
 #include "Context.hpp"
 
+#include <algorithm>
+
 Context::Context(std::string windowName, int width, int height) {
 	// Resource type
 	//type = Resource::Type::
 
 	this->width = width;
 	this->height = height;
+	framebufferWidth = width;
+	framebufferHeight = height;
 
 	// OpenGL version and features
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -22,8 +26,18 @@ Context::Context(std::string windowName, int width, int height) {
 		return;
 	}
 
-	// GLFW callbacks for this context
+	// GLFW callbacks for this context; input reaches it through the window's user pointer
+	glfwSetWindowUserPointer(window, this);
 	glfwSetFramebufferSizeCallback(window, clbck::framebufferSize);
+	glfwSetWindowSizeCallback(window, clbck::windowSize);
+	glfwSetKeyCallback(window, clbck::key);
+	glfwSetMouseButtonCallback(window, clbck::mouseButton);
+	glfwSetCursorPosCallback(window, clbck::cursorPos);
+	glfwSetScrollCallback(window, clbck::scroll);
+	glfwSetWindowIconifyCallback(window, clbck::windowIconify);
+	glfwSetWindowFocusCallback(window, clbck::windowFocus);
+	glfwSetWindowRefreshCallback(window, clbck::windowRefresh);
+	updateContextState();
 
 	// Set default background color for GL_COLOR_BUFFER_BIT
 	backgroundColor[0] = .2f;
@@ -36,13 +50,76 @@ bool Context::shouldClose() const {
 	return glfwWindowShouldClose(window);
 }
 
-void Context::processInput() const {
-	if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-		glfwSetWindowShouldClose(window, true);
+void Context::processInput() {
+	events.clear();
+	size_t count = eventQueue.drain(events);
+	double now = glfwGetTime();
+	inputStats.events += count;
+	for(const input::Event & event : events) {
+		inputStats.maxAgeMs = std::max(inputStats.maxAgeMs, (now - event.time) * 1e3);
+		switch(event.type) {
+		case input::EventType::Key:
+			if(event.code >= 0 && event.code < (int)keys.size())
+				keys[event.code] = event.action!=GLFW_RELEASE;
+			if(event.code==GLFW_KEY_ESCAPE && event.action==GLFW_PRESS)
+				glfwSetWindowShouldClose(window, true);
+			break;
+		case input::EventType::WindowSize:
+			width = (int)event.x;
+			height = (int)event.y;
+			break;
+		case input::EventType::FramebufferSize:
+			framebufferWidth = (int)event.x;
+			framebufferHeight = (int)event.y;
+			break;
+		case input::EventType::WindowIconify:
+			iconified = event.action!=0;
+			break;
+		case input::EventType::WindowFocus:
+			focused = event.action!=0;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void Context::pollEvents() {
+	glfwPollEvents();
+	inputStats.polls++;
+}
+
+void Context::waitEvents(double timeout) {
+	glfwWaitEventsTimeout(timeout);
+	inputStats.polls++;
+}
+
+void Context::pushEvent(const input::Event & event) {
+	eventQueue.push(event);
+}
+
+void Context::requestRedraw() {
+	pushEvent(input::Event{input::EventType::Redraw, 0, 0, 0, 0., 0., glfwGetTime()});
+	glfwPostEmptyEvent();
+}
+
+input::Stats Context::getInputStats() const {
+	input::Stats stats = inputStats;
+	stats.dropped = eventQueue.getDropped() - droppedBase;
+	return stats;
+}
+
+void Context::resetInputStats() {
+	inputStats = input::Stats();
+	// The queue's count only grows; stats report the difference
+	droppedBase = eventQueue.getDropped();
 }
 
 void Context::updateContextState() {
 	glfwGetWindowSize(window, &width, &height);
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	iconified = glfwGetWindowAttrib(window, GLFW_ICONIFIED);
+	focused = glfwGetWindowAttrib(window, GLFW_FOCUSED);
 }
 
 void Context::swapBuffers() const {
@@ -61,6 +138,11 @@ void Context::makeCurrent() {
 	pushBackgroundColor();
 }
 
+void Context::releaseCurrent() const {
+	if(window == glfwGetCurrentContext())
+		glfwMakeContextCurrent(NULL);
+}
+
 bool Context::isOpenGLMapped() const {
 	return openglMapped;
 }
@@ -92,7 +174,7 @@ int Context::getNumAttributes() const {
 }
 
 void Context::pushViewport() const {
-	clbck::framebufferSize(window, width, height);
+	glViewport(0, 0, framebufferWidth, framebufferHeight);
 }
 
 void Context::pushBackgroundColor() const {
@@ -18,11 +18,14 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <bitset>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 #include "callbacks.hpp"
+#include "Input.hpp"
 
 class Context {
 public:
@@ -36,10 +39,47 @@ public:
 	// Should this context be closed
 	bool shouldClose() const;
 
-	// Process input from the game loop (may be changed in the future)
-	void processInput() const;
+	// Drain the input events queued since the last call (see Input.hpp): they become this frame's
+	// events, resizes update the context's sizes and ESC closes the window
+	void processInput();
 
-	// Updates width & height of the context
+	// Poll GLFW events (main thread only); their callbacks queue input events
+	void pollEvents();
+
+	// Sleep until an event arrives or `timeout` seconds pass (main thread only)
+	void waitEvents(double timeout);
+
+	// Queue an input event (from any thread; GLFW callbacks of this context's window do)
+	void pushEvent(const input::Event & event);
+
+	// Ask for the next frame to be drawn (from any thread, e.g. a loader that finished): queues a
+	// Redraw event and wakes the main thread from waitEvents()
+	void requestRedraw();
+
+	// Events are queued that the next processInput() will drain
+	bool hasEvents() const { return !eventQueue.empty(); }
+
+	// Events drained by the last processInput(), oldest first
+	const std::vector<input::Event> & getEvents() const { return events; }
+	// Key state after the last processInput()
+	bool isKeyDown(int key) const { return key >= 0 && key < (int)keys.size() && keys[key]; }
+	bool isAnyKeyDown() const { return keys.any(); }
+
+	// Window state after the last processInput()
+	bool isIconified() const { return iconified; }
+	bool isFocused() const { return focused; }
+
+	// Interval (seconds) of polling events while the main thread waits, e.g. for the render
+	// thread; 0 polls once per frame
+	void setPollInterval(double seconds) { pollInterval = seconds; }
+	double getPollInterval() const { return pollInterval; }
+
+	// Totals since the last reset
+	input::Stats getInputStats() const;
+	void resetInputStats();
+
+	// Query width & height of the context and it's framebuffer (resize events keep them up
+	// to date, see processInput())
 	void updateContextState();
 
 	// Swap buffers for context
@@ -48,18 +88,39 @@ public:
 	// Make context current for OpenGL and set GLFW callbacks for this context
 	void makeCurrent();
 
+	// Detach the context from the calling thread, so another one (e.g. a render thread) can make it current
+	void releaseCurrent() const;
+
 	// Check if OpenGL was mapped for this context
 	bool isOpenGLMapped() const;
 
 	// Get supported maximum number of atributes for shaders
 	int getNumAttributes() const;
 
+	// Size of the context's window
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	// Size of the framebuffer in pixels (differs from the window size on high DPI screens)
+	int getFramebufferWidth() const { return framebufferWidth; }
+	int getFramebufferHeight() const { return framebufferHeight; }
+
 private:
 	GLFWwindow * window;
 	int width;
 	int height;
+	int framebufferWidth;
+	int framebufferHeight;
 	float backgroundColor[4];
 	bool openglMapped = false;
+	bool iconified = false;
+	bool focused = true;
+
+	input::EventQueue eventQueue;
+	std::vector<input::Event> events;
+	std::bitset<GLFW_KEY_LAST + 1> keys;
+	double pollInterval = 0.;
+	input::Stats inputStats;
+	size_t droppedBase = 0;
 
 	// Push OpenGL viewport according to this context
 	void pushViewport() const;
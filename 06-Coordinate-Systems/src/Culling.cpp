@@ -0,0 +1,232 @@
+#include "Culling.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include "Jobs.hpp"
+
+using namespace cull;
+
+namespace {
+	// The widest vector type available at compile time
+#if defined(__AVX__)
+	typedef __m256 Vec;
+	constexpr size_t WIDTH = 8;
+	inline Vec load(const float * p) { return _mm256_loadu_ps(p); }
+	inline Vec splat(float v) { return _mm256_set1_ps(v); }
+	inline Vec zero() { return _mm256_setzero_ps(); }
+	inline Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+	inline Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+	inline Vec orLess(Vec acc, Vec a, Vec b) { return _mm256_or_ps(acc, _mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+	inline unsigned mask(Vec v) { return (unsigned)_mm256_movemask_ps(v); }
+#elif defined(__SSE__) || defined(_M_X64)
+	typedef __m128 Vec;
+	constexpr size_t WIDTH = 4;
+	inline Vec load(const float * p) { return _mm_loadu_ps(p); }
+	inline Vec splat(float v) { return _mm_set1_ps(v); }
+	inline Vec zero() { return _mm_setzero_ps(); }
+	inline Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+	inline Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+	inline Vec orLess(Vec acc, Vec a, Vec b) { return _mm_or_ps(acc, _mm_cmplt_ps(a, b)); }
+	inline unsigned mask(Vec v) { return (unsigned)_mm_movemask_ps(v); }
+#else
+	typedef float Vec;
+	constexpr size_t WIDTH = 1;
+	inline Vec load(const float * p) { return *p; }
+	inline Vec splat(float v) { return v; }
+	inline Vec zero() { return 0.f; }
+	inline Vec mul(Vec a, Vec b) { return a*b; }
+	inline Vec add(Vec a, Vec b) { return a+b; }
+	inline Vec orLess(Vec acc, Vec a, Vec b) { return (acc!=0.f || a<b) ? 1.f : 0.f; }
+	inline unsigned mask(Vec v) { return v!=0.f ? 1u : 0u; }
+#endif
+	constexpr unsigned FULL_MASK = (1u << WIDTH) - 1;
+
+	// Plane components broadcast over all lanes
+	struct PlaneVec {
+		Vec nx, ny, nz, w;
+		Vec absNx, absNy, absNz;
+	};
+
+	void splatPlanes(const Frustum & frustum, PlaneVec * planes) {
+		for(int i = 0; i < 6; ++i) {
+			const glm::vec4 & p = frustum.planes[i];
+			planes[i] = PlaneVec{splat(p.x), splat(p.y), splat(p.z), splat(p.w),
+				splat(std::fabs(p.x)), splat(std::fabs(p.y)), splat(std::fabs(p.z))};
+		}
+	}
+
+	// Write indices of set bits of a visibility mask, return the advanced output pointer
+	inline uint32_t * compact(unsigned visibleMask, uint32_t base, uint32_t * out) {
+		while(visibleMask) {
+			*out++ = base + (uint32_t)__builtin_ctz(visibleMask);
+			visibleMask &= visibleMask-1;
+		}
+		return out;
+	}
+
+	typedef std::chrono::steady_clock Clock;
+
+	// Split [0, n) into contiguous, vector aligned ranges, cull them in parallel, concatenate in order
+	template<typename Volumes, typename Kernel>
+	Stats cullParallel(const Volumes & volumes, std::vector<uint32_t> & visible, unsigned numThreads, Kernel kernel) {
+		auto start = Clock::now();
+		size_t n = volumes.size();
+		visible.clear();
+
+		size_t blocks = (n + WIDTH-1) / WIDTH;
+		numThreads = (unsigned)std::max<size_t>(1, std::min<size_t>(numThreads, blocks / 64));
+		if(numThreads==1)
+			kernel(0, n, visible);
+		else {
+			// A few pieces per thread for the pool to balance, each with it's own output
+			size_t numPieces = std::min<size_t>(blocks / 64, (size_t)numThreads * 4);
+			std::vector<std::vector<uint32_t>> partial(numPieces);
+			size_t blocksPerPiece = (blocks + numPieces-1) / numPieces;
+			job::parallelFor(0, numPieces, 1, [&](size_t first, size_t last) {
+				for(size_t p = first; p < last; ++p)
+					kernel(std::min(n, p * blocksPerPiece * WIDTH), std::min(n, (p+1) * blocksPerPiece * WIDTH), partial[p]);
+			});
+
+			size_t total = 0;
+			for(const auto & p : partial)
+				total += p.size();
+			visible.reserve(total);
+			for(const auto & p : partial)
+				visible.insert(visible.end(), p.begin(), p.end());
+		}
+
+		Stats stats;
+		stats.tested = n;
+		stats.visible = visible.size();
+		stats.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		return stats;
+	}
+}
+
+void AABBArray::push(const glm::vec3 & min, const glm::vec3 & max) {
+	glm::vec3 c = (min + max) * .5f;
+	glm::vec3 e = (max - min) * .5f;
+	centerX.push_back(c.x); centerY.push_back(c.y); centerZ.push_back(c.z);
+	extentX.push_back(e.x); extentY.push_back(e.y); extentZ.push_back(e.z);
+}
+
+void AABBArray::set(size_t i, const glm::vec3 & min, const glm::vec3 & max) {
+	glm::vec3 c = (min + max) * .5f;
+	glm::vec3 e = (max - min) * .5f;
+	centerX[i] = c.x; centerY[i] = c.y; centerZ[i] = c.z;
+	extentX[i] = e.x; extentY[i] = e.y; extentZ[i] = e.z;
+}
+
+void AABBArray::clear() {
+	for(auto * v : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ})
+		v->clear();
+}
+
+void AABBArray::reserve(size_t n) {
+	for(auto * v : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ})
+		v->reserve(n);
+}
+
+void AABBArray::resize(size_t n) {
+	for(auto * v : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ})
+		v->resize(n);
+}
+
+void SphereArray::push(const glm::vec3 & center, float r) {
+	centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+	radius.push_back(r);
+}
+
+void SphereArray::clear() {
+	for(auto * v : {&centerX, &centerY, &centerZ, &radius})
+		v->clear();
+}
+
+void SphereArray::reserve(size_t n) {
+	for(auto * v : {&centerX, &centerY, &centerZ, &radius})
+		v->reserve(n);
+}
+
+void cull::frustumAABBs(const Frustum & frustum, const AABBArray & boxes, size_t begin, size_t end, std::vector<uint32_t> & visible) {
+	PlaneVec planes[6];
+	splatPlanes(frustum, planes);
+
+	size_t first = visible.size();
+	visible.resize(first + (end-begin));
+	uint32_t * out = visible.data() + first;
+
+	size_t i = begin;
+	for(; i + WIDTH <= end; i += WIDTH) {
+		Vec cx = load(&boxes.centerX[i]), cy = load(&boxes.centerY[i]), cz = load(&boxes.centerZ[i]);
+		Vec ex = load(&boxes.extentX[i]), ey = load(&boxes.extentY[i]), ez = load(&boxes.extentZ[i]);
+		Vec outside = zero();
+		for(const PlaneVec & p : planes) {
+			// Signed distance of the center plus the box "radius" projected on the normal
+			Vec d = add(add(mul(p.nx, cx), mul(p.ny, cy)), add(mul(p.nz, cz), p.w));
+			Vec r = add(add(mul(p.absNx, ex), mul(p.absNy, ey)), mul(p.absNz, ez));
+			outside = orLess(outside, add(d, r), zero());
+		}
+		out = compact(~mask(outside) & FULL_MASK, (uint32_t)i, out);
+	}
+	for(; i < end; ++i)
+		if(frustum.intersects(glm::vec3(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]),
+													glm::vec3(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i])))
+			*out++ = (uint32_t)i;
+
+	visible.resize(out - visible.data());
+}
+
+void cull::frustumSpheres(const Frustum & frustum, const SphereArray & spheres, size_t begin, size_t end, std::vector<uint32_t> & visible) {
+	PlaneVec planes[6];
+	splatPlanes(frustum, planes);
+
+	size_t first = visible.size();
+	visible.resize(first + (end-begin));
+	uint32_t * out = visible.data() + first;
+
+	size_t i = begin;
+	for(; i + WIDTH <= end; i += WIDTH) {
+		Vec cx = load(&spheres.centerX[i]), cy = load(&spheres.centerY[i]), cz = load(&spheres.centerZ[i]);
+		Vec r = load(&spheres.radius[i]);
+		Vec outside = zero();
+		for(const PlaneVec & p : planes) {
+			Vec d = add(add(mul(p.nx, cx), mul(p.ny, cy)), add(mul(p.nz, cz), p.w));
+			outside = orLess(outside, add(d, r), zero());
+		}
+		out = compact(~mask(outside) & FULL_MASK, (uint32_t)i, out);
+	}
+	for(; i < end; ++i)
+		if(frustum.intersects(glm::vec3(spheres.centerX[i], spheres.centerY[i], spheres.centerZ[i]), spheres.radius[i]))
+			*out++ = (uint32_t)i;
+
+	visible.resize(out - visible.data());
+}
+
+Stats cull::frustumAABBs(const Frustum & frustum, const AABBArray & boxes, std::vector<uint32_t> & visible, unsigned numThreads) {
+	return cullParallel(boxes, visible, numThreads, [&](size_t begin, size_t end, std::vector<uint32_t> & out) {
+		frustumAABBs(frustum, boxes, begin, end, out);
+	});
+}
+
+Stats cull::frustumSpheres(const Frustum & frustum, const SphereArray & spheres, std::vector<uint32_t> & visible, unsigned numThreads) {
+	return cullParallel(spheres, visible, numThreads, [&](size_t begin, size_t end, std::vector<uint32_t> & out) {
+		frustumSpheres(frustum, spheres, begin, end, out);
+	});
+}
+
+const char * cull::simdName() {
+#if defined(__AVX__)
+	return "AVX (8 wide)";
+#elif defined(__SSE__) || defined(_M_X64)
+	return "SSE (4 wide)";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,88 @@
+/*
+ * Frustum culling of many bounding volumes at once.
+ *
+ * Bounding volumes are stored as structures of arrays (AABBs as center/extent,
+ * spheres as center/radius), so a SIMD register holds the same coordinate of
+ * 8 (AVX) or 4 (SSE) objects and each plane is tested against all of them with
+ * a handful of instructions. The result is a compact list of indices of
+ * visible objects, in increasing order.
+ *
+ * The range can be split over worker threads; every thread compacts into it's
+ * own list and the lists are concatenated in order, so the output doesn't
+ * depend on the number of threads.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef CULLING_HPP
+#define CULLING_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+
+namespace cull {
+	// Axis aligned boxes, structure of arrays
+	struct AABBArray {
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ;
+
+		void push(const glm::vec3 & min, const glm::vec3 & max);
+		// Overwrite box i (e.g. when boxes are filled in parallel after a resize)
+		void set(size_t i, const glm::vec3 & min, const glm::vec3 & max);
+		void clear();
+		void reserve(size_t n);
+		void resize(size_t n);
+		size_t size() const { return centerX.size(); }
+	};
+
+	// Bounding spheres, structure of arrays
+	struct SphereArray {
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> radius;
+
+		void push(const glm::vec3 & center, float r);
+		void clear();
+		void reserve(size_t n);
+		size_t size() const { return centerX.size(); }
+	};
+
+	struct Stats {
+		size_t tested = 0;
+		size_t visible = 0;
+		double ms = 0.;
+
+		size_t culled() const { return tested - visible; }
+		double nsPerObject() const { return tested ? ms*1e6 / tested : 0.; }
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[culling|tested:" << s.tested
+				 << "|visible:" << s.visible
+				 << "|culled:" << s.culled()
+				 << "|ms:" << s.ms
+				 << "|ns/object:" << s.nsPerObject()
+				 << "]";
+			return os;
+		}
+	};
+
+	// Append indices (in [begin, end)) of volumes intersecting the frustum to `visible`
+	void frustumAABBs(const Frustum & frustum, const AABBArray & boxes, size_t begin, size_t end, std::vector<uint32_t> & visible);
+	void frustumSpheres(const Frustum & frustum, const SphereArray & spheres, size_t begin, size_t end, std::vector<uint32_t> & visible);
+
+	// Cull all volumes, splitting the work over up to numThreads threads of the job pool (see Jobs.hpp);
+	// `visible` is overwritten
+	Stats frustumAABBs(const Frustum & frustum, const AABBArray & boxes, std::vector<uint32_t> & visible, unsigned numThreads = 1);
+	Stats frustumSpheres(const Frustum & frustum, const SphereArray & spheres, std::vector<uint32_t> & visible, unsigned numThreads = 1);
+
+	// Instruction set the culling was compiled with
+	const char * simdName();
+}
+
+#endif /* CULLING_HPP */
@@ -0,0 +1,285 @@
+#include "DynamicAABBTree.hpp"
+
+#include <algorithm>
+
+namespace {
+	// Traversal stack, reused between queries of a thread
+	thread_local std::vector<DynamicAABBTree::ProxyID> stack;
+}
+
+DynamicAABBTree::DynamicAABBTree(float margin) : margin(margin) {}
+
+DynamicAABBTree::ProxyID DynamicAABBTree::allocateNode() {
+	if(freeList==NULL_NODE) {
+		nodes.emplace_back();
+		nodes.back().height = 0;
+		return (ProxyID)(nodes.size()-1);
+	}
+	ProxyID node = freeList;
+	freeList = nodes[node].parent;
+	nodes[node] = Node();
+	nodes[node].height = 0;
+	return node;
+}
+
+void DynamicAABBTree::freeNode(ProxyID node) {
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+}
+
+DynamicAABBTree::ProxyID DynamicAABBTree::insert(uint32_t object, const AABB & box) {
+	ProxyID proxy = allocateNode();
+	nodes[proxy].box = AABB(box.min - glm::vec3(margin), box.max + glm::vec3(margin));
+	nodes[proxy].object = object;
+	insertLeaf(proxy);
+	++numLeaves;
+	return proxy;
+}
+
+void DynamicAABBTree::remove(ProxyID proxy) {
+	removeLeaf(proxy);
+	freeNode(proxy);
+	--numLeaves;
+}
+
+bool DynamicAABBTree::move(ProxyID proxy, const AABB & box, const glm::vec3 & displacement) {
+	if(nodes[proxy].box.contains(box))
+		return false;
+
+	removeLeaf(proxy);
+
+	// Enlarge by the margin and predict further motion
+	AABB fat(box.min - glm::vec3(margin), box.max + glm::vec3(margin));
+	glm::vec3 d = displacement * 2.f;
+	for(int axis = 0; axis < 3; ++axis) {
+		if(d[axis] < 0.f)
+			fat.min[axis] += d[axis];
+		else
+			fat.max[axis] += d[axis];
+	}
+	nodes[proxy].box = fat;
+
+	insertLeaf(proxy);
+	return true;
+}
+
+void DynamicAABBTree::insertLeaf(ProxyID leaf) {
+	if(root==NULL_NODE) {
+		root = leaf;
+		nodes[root].parent = NULL_NODE;
+		return;
+	}
+
+	// Descend to the sibling with the lowest surface area cost
+	AABB leafBox = nodes[leaf].box;
+	ProxyID index = root;
+	while(!nodes[index].isLeaf()) {
+		ProxyID child1 = nodes[index].child1;
+		ProxyID child2 = nodes[index].child2;
+
+		float area = nodes[index].box.surfaceArea();
+		float combinedArea = AABB::merge(nodes[index].box, leafBox).surfaceArea();
+
+		// Cost of making a new parent for this node and the leaf
+		float cost = 2.f * combinedArea;
+		// Minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.f * (combinedArea - area);
+
+		auto descendCost = [&](ProxyID child) {
+			float merged = AABB::merge(leafBox, nodes[child].box).surfaceArea();
+			if(nodes[child].isLeaf())
+				return merged + inheritanceCost;
+			return merged - nodes[child].box.surfaceArea() + inheritanceCost;
+		};
+		float cost1 = descendCost(child1);
+		float cost2 = descendCost(child2);
+
+		if(cost < cost1 && cost < cost2)
+			break;
+		index = cost1 < cost2 ? child1 : child2;
+	}
+	ProxyID sibling = index;
+
+	// New parent for the sibling and the leaf
+	ProxyID oldParent = nodes[sibling].parent;
+	ProxyID newParent = allocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].box = AABB::merge(leafBox, nodes[sibling].box);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].child1 = sibling;
+	nodes[newParent].child2 = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if(oldParent!=NULL_NODE) {
+		if(nodes[oldParent].child1==sibling)
+			nodes[oldParent].child1 = newParent;
+		else
+			nodes[oldParent].child2 = newParent;
+	}
+	else
+		root = newParent;
+
+	refitUpwards(nodes[leaf].parent);
+}
+
+void DynamicAABBTree::removeLeaf(ProxyID leaf) {
+	if(leaf==root) {
+		root = NULL_NODE;
+		return;
+	}
+
+	ProxyID parent = nodes[leaf].parent;
+	ProxyID grandParent = nodes[parent].parent;
+	ProxyID sibling = nodes[parent].child1==leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	// The sibling takes the parent's place
+	if(grandParent!=NULL_NODE) {
+		if(nodes[grandParent].child1==parent)
+			nodes[grandParent].child1 = sibling;
+		else
+			nodes[grandParent].child2 = sibling;
+		nodes[sibling].parent = grandParent;
+		freeNode(parent);
+		refitUpwards(grandParent);
+	}
+	else {
+		root = sibling;
+		nodes[sibling].parent = NULL_NODE;
+		freeNode(parent);
+	}
+}
+
+void DynamicAABBTree::refitUpwards(ProxyID index) {
+	while(index!=NULL_NODE) {
+		index = balance(index);
+		Node & node = nodes[index];
+		const Node & child1 = nodes[node.child1];
+		const Node & child2 = nodes[node.child2];
+		node.height = 1 + std::max(child1.height, child2.height);
+		node.box = AABB::merge(child1.box, child2.box);
+		index = node.parent;
+	}
+}
+
+DynamicAABBTree::ProxyID DynamicAABBTree::balance(ProxyID iA) {
+	if(nodes[iA].isLeaf() || nodes[iA].height < 2)
+		return iA;
+
+	ProxyID iB = nodes[iA].child1;
+	ProxyID iC = nodes[iA].child2;
+	int diff = nodes[iC].height - nodes[iB].height;
+
+	// Rotate the taller child (C or B) up, it's taller grandchild stays under it
+	auto rotateUp = [this, iA](ProxyID iUp, ProxyID iOther, bool upIsChild2) {
+		Node & A = nodes[iA];
+		Node & up = nodes[iUp];
+		ProxyID iF = up.child1;
+		ProxyID iG = up.child2;
+
+		up.child1 = iA;
+		up.parent = A.parent;
+		A.parent = iUp;
+
+		if(up.parent!=NULL_NODE) {
+			if(nodes[up.parent].child1==iA)
+				nodes[up.parent].child1 = iUp;
+			else
+				nodes[up.parent].child2 = iUp;
+		}
+		else
+			root = iUp;
+
+		// The taller grandchild stays under `up`, the shorter one moves under A
+		ProxyID iKeep = nodes[iF].height > nodes[iG].height ? iF : iG;
+		ProxyID iMove = iKeep==iF ? iG : iF;
+		up.child2 = iKeep;
+		if(upIsChild2)
+			A.child2 = iMove;
+		else
+			A.child1 = iMove;
+		nodes[iMove].parent = iA;
+
+		A.box = AABB::merge(nodes[iOther].box, nodes[iMove].box);
+		A.height = 1 + std::max(nodes[iOther].height, nodes[iMove].height);
+		up.box = AABB::merge(A.box, nodes[iKeep].box);
+		up.height = 1 + std::max(A.height, nodes[iKeep].height);
+		return iUp;
+	};
+
+	if(diff > 1)
+		return rotateUp(iC, iB, true);
+	if(diff < -1)
+		return rotateUp(iB, iC, false);
+	return iA;
+}
+
+void DynamicAABBTree::queryFrustum(const Frustum & frustum, std::vector<uint32_t> & objects) const {
+	if(root==NULL_NODE)
+		return;
+	stack.clear();
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const Node & node = nodes[stack.back()];
+		stack.pop_back();
+		if(!frustum.intersects(node.box.center(), node.box.extent()))
+			continue;
+		if(node.isLeaf())
+			objects.push_back(node.object);
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+void DynamicAABBTree::queryRegion(const AABB & region, std::vector<uint32_t> & objects) const {
+	if(root==NULL_NODE)
+		return;
+	stack.clear();
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const Node & node = nodes[stack.back()];
+		stack.pop_back();
+		if(!region.overlaps(node.box))
+			continue;
+		if(node.isLeaf())
+			objects.push_back(node.object);
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+}
+
+bool DynamicAABBTree::raycast(const Ray & ray, float maxT, RayHit & hit) const {
+	if(root==NULL_NODE)
+		return false;
+	float best = maxT;
+	uint32_t bestObject = UINT32_MAX;
+	stack.clear();
+	stack.push_back(root);
+	while(!stack.empty()) {
+		const Node & node = nodes[stack.back()];
+		stack.pop_back();
+		float t;
+		if(!ray.intersects(node.box, best, t))
+			continue;
+		if(node.isLeaf()) {
+			if(t < best) {
+				best = t;
+				bestObject = node.object;
+			}
+		}
+		else {
+			stack.push_back(node.child1);
+			stack.push_back(node.child2);
+		}
+	}
+	if(bestObject==UINT32_MAX)
+		return false;
+	hit.object = bestObject;
+	hit.t = best;
+	return true;
+}
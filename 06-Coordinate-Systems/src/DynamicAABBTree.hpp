@@ -0,0 +1,94 @@
+/*
+ * Incrementally updated bounding volume hierarchy for moving objects.
+ *
+ * A binary tree of "fat" AABBs: every leaf box is enlarged by a margin (and
+ * in the direction of motion), so small movements don't touch the tree at
+ * all. When an object leaves it's fat box, it's leaf is removed and inserted
+ * again. Insertion picks the sibling by the surface area heuristic and then
+ * walks up refitting the ancestors; unbalanced nodes are fixed with tree
+ * rotations on the way, keeping the height logarithmic.
+ *
+ * Nodes live in a single array with a free list, so proxies (node indices)
+ * stay valid until removed.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef DYNAMIC_AABB_TREE_HPP
+#define DYNAMIC_AABB_TREE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "AABB.hpp"
+#include "Frustum.hpp"
+
+class DynamicAABBTree {
+public:
+	typedef int32_t ProxyID;
+	static constexpr ProxyID NULL_NODE = -1;
+
+	// margin: how much leaf boxes are enlarged on each side
+	DynamicAABBTree(float margin = .1f);
+
+	// Delete copy and assignment constructors
+	DynamicAABBTree(const DynamicAABBTree &) = delete;
+	DynamicAABBTree & operator=(const DynamicAABBTree &) = delete;
+
+	ProxyID insert(uint32_t object, const AABB & box);
+	void remove(ProxyID proxy);
+
+	// Update the object's box; returns true if the tree had to be changed
+	bool move(ProxyID proxy, const AABB & box, const glm::vec3 & displacement = glm::vec3(0.f));
+
+	const AABB & getFatAABB(ProxyID proxy) const { return nodes[proxy].box; }
+	uint32_t getObject(ProxyID proxy) const { return nodes[proxy].object; }
+
+	// Append IDs of objects whose fat boxes intersect the frustum / the region
+	void queryFrustum(const Frustum & frustum, std::vector<uint32_t> & objects) const;
+	void queryRegion(const AABB & region, std::vector<uint32_t> & objects) const;
+
+	// Closest object whose fat box is hit by the ray within maxT; false if none
+	bool raycast(const Ray & ray, float maxT, RayHit & hit) const;
+
+	int getHeight() const { return root==NULL_NODE ? 0 : nodes[root].height; }
+	size_t size() const { return numLeaves; }
+
+private:
+	struct Node {
+		AABB box;
+		uint32_t object = UINT32_MAX;
+		// Parent, or the next free node when on the free list
+		ProxyID parent = NULL_NODE;
+		ProxyID child1 = NULL_NODE;
+		ProxyID child2 = NULL_NODE;
+		// Leaf = 0, free node = -1
+		int height = -1;
+
+		bool isLeaf() const { return child1==NULL_NODE; }
+	};
+
+	std::vector<Node> nodes;
+	ProxyID root = NULL_NODE;
+	ProxyID freeList = NULL_NODE;
+	size_t numLeaves = 0;
+	float margin;
+
+	ProxyID allocateNode();
+	void freeNode(ProxyID node);
+
+	void insertLeaf(ProxyID leaf);
+	void removeLeaf(ProxyID leaf);
+
+	// Rotate the subtree if it's children heights differ by more than 1; returns the new subtree root
+	ProxyID balance(ProxyID node);
+
+	// Walk up from the node refitting boxes and heights, balancing on the way
+	void refitUpwards(ProxyID node);
+};
+
+#endif /* DYNAMIC_AABB_TREE_HPP */
@@ -0,0 +1,56 @@
+#include "DynamicResolution.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+DynamicResolution::Controller::Controller(const Settings & settings) :
+	settings(settings),
+	scale(settings.fixedScale > 0.f ? settings.fixedScale : settings.maxScale) {
+}
+
+float DynamicResolution::Controller::update(double gpuMs, float frameScale) {
+	if(settings.fixedScale > 0.f || gpuMs <= 0.)
+		return scale;
+	// Within the band: keep it
+	double error = gpuMs / settings.targetMs - 1.;
+	if(std::fabs(error) <= settings.hysteresis)
+		return scale;
+	// Cost goes with the pixel count, the square of the scale
+	float factor = (float)std::sqrt(settings.targetMs / gpuMs);
+	factor = std::clamp(factor, 1.f - settings.maxStep, 1.f + settings.maxStep);
+	float next = std::clamp(frameScale * factor, settings.minScale, settings.maxScale);
+	if(next!=scale)
+		changes++;
+	scale = next;
+	return scale;
+}
+
+DynamicResolution::DynamicResolution(const Settings & settings) : settings(settings), controller(settings) {
+	stats.scale = controller.getScale();
+}
+
+void DynamicResolution::begin(int referenceWidth, int referenceHeight) {
+	// Feed the controller with the results that arrived
+	timer.read([this](size_t slot, double ms) {
+		stats.gpuMs = ms;
+		controller.update(ms, queryScales[slot]);
+	});
+
+	// Within the targets, allocated at the biggest scale
+	stats.scale = controller.getScale();
+	stats.changes = controller.getChanges();
+	int maxWidth = std::max(1, (int)std::ceil(referenceWidth * getMaxScale()));
+	int maxHeight = std::max(1, (int)std::ceil(referenceHeight * getMaxScale()));
+	stats.width = std::clamp((int)std::lround(referenceWidth * stats.scale), 1, maxWidth);
+	stats.height = std::clamp((int)std::lround(referenceHeight * stats.scale), 1, maxHeight);
+
+	glViewport(0, 0, stats.width, stats.height);
+	// A full ring (results not read yet) skips the measurement of this frame
+	size_t slot = timer.begin();
+	if(slot < GPUTimer::NumQueries)
+		queryScales[slot] = stats.scale;
+}
+
+void DynamicResolution::end() {
+	timer.end();
+}
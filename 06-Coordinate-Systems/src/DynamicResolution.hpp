@@ -0,0 +1,122 @@
+/*
+ * Dynamic resolution: the scene is rendered offscreen at a fraction of the
+ * framebuffer's size, chosen every frame from the measured GPU time, and
+ * upscaled to the default framebuffer (by the fused post-processing pass,
+ * see PostProcess.hpp).
+ *
+ * The GPU time of each frame's scene pass is measured with a GPUTimer.
+ * Results arrive a few frames later and are read back only when available -
+ * the CPU never waits for them. The controller assumes the cost is proportional to the
+ * pixel count, i.e. to the square of the scale, and moves the scale towards
+ * sqrt(target / measured) times the one the measured frame was drawn at, by
+ * a limited step. Times
+ * within the hysteresis band around the target leave the scale alone, so
+ * it doesn't change with every bit of noise. With a fixed scale (e.g. for
+ * benchmarks) the controller is bypassed.
+ *
+ * The scene's targets are transients of the frame graph (see FrameGraph.hpp)
+ * sized at the biggest scale, and a frame only renders into the lower left
+ * part of them, so changing the scale never reallocates; getStats() tells
+ * how big that part is.
+ *
+ * Everything but the constructor and getMaxScale() is called on the GL
+ * thread (in recorded commands, see RenderThread.hpp).
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef DYNAMIC_RESOLUTION_HPP
+#define DYNAMIC_RESOLUTION_HPP
+
+#include <memory>
+#include <cstddef>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include "GPUTimer.hpp"
+
+class DynamicResolution {
+public:
+	struct Settings {
+		// GPU time of the scene pass to aim for
+		double targetMs = 12.;
+		float minScale = .5f;
+		float maxScale = 1.f;
+		// Band around the target (a fraction of it) where the scale is kept
+		float hysteresis = .1f;
+		// Biggest relative change of the scale per frame
+		float maxStep = .1f;
+		// Scale used every frame instead of the controller's, 0 to control it
+		float fixedScale = 0.f;
+	};
+
+	// Scale from GPU times, without any GL
+	class Controller {
+	public:
+		explicit Controller(const Settings & settings);
+
+		// Scale for the next frame after a frame drawn at frameScale took gpuMs. Results come in
+		// frames late, so the correction is relative to the scale it was measured at, not the current
+		float update(double gpuMs, float frameScale);
+		float getScale() const { return scale; }
+		// Times the scale changed
+		size_t getChanges() const { return changes; }
+
+	private:
+		Settings settings;
+		float scale;
+		size_t changes = 0;
+	};
+
+	struct Stats {
+		float scale = 1.f;
+		// Size of the part of the targets drawn into
+		int width = 0;
+		int height = 0;
+		// Latest measured GPU time of the scene pass
+		double gpuMs = 0.;
+		size_t changes = 0;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[dynamic resolution|scale:" << s.scale
+				 << "|width:" << s.width
+				 << "|height:" << s.height
+				 << "|gpuMs:" << s.gpuMs
+				 << "|changes:" << s.changes
+				 << "]";
+			return os;
+		}
+	};
+
+	// The timer's queries are created by the first begin()
+	explicit DynamicResolution(const Settings & settings);
+
+	// Delete copy and assignment constructors
+	DynamicResolution(const DynamicResolution &) = delete;
+	DynamicResolution & operator=(const DynamicResolution &) = delete;
+
+	// Scale of the scene's targets (relative to the framebuffer), the biggest the scene is drawn at
+	float getMaxScale() const { return settings.fixedScale > 0.f ? settings.fixedScale : settings.maxScale; }
+
+	// Start the scene pass, it's targets bound: sets the viewport to the scaled reference size
+	// (RenderTargetPool::getReferenceWidth() etc.)
+	void begin(int referenceWidth, int referenceHeight);
+	// End the scene pass
+	void end();
+
+	const Stats & getStats() const { return stats; }
+
+private:
+	Settings settings;
+	Controller controller;
+
+	// Scene pass timer, and the scale of the frame measured in each of it's ring slots
+	GPUTimer timer;
+	float queryScales[GPUTimer::NumQueries] = {};
+
+	Stats stats;
+};
+
+#endif /* DYNAMIC_RESOLUTION_HPP */
@@ -0,0 +1,145 @@
+#include "ECS.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+using namespace ecs;
+
+namespace {
+	std::mutex registryMutex;
+	std::vector<ComponentInfo> registry;
+
+	size_t alignUp(size_t value, size_t align) {
+		return (value + align-1) / align * align;
+	}
+}
+
+ComponentID ecs::registerComponent(size_t size, size_t align) {
+	std::lock_guard<std::mutex> lock(registryMutex);
+	// Never reallocate, so references from componentInfo() stay valid
+	registry.reserve(MAX_COMPONENTS);
+	if(registry.size() >= MAX_COMPONENTS)
+		throw std::runtime_error("ECS: too many component types\n");
+	registry.push_back(ComponentInfo{size, align});
+	return (ComponentID)(registry.size()-1);
+}
+
+const ComponentInfo & ecs::componentInfo(ComponentID id) {
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return registry[id];
+}
+
+Archetype::Archetype(Signature signature) : signature(signature) {
+	size_t rowBytes = sizeof(Entity);
+	for(ComponentID id = 0; id < MAX_COMPONENTS; ++id)
+		if(has(id)) {
+			components.push_back(id);
+			sizes[id] = componentInfo(id).size;
+			rowBytes += sizes[id];
+		}
+
+	// Fit as many rows as possible into a chunk, taking column alignment into account
+	auto layout = [this](uint32_t rows) {
+		size_t offset = sizeof(Entity) * rows;
+		for(ComponentID id : components) {
+			const ComponentInfo & info = componentInfo(id);
+			offset = alignUp(offset, info.align);
+			offsets[id] = offset;
+			offset += info.size * rows;
+		}
+		return offset;
+	};
+	capacity = (uint32_t)std::max<size_t>(1, CHUNK_SIZE / rowBytes);
+	while(capacity > 1 && layout(capacity) > CHUNK_SIZE)
+		--capacity;
+	chunkBytes = std::max(CHUNK_SIZE, layout(capacity));
+}
+
+void World::destroy(Entity e) {
+	if(!isAlive(e))
+		return;
+	Record & rec = records[e.index];
+	removeRow(rec.archetype, rec.chunk, rec.row);
+	rec.archetype = nullptr;
+	++rec.generation;
+	freeIndices.push_back(e.index);
+}
+
+Entity World::allocateEntity() {
+	Entity e;
+	if(!freeIndices.empty()) {
+		e.index = freeIndices.back();
+		freeIndices.pop_back();
+	}
+	else {
+		e.index = (uint32_t)records.size();
+		records.emplace_back();
+	}
+	e.generation = records[e.index].generation;
+	return e;
+}
+
+Archetype * World::archetypeFor(Signature signature) {
+	auto it = archetypeMap.find(signature);
+	if(it!=archetypeMap.end())
+		return it->second;
+	archetypes.push_back(std::make_unique<Archetype>(signature));
+	archetypeMap[signature] = archetypes.back().get();
+	return archetypes.back().get();
+}
+
+void World::place(Entity e, Archetype * archetype) {
+	auto & chunks = archetype->chunks;
+	if(chunks.empty() || chunks.back()->count==archetype->capacity)
+		chunks.push_back(std::make_unique<Chunk>(archetype->chunkBytes));
+
+	Chunk & chunk = *chunks.back();
+	Record & rec = records[e.index];
+	rec.archetype = archetype;
+	rec.chunk = (uint32_t)(chunks.size()-1);
+	rec.row = chunk.count;
+	chunk.entities()[chunk.count++] = e;
+	++archetype->size;
+}
+
+void World::removeRow(Archetype * archetype, uint32_t chunkIndex, uint32_t row) {
+	auto & chunks = archetype->chunks;
+	Chunk & hole = *chunks[chunkIndex];
+	Chunk & last = *chunks.back();
+	uint32_t lastRow = last.count-1;
+
+	if(&hole!=&last || row!=lastRow) {
+		for(ComponentID id : archetype->components) {
+			size_t size = archetype->sizes[id];
+			std::memcpy(static_cast<unsigned char *>(archetype->column(hole, id)) + size*row,
+									static_cast<unsigned char *>(archetype->column(last, id)) + size*lastRow, size);
+		}
+		Entity moved = last.entities()[lastRow];
+		hole.entities()[row] = moved;
+		records[moved.index].chunk = chunkIndex;
+		records[moved.index].row = row;
+	}
+
+	--last.count;
+	--archetype->size;
+	if(last.count==0)
+		chunks.pop_back();
+}
+
+void World::moveEntity(Entity e, Archetype * to) {
+	Record from = records[e.index];
+	place(e, to);
+	const Record & rec = records[e.index];
+
+	Chunk & src = *from.archetype->chunks[from.chunk];
+	Chunk & dst = *to->chunks[rec.chunk];
+	for(ComponentID id : to->components)
+		if(from.archetype->has(id)) {
+			size_t size = to->sizes[id];
+			std::memcpy(static_cast<unsigned char *>(to->column(dst, id)) + size*rec.row,
+									static_cast<unsigned char *>(from.archetype->column(src, id)) + size*from.row, size);
+		}
+
+	removeRow(from.archetype, from.chunk, from.row);
+}
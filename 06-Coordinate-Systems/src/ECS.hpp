@@ -0,0 +1,301 @@
+/*
+ * Archetype based entity storage.
+ *
+ * Entities with the same set of components share an Archetype. An archetype
+ * keeps it's entities in fixed size Chunks (16 KiB); inside a chunk every
+ * component type has it's own contiguous column, so a query touching only a
+ * few component types walks just those columns, front to back.
+ *
+ * Components must be trivially copyable structs - they are moved around with
+ * memcpy when entities change archetypes or get removed (swap with the last one).
+ * Up to 64 component types are supported (one bit each in a Signature).
+ *
+ * Unlike Resources (few, heap allocated, shared), entities are meant for
+ * the many small per-object records of a scene: transforms, mesh and material
+ * references, bounds.
+ *
+ * Usage:
+ *   ecs::World world;
+ *   ecs::Entity e = world.create(ecs::MeshRef{mesh, 0}, ecs::Bounds{});
+ *   world.each<ecs::MeshRef, ecs::Bounds>([](ecs::MeshRef & m, ecs::Bounds & b) { ... });
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef ECS_HPP
+#define ECS_HPP
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <type_traits>
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <algorithm>
+
+#include "Jobs.hpp"
+
+namespace ecs {
+	typedef uint32_t ComponentID;
+	typedef uint64_t Signature;
+
+	constexpr size_t MAX_COMPONENTS = 64;
+	constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+	struct Entity {
+		uint32_t index = UINT32_MAX;
+		uint32_t generation = 0;
+
+		bool operator==(const Entity & other) const { return index==other.index && generation==other.generation; }
+		bool operator!=(const Entity & other) const { return !(*this==other); }
+	};
+
+	struct ComponentInfo {
+		size_t size;
+		size_t align;
+	};
+
+	// Register a new component type; throws std::runtime_error past MAX_COMPONENTS
+	ComponentID registerComponent(size_t size, size_t align);
+	const ComponentInfo & componentInfo(ComponentID id);
+
+	// Process wide ID of a component type, assigned on first use
+	template<typename T>
+	ComponentID componentID() {
+		static_assert(std::is_trivially_copyable_v<T>, "ECS components must be trivially copyable");
+		static const ComponentID id = registerComponent(sizeof(T), alignof(T));
+		return id;
+	}
+
+	template<typename... Ts>
+	Signature signatureOf() {
+		return (Signature(0) | ... | (Signature(1) << componentID<Ts>()));
+	}
+
+	// Block of memory for a number of entities of one archetype:
+	// [entities][column of component A][column of component B]...
+	struct Chunk {
+		unsigned char * data;
+		uint32_t count = 0;
+
+		Chunk(size_t bytes) : data(static_cast<unsigned char *>(::operator new(bytes, std::align_val_t(64)))) {}
+		~Chunk() { ::operator delete(data, std::align_val_t(64)); }
+
+		// Delete copy and assignment constructors
+		Chunk(const Chunk &) = delete;
+		Chunk & operator=(const Chunk &) = delete;
+
+		Entity * entities() { return reinterpret_cast<Entity *>(data); }
+	};
+
+	class Archetype {
+	public:
+		Archetype(Signature signature);
+
+		// Delete copy and assignment constructors
+		Archetype(const Archetype &) = delete;
+		Archetype & operator=(const Archetype &) = delete;
+
+		Signature getSignature() const { return signature; }
+		bool has(ComponentID id) const { return signature & (Signature(1) << id); }
+		bool matches(Signature query) const { return (signature & query)==query; }
+
+		// Number of entities per chunk
+		uint32_t getCapacity() const { return capacity; }
+		size_t getSize() const { return size; }
+
+		std::vector<std::unique_ptr<Chunk>> & getChunks() { return chunks; }
+
+		// Raw column of a component in a chunk
+		void * column(Chunk & chunk, ComponentID id) const { return chunk.data + offsets[id]; }
+
+		template<typename T>
+		T * column(Chunk & chunk) const { return static_cast<T *>(column(chunk, componentID<T>())); }
+
+		const std::vector<ComponentID> & getComponents() const { return components; }
+
+	private:
+		Signature signature;
+		std::vector<ComponentID> components;
+		// Byte offset of each component's column inside a chunk and component sizes (indexed by ComponentID)
+		size_t offsets[MAX_COMPONENTS] = {};
+		size_t sizes[MAX_COMPONENTS] = {};
+		size_t chunkBytes;
+		uint32_t capacity;
+		// Number of entities in all chunks; only the last chunk may be not full
+		size_t size = 0;
+		std::vector<std::unique_ptr<Chunk>> chunks;
+
+		friend class World;
+	};
+
+	class World {
+	public:
+		World() = default;
+
+		// Delete copy and assignment constructors
+		World(const World &) = delete;
+		World & operator=(const World &) = delete;
+
+		// Create an entity with the given components
+		template<typename... Ts>
+		Entity create(const Ts &... components) {
+			Entity e = allocateEntity();
+			Archetype * archetype = archetypeFor(signatureOf<Ts...>());
+			place(e, archetype);
+			const Record & rec = records[e.index];
+			Chunk & chunk = *archetype->chunks[rec.chunk];
+			((archetype->column<Ts>(chunk)[rec.row] = components), ...);
+			return e;
+		}
+
+		// Remove the entity with all of it's components
+		void destroy(Entity e);
+
+		bool isAlive(Entity e) const {
+			return e.index < records.size() && records[e.index].generation==e.generation && records[e.index].archetype;
+		}
+
+		// Component of an entity; nullptr if the entity doesn't have it
+		template<typename T>
+		T * get(Entity e) {
+			if(!isAlive(e))
+				return nullptr;
+			const Record & rec = records[e.index];
+			if(!rec.archetype->has(componentID<T>()))
+				return nullptr;
+			return &rec.archetype->column<T>(*rec.archetype->chunks[rec.chunk])[rec.row];
+		}
+
+		// Add (or overwrite) a component; moves the entity to another archetype
+		template<typename T>
+		void add(Entity e, const T & component) {
+			if(!isAlive(e))
+				return;
+			ComponentID id = componentID<T>();
+			if(!records[e.index].archetype->has(id))
+				moveEntity(e, archetypeFor(records[e.index].archetype->getSignature() | (Signature(1) << id)));
+			*get<T>(e) = component;
+		}
+
+		// Remove a component; moves the entity to another archetype
+		template<typename T>
+		void remove(Entity e) {
+			if(!isAlive(e))
+				return;
+			ComponentID id = componentID<T>();
+			if(records[e.index].archetype->has(id))
+				moveEntity(e, archetypeFor(records[e.index].archetype->getSignature() & ~(Signature(1) << id)));
+		}
+
+		// Call f(count, entities, Ts * columns...) for each chunk of matching archetypes
+		template<typename... Ts, typename F>
+		void eachChunk(F && f) {
+			Signature query = signatureOf<Ts...>();
+			for(auto & archetype : archetypes) {
+				if(!archetype->matches(query))
+					continue;
+				for(auto & chunk : archetype->chunks)
+					if(chunk->count)
+						f((size_t)chunk->count, chunk->entities(), archetype->template column<Ts>(*chunk)...);
+			}
+		}
+
+		// Call f(Ts &...) for each entity having all of the components
+		template<typename... Ts, typename F>
+		void each(F && f) {
+			eachChunk<Ts...>([&f](size_t count, Entity *, Ts *... columns) {
+				for(size_t i = 0; i < count; ++i)
+					f(columns[i]...);
+			});
+		}
+
+		// Like eachChunk, but chunks are spread over the job pool (see Jobs.hpp), a few pieces
+		// per thread for up to numThreads threads. f must be safe to call concurrently for different chunks.
+		template<typename... Ts, typename F>
+		void parallelEachChunk(F && f, unsigned numThreads = job::global().size()) {
+			parallelEachChunkIndexed<Ts...>([&f](size_t, size_t count, Entity * entities, Ts *... columns) {
+				f(count, entities, columns...);
+			}, numThreads);
+		}
+
+		// Like parallelEachChunk, calling f(first, count, entities, Ts * columns...) where `first` is the
+		// position of the chunk's first entity in eachChunk order, so results can be written in place
+		template<typename... Ts, typename F>
+		void parallelEachChunkIndexed(F && f, unsigned numThreads = job::global().size()) {
+			struct Work {
+				Archetype * archetype;
+				Chunk * chunk;
+				size_t first;
+			};
+			Signature query = signatureOf<Ts...>();
+			std::vector<Work> work;
+			size_t first = 0;
+			for(auto & archetype : archetypes)
+				if(archetype->matches(query))
+					for(auto & chunk : archetype->chunks)
+						if(chunk->count) {
+							work.push_back(Work{archetype.get(), chunk.get(), first});
+							first += chunk->count;
+						}
+
+			auto run = [&](size_t begin, size_t end) {
+				for(size_t i = begin; i < end; ++i) {
+					const Work & w = work[i];
+					f(w.first, (size_t)w.chunk->count, w.chunk->entities(), w.archetype->template column<Ts>(*w.chunk)...);
+				}
+			};
+			if(std::max(1u, numThreads)==1)
+				run(0, work.size());
+			else
+				job::parallelFor(0, work.size(), job::grainFor(work.size(), numThreads), run);
+		}
+
+		// Number of alive entities
+		size_t size() const { return records.size() - freeIndices.size(); }
+
+		// Number of entities having all of the components
+		template<typename... Ts>
+		size_t countOf() const {
+			Signature query = signatureOf<Ts...>();
+			size_t count = 0;
+			for(const auto & archetype : archetypes)
+				if(archetype->matches(query))
+					for(const auto & chunk : archetype->chunks)
+						count += chunk->count;
+			return count;
+		}
+
+		size_t getNumArchetypes() const { return archetypes.size(); }
+
+	private:
+		// Where an entity lives
+		struct Record {
+			Archetype * archetype = nullptr;
+			uint32_t chunk = 0;
+			uint32_t row = 0;
+			uint32_t generation = 0;
+		};
+
+		std::vector<Record> records;
+		std::vector<uint32_t> freeIndices;
+		std::vector<std::unique_ptr<Archetype>> archetypes;
+		std::unordered_map<Signature, Archetype *> archetypeMap;
+
+		Entity allocateEntity();
+		Archetype * archetypeFor(Signature signature);
+
+		// Append the entity at the end of the archetype (components left uninitialized)
+		void place(Entity e, Archetype * archetype);
+
+		// Fill the hole at (chunk, row) with the archetype's last entity
+		void removeRow(Archetype * archetype, uint32_t chunk, uint32_t row);
+
+		// Move the entity to another archetype, carrying over the components both have
+		void moveEntity(Entity e, Archetype * to);
+	};
+}
+
+#endif /* ECS_HPP */
@@ -0,0 +1,168 @@
+#include "FrameGraph.hpp"
+
+#include <algorithm>
+
+void FrameGraph::reset() {
+	textures.clear();
+	passes.clear();
+	slots.clear();
+}
+
+FrameGraph::TextureID FrameGraph::create(const std::string & name, const RenderTargetDesc & desc) {
+	Texture texture;
+	texture.name = name;
+	texture.desc = desc;
+	textures.push_back(texture);
+	return (TextureID)(textures.size() - 1);
+}
+
+void FrameGraph::addPass(const std::string & name, const std::vector<TextureID> & reads,
+												 const std::vector<TextureID> & writes, Record record) {
+	// compile() indexes the textures with every ID of a pass, so passes with an invalid one are dropped
+	for(TextureID texture : reads)
+		if(texture==Backbuffer || texture >= textures.size()) {
+			std::cerr << "ERROR: (FrameGraph::addPass) Pass " << name << " reads an invalid texture, pass dropped\n";
+			return;
+		}
+	for(TextureID texture : writes)
+		if(texture!=Backbuffer && texture >= textures.size()) {
+			std::cerr << "ERROR: (FrameGraph::addPass) Pass " << name << " writes an invalid texture, pass dropped\n";
+			return;
+		}
+
+	Pass pass;
+	pass.name = name;
+	pass.reads = reads;
+	pass.writes = writes;
+	pass.record = std::move(record);
+	passes.push_back(std::move(pass));
+}
+
+void FrameGraph::compile(int referenceWidth, int referenceHeight) {
+	for(Texture & texture : textures) {
+		texture.readers = 0;
+		texture.slot = NoSlot;
+		texture.first = ~0u;
+		texture.last = 0;
+	}
+	for(Pass & pass : passes) {
+		pass.references = (uint32_t)pass.writes.size();
+		pass.culled = false;
+		for(TextureID texture : pass.reads)
+			textures[texture].readers++;
+	}
+
+	// Textures nobody reads make their writers lose a reference; a writer without any left is culled and
+	// it's reads lose a reader in turn. The Backbuffer is never unread
+	std::vector<TextureID> unread;
+	for(TextureID i = 0; i < textures.size(); ++i)
+		if(!textures[i].readers)
+			unread.push_back(i);
+	auto cull = [&](Pass & pass) {
+		pass.culled = true;
+		for(TextureID texture : pass.reads)
+			if(--textures[texture].readers==0)
+				unread.push_back(texture);
+	};
+	for(Pass & pass : passes)
+		if(!pass.references)
+			cull(pass);
+	while(!unread.empty()) {
+		TextureID texture = unread.back();
+		unread.pop_back();
+		for(Pass & pass : passes)
+			if(!pass.culled && std::count(pass.writes.begin(), pass.writes.end(), texture))
+				if(--pass.references==0)
+					cull(pass);
+	}
+
+	// Lifetimes over the kept passes
+	for(uint32_t i = 0; i < passes.size(); ++i) {
+		if(passes[i].culled)
+			continue;
+		for(const std::vector<TextureID> * used : {&passes[i].reads, &passes[i].writes})
+			for(TextureID texture : *used)
+				if(texture!=Backbuffer) {
+					textures[texture].first = std::min(textures[texture].first, i);
+					textures[texture].last = std::max(textures[texture].last, i);
+				}
+	}
+
+	// Slots: a texture takes a free one of it's size and format when it's first used and frees it
+	// after it's last use
+	slots.clear();
+	std::vector<uint32_t> free;
+	for(uint32_t i = 0; i < passes.size(); ++i) {
+		if(passes[i].culled)
+			continue;
+		for(const std::vector<TextureID> * used : {&passes[i].reads, &passes[i].writes})
+			for(TextureID texture : *used) {
+				if(texture==Backbuffer || textures[texture].first!=i || textures[texture].slot!=NoSlot)
+					continue;
+				Texture & t = textures[texture];
+				auto found = std::find_if(free.begin(), free.end(), [&](uint32_t slot) { return slots[slot]==t.desc; });
+				if(found!=free.end()) {
+					t.slot = *found;
+					free.erase(found);
+				}
+				else {
+					t.slot = (uint32_t)slots.size();
+					slots.push_back(t.desc);
+				}
+			}
+		for(Texture & texture : textures)
+			if(texture.slot!=NoSlot && texture.last==i && texture.first!=~0u) {
+				free.push_back(texture.slot);
+				// Released once
+				texture.first = ~0u;
+			}
+	}
+
+	stats = Stats();
+	stats.passes = passes.size();
+	stats.transients = textures.size();
+	stats.slots = slots.size();
+	for(const Pass & pass : passes)
+		stats.culled += pass.culled;
+	for(const Texture & texture : textures)
+		if(texture.slot!=NoSlot)
+			stats.bytes += texture.desc.getBytes(referenceWidth, referenceHeight);
+	for(const RenderTargetDesc & slot : slots)
+		stats.aliasedBytes += slot.getBytes(referenceWidth, referenceHeight);
+}
+
+void FrameGraph::record(CommandBuffer & commands, RenderTargetPool * pool, int framebufferWidth,
+												int framebufferHeight) const {
+	size_t count = slots.size();
+	RenderTargetDesc * descs = commands.allocate<RenderTargetDesc>(count);
+	std::copy(slots.begin(), slots.end(), descs);
+	commands.record([=]() {
+		pool->beginFrame(descs, count, framebufferWidth, framebufferHeight);
+	});
+
+	for(const Pass & pass : passes) {
+		if(pass.culled)
+			continue;
+		// The Backbuffer is bound alone, as the default framebuffer
+		bool backbuffer = std::count(pass.writes.begin(), pass.writes.end(), Backbuffer) > 0;
+		size_t targetCount = backbuffer ? 0 : pass.writes.size();
+		uint32_t * targets = commands.allocate<uint32_t>(targetCount);
+		for(size_t i = 0; i < targetCount; ++i)
+			targets[i] = textures[pass.writes[i]].slot;
+		commands.record([=]() {
+			pool->bind(targets, targetCount);
+		});
+		pass.record(commands);
+	}
+}
+
+uint32_t FrameGraph::getSlot(TextureID texture) const {
+	return texture < textures.size() ? textures[texture].slot : NoSlot;
+}
+
+bool FrameGraph::isCulled(const std::string & pass) const {
+	for(const Pass & p : passes)
+		if(p.name==pass)
+			return p.culled;
+	return true;
+}
@@ -0,0 +1,127 @@
+/*
+ * Frame graph: the passes of a frame and the render targets between them.
+ *
+ * Every frame passes are declared in execution order with the textures
+ * they read and write and a function recording their commands. Textures
+ * are either transient - created by the graph, living only within the
+ * frame - or the Backbuffer, the default framebuffer. compile() then:
+ * - culls passes nothing uses: a pass is kept if it writes the Backbuffer
+ *   or a texture a kept pass reads (counted back from the readers, so a
+ *   chain of unused passes goes away as a whole);
+ * - finds the lifetime of every transient, from the first kept pass using
+ *   it to the last one;
+ * - assigns transients to slots of a RenderTargetPool. A slot freed after
+ *   the last use of a transient is reused by a later one of the same size
+ *   and format, so transients that never live at the same time share
+ *   memory. OpenGL can't place textures in shared memory, so aliasing here
+ *   means sharing whole texture objects.
+ * record() records the kept passes, each preceded by a command binding it's
+ * targets. Culled passes record nothing, so they cost no CPU either.
+ *
+ * Declaring and compiling (on the simulation thread) touches no GL;
+ * recorded commands use the pool on the GL thread.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef FRAME_GRAPH_HPP
+#define FRAME_GRAPH_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <functional>
+
+#include "CommandBuffer.hpp"
+#include "RenderTargetPool.hpp"
+
+class FrameGraph {
+public:
+	typedef uint32_t TextureID;
+	// The default framebuffer; only written, by passes whose results are shown
+	static constexpr TextureID Backbuffer = ~0u;
+	static constexpr uint32_t NoSlot = ~0u;
+
+	// Records the commands of a pass
+	typedef std::function<void(CommandBuffer & commands)> Record;
+
+	struct Stats {
+		size_t passes = 0;
+		size_t culled = 0;
+		size_t transients = 0;
+		// Pool slots the transients were assigned to
+		size_t slots = 0;
+		// Memory of the transients at the reference size, without and with aliasing
+		size_t bytes = 0;
+		size_t aliasedBytes = 0;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[frame graph|passes:" << s.passes
+				 << "|culled:" << s.culled
+				 << "|transients:" << s.transients
+				 << "|slots:" << s.slots
+				 << "|MB:" << s.bytes / (1024.*1024.)
+				 << "|aliasedMB:" << s.aliasedBytes / (1024.*1024.)
+				 << "]";
+			return os;
+		}
+	};
+
+	FrameGraph() = default;
+
+	// Delete copy and assignment constructors
+	FrameGraph(const FrameGraph &) = delete;
+	FrameGraph & operator=(const FrameGraph &) = delete;
+
+	// Drop the passes and textures of the last frame
+	void reset();
+
+	TextureID create(const std::string & name, const RenderTargetDesc & desc);
+	// Targets of `writes` are bound while the pass' commands execute. A pass reading the Backbuffer or
+	// using a texture not created this frame is reported and dropped
+	void addPass(const std::string & name, const std::vector<TextureID> & reads, const std::vector<TextureID> & writes,
+							 Record record);
+
+	// Cull, find lifetimes and assign slots; stats report memory at the given reference size
+	void compile(int referenceWidth = 1920, int referenceHeight = 1080);
+	// Record the kept passes: the first command gives the pool this frame's slots
+	void record(CommandBuffer & commands, RenderTargetPool * pool, int framebufferWidth, int framebufferHeight) const;
+
+	// After compile(): pool slot of a texture, NoSlot if it's unused (or the Backbuffer)
+	uint32_t getSlot(TextureID texture) const;
+	bool isCulled(const std::string & pass) const;
+
+	const Stats & getStats() const { return stats; }
+
+private:
+	struct Texture {
+		std::string name;
+		RenderTargetDesc desc;
+		// Kept passes reading it
+		uint32_t readers = 0;
+		uint32_t slot = NoSlot;
+		// First and last kept pass using it
+		uint32_t first = ~0u;
+		uint32_t last = 0;
+	};
+
+	struct Pass {
+		std::string name;
+		std::vector<TextureID> reads;
+		std::vector<TextureID> writes;
+		Record record;
+		// Written textures read by kept passes (or the Backbuffer); culled at 0
+		uint32_t references = 0;
+		bool culled = false;
+	};
+
+	std::vector<Texture> textures;
+	std::vector<Pass> passes;
+	std::vector<RenderTargetDesc> slots;
+	Stats stats;
+};
+
+#endif /* FRAME_GRAPH_HPP */
@@ -0,0 +1,122 @@
+#include "FramePacer.hpp"
+
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+#include <GLFW/glfw3.h>
+
+namespace {
+	double toMs(std::chrono::steady_clock::duration duration) {
+		return std::chrono::duration<double, std::milli>(duration).count();
+	}
+}
+
+FramePacer::FramePacer(const Settings & settings) :
+	settings(settings),
+	swapIntervalChanged(settings.swapInterval >= 0) {
+}
+
+void FramePacer::beginFrame() {
+	Settings current = getSettings();
+	Clock::time_point now = Clock::now();
+	double capWait = 0.;
+	if(current.targetFrameMs > 0. && started) {
+		auto target = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(current.targetFrameMs));
+		deadline += target;
+		// Too late to keep the schedule: start it over from now
+		if(deadline < now)
+			deadline = now;
+		waitUntil(deadline, current.spinMs);
+		capWait = toMs(Clock::now() - now);
+	}
+	else
+		deadline = now;
+
+	Clock::time_point start = Clock::now();
+	std::lock_guard<std::mutex> lock(mutex);
+	if(started) {
+		double frameMs = toMs(start - frameStart);
+		stats.frames++;
+		stats.frameMs += frameMs;
+		stats.capWaitMs += capWait;
+		if(current.targetFrameMs > 0.)
+			stats.maxErrorMs = std::max(stats.maxErrorMs, std::abs(frameMs - current.targetFrameMs));
+	}
+	frameStart = start;
+	started = true;
+}
+
+void FramePacer::endFrame() {
+	double cpu = toMs(Clock::now() - frameStart);
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.cpuMs += cpu;
+}
+
+double FramePacer::waitUntil(std::chrono::steady_clock::time_point deadline, double spinMs) {
+	auto spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(spinMs));
+	if(Clock::now() < deadline - spin)
+		std::this_thread::sleep_until(deadline - spin);
+	while(Clock::now() < deadline)
+		std::this_thread::yield();
+	return toMs(Clock::now() - deadline);
+}
+
+void FramePacer::beginGPUFrame() {
+	Settings current;
+	bool applySwapInterval;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		current = settings;
+		applySwapInterval = swapIntervalChanged;
+		swapIntervalChanged = false;
+	}
+	if(applySwapInterval && current.swapInterval >= 0)
+		glfwSwapInterval(current.swapInterval);
+
+	Clock::time_point start = Clock::now();
+	// With a limit of N, this frame may start once the one N frames back is done
+	while(current.maxFramesInFlight > 0 && fences.size() >= current.maxFramesInFlight) {
+		GLsync fence = fences.front();
+		fences.pop_front();
+		// The first wait flushes, so the fence is sure to reach the GPU
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		GLenum result;
+		do {
+			result = glClientWaitSync(fence, flags, 1000000);
+			flags = 0;
+		} while(result==GL_TIMEOUT_EXPIRED);
+		if(result==GL_WAIT_FAILED)
+			std::cerr << "ERROR: (FramePacer::beginGPUFrame) Waiting for a fence failed\n";
+		glDeleteSync(fence);
+	}
+	double waited = toMs(Clock::now() - start);
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.fenceWaitMs += waited;
+}
+
+void FramePacer::endGPUFrame() {
+	fences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void FramePacer::setSettings(const Settings & settings) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if(settings.swapInterval!=this->settings.swapInterval)
+		swapIntervalChanged = true;
+	this->settings = settings;
+}
+
+FramePacer::Settings FramePacer::getSettings() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return settings;
+}
+
+FramePacer::Stats FramePacer::getStats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void FramePacer::resetStats() {
+	std::lock_guard<std::mutex> lock(mutex);
+	stats = Stats();
+}
@@ -0,0 +1,119 @@
+/*
+ * Frame pacing: swap interval, a limit of frames queued on the GPU and a
+ * precise frame rate cap.
+ *
+ * Without pacing the loop runs as fast as the swap lets it, and the driver
+ * may queue several frames ahead of the GPU - more throughput, but input
+ * read by the CPU shows up frames later. The pacer trades one against the
+ * other:
+ * - The swap interval (0 = no vsync) is applied on the GL thread.
+ * - After every swap a fence is inserted; before a frame is executed the GL
+ *   thread waits for the fence of the frame maxFramesInFlight back, so the
+ *   GPU is never more than that many frames behind.
+ * - The simulation thread can be capped to a target frame time. Sleeping
+ *   alone overshoots by the scheduler's granularity, so it sleeps until
+ *   spinMs before the deadline and yields in a loop for the rest. Deadlines
+ *   follow each other by exactly the target, so errors don't add up; after
+ *   a frame too long to catch up with the schedule starts over.
+ *
+ * The simulation side (beginFrame/endFrame) and the GL side (beginGPUFrame/
+ * endGPUFrame, see RenderThread.hpp) may run on different threads.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+
+#include <glad/glad.h>
+
+class FramePacer {
+public:
+	struct Settings {
+		// glfwSwapInterval() value, -1 keeps the driver's default
+		int swapInterval = -1;
+		// Frames the GPU may be behind the GL thread, 0 for no limit
+		unsigned maxFramesInFlight = 2;
+		// Frame time of the cap in milliseconds, 0 for no cap
+		double targetFrameMs = 0.;
+		// Time before a deadline spent yielding instead of sleeping
+		double spinMs = 2.;
+	};
+
+	// Per frame averages since the last reset
+	struct Stats {
+		size_t frames = 0;
+		// Simulation: recording a frame, waiting for the cap
+		double cpuMs = 0.;
+		double capWaitMs = 0.;
+		// GL thread: waiting for the GPU
+		double fenceWaitMs = 0.;
+		// Time between frame starts, and it's worst distance from the target (with a cap)
+		double frameMs = 0.;
+		double maxErrorMs = 0.;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			double n = s.frames ? (double)s.frames : 1.;
+			os << "[pacing|frames:" << s.frames
+				 << "|cpuMs:" << s.cpuMs / n
+				 << "|capWaitMs:" << s.capWaitMs / n
+				 << "|fenceWaitMs:" << s.fenceWaitMs / n
+				 << "|frameMs:" << s.frameMs / n
+				 << "|maxErrorMs:" << s.maxErrorMs
+				 << "]";
+			return os;
+		}
+	};
+
+	explicit FramePacer(const Settings & settings);
+
+	// Delete copy and assignment constructors
+	FramePacer(const FramePacer &) = delete;
+	FramePacer & operator=(const FramePacer &) = delete;
+
+	// Simulation thread: wait for the frame's deadline (with a cap) and start timing it
+	void beginFrame();
+	// Simulation thread: the frame is recorded
+	void endFrame();
+
+	// GL thread, before executing a frame: apply a changed swap interval and wait until the GPU
+	// is less than maxFramesInFlight frames behind
+	void beginGPUFrame();
+	// GL thread, after the swap: fence the frame
+	void endGPUFrame();
+
+	// Takes effect with the next frame
+	void setSettings(const Settings & settings);
+	Settings getSettings() const;
+
+	Stats getStats() const;
+	void resetStats();
+
+	// Sleep until spinMs before `deadline`, then yield until it; returns how late it woke (ms)
+	static double waitUntil(std::chrono::steady_clock::time_point deadline, double spinMs);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	mutable std::mutex mutex;
+	Settings settings;
+	bool swapIntervalChanged;
+	Stats stats;
+
+	// Simulation side
+	Clock::time_point deadline;
+	Clock::time_point frameStart;
+	bool started = false;
+
+	// GL side: fences of the frames in flight, oldest first
+	std::deque<GLsync> fences;
+};
+
+#endif /* FRAME_PACER_HPP */
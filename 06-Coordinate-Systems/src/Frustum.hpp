@@ -0,0 +1,73 @@
+/*
+ * View frustum as 6 planes extracted from a view-projection matrix
+ * (Gribb-Hartmann method). Plane normals point inside the frustum,
+ * so a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all planes.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+struct Frustum {
+	enum Plane {
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far
+	};
+
+	glm::vec4 planes[6];
+
+	// Planes of a projection * view matrix (OpenGL clip space, z in [-w, w])
+	static Frustum fromMatrix(const glm::mat4 & viewProjection) {
+		auto row = [&viewProjection](int i) {
+			return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		};
+		Frustum f;
+		f.planes[Left] = row(3) + row(0);
+		f.planes[Right] = row(3) - row(0);
+		f.planes[Bottom] = row(3) + row(1);
+		f.planes[Top] = row(3) - row(1);
+		f.planes[Near] = row(3) + row(2);
+		f.planes[Far] = row(3) - row(2);
+		for(auto & p : f.planes)
+			p = p / glm::length(glm::vec3(p));
+		return f;
+	}
+
+	// Every plane moved `distance` outwards; contains this frustum moved by up to that distance
+	Frustum expanded(float distance) const {
+		Frustum f = *this;
+		for(auto & p : f.planes)
+			p.w += distance;
+		return f;
+	}
+
+	// Conservative box test; true unless the box is fully outside one of the planes
+	bool intersects(const glm::vec3 & center, const glm::vec3 & extent) const {
+		for(const auto & p : planes) {
+			float d = p.x*center.x + p.y*center.y + p.z*center.z + p.w;
+			float r = std::fabs(p.x)*extent.x + std::fabs(p.y)*extent.y + std::fabs(p.z)*extent.z;
+			if(d + r < 0.f)
+				return false;
+		}
+		return true;
+	}
+
+	bool intersects(const glm::vec3 & center, float radius) const {
+		for(const auto & p : planes)
+			if(p.x*center.x + p.y*center.y + p.z*center.z + p.w < -radius)
+				return false;
+		return true;
+	}
+};
+
+#endif /* FRUSTUM_HPP */
@@ -0,0 +1,53 @@
+#include "GPUTimer.hpp"
+
+GPUTimer::~GPUTimer() {
+	if(created)
+		glDeleteQueries(NumQueries, queries);
+}
+
+bool GPUTimer::readOldest(size_t & slot, double & ms) {
+	// Results arrive in order; stop at the first one still in flight
+	if(oldest==next)
+		return false;
+	GLuint query = queries[oldest % NumQueries];
+	GLint available = 0;
+	glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if(!available)
+		return false;
+	GLuint64 ns = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+	slot = oldest % NumQueries;
+	ms = ns * 1e-6;
+	totalMs += ms;
+	samples++;
+	++oldest;
+	return true;
+}
+
+size_t GPUTimer::begin() {
+	if(!created) {
+		glGenQueries(NumQueries, queries);
+		created = true;
+	}
+	read([](size_t, double) {});
+
+	if(next - oldest >= NumQueries)
+		return NumQueries;
+	size_t slot = next % NumQueries;
+	glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+	++next;
+	timing = true;
+	return slot;
+}
+
+void GPUTimer::end() {
+	if(timing) {
+		glEndQuery(GL_TIME_ELAPSED);
+		timing = false;
+	}
+}
+
+void GPUTimer::resetStats() {
+	totalMs = 0.;
+	samples = 0;
+}
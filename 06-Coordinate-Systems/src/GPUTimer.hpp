@@ -0,0 +1,70 @@
+/*
+ * GPU time of a range of GL commands, measured with timer queries.
+ *
+ * Results of a GL_TIME_ELAPSED query arrive frames after it ended, so each
+ * timer keeps a small ring of queries and reads the ones that finished at
+ * the next begin() - the CPU never waits for the GPU. A frame whose query
+ * finds the ring full isn't measured. Each result can also be taken with
+ * the ring slot it's query ran in (read()), e.g. to know what the measured
+ * frame was drawn with (see DynamicResolution.hpp). Time elapsed queries
+ * can't nest: only one timer may run at a time.
+ *
+ * GL thread only.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+
+#include <cstddef>
+
+#include <glad/glad.h>
+
+class GPUTimer {
+public:
+	static constexpr size_t NumQueries = 4;
+
+	GPUTimer() = default;
+	~GPUTimer();
+
+	// Delete copy and assignment constructors
+	GPUTimer(const GPUTimer &) = delete;
+	GPUTimer & operator=(const GPUTimer &) = delete;
+
+	// Start measuring; returns the ring slot of the query, NumQueries when the ring is full and this
+	// range isn't measured. Results that arrived are read first (without a callback)
+	size_t begin();
+	void end();
+
+	// Read the results that arrived, in order: onResult(slot, ms) with the slot begin() returned
+	template<typename F>
+	void read(const F & onResult) {
+		size_t slot;
+		double ms;
+		while(readOldest(slot, ms))
+			onResult(slot, ms);
+	}
+
+	// Average of the results that arrived since the last reset, and how many there were
+	double getMs() const { return samples ? totalMs / samples : 0.; }
+	size_t getSamples() const { return samples; }
+	void resetStats();
+
+private:
+	// Ring of queries; [oldest, next) are waiting for results
+	GLuint queries[NumQueries] = {};
+	size_t oldest = 0;
+	size_t next = 0;
+	bool created = false;
+	bool timing = false;
+
+	double totalMs = 0.;
+	size_t samples = 0;
+
+	// Take the oldest query's result if it arrived
+	bool readOldest(size_t & slot, double & ms);
+};
+
+#endif /* GPU_TIMER_HPP */
@@ -0,0 +1,164 @@
+#include "GeometryPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Mesh.hpp"
+
+GeometryPool::RangeAllocator::RangeAllocator(uint32_t capacity) : capacity(capacity) {
+	if(capacity) {
+		free.emplace(0, capacity);
+		bySize.emplace(capacity, 0);
+	}
+}
+
+bool GeometryPool::RangeAllocator::allocate(uint32_t size, uint32_t & start) {
+	if(size==0) {
+		start = 0;
+		return true;
+	}
+	// Smallest free range that fits
+	auto it = bySize.lower_bound(size);
+	if(it==bySize.end())
+		return false;
+	start = it->second;
+	uint32_t left = it->first - size;
+	bySize.erase(it);
+	free.erase(start);
+	if(left) {
+		free.emplace(start + size, left);
+		bySize.emplace(left, start + size);
+	}
+	return true;
+}
+
+void GeometryPool::RangeAllocator::release(uint32_t start, uint32_t size) {
+	if(size==0)
+		return;
+	auto eraseBySize = [this](uint32_t first, uint32_t length) {
+		auto [lo, hi] = bySize.equal_range(length);
+		for(auto it = lo; it!=hi; ++it)
+			if(it->second==first) {
+				bySize.erase(it);
+				return;
+			}
+	};
+
+	auto next = free.lower_bound(start);
+	// Merge with the following range
+	if(next!=free.end() && next->first==start + size) {
+		eraseBySize(next->first, next->second);
+		size += next->second;
+		next = free.erase(next);
+	}
+	// Merge with the preceding range
+	if(next!=free.begin()) {
+		auto prev = std::prev(next);
+		if(prev->first + prev->second==start) {
+			eraseBySize(prev->first, prev->second);
+			start = prev->first;
+			size += prev->second;
+			free.erase(prev);
+		}
+	}
+	free.emplace(start, size);
+	bySize.emplace(size, start);
+}
+
+GeometryPool::GeometryPool(uint32_t verticesPerPage, uint32_t indicesPerPage) :
+	verticesPerPage(verticesPerPage),
+	indicesPerPage(indicesPerPage) {
+}
+
+GeometryPool::Page GeometryPool::createPage(uint32_t vertexCapacity, uint32_t indexCapacity) {
+	Page page;
+	page.vertices = RangeAllocator(vertexCapacity);
+	page.indices = RangeAllocator(indexCapacity);
+
+	glGenVertexArrays(1, &page.VAO);
+	glGenBuffers(1, &page.VBO);
+	glGenBuffers(1, &page.EBO);
+	glBindVertexArray(page.VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, page.VBO);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+	glVertexAttribPointer(Mesh::Attribute::Position, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+	glEnableVertexAttribArray(Mesh::Attribute::Position);
+	glVertexAttribPointer(Mesh::Attribute::Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+	glEnableVertexAttribArray(Mesh::Attribute::Color);
+	glVertexAttribPointer(Mesh::Attribute::TexCoord, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+	glEnableVertexAttribArray(Mesh::Attribute::TexCoord);
+	glVertexAttribPointer(Mesh::Attribute::Normal, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+	glEnableVertexAttribArray(Mesh::Attribute::Normal);
+
+	// VAO keeps track of the element buffer bound while it's bound
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCapacity * sizeof(uint32_t), nullptr, GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	stats.pages++;
+	stats.capacityBytes += (size_t)vertexCapacity * sizeof(Vertex) + (size_t)indexCapacity * sizeof(uint32_t);
+	return page;
+}
+
+GeometryPool::Allocation GeometryPool::allocate(uint32_t vertexCount, uint32_t indexCount) {
+	Allocation a;
+	a.vertexCount = vertexCount;
+	a.indexCount = indexCount;
+
+	for(uint32_t p = 0; p < pages.size(); ++p) {
+		Page & page = pages[p];
+		if(!page.vertices.allocate(vertexCount, a.baseVertex))
+			continue;
+		if(!page.indices.allocate(indexCount, a.firstIndex)) {
+			page.vertices.release(a.baseVertex, vertexCount);
+			continue;
+		}
+		a.page = p;
+		stats.allocations++;
+		return a;
+	}
+
+	// Nothing fits: a new page, big enough even for oversized geometry
+	pages.push_back(createPage(std::max(verticesPerPage, vertexCount), std::max(indicesPerPage, indexCount)));
+	a.page = (uint32_t)pages.size() - 1;
+	if(!pages.back().vertices.allocate(vertexCount, a.baseVertex) || !pages.back().indices.allocate(indexCount, a.firstIndex))
+		throw std::runtime_error("GeometryPool: allocation failed on a fresh page\n");
+	stats.allocations++;
+	return a;
+}
+
+void GeometryPool::upload(const Allocation & a, const Vertex * vertices, const uint32_t * indices) {
+	const Page & page = pages[a.page];
+	glBindBuffer(GL_COPY_WRITE_BUFFER, page.VBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)a.baseVertex * sizeof(Vertex), (GLsizeiptr)a.vertexCount * sizeof(Vertex), vertices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, page.EBO);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)a.firstIndex * sizeof(uint32_t), (GLsizeiptr)a.indexCount * sizeof(uint32_t), indices);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	stats.vertexBytes += (size_t)a.vertexCount * sizeof(Vertex);
+	stats.indexBytes += (size_t)a.indexCount * sizeof(uint32_t);
+}
+
+void GeometryPool::free(const Allocation & a) {
+	Page & page = pages[a.page];
+	page.vertices.release(a.baseVertex, a.vertexCount);
+	page.indices.release(a.firstIndex, a.indexCount);
+	stats.allocations--;
+	stats.vertexBytes -= std::min(stats.vertexBytes, (size_t)a.vertexCount * sizeof(Vertex));
+	stats.indexBytes -= std::min(stats.indexBytes, (size_t)a.indexCount * sizeof(uint32_t));
+}
+
+void GeometryPool::bind(uint32_t page) const {
+	glBindVertexArray(pages[page].VAO);
+}
+
+void GeometryPool::multiDraw(const std::vector<GLsizei> & counts, const std::vector<const void *> & offsets,
+														 const std::vector<GLint> & baseVertices) {
+	if(counts.empty())
+		return;
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(),
+																(GLsizei)counts.size(), const_cast<GLint *>(baseVertices.data()));
+}
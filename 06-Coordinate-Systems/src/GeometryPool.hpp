@@ -0,0 +1,124 @@
+/*
+ * Shared vertex and index storage for many meshes of the same vertex layout.
+ *
+ * Instead of a VAO, VBO and EBO per mesh, geometry is sub-allocated from a
+ * few big pages, each one a VBO + EBO pair with a single VAO. An allocation
+ * is a (page, baseVertex, firstIndex, counts) record: indices stay relative
+ * to the allocation's first vertex and draws pass baseVertex, so any number
+ * of allocations of a page can be drawn with one VAO bind and a single
+ * glMultiDrawElementsBaseVertex.
+ *
+ * Each page keeps free lists of vertex and index ranges (freed
+ * neighbours are merged, best fit). Geometry bigger than a page gets a page of it's own.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef GEOMETRY_POOL_HPP
+#define GEOMETRY_POOL_HPP
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+class GeometryPool {
+public:
+	// Layout of pooled vertices, attribute locations as in Mesh::Attribute
+	struct Vertex {
+		glm::vec3 position;
+		uint8_t color[4];
+		glm::vec2 texCoord;
+		glm::vec3 normal;
+	};
+
+	struct Allocation {
+		uint32_t page = 0;
+		uint32_t baseVertex = 0;
+		uint32_t firstIndex = 0;
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+	};
+
+	struct Stats {
+		size_t pages = 0;
+		size_t allocations = 0;
+		size_t vertexBytes = 0;
+		size_t indexBytes = 0;
+		size_t capacityBytes = 0;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[geometry pool|pages:" << s.pages
+				 << "|allocations:" << s.allocations
+				 << "|vertexBytes:" << s.vertexBytes
+				 << "|indexBytes:" << s.indexBytes
+				 << "|capacityBytes:" << s.capacityBytes
+				 << "]";
+			return os;
+		}
+	};
+
+	// Best fit allocator over [0, capacity) that merges freed neighbours;
+	// the pages use one for vertices and one for indices
+	struct RangeAllocator {
+		uint32_t capacity = 0;
+		// Free ranges by start, and the same ranges by size for the best fit lookup
+		std::map<uint32_t, uint32_t> free;
+		std::multimap<uint32_t, uint32_t> bySize;
+
+		explicit RangeAllocator(uint32_t capacity = 0);
+		// False when no free range is big enough
+		bool allocate(uint32_t size, uint32_t & start);
+		void release(uint32_t start, uint32_t size);
+	};
+
+	// Page sizes in vertices and 32 bit indices
+	GeometryPool(uint32_t verticesPerPage = 1u << 20, uint32_t indicesPerPage = 1u << 22);
+
+	// Delete copy and assignment constructors
+	GeometryPool(const GeometryPool &) = delete;
+	GeometryPool & operator=(const GeometryPool &) = delete;
+
+	// Reserve space (creates a page if no existing one has room)
+	Allocation allocate(uint32_t vertexCount, uint32_t indexCount);
+
+	// Fill an allocation; indices are relative to it's first vertex
+	void upload(const Allocation & allocation, const Vertex * vertices, const uint32_t * indices);
+
+	// Return the space to the page's free lists
+	void free(const Allocation & allocation);
+
+	// Bind the page's VAO (with it's element buffer)
+	void bind(uint32_t page) const;
+
+	// One call for many ranges of the bound page; offsets are in bytes
+	static void multiDraw(const std::vector<GLsizei> & counts, const std::vector<const void *> & offsets,
+												const std::vector<GLint> & baseVertices);
+
+	size_t getNumPages() const { return pages.size(); }
+	const Stats & getStats() const { return stats; }
+
+private:
+	struct Page {
+		GLuint VAO = 0;
+		GLuint VBO = 0;
+		GLuint EBO = 0;
+		RangeAllocator vertices;
+		RangeAllocator indices;
+	};
+
+	uint32_t verticesPerPage;
+	uint32_t indicesPerPage;
+	std::vector<Page> pages;
+	Stats stats;
+
+	Page createPage(uint32_t vertexCapacity, uint32_t indexCapacity);
+};
+
+#endif /* GEOMETRY_POOL_HPP */
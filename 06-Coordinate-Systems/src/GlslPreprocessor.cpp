@@ -0,0 +1,66 @@
+#include "GlslPreprocessor.hpp"
+
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+
+#include "utils.hpp"
+
+namespace {
+	std::string directoryOf(const std::string & path) {
+		size_t slash = path.find_last_of('/');
+		return slash==std::string::npos ? std::string() : path.substr(0, slash+1);
+	}
+
+	// File name of an `#include "name"` line, empty if the line isn't one
+	std::string includedName(const std::string & line) {
+		size_t start = line.find_first_not_of(" \t");
+		if(start==std::string::npos || line.compare(start, 8, "#include")!=0)
+			return std::string();
+		size_t open = line.find('"', start + 8);
+		size_t close = open==std::string::npos ? open : line.find('"', open + 1);
+		if(close==std::string::npos)
+			throw std::runtime_error("GLSL: malformed #include: " + line + '\n');
+		return line.substr(open + 1, close - open - 1);
+	}
+
+	bool isVersion(const std::string & line) {
+		size_t start = line.find_first_not_of(" \t");
+		return start!=std::string::npos && line.compare(start, 8, "#version")==0;
+	}
+
+	void expand(const std::string & path, const std::vector<std::string> & defines,
+							std::vector<std::string> & files, std::ostringstream & out) {
+		if(std::find(files.begin(), files.end(), path)!=files.end())
+			return;
+		std::string source;
+		utls::readFile(path, source);
+		size_t fileIndex = files.size();
+		files.push_back(path);
+
+		std::istringstream in(source);
+		std::string line;
+		for(size_t number = 1; std::getline(in, line); ++number) {
+			std::string name = includedName(line);
+			if(!name.empty()) {
+				out << "#line 1 " << files.size() << '\n';
+				expand(directoryOf(path) + name, defines, files, out);
+				out << "#line " << number + 1 << ' ' << fileIndex << '\n';
+				continue;
+			}
+			out << line << '\n';
+			if(fileIndex==0 && isVersion(line)) {
+				for(const std::string & define : defines)
+					out << "#define " << define << '\n';
+				out << "#line " << number + 1 << " 0\n";
+			}
+		}
+	}
+}
+
+std::string glsl::preprocess(const std::string & path, const std::vector<std::string> & defines,
+														 std::vector<std::string> & files) {
+	std::ostringstream out;
+	expand(path, defines, files, out);
+	return out.str();
+}
@@ -0,0 +1,31 @@
+/*
+ * Minimal preprocessing of GLSL sources before they are handed to OpenGL,
+ * which has no #include of it's own:
+ * - `#include "file"` is replaced by the file's contents (path relative to
+ *   the including file); every file is included once, so cycles are harmless,
+ * - given defines are injected as `#define` lines right after `#version`.
+ * Everything else, including #ifdef on the injected defines, is left to the
+ * GLSL compiler.
+ *
+ * `#line` directives keep compiler messages pointing at the right lines;
+ * the source string number of a message is the file's index in `files`.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef GLSL_PREPROCESSOR_HPP
+#define GLSL_PREPROCESSOR_HPP
+
+#include <string>
+#include <vector>
+
+namespace glsl {
+	// Read and expand a shader source; each define is "NAME" or "NAME value".
+	// Paths of the files read are appended to `files` (the top file first).
+	// Missing files end with a std::ios_base::failure.
+	std::string preprocess(const std::string & path, const std::vector<std::string> & defines,
+												 std::vector<std::string> & files);
+}
+
+#endif /* GLSL_PREPROCESSOR_HPP */
@@ -0,0 +1,824 @@
+#include "GltfLoader.hpp"
+
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <memory>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "Json.hpp"
+#include "MappedFile.hpp"
+#include "Mesh.hpp"
+#include "Material.hpp"
+#include "Texture.hpp"
+#include "LOD.hpp"
+#include "Meshlets.hpp"
+#include "GeometryPool.hpp"
+#include "Jobs.hpp"
+
+namespace {
+	// GLB container constants
+	constexpr uint32_t GLB_MAGIC = 0x46546C67;  // "glTF"
+	constexpr uint32_t GLB_VERSION = 2;
+	constexpr uint32_t CHUNK_JSON = 0x4E4F534A; // "JSON"
+	constexpr uint32_t CHUNK_BIN = 0x004E4942;  // "BIN\0"
+
+	struct BufferView {
+		size_t byteOffset = 0;
+		size_t byteLength = 0;
+		size_t byteStride = 0;
+	};
+
+	struct Accessor {
+		int bufferView = -1;
+		size_t byteOffset = 0;
+		GLenum componentType = GL_FLOAT;
+		size_t count = 0;
+		int numComponents = 1;
+		bool normalized = false;
+		bool hasBounds = false;
+		glm::vec3 min = glm::vec3(0.f);
+		glm::vec3 max = glm::vec3(0.f);
+	};
+
+	struct MaterialDesc {
+		std::string name;
+		glm::vec4 baseColorFactor = glm::vec4(1.f);
+		int baseColorTexture = -1;
+		float metallicFactor = 1.f;
+		float roughnessFactor = 1.f;
+		bool doubleSided = false;
+	};
+
+	struct ImageDesc {
+		int bufferView = -1;
+		std::string uri;
+	};
+
+	// Everything but meshes; meshes are kept as raw JSON to be parsed in parallel
+	struct Document {
+		std::vector<BufferView> bufferViews;
+		std::vector<Accessor> accessors;
+		std::vector<MaterialDesc> materials;
+		std::vector<ImageDesc> images;
+		std::vector<int> textureSources;
+		std::vector<std::string_view> meshes;
+		const unsigned char * bin = nullptr;
+		size_t binLength = 0;
+		// Build LOD chains and meshlets of big primitives
+		bool detail = true;
+	};
+
+	// Vertex attribute resolved against the binary chunk, ready for glVertexAttribPointer
+	struct AttributeLayout {
+		GLuint location;
+		int bufferView;
+		GLint size;
+		GLenum type;
+		GLboolean normalized;
+		GLsizei stride;
+		size_t offset;
+	};
+
+	struct PrimitiveLayout {
+		std::vector<AttributeLayout> attributes;
+		int indexView = -1;
+		GLenum indexType = GL_UNSIGNED_INT;
+		size_t indexOffset = 0;
+		GLsizei count = 0;
+		GLenum mode = GL_TRIANGLES;
+		int material = -1;
+		glm::vec3 boundsMin = glm::vec3(0.f);
+		glm::vec3 boundsMax = glm::vec3(0.f);
+		// Level of detail chain: all levels' 32 bit indices one after another
+		std::vector<uint32_t> lodIndices;
+		std::vector<Mesh::LOD> lods;
+		std::shared_ptr<const meshlet::Set> meshlets;
+		// Accessors by attribute location (-1 if missing) and of the indices
+		long long accessors[4] = {-1, -1, -1, -1};
+		long long indices = -1;
+	};
+
+	struct MeshLayout {
+		std::string name;
+		std::vector<PrimitiveLayout> primitives;
+		// Buffer views referenced by this mesh (each becomes a GL buffer)
+		std::vector<int> bufferViews;
+		std::string error;
+	};
+
+	uint32_t readU32(const unsigned char * p) {
+		uint32_t v;
+		std::memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	int numComponentsOf(const std::string & type) {
+		if(type=="SCALAR") return 1;
+		if(type=="VEC2") return 2;
+		if(type=="VEC3") return 3;
+		if(type=="VEC4") return 4;
+		if(type=="MAT2") return 4;
+		if(type=="MAT3") return 9;
+		if(type=="MAT4") return 16;
+		throw std::runtime_error("glTF: unknown accessor type " + type + '\n');
+	}
+
+	size_t componentSize(GLenum componentType) {
+		switch(componentType) {
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		case GL_UNSIGNED_INT:
+		case GL_FLOAT:
+			return 4;
+		default:
+			throw std::runtime_error("glTF: unknown component type\n");
+		}
+	}
+
+	// Attribute semantic to the shaders' attribute location, -1 if not used by the project
+	int locationOf(std::string_view semantic) {
+		if(semantic=="POSITION") return Mesh::Attribute::Position;
+		if(semantic=="COLOR_0") return Mesh::Attribute::Color;
+		if(semantic=="TEXCOORD_0") return Mesh::Attribute::TexCoord;
+		if(semantic=="NORMAL") return Mesh::Attribute::Normal;
+		return -1;
+	}
+
+	void readVec(json::Reader & r, float * out, int n) {
+		r.beginArray();
+		for(int i = 0; r.nextElement(); ++i) {
+			float v = (float)r.readNumber();
+			if(i < n)
+				out[i] = v;
+		}
+	}
+
+	void parseBufferViews(json::Reader & r, Document & doc) {
+		r.beginArray();
+		while(r.nextElement()) {
+			BufferView view;
+			std::string_view key;
+			r.beginObject();
+			while(r.nextKey(key)) {
+				if(key=="buffer") {
+					if(r.readInt()!=0)
+						throw std::runtime_error("glTF: only the GLB binary chunk buffer is supported\n");
+				}
+				else if(key=="byteOffset") view.byteOffset = r.readSize();
+				else if(key=="byteLength") view.byteLength = r.readSize();
+				else if(key=="byteStride") view.byteStride = r.readSize();
+				else r.skipValue();
+			}
+			doc.bufferViews.push_back(view);
+		}
+	}
+
+	void parseAccessors(json::Reader & r, Document & doc) {
+		r.beginArray();
+		while(r.nextElement()) {
+			Accessor acc;
+			bool hasMin = false, hasMax = false;
+			std::string_view key;
+			r.beginObject();
+			while(r.nextKey(key)) {
+				if(key=="bufferView") acc.bufferView = (int)r.readInt();
+				else if(key=="byteOffset") acc.byteOffset = r.readSize();
+				else if(key=="componentType") acc.componentType = (GLenum)r.readInt();
+				else if(key=="count") acc.count = r.readSize();
+				else if(key=="normalized") acc.normalized = r.readBool();
+				else if(key=="type") acc.numComponents = numComponentsOf(r.readString());
+				else if(key=="min") { readVec(r, &acc.min.x, 3); hasMin = true; }
+				else if(key=="max") { readVec(r, &acc.max.x, 3); hasMax = true; }
+				else r.skipValue();
+			}
+			acc.hasBounds = hasMin && hasMax;
+			doc.accessors.push_back(acc);
+		}
+	}
+
+	void parseMaterials(json::Reader & r, Document & doc) {
+		r.beginArray();
+		while(r.nextElement()) {
+			MaterialDesc mat;
+			std::string_view key;
+			r.beginObject();
+			while(r.nextKey(key)) {
+				if(key=="name")
+					mat.name = r.readString();
+				else if(key=="doubleSided")
+					mat.doubleSided = r.readBool();
+				else if(key=="pbrMetallicRoughness") {
+					std::string_view pbrKey;
+					r.beginObject();
+					while(r.nextKey(pbrKey)) {
+						if(pbrKey=="baseColorFactor") readVec(r, &mat.baseColorFactor.x, 4);
+						else if(pbrKey=="metallicFactor") mat.metallicFactor = (float)r.readNumber();
+						else if(pbrKey=="roughnessFactor") mat.roughnessFactor = (float)r.readNumber();
+						else if(pbrKey=="baseColorTexture") {
+							std::string_view texKey;
+							r.beginObject();
+							while(r.nextKey(texKey)) {
+								if(texKey=="index") mat.baseColorTexture = (int)r.readInt();
+								else r.skipValue();
+							}
+						}
+						else r.skipValue();
+					}
+				}
+				else r.skipValue();
+			}
+			doc.materials.push_back(mat);
+		}
+	}
+
+	void parseImages(json::Reader & r, Document & doc) {
+		r.beginArray();
+		while(r.nextElement()) {
+			ImageDesc img;
+			std::string_view key;
+			r.beginObject();
+			while(r.nextKey(key)) {
+				if(key=="bufferView") img.bufferView = (int)r.readInt();
+				else if(key=="uri") img.uri = r.readString();
+				else r.skipValue();
+			}
+			doc.images.push_back(img);
+		}
+	}
+
+	void parseTextures(json::Reader & r, Document & doc) {
+		r.beginArray();
+		while(r.nextElement()) {
+			int source = -1;
+			std::string_view key;
+			r.beginObject();
+			while(r.nextKey(key)) {
+				if(key=="source") source = (int)r.readInt();
+				else r.skipValue();
+			}
+			doc.textureSources.push_back(source);
+		}
+	}
+
+	void parseDocument(std::string_view text, Document & doc) {
+		json::Reader r(text);
+		std::string_view key;
+		r.beginObject();
+		while(r.nextKey(key)) {
+			if(key=="bufferViews") parseBufferViews(r, doc);
+			else if(key=="accessors") parseAccessors(r, doc);
+			else if(key=="materials") parseMaterials(r, doc);
+			else if(key=="images") parseImages(r, doc);
+			else if(key=="textures") parseTextures(r, doc);
+			else if(key=="meshes") {
+				r.beginArray();
+				while(r.nextElement())
+					doc.meshes.push_back(r.captureValue());
+			}
+			else r.skipValue();
+		}
+
+		// Written so that nothing can overflow
+		for(const auto & view : doc.bufferViews)
+			if(view.byteLength > doc.binLength || view.byteOffset > doc.binLength - view.byteLength)
+				throw std::runtime_error("glTF: buffer view exceeds the binary chunk\n");
+	}
+
+	// Check the accessor fits it's buffer view; return it's element stride
+	size_t validateAccessor(const Document & doc, const Accessor & acc) {
+		if(acc.bufferView < 0 || acc.bufferView >= (int)doc.bufferViews.size())
+			throw std::runtime_error("glTF: accessor without a valid buffer view\n");
+		const BufferView & view = doc.bufferViews[acc.bufferView];
+		size_t elementSize = componentSize(acc.componentType) * acc.numComponents;
+		size_t stride = view.byteStride ? view.byteStride : elementSize;
+		// The last element has to end within the view; the count is limited before anything is multiplied
+		if(acc.count && (acc.byteOffset > view.byteLength || elementSize > view.byteLength - acc.byteOffset ||
+										 (stride && acc.count-1 > (view.byteLength - acc.byteOffset - elementSize) / stride)))
+			throw std::runtime_error("glTF: accessor exceeds it's buffer view\n");
+		return stride;
+	}
+
+	const Accessor & accessorAt(const Document & doc, long long index) {
+		if(index < 0 || index >= (long long)doc.accessors.size())
+			throw std::runtime_error("glTF: accessor index out of range\n");
+		return doc.accessors[index];
+	}
+
+	// Bounds of float positions when the accessor doesn't state them
+	void computeBounds(const Document & doc, const Accessor & acc, size_t stride, PrimitiveLayout & prim) {
+		if(acc.componentType!=GL_FLOAT || acc.count==0)
+			return;
+		const unsigned char * base = doc.bin + doc.bufferViews[acc.bufferView].byteOffset + acc.byteOffset;
+		glm::vec3 lo(std::numeric_limits<float>::max());
+		glm::vec3 hi(-std::numeric_limits<float>::max());
+		for(size_t i = 0; i < acc.count; ++i) {
+			glm::vec3 p;
+			std::memcpy(&p.x, base + i*stride, sizeof(float)*3);
+			lo = glm::min(lo, p);
+			hi = glm::max(hi, p);
+		}
+		prim.boundsMin = lo;
+		prim.boundsMax = hi;
+	}
+
+	// Float accessor as a tightly packed array of n components per element
+	void readFloats(const Document & doc, const Accessor & acc, int n, std::vector<float> & out) {
+		size_t stride = validateAccessor(doc, acc);
+		const unsigned char * base = doc.bin + doc.bufferViews[acc.bufferView].byteOffset + acc.byteOffset;
+		size_t first = out.size();
+		out.resize(first + acc.count*n);
+		for(size_t i = 0; i < acc.count; ++i)
+			std::memcpy(&out[first + i*n], base + i*stride, sizeof(float)*n);
+	}
+
+	std::vector<uint32_t> readIndices(const Document & doc, const Accessor & acc) {
+		validateAccessor(doc, acc);
+		const unsigned char * base = doc.bin + doc.bufferViews[acc.bufferView].byteOffset + acc.byteOffset;
+		std::vector<uint32_t> out(acc.count);
+		for(size_t i = 0; i < acc.count; ++i) {
+			switch(acc.componentType) {
+			case GL_UNSIGNED_BYTE:
+				out[i] = base[i];
+				break;
+			case GL_UNSIGNED_SHORT: {
+				uint16_t v;
+				std::memcpy(&v, base + i*2, sizeof(v));
+				out[i] = v;
+				break;
+			}
+			case GL_UNSIGNED_INT:
+				std::memcpy(&out[i], base + i*4, sizeof(uint32_t));
+				break;
+			default:
+				// parsePrimitive() lets no other type through
+				throw std::runtime_error("glTF: index accessors must be UNSIGNED_BYTE/SHORT/INT\n");
+			}
+		}
+		return out;
+	}
+
+	// Component as a float; normalized integers map to [0, 1] or [-1, 1]
+	float readComponent(const unsigned char * p, GLenum type, bool normalized) {
+		switch(type) {
+		case GL_BYTE: { int8_t v; std::memcpy(&v, p, 1); return normalized ? std::max(v / 127.f, -1.f) : v; }
+		case GL_UNSIGNED_BYTE: return normalized ? *p / 255.f : *p;
+		case GL_SHORT: { int16_t v; std::memcpy(&v, p, 2); return normalized ? std::max(v / 32767.f, -1.f) : v; }
+		case GL_UNSIGNED_SHORT: { uint16_t v; std::memcpy(&v, p, 2); return normalized ? v / 65535.f : v; }
+		case GL_UNSIGNED_INT: { uint32_t v; std::memcpy(&v, p, 4); return (float)v; }
+		default: { float v; std::memcpy(&v, p, 4); return v; }
+		}
+	}
+
+	// Primitive's attributes converted to the pooled vertex layout; missing ones get defaults
+	std::vector<GeometryPool::Vertex> readVertices(const Document & doc, const PrimitiveLayout & prim) {
+		const Accessor & pos = doc.accessors[prim.accessors[Mesh::Attribute::Position]];
+		std::vector<GeometryPool::Vertex> vertices(pos.count);
+		for(auto & v : vertices) {
+			v.position = v.normal = glm::vec3(0.f);
+			v.texCoord = glm::vec2(0.f);
+			v.color[0] = v.color[1] = v.color[2] = v.color[3] = 255;
+		}
+
+		for(int location = 0; location < 4; ++location) {
+			if(prim.accessors[location] < 0)
+				continue;
+			const Accessor & acc = doc.accessors[prim.accessors[location]];
+			size_t stride = validateAccessor(doc, acc);
+			size_t size = componentSize(acc.componentType);
+			bool normalized = acc.normalized || location==Mesh::Attribute::Color;
+			const unsigned char * base = doc.bin + doc.bufferViews[acc.bufferView].byteOffset + acc.byteOffset;
+			for(size_t i = 0; i < std::min(acc.count, vertices.size()); ++i) {
+				float c[4] = {0.f, 0.f, 0.f, 1.f};
+				for(int k = 0; k < acc.numComponents; ++k)
+					c[k] = readComponent(base + i*stride + k*size, acc.componentType, normalized);
+				GeometryPool::Vertex & v = vertices[i];
+				if(location==Mesh::Attribute::Position)
+					v.position = glm::vec3(c[0], c[1], c[2]);
+				else if(location==Mesh::Attribute::Normal)
+					v.normal = glm::vec3(c[0], c[1], c[2]);
+				else if(location==Mesh::Attribute::TexCoord)
+					v.texCoord = glm::vec2(c[0], c[1]);
+				else
+					for(int k = 0; k < 4; ++k)
+						v.color[k] = (uint8_t)std::lround(std::clamp(c[k], 0.f, 1.f) * 255.f);
+			}
+		}
+		return vertices;
+	}
+
+	// Triangle lists with float positions get simplified levels (texture coordinates and normals,
+	// when stored as floats, guide the simplifier) and, when really big, meshlets
+	void buildDetail(const Document & doc, const long long * accessors, long long indices, PrimitiveLayout & prim) {
+		const Accessor & pos = doc.accessors[accessors[Mesh::Attribute::Position]];
+		if(prim.mode!=GL_TRIANGLES || pos.componentType!=GL_FLOAT || pos.numComponents!=3)
+			return;
+
+		std::vector<uint32_t> triangles;
+		if(indices >= 0)
+			triangles = readIndices(doc, doc.accessors[indices]);
+		else {
+			triangles.resize(pos.count);
+			for(uint32_t i = 0; i < triangles.size(); ++i)
+				triangles[i] = i;
+		}
+		triangles.resize(triangles.size() / 3 * 3);
+		for(uint32_t i : triangles)
+			if(i >= pos.count)
+				throw std::runtime_error("glTF: vertex index out of range\n");
+		if(triangles.size() < 3 * 256)
+			return;
+
+		std::vector<float> coordinates;
+		readFloats(doc, pos, 3, coordinates);
+		std::vector<glm::vec3> positions(pos.count);
+		for(size_t v = 0; v < pos.count; ++v)
+			positions[v] = glm::vec3(coordinates[v*3], coordinates[v*3 + 1], coordinates[v*3 + 2]);
+
+		// Without a material it's drawn with the fallback one, double-sided
+		if(triangles.size() >= 3 * 16384) {
+			bool singleSided = prim.material >= 0 && prim.material < (int)doc.materials.size() &&
+												 !doc.materials[prim.material].doubleSided;
+			prim.meshlets = std::make_shared<meshlet::Set>(
+					meshlet::build(positions.data(), positions.size(), triangles, singleSided));
+		}
+
+		// Attributes interleaved per vertex
+		std::vector<float> attributes;
+		int attributeCount = 0;
+		std::vector<std::pair<std::vector<float>, int>> streams;
+		for(auto [location, n] : {std::pair{Mesh::Attribute::TexCoord, 2}, {Mesh::Attribute::Normal, 3}}) {
+			if(accessors[location] < 0)
+				continue;
+			const Accessor & acc = doc.accessors[accessors[location]];
+			if(acc.componentType!=GL_FLOAT || acc.numComponents!=n || acc.count!=pos.count)
+				continue;
+			streams.emplace_back();
+			readFloats(doc, acc, n, streams.back().first);
+			streams.back().second = n;
+			attributeCount += n;
+		}
+		attributes.reserve(pos.count * attributeCount);
+		for(size_t v = 0; v < pos.count; ++v)
+			for(const auto & [data, n] : streams)
+				attributes.insert(attributes.end(), data.begin() + v*n, data.begin() + (v+1)*n);
+
+		lod::Geometry geometry;
+		geometry.positions = positions.data();
+		geometry.numVertices = pos.count;
+		geometry.attributes = attributes.data();
+		geometry.attributeCount = attributeCount;
+		std::vector<lod::Level> chain = lod::buildChain(geometry, triangles);
+		if(chain.size() < 2)
+			return;
+
+		for(const lod::Level & level : chain) {
+			prim.lods.push_back(Mesh::LOD{(GLsizei)level.indices.size(), prim.lodIndices.size() * sizeof(uint32_t), level.error});
+			prim.lodIndices.insert(prim.lodIndices.end(), level.indices.begin(), level.indices.end());
+		}
+	}
+
+	void parsePrimitive(json::Reader & r, const Document & doc, PrimitiveLayout & prim) {
+		long long indices = -1;
+		long long position = -1;
+		long long accessors[4] = {-1, -1, -1, -1};
+		std::string_view key;
+		r.beginObject();
+		while(r.nextKey(key)) {
+			if(key=="attributes") {
+				std::string_view semantic;
+				r.beginObject();
+				while(r.nextKey(semantic)) {
+					long long index = r.readInt();
+					int location = locationOf(semantic);
+					if(location < 0)
+						continue;
+					const Accessor & acc = accessorAt(doc, index);
+					size_t stride = validateAccessor(doc, acc);
+					if(acc.numComponents > 4)
+						throw std::runtime_error("glTF: matrix vertex attributes are not supported\n");
+					prim.attributes.push_back(AttributeLayout{
+							(GLuint)location, acc.bufferView, acc.numComponents, acc.componentType,
+							(GLboolean)(acc.normalized || (location==Mesh::Attribute::Color && acc.componentType!=GL_FLOAT)),
+							(GLsizei)stride, acc.byteOffset});
+					if(location==Mesh::Attribute::Position)
+						position = index;
+					accessors[location] = index;
+				}
+			}
+			else if(key=="indices") indices = r.readInt();
+			else if(key=="material") prim.material = (int)r.readInt();
+			else if(key=="mode") prim.mode = (GLenum)r.readInt();
+			else r.skipValue();
+		}
+
+		if(position < 0)
+			throw std::runtime_error("glTF: primitive without POSITION attribute\n");
+		const Accessor & pos = doc.accessors[position];
+		if(pos.hasBounds) {
+			prim.boundsMin = pos.min;
+			prim.boundsMax = pos.max;
+		}
+		else
+			computeBounds(doc, pos, validateAccessor(doc, pos), prim);
+
+		if(indices >= 0) {
+			const Accessor & idx = accessorAt(doc, indices);
+			// Sized by validateAccessor() and drawn by glDrawElements() as the component type says
+			if(idx.componentType!=GL_UNSIGNED_BYTE && idx.componentType!=GL_UNSIGNED_SHORT && idx.componentType!=GL_UNSIGNED_INT)
+				throw std::runtime_error("glTF: index accessors must be UNSIGNED_BYTE/SHORT/INT, not " +
+																 std::to_string(idx.componentType) + '\n');
+			if(idx.numComponents!=1)
+				throw std::runtime_error("glTF: index accessors must be SCALAR\n");
+			validateAccessor(doc, idx);
+			if(doc.bufferViews[idx.bufferView].byteStride)
+				throw std::runtime_error("glTF: index buffer views must be tightly packed\n");
+			prim.indexView = idx.bufferView;
+			prim.indexType = idx.componentType;
+			prim.indexOffset = idx.byteOffset;
+			prim.count = (GLsizei)idx.count;
+		}
+		else
+			prim.count = (GLsizei)pos.count;
+
+		std::copy(accessors, accessors + 4, prim.accessors);
+		prim.indices = indices;
+		if(doc.detail)
+			buildDetail(doc, accessors, indices, prim);
+	}
+
+	// Runs on a worker thread: no GL calls here
+	void parseMesh(std::string_view text, const Document & doc, MeshLayout & mesh) {
+		json::Reader r(text);
+		std::string_view key;
+		r.beginObject();
+		while(r.nextKey(key)) {
+			if(key=="name")
+				mesh.name = r.readString();
+			else if(key=="primitives") {
+				r.beginArray();
+				while(r.nextElement()) {
+					mesh.primitives.emplace_back();
+					parsePrimitive(r, doc, mesh.primitives.back());
+				}
+			}
+			else r.skipValue();
+		}
+
+		// Gather buffer views this mesh needs on the GPU
+		for(const auto & prim : mesh.primitives) {
+			for(const auto & attr : prim.attributes)
+				mesh.bufferViews.push_back(attr.bufferView);
+			if(prim.indexView >= 0)
+				mesh.bufferViews.push_back(prim.indexView);
+		}
+		std::sort(mesh.bufferViews.begin(), mesh.bufferViews.end());
+		mesh.bufferViews.erase(std::unique(mesh.bufferViews.begin(), mesh.bufferViews.end()), mesh.bufferViews.end());
+	}
+
+	void parseMeshesParallel(const Document & doc, std::vector<MeshLayout> & meshes) {
+		meshes.resize(doc.meshes.size());
+		// One job per mesh, meshes differ a lot in size
+		job::parallelFor(0, meshes.size(), 1, [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i) {
+				try {
+					parseMesh(doc.meshes[i], doc, meshes[i]);
+				}
+				catch(const std::exception & e) {
+					meshes[i].error = e.what();
+				}
+			}
+		});
+
+		for(const auto & mesh : meshes)
+			if(!mesh.error.empty())
+				throw std::runtime_error(mesh.error);
+	}
+
+	std::string directoryOf(const std::string & path) {
+		size_t slash = path.find_last_of('/');
+		return slash==std::string::npos ? std::string() : path.substr(0, slash+1);
+	}
+
+	// Runs on any thread: decode the image of a texture (no pixels if it has no supported source)
+	Texture::Image decodeTexture(const Document & doc, int texture, const std::string & baseDir) {
+		int source = doc.textureSources[texture];
+		if(source < 0 || source >= (int)doc.images.size())
+			return Texture::Image();
+
+		const ImageDesc & img = doc.images[source];
+		if(img.bufferView >= 0 && img.bufferView < (int)doc.bufferViews.size()) {
+			const BufferView & view = doc.bufferViews[img.bufferView];
+			return Texture::decode(doc.bin + view.byteOffset, view.byteLength, false);
+		}
+		if(!img.uri.empty() && img.uri.rfind("data:", 0)==std::string::npos)
+			return Texture::decode((baseDir + img.uri).c_str(), false);
+		std::cerr << "ERROR: (gltf::decodeTexture) Unsupported image source of texture " << texture << '\n';
+		return Texture::Image();
+	}
+
+	// Runs on the GL thread: create buffers and VAOs pointing into them
+	Mesh * uploadMesh(const Document & doc, const MeshLayout & layout, const std::vector<u64> & materials) {
+		std::vector<GLuint> buffers(layout.bufferViews.size());
+		glGenBuffers((GLsizei)buffers.size(), buffers.data());
+		auto bufferOf = [&](int view) {
+			auto it = std::lower_bound(layout.bufferViews.begin(), layout.bufferViews.end(), view);
+			return buffers[it - layout.bufferViews.begin()];
+		};
+
+		// Upload straight from the mapped file; GL_ARRAY_BUFFER is just a binding point here,
+		// the same buffer object may later serve as an element buffer
+		for(size_t i = 0; i < buffers.size(); ++i) {
+			const BufferView & view = doc.bufferViews[layout.bufferViews[i]];
+			glBindBuffer(GL_ARRAY_BUFFER, buffers[i]);
+			glBufferData(GL_ARRAY_BUFFER, view.byteLength, doc.bin + view.byteOffset, GL_STATIC_DRAW);
+		}
+
+		std::vector<Mesh::Primitive> primitives;
+		std::vector<GLuint> lodBuffers;
+		for(const auto & prim : layout.primitives) {
+			Mesh::Primitive p;
+			glGenVertexArrays(1, &p.VAO);
+			glBindVertexArray(p.VAO);
+
+			for(const auto & attr : prim.attributes) {
+				glBindBuffer(GL_ARRAY_BUFFER, bufferOf(attr.bufferView));
+				glVertexAttribPointer(attr.location, attr.size, attr.type, attr.normalized, attr.stride, (void*)attr.offset);
+				glEnableVertexAttribArray(attr.location);
+			}
+			// VAO keeps track of the element buffer bound while it's bound
+			// Primitives with a LOD chain draw all levels from their own element buffer
+			GLuint lodBuffer = 0;
+			if(!prim.lods.empty()) {
+				glGenBuffers(1, &lodBuffer);
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lodBuffer);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, prim.lodIndices.size()*sizeof(uint32_t), prim.lodIndices.data(), GL_STATIC_DRAW);
+				lodBuffers.push_back(lodBuffer);
+			}
+			else if(prim.indexView >= 0)
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferOf(prim.indexView));
+
+			glBindVertexArray(0);
+
+			p.mode = prim.mode;
+			p.count = prim.count;
+			p.indexed = prim.indexView >= 0;
+			p.indexType = prim.indexType;
+			p.indexOffset = prim.indexOffset;
+			p.material = (prim.material >= 0 && prim.material < (int)materials.size()) ? materials[prim.material] : 0;
+			p.boundsMin = prim.boundsMin;
+			p.boundsMax = prim.boundsMax;
+			if(lodBuffer) {
+				p.indexed = true;
+				p.indexType = GL_UNSIGNED_INT;
+				p.count = prim.lods[0].count;
+				p.indexOffset = prim.lods[0].indexOffset;
+				p.lods = prim.lods;
+			}
+			p.elementBuffer = lodBuffer ? lodBuffer : (prim.indexView >= 0 ? bufferOf(prim.indexView) : 0);
+			p.meshlets = prim.meshlets;
+			primitives.push_back(p);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		buffers.insert(buffers.end(), lodBuffers.begin(), lodBuffers.end());
+
+		return new Mesh(std::move(buffers), std::move(primitives));
+	}
+}
+
+namespace {
+	// Find the chunks of a mapped GLB file and parse it's JSON (meshes are only captured)
+	void readDocument(const MappedFile & file, Document & doc) {
+		const unsigned char * data = file.data();
+
+		// Header: magic, version, total length
+		if(file.size() < 20 || readU32(data)!=GLB_MAGIC)
+			throw std::runtime_error("glTF: not a GLB file\n");
+		if(readU32(data+4)!=GLB_VERSION)
+			throw std::runtime_error("glTF: unsupported GLB version\n");
+		size_t totalLength = std::min<size_t>(readU32(data+8), file.size());
+
+		// Chunks: length, type, data (4 byte aligned)
+		std::string_view jsonText;
+		for(size_t offset = 12; offset + 8 <= totalLength;) {
+			size_t chunkLength = readU32(data+offset);
+			uint32_t chunkType = readU32(data+offset+4);
+			const unsigned char * chunk = data + offset + 8;
+			if(offset + 8 + chunkLength > totalLength)
+				throw std::runtime_error("glTF: chunk exceeds the file\n");
+
+			if(chunkType==CHUNK_JSON && jsonText.empty())
+				jsonText = std::string_view(reinterpret_cast<const char *>(chunk), chunkLength);
+			else if(chunkType==CHUNK_BIN && doc.bin==nullptr) {
+				doc.bin = chunk;
+				doc.binLength = chunkLength;
+			}
+			offset += 8 + ((chunkLength + 3) & ~size_t(3));
+		}
+		if(jsonText.empty())
+			throw std::runtime_error("glTF: missing JSON chunk\n");
+
+		parseDocument(jsonText, doc);
+	}
+
+	// Textures and materials; returns resIDs of the materials
+	std::vector<u64> loadMaterials(const Document & doc, const std::string & baseDir, ResourceManager & resMan) {
+		// Textures used by the materials are decoded by jobs, then uploaded here on the GL thread
+		std::vector<int> used;
+		for(const auto & desc : doc.materials)
+			if(desc.baseColorTexture >= 0 && desc.baseColorTexture < (int)doc.textureSources.size())
+				used.push_back(desc.baseColorTexture);
+		std::sort(used.begin(), used.end());
+		used.erase(std::unique(used.begin(), used.end()), used.end());
+		std::vector<Texture::Image> images(used.size());
+		job::parallelFor(0, used.size(), 1, [&](size_t first, size_t last) {
+			for(size_t i = first; i < last; ++i)
+				images[i] = decodeTexture(doc, used[i], baseDir);
+		});
+		std::vector<u64> textures(doc.textureSources.size(), 0);
+		for(size_t i = 0; i < used.size(); ++i)
+			if(images[i].data)
+				textures[used[i]] = resMan.insert(new Texture(images[i], GL_TEXTURE_2D));
+			// Unsupported sources were reported and have no path; the rest failed to decode
+			else if(!images[i].path.empty())
+				throw std::runtime_error("glTF: couldn't decode image of texture " + std::to_string(used[i]) + "\n");
+
+		std::vector<u64> materials;
+		for(const auto & desc : doc.materials) {
+			u64 texture = 0;
+			if(desc.baseColorTexture >= 0 && desc.baseColorTexture < (int)textures.size())
+				texture = textures[desc.baseColorTexture];
+			Material * mat = new Material(desc.baseColorFactor, texture, desc.metallicFactor, desc.roughnessFactor);
+			mat->setDoubleSided(desc.doubleSided);
+			materials.push_back(desc.name.empty() ? resMan.insert(mat) : resMan.insert(desc.name, mat));
+		}
+		return materials;
+	}
+}
+
+std::vector<u64> gltf::loadGLB(const char * path, ResourceManager & resMan) {
+	MappedFile file(path);
+	Document doc;
+	readDocument(file, doc);
+
+	std::vector<MeshLayout> layouts;
+	parseMeshesParallel(doc, layouts);
+
+	// GL objects: textures, materials and then meshes
+	std::vector<u64> materials = loadMaterials(doc, directoryOf(file.getPath()), resMan);
+	std::vector<u64> meshes;
+	for(const auto & layout : layouts) {
+		Mesh * mesh = uploadMesh(doc, layout, materials);
+		meshes.push_back(layout.name.empty() ? resMan.insert(mesh) : resMan.insert(layout.name, mesh));
+	}
+
+	return meshes;
+}
+
+size_t gltf::loadStaticGLB(const char * path, ResourceManager & resMan, StaticGeometry & geometry,
+													 const glm::mat4 & transform) {
+	MappedFile file(path);
+	Document doc;
+	doc.detail = false;
+	readDocument(file, doc);
+
+	std::vector<MeshLayout> layouts;
+	parseMeshesParallel(doc, layouts);
+
+	std::vector<u64> materials = loadMaterials(doc, directoryOf(file.getPath()), resMan);
+	size_t added = 0;
+	for(const auto & layout : layouts)
+		for(const auto & prim : layout.primitives) {
+			if(prim.mode!=GL_TRIANGLES) {
+				std::cerr << "ERROR: (gltf::loadStaticGLB) Only triangle lists can be static, primitive of "
+									<< layout.name << " skipped\n";
+				continue;
+			}
+			std::vector<GeometryPool::Vertex> vertices = readVertices(doc, prim);
+			std::vector<uint32_t> indices;
+			if(prim.indices >= 0)
+				indices = readIndices(doc, doc.accessors[prim.indices]);
+			else {
+				indices.resize(vertices.size());
+				for(uint32_t i = 0; i < indices.size(); ++i)
+					indices[i] = i;
+			}
+			u64 material = (prim.material >= 0 && prim.material < (int)materials.size()) ? materials[prim.material] : 0;
+			geometry.add(material, std::move(vertices), std::move(indices), transform);
+			++added;
+		}
+	geometry.build();
+	return added;
+}
@@ -0,0 +1,58 @@
+/*
+ * Loader of binary glTF 2.0 files (.glb).
+ *
+ * The file is memory mapped and it's JSON chunk is read with the streaming
+ * json::Reader, without building a document tree. Vertex and index data is
+ * uploaded to OpenGL buffers straight from the mapped binary chunk - there
+ * are no intermediate copies; VAOs point at the glTF accessors as they are
+ * laid out in the file (interleaved or not, any component type).
+ *
+ * Meshes are independent of each other, so their JSON is parsed and resolved
+ * against accessors/buffer views by jobs on the pool's threads (see Jobs.hpp),
+ * one mesh per job; textures are decoded the same way. Only the GL calls are
+ * done on the calling thread, which must have the OpenGL context current.
+ *
+ * Big enough triangle primitives get a level of detail chain (see LOD.hpp),
+ * simplified on the worker threads as well. Their levels are the only index
+ * data that is copied: into an element buffer of their own. Really big ones
+ * are split into meshlets too, with back facing clusters culled only when
+ * the material is single-sided (back faces are culled by GL then anyway).
+ *
+ * Scenery that never moves can be loaded as static geometry instead (see
+ * StaticGeometry.hpp): attributes are read into one vertex layout and the
+ * primitives are merged by material into a shared geometry pool.
+ *
+ * Created resources (registered in the ResourceManager):
+ * - a Texture for each glTF texture used by a material (embedded or external image),
+ * - a Material for each glTF material, single-sided unless it's doubleSided,
+ * - a Mesh for each glTF mesh.
+ *
+ * Only buffer 0 held in the GLB binary chunk is supported (no external .bin files).
+ * Errors in the file end with a std::runtime_error.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef GLTF_LOADER_HPP
+#define GLTF_LOADER_HPP
+
+#include <vector>
+
+#include "Resource.hpp"
+#include "ResourceManager.hpp"
+#include "StaticGeometry.hpp"
+
+namespace gltf {
+	// Load all meshes (along with their materials and textures) of a .glb file.
+	// Returns resIDs of the created meshes.
+	std::vector<u64> loadGLB(const char * path, ResourceManager & resMan);
+
+	// Load triangle primitives of a .glb file as static geometry placed by transform:
+	// no Mesh resources, vertices are converted to the pooled layout and merged by material.
+	// Returns the number of primitives added.
+	size_t loadStaticGLB(const char * path, ResourceManager & resMan, StaticGeometry & geometry,
+											 const glm::mat4 & transform = glm::mat4(1.f));
+}
+
+#endif /* GLTF_LOADER_HPP */
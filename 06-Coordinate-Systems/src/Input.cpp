@@ -0,0 +1,57 @@
+#include "Input.hpp"
+
+input::EventQueue::EventQueue() : cells(new Cell[Capacity]), head(0), tail(0), dropped(0) {
+	static_assert((Capacity & (Capacity-1))==0, "EventQueue capacity must be a power of two");
+	// Cell i is free for the producer of position i
+	for(size_t i = 0; i < Capacity; ++i)
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool input::EventQueue::push(const Event & event) {
+	size_t position = head.load(std::memory_order_relaxed);
+	while(true) {
+		Cell & cell = cells[position & (Capacity-1)];
+		size_t sequence = cell.sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+		if(difference==0) {
+			// Free: claim it, or retry at the position another producer moved the head to
+			if(head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+				cell.event = event;
+				cell.sequence.store(position + 1, std::memory_order_release);
+				return true;
+			}
+		}
+		else if(difference < 0) {
+			// Still holds the event of the previous lap: full
+			dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+			position = head.load(std::memory_order_relaxed);
+	}
+}
+
+bool input::EventQueue::pop(Event & event) {
+	Cell & cell = cells[tail & (Capacity-1)];
+	if(cell.sequence.load(std::memory_order_acquire)!=tail + 1)
+		return false;
+	event = cell.event;
+	// Free for the producer of the next lap
+	cell.sequence.store(tail + Capacity, std::memory_order_release);
+	++tail;
+	return true;
+}
+
+bool input::EventQueue::empty() const {
+	return cells[tail & (Capacity-1)].sequence.load(std::memory_order_acquire)!=tail + 1;
+}
+
+size_t input::EventQueue::drain(std::vector<Event> & events) {
+	size_t count = 0;
+	Event event;
+	while(pop(event)) {
+		events.push_back(event);
+		++count;
+	}
+	return count;
+}
@@ -0,0 +1,118 @@
+/*
+ * Timestamped input events and the lock-free queue carrying them.
+ *
+ * GLFW reports input through callbacks while events are polled. Every
+ * callback turns into an Event stamped with glfwGetTime() and pushed into
+ * the Context's queue, so nothing that happened between two frames is lost
+ * (a key pressed and released within one frame shows up as two events) and
+ * the simulation sees when it happened. GLFW can't tell when the OS got an
+ * event, only when it was polled: the more often events are polled, the
+ * more exact the timestamps.
+ *
+ * The queue is a bounded ring of Vyukov's design: every cell carries a
+ * sequence number telling producers whether it's free and the consumer
+ * whether it's written. Producers claim cells with one CAS on the head, so
+ * events can be pushed from any thread; a single consumer drains it without
+ * atomic read-modify-writes. When the ring is full new events are dropped
+ * and counted, the producer never blocks.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef INPUT_HPP
+#define INPUT_HPP
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+namespace input {
+	enum class EventType : uint8_t {
+		Key,
+		MouseButton,
+		CursorPos,
+		Scroll,
+		WindowSize,
+		FramebufferSize,
+		// The window was (action 1) or stopped being (action 0) iconified / focused
+		WindowIconify,
+		WindowFocus,
+		// The window's contents were damaged, e.g. uncovered
+		WindowRefresh,
+		// Something other than input changed what's drawn (e.g. a loader finished), see
+		// Context::requestRedraw()
+		Redraw
+	};
+
+	struct Event {
+		EventType type;
+		// Key or mouse button, it's action (GLFW_PRESS, GLFW_RELEASE, GLFW_REPEAT) and modifiers
+		int32_t code;
+		int32_t action;
+		int32_t mods;
+		// Cursor position, scroll offset or new size
+		double x;
+		double y;
+		// glfwGetTime() when GLFW reported the event
+		double time;
+	};
+
+	struct Stats {
+		size_t events = 0;
+		size_t dropped = 0;
+		size_t polls = 0;
+		// Longest time an event waited in the queue before it was drained
+		double maxAgeMs = 0.;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[input|events:" << s.events
+				 << "|dropped:" << s.dropped
+				 << "|polls:" << s.polls
+				 << "|maxAgeMs:" << s.maxAgeMs
+				 << "]";
+			return os;
+		}
+	};
+
+	// Bounded multi producer, single consumer ring of events
+	class EventQueue {
+	public:
+		static constexpr size_t Capacity = 4096;
+
+		EventQueue();
+
+		// Delete copy and assignment constructors
+		EventQueue(const EventQueue &) = delete;
+		EventQueue & operator=(const EventQueue &) = delete;
+
+		// Any thread; false (and the event is dropped) when the ring is full
+		bool push(const Event & event);
+		// Consumer only; oldest event, false when empty
+		bool pop(Event & event);
+		// Consumer only; append all queued events to `events`, returns how many
+		size_t drain(std::vector<Event> & events);
+
+		// Consumer only; no event is ready to be popped
+		bool empty() const;
+
+		// Events dropped because the ring was full
+		size_t getDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+	private:
+		struct Cell {
+			std::atomic<size_t> sequence;
+			Event event;
+		};
+
+		std::unique_ptr<Cell[]> cells;
+		alignas(64) std::atomic<size_t> head;
+		alignas(64) size_t tail;
+		std::atomic<size_t> dropped;
+	};
+}
+
+#endif /* INPUT_HPP */
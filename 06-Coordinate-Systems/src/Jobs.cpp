@@ -0,0 +1,254 @@
+#include "Jobs.hpp"
+
+#include <stdexcept>
+
+namespace {
+	// Pool and index of the calling thread; the creating thread's previous ones are restored
+	// when a pool is destroyed
+	thread_local const job::Scheduler * threadScheduler = nullptr;
+	thread_local int threadPoolIndex = -1;
+
+	std::unique_ptr<job::Scheduler> & globalScheduler() {
+		static std::unique_ptr<job::Scheduler> scheduler;
+		return scheduler;
+	}
+}
+
+job::Deque::Deque() : top(0), bottom(0), buffer(new std::atomic<Job *>[Capacity]) {
+}
+
+bool job::Deque::push(Job * job) {
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if(b - t >= Capacity)
+		return false;
+	buffer[b & (Capacity-1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+job::Job * job::Deque::pop() {
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+	if(t > b) {
+		// Empty
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+	Job * job = buffer[b & (Capacity-1)].load(std::memory_order_relaxed);
+	if(t==b) {
+		// Last job: race the thieves for it
+		if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = nullptr;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+job::Job * job::Deque::steal() {
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+	if(t >= b)
+		return nullptr;
+	Job * job = buffer[t & (Capacity-1)].load(std::memory_order_relaxed);
+	if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;
+	return job;
+}
+
+job::Scheduler::Scheduler(unsigned numThreads) : running(true), epoch(0), sleeping(0) {
+	if(numThreads==0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	for(unsigned i = 0; i < numThreads; ++i) {
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->jobs = std::make_unique<Job[]>(JobsPerThread);
+	}
+	previousScheduler = threadScheduler;
+	previousIndex = threadPoolIndex;
+	threadScheduler = this;
+	threadPoolIndex = 0;
+	for(unsigned i = 1; i < numThreads; ++i)
+		workers[i]->thread = std::thread(&Scheduler::loop, this, i);
+}
+
+job::Scheduler::~Scheduler() {
+	running = false;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_all();
+	for(auto & worker : workers)
+		if(worker->thread.joinable())
+			worker->thread.join();
+	if(threadScheduler==this) {
+		threadScheduler = previousScheduler;
+		threadPoolIndex = previousIndex;
+	}
+}
+
+int job::Scheduler::threadIndex() const {
+	return threadScheduler==this ? threadPoolIndex : -1;
+}
+
+bool job::Scheduler::isPoolThread() const {
+	return threadIndex() >= 0;
+}
+
+job::Job * job::Scheduler::create(Function function, const void * data, size_t size, Job * parent) {
+	int index = threadIndex();
+	if(index < 0)
+		throw std::runtime_error("job::Scheduler: jobs can only be created on the pool's threads\n");
+	if(size > Job::DataSize)
+		throw std::runtime_error("job::Scheduler: job data too big\n");
+
+	// Slots of unfinished jobs (e.g. the root of a running parallelFor) are skipped;
+	// when the whole ring is busy, help with other work until one frees up
+	Worker & worker = *workers[index];
+	Job * job = nullptr;
+	while(!job) {
+		for(uint32_t tries = 0; tries < JobsPerThread && !job; ++tries) {
+			Job * slot = &worker.jobs[worker.nextJob++ & (JobsPerThread-1)];
+			if(finished(slot))
+				job = slot;
+		}
+		if(job)
+			break;
+		Job * other = find((unsigned)index);
+		if(other)
+			execute(other, (unsigned)index);
+		else
+			std::this_thread::yield();
+	}
+
+	job->function = function;
+	job->parent = parent;
+	job->unfinished.store(1, std::memory_order_relaxed);
+	if(size)
+		std::memcpy(job->data, data, size);
+	if(parent)
+		parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+	return job;
+}
+
+void job::Scheduler::run(Job * job) {
+	int index = threadIndex();
+	if(index < 0 || !workers[index]->deque.push(job)) {
+		job->function(*job, job->data);
+		finish(job);
+		return;
+	}
+	// Pairs with the sleeping count / epoch check of an idle worker: one of them sees the other
+	epoch.fetch_add(1);
+	if(sleeping.load() > 0) {
+		{
+			std::lock_guard<std::mutex> lock(sleepMutex);
+		}
+		wake.notify_one();
+	}
+}
+
+void job::Scheduler::wait(const Job * job) {
+	int index = threadIndex();
+	while(!finished(job)) {
+		Job * other = index >= 0 ? find((unsigned)index) : nullptr;
+		if(other)
+			execute(other, (unsigned)index);
+		else
+			std::this_thread::yield();
+	}
+}
+
+job::Job * job::Scheduler::find(unsigned index) {
+	Worker & worker = *workers[index];
+	if(Job * job = worker.deque.pop())
+		return job;
+	unsigned n = (unsigned)workers.size();
+	for(unsigned k = 1; k < n; ++k) {
+		Job * job = workers[(index + k) % n]->deque.steal();
+		if(job) {
+			worker.steals.fetch_add(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void job::Scheduler::execute(Job * job, unsigned index) {
+	job->function(*job, job->data);
+	finish(job);
+	workers[index]->executed.fetch_add(1, std::memory_order_relaxed);
+}
+
+void job::Scheduler::finish(Job * job) {
+	// The parent is read first: once the count drops to 0 the slot may be reused
+	while(job) {
+		Job * parent = job->parent;
+		if(job->unfinished.fetch_sub(1, std::memory_order_acq_rel)!=1)
+			return;
+		job = parent;
+	}
+}
+
+void job::Scheduler::loop(unsigned index) {
+	threadScheduler = this;
+	threadPoolIndex = (int)index;
+	Worker & worker = *workers[index];
+	while(running.load(std::memory_order_relaxed)) {
+		uint64_t seen = epoch.load();
+		Job * job = nullptr;
+		// Spin a little before going to sleep, work often comes in bursts
+		for(int spin = 0; spin < 64 && !job && running.load(std::memory_order_relaxed); ++spin) {
+			job = find(index);
+			if(!job)
+				std::this_thread::yield();
+		}
+		if(job) {
+			execute(job, index);
+			continue;
+		}
+
+		sleeping.fetch_add(1);
+		{
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wake.wait(lock, [&]() { return epoch.load()!=seen || !running.load(); });
+		}
+		sleeping.fetch_sub(1);
+		worker.sleeps.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+job::Scheduler::Stats job::Scheduler::getStats() const {
+	Stats stats;
+	stats.threads = size();
+	for(const auto & worker : workers) {
+		stats.jobs += worker->executed.load(std::memory_order_relaxed);
+		stats.steals += worker->steals.load(std::memory_order_relaxed);
+		stats.sleeps += worker->sleeps.load(std::memory_order_relaxed);
+	}
+	return stats;
+}
+
+void job::Scheduler::resetStats() {
+	for(auto & worker : workers) {
+		worker->executed.store(0, std::memory_order_relaxed);
+		worker->steals.store(0, std::memory_order_relaxed);
+		worker->sleeps.store(0, std::memory_order_relaxed);
+	}
+}
+
+job::Scheduler & job::global() {
+	std::unique_ptr<Scheduler> & scheduler = globalScheduler();
+	if(!scheduler)
+		scheduler = std::make_unique<Scheduler>();
+	return *scheduler;
+}
+
+void job::setThreads(unsigned numThreads) {
+	std::unique_ptr<Scheduler> & scheduler = globalScheduler();
+	scheduler.reset();
+	scheduler = std::make_unique<Scheduler>(numThreads);
+}
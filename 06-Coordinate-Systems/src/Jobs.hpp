@@ -0,0 +1,239 @@
+/*
+ * Job system: a fixed pool of worker threads sharing work by stealing.
+ *
+ * A job is a function pointer and a small block of data (a trivially
+ * copyable lambda or struct of up to Job::DataSize bytes). Jobs are taken
+ * from a per-thread ring of preallocated slots, so creating one doesn't
+ * allocate. A job created with a parent counts as unfinished work of the
+ * parent: the parent is finished only when it's own function returned and
+ * all of it's children finished. Waiting on one job therefore waits for the
+ * whole tree spawned under it.
+ *
+ * Every thread of the pool has a Chase-Lev work-stealing deque (Chase & Lev,
+ * "Dynamic Circular Work-Stealing Deque", with the C11 memory orders of
+ * Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+ * The owner pushes and pops at the bottom without locking, other threads
+ * steal single jobs from the top with one CAS. Idle workers try to steal
+ * from each other and then sleep until new jobs are pushed.
+ *
+ * The thread that creates the Scheduler is thread 0 of the pool. It doesn't
+ * block in wait(): it runs it's own and stolen jobs until the awaited one is
+ * finished, so it's never idle while there is work. Threads outside the pool
+ * can't create jobs; parallelFor() called on them runs serially.
+ *
+ * parallelFor() splits a range in halves recursively, pushing one half as a
+ * child job and continuing with the other, until pieces are no bigger than
+ * the grain. Idle threads steal the big halves first, so the range spreads
+ * over the pool in a logarithmic number of steals.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef JOBS_HPP
+#define JOBS_HPP
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <algorithm>
+
+namespace job {
+	struct Job;
+	typedef void (*Function)(Job & job, const void * data);
+
+	struct alignas(64) Job {
+		static constexpr size_t DataSize = 104;
+
+		Function function;
+		Job * parent;
+		// The job itself and it's unfinished children
+		std::atomic<int32_t> unfinished;
+		unsigned char data[DataSize];
+	};
+	static_assert(sizeof(Job)==128, "Job should span two cache lines");
+
+	// Chase-Lev deque of fixed capacity: push/pop by the owner, steal by anyone
+	class Deque {
+	public:
+		static constexpr int64_t Capacity = 4096;
+
+		Deque();
+
+		// Delete copy and assignment constructors
+		Deque(const Deque &) = delete;
+		Deque & operator=(const Deque &) = delete;
+
+		// Owner only; false when full
+		bool push(Job * job);
+		// Owner only; newest job or null
+		Job * pop();
+		// Any thread; oldest job or null (also when losing a race)
+		Job * steal();
+
+		bool empty() const { return top.load(std::memory_order_relaxed) >= bottom.load(std::memory_order_relaxed); }
+
+	private:
+		alignas(64) std::atomic<int64_t> top;
+		alignas(64) std::atomic<int64_t> bottom;
+		std::unique_ptr<std::atomic<Job *>[]> buffer;
+	};
+
+	class Scheduler {
+	public:
+		struct Stats {
+			unsigned threads = 0;
+			size_t jobs = 0;
+			size_t steals = 0;
+			size_t sleeps = 0;
+
+			friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+				os << "[jobs|threads:" << s.threads
+					 << "|jobs:" << s.jobs
+					 << "|steals:" << s.steals
+					 << "|sleeps:" << s.sleeps
+					 << "]";
+				return os;
+			}
+		};
+
+		// numThreads in total, the calling thread included (0 means one per hardware thread)
+		explicit Scheduler(unsigned numThreads = 0);
+		~Scheduler();
+
+		// Delete copy and assignment constructors
+		Scheduler(const Scheduler &) = delete;
+		Scheduler & operator=(const Scheduler &) = delete;
+
+		// Job calling function with a copy of `size` bytes of data; counted as a child of parent
+		Job * create(Function function, const void * data = nullptr, size_t size = 0, Job * parent = nullptr);
+
+		// Job calling a copy of f()
+		template<typename F>
+		Job * create(const F & f, Job * parent = nullptr) {
+			static_assert(std::is_trivially_copyable<F>::value && sizeof(F) <= Job::DataSize,
+										"Job functions must be small and trivially copyable (capture by reference)");
+			return create([](Job &, const void * data) { (*static_cast<const F *>(data))(); }, &f, sizeof(F), parent);
+		}
+
+		// Queue a created job on the calling thread's deque (runs it right away when the deque is full)
+		void run(Job * job);
+
+		// Run jobs until the given one is finished
+		void wait(const Job * job);
+
+		bool finished(const Job * job) const { return job->unfinished.load(std::memory_order_acquire)==0; }
+
+		// Threads of the pool, the creating thread included
+		unsigned size() const { return (unsigned)workers.size(); }
+
+		// True on the threads of this pool
+		bool isPoolThread() const;
+		// Index of the calling thread in this pool (0 is the creating thread), or -1; lets jobs
+		// write into per-thread buffers without locking
+		int threadIndex() const;
+
+		// Totals since the last reset
+		Stats getStats() const;
+		void resetStats();
+
+	private:
+		struct alignas(64) Worker {
+			Deque deque;
+			std::unique_ptr<Job[]> jobs;
+			uint32_t nextJob = 0;
+			std::thread thread;
+			std::atomic<size_t> executed{0};
+			std::atomic<size_t> steals{0};
+			std::atomic<size_t> sleeps{0};
+		};
+		static constexpr uint32_t JobsPerThread = 4096;
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::atomic<bool> running;
+
+		// Idle workers sleep until the epoch moves (every push moves it)
+		std::atomic<uint64_t> epoch;
+		std::atomic<int> sleeping;
+		std::mutex sleepMutex;
+		std::condition_variable wake;
+
+		// Pool the creating thread belonged to before, restored by the destructor
+		const Scheduler * previousScheduler;
+		int previousIndex;
+
+		void loop(unsigned index);
+		// A job from the thread's own deque or stolen from another one
+		Job * find(unsigned index);
+		void execute(Job * job, unsigned index);
+		static void finish(Job * job);
+	};
+
+	// Pool used by the engine's systems; created on first use by the calling (main) thread
+	Scheduler & global();
+
+	// Replace the global pool with one of numThreads threads (no jobs may be in flight)
+	void setThreads(unsigned numThreads);
+
+	namespace detail {
+		template<typename F>
+		struct Range {
+			Scheduler * scheduler;
+			const F * f;
+			size_t begin;
+			size_t end;
+			size_t grain;
+		};
+
+		// Push the upper half as a child until the range fits the grain, then run what's left
+		template<typename F>
+		void splitRange(Job & job, const void * data) {
+			Range<F> r;
+			std::memcpy(&r, data, sizeof(r));
+			while(r.end - r.begin > r.grain) {
+				Range<F> upper = r;
+				upper.begin = r.begin + (r.end - r.begin) / 2;
+				r.scheduler->run(r.scheduler->create(&splitRange<F>, &upper, sizeof(upper), &job));
+				r.end = upper.begin;
+			}
+			(*r.f)(r.begin, r.end);
+		}
+	}
+
+	// Grain giving each of numThreads threads a few pieces of n items to balance with
+	inline size_t grainFor(size_t n, unsigned numThreads) {
+		return std::max<size_t>(1, n / ((size_t)std::max(1u, numThreads) * 4));
+	}
+
+	// Call f(first, end) for pieces of [begin, end) of up to `grain` items (0 picks one for the pool
+	// size) on the scheduler's threads; returns when all pieces are done
+	template<typename F>
+	void parallelFor(Scheduler & scheduler, size_t begin, size_t end, size_t grain, const F & f) {
+		if(begin >= end)
+			return;
+		if(grain==0)
+			grain = grainFor(end - begin, scheduler.size());
+		if(end - begin <= grain || scheduler.size()==1 || !scheduler.isPoolThread()) {
+			f(begin, end);
+			return;
+		}
+		detail::Range<F> range{&scheduler, &f, begin, end, grain};
+		Job * root = scheduler.create(&detail::splitRange<F>, &range, sizeof(range));
+		scheduler.run(root);
+		scheduler.wait(root);
+	}
+
+	template<typename F>
+	void parallelFor(size_t begin, size_t end, size_t grain, const F & f) {
+		parallelFor(global(), begin, end, grain, f);
+	}
+}
+
+#endif /* JOBS_HPP */
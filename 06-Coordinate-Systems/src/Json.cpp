@@ -0,0 +1,253 @@
+#include "Json.hpp"
+
+#include <charconv>
+#include <cmath>
+
+using namespace json;
+
+Token Reader::peek() {
+	skipWhitespace();
+	if(pos >= text.size())
+		return Token::End;
+
+	switch(text[pos]) {
+	case '{':
+		return Token::Object;
+	case '[':
+		return Token::Array;
+	case '"':
+		return Token::String;
+	case 't':
+	case 'f':
+		return Token::Bool;
+	case 'n':
+		return Token::Null;
+	default:
+		if(text[pos]=='-' || (text[pos]>='0' && text[pos]<='9'))
+			return Token::Number;
+		fail("unexpected character");
+	}
+}
+
+void Reader::beginObject() {
+	expect('{');
+	first = true;
+}
+
+bool Reader::nextKey(std::string_view & key) {
+	skipWhitespace();
+	if(pos < text.size() && text[pos]=='}') {
+		++pos;
+		first = false;
+		return false;
+	}
+	if(!first)
+		expect(',');
+	skipWhitespace();
+
+	bool escaped;
+	key = readRawString(escaped);
+	// Keys with escape sequences are not a thing glTF & co. need; compare them raw
+	expect(':');
+	first = true;
+	return true;
+}
+
+void Reader::beginArray() {
+	expect('[');
+	first = true;
+}
+
+bool Reader::nextElement() {
+	skipWhitespace();
+	if(pos < text.size() && text[pos]==']') {
+		++pos;
+		first = false;
+		return false;
+	}
+	if(!first)
+		expect(',');
+	first = true;
+	return true;
+}
+
+std::string Reader::readString() {
+	skipWhitespace();
+	bool escaped;
+	std::string_view raw = readRawString(escaped);
+	first = false;
+	return escaped ? unescape(raw) : std::string(raw);
+}
+
+double Reader::readNumber() {
+	skipWhitespace();
+	double value = 0.;
+	auto [ptr, ec] = std::from_chars(text.data()+pos, text.data()+text.size(), value);
+	if(ec != std::errc())
+		fail("invalid number");
+	pos = ptr - text.data();
+	first = false;
+	return value;
+}
+
+long long Reader::readInt() {
+	double value = readNumber();
+	if(value != std::floor(value))
+		fail("expected an integer");
+	// Beyond 2^53 doubles skip integers anyway; this also keeps the cast defined
+	if(std::fabs(value) > 9007199254740992.)
+		fail("integer out of range");
+	return (long long)value;
+}
+
+size_t Reader::readSize() {
+	long long value = readInt();
+	if(value < 0)
+		fail("expected a non-negative integer");
+	return (size_t)value;
+}
+
+bool Reader::readBool() {
+	skipWhitespace();
+	bool value;
+	if(text.substr(pos, 4) == "true") {
+		pos += 4;
+		value = true;
+	}
+	else if(text.substr(pos, 5) == "false") {
+		pos += 5;
+		value = false;
+	}
+	else
+		fail("expected a boolean");
+	first = false;
+	return value;
+}
+
+void Reader::readNull() {
+	skipWhitespace();
+	if(text.substr(pos, 4) != "null")
+		fail("expected null");
+	pos += 4;
+	first = false;
+}
+
+void Reader::skipValue() {
+	std::string_view key;
+	switch(peek()) {
+	case Token::Object:
+		beginObject();
+		while(nextKey(key))
+			skipValue();
+		break;
+	case Token::Array:
+		beginArray();
+		while(nextElement())
+			skipValue();
+		break;
+	case Token::String:
+		{
+			bool escaped;
+			readRawString(escaped);
+			first = false;
+		}
+		break;
+	case Token::Number:
+		readNumber();
+		break;
+	case Token::Bool:
+		readBool();
+		break;
+	case Token::Null:
+		readNull();
+		break;
+	case Token::End:
+		fail("unexpected end of text");
+	}
+}
+
+std::string_view Reader::captureValue() {
+	skipWhitespace();
+	size_t begin = pos;
+	skipValue();
+	return text.substr(begin, pos-begin);
+}
+
+void Reader::skipWhitespace() {
+	while(pos < text.size() &&
+				(text[pos]==' ' || text[pos]=='\n' || text[pos]=='\r' || text[pos]=='\t'))
+		++pos;
+}
+
+void Reader::expect(char c) {
+	skipWhitespace();
+	if(pos >= text.size() || text[pos]!=c) {
+		std::string what = "expected '";
+		what += c;
+		what += '\'';
+		fail(what.c_str());
+	}
+	++pos;
+}
+
+void Reader::fail(const char * what) const {
+	throw std::runtime_error(std::string("JSON: ") + what + " at offset " + std::to_string(pos) + '\n');
+}
+
+std::string_view Reader::readRawString(bool & escaped) {
+	expect('"');
+	escaped = false;
+	size_t begin = pos;
+	while(pos < text.size() && text[pos]!='"') {
+		if(text[pos]=='\\') {
+			escaped = true;
+			++pos;
+		}
+		++pos;
+	}
+	if(pos >= text.size())
+		fail("unterminated string");
+	return text.substr(begin, (pos++)-begin);
+}
+
+std::string Reader::unescape(std::string_view raw) {
+	std::string str;
+	str.reserve(raw.size());
+	for(size_t i = 0; i < raw.size(); ++i) {
+		if(raw[i]!='\\' || i+1 >= raw.size()) {
+			str += raw[i];
+			continue;
+		}
+		switch(raw[++i]) {
+		case 'b': str += '\b'; break;
+		case 'f': str += '\f'; break;
+		case 'n': str += '\n'; break;
+		case 'r': str += '\r'; break;
+		case 't': str += '\t'; break;
+		case 'u':
+			{
+				// Basic Multilingual Plane only, encoded as UTF-8
+				unsigned code = 0;
+				if(i+4 < raw.size())
+					std::from_chars(raw.data()+i+1, raw.data()+i+5, code, 16);
+				i += 4;
+				if(code < 0x80)
+					str += (char)code;
+				else if(code < 0x800) {
+					str += (char)(0xC0 | (code>>6));
+					str += (char)(0x80 | (code&0x3F));
+				}
+				else {
+					str += (char)(0xE0 | (code>>12));
+					str += (char)(0x80 | ((code>>6)&0x3F));
+					str += (char)(0x80 | (code&0x3F));
+				}
+			}
+			break;
+		default:
+			// \" \\ \/
+			str += raw[i];
+		}
+	}
+	return str;
+}
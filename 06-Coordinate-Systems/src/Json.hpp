@@ -0,0 +1,90 @@
+/*
+ * A small streaming (pull) JSON parser.
+ * It doesn't build any document tree. Instead, the caller walks the text
+ * in order and pulls the values it's interested in, skipping the rest.
+ * The text is not copied - strings without escape sequences are returned
+ * as views into the original buffer.
+ *
+ * Typical use:
+ *   json::Reader r(text);
+ *   r.beginObject();
+ *   std::string_view key;
+ *   while(r.nextKey(key)) {
+ *     if(key == "count") n = r.readInt();
+ *     else r.skipValue();
+ *   }
+ *
+ * Malformed input ends with a std::runtime_error.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <string>
+#include <cstddef>
+#include <string_view>
+#include <exception>
+#include <stdexcept>
+
+namespace json {
+	// Kind of the next value in the text
+	enum class Token {
+		Object,
+		Array,
+		String,
+		Number,
+		Bool,
+		Null,
+		End
+	};
+
+	class Reader {
+	public:
+		Reader(std::string_view text) : text(text) {}
+
+		// Type of the next value, without consuming it
+		Token peek();
+
+		// Objects: beginObject() and then nextKey() until it returns false
+		void beginObject();
+		bool nextKey(std::string_view & key);
+
+		// Arrays: beginArray() and then nextElement() until it returns false
+		void beginArray();
+		bool nextElement();
+
+		// Scalars
+		std::string readString();
+		double readNumber();
+		long long readInt();
+		// Non-negative integer, e.g. a size or an offset
+		size_t readSize();
+		bool readBool();
+		void readNull();
+
+		// Skip the next value entirely (with all of it's children)
+		void skipValue();
+
+		// Skip the next value and return it's raw text, e.g. to parse it later with another Reader
+		std::string_view captureValue();
+
+	private:
+		std::string_view text;
+		size_t pos = 0;
+		// Set by nextKey()/nextElement() to tell if a ',' must precede the next item
+		bool first = true;
+
+		void skipWhitespace();
+		void expect(char c);
+		[[noreturn]] void fail(const char * what) const;
+
+		// Raw string contents between the quotes, with escape sequences untouched
+		std::string_view readRawString(bool & escaped);
+		static std::string unescape(std::string_view raw);
+	};
+}
+
+#endif /* JSON_HPP */
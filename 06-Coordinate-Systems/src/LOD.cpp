@@ -0,0 +1,271 @@
+#include "LOD.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace lod;
+
+namespace {
+	// Symmetric 4x4 error quadric of planes (a, b, c, d), weighted by triangle area
+	struct Quadric {
+		double aa = 0., ab = 0., ac = 0., ad = 0.;
+		double bb = 0., bc = 0., bd = 0.;
+		double cc = 0., cd = 0.;
+		double dd = 0.;
+		double weight = 0.;
+
+		void addPlane(const glm::vec3 & n, float d, double w) {
+			aa += w*n.x*n.x; ab += w*n.x*n.y; ac += w*n.x*n.z; ad += w*n.x*d;
+			bb += w*n.y*n.y; bc += w*n.y*n.z; bd += w*n.y*d;
+			cc += w*n.z*n.z; cd += w*n.z*d;
+			dd += w*d*d;
+			weight += w;
+		}
+
+		void add(const Quadric & q) {
+			aa += q.aa; ab += q.ab; ac += q.ac; ad += q.ad;
+			bb += q.bb; bc += q.bc; bd += q.bd;
+			cc += q.cc; cd += q.cd;
+			dd += q.dd;
+			weight += q.weight;
+		}
+
+		// Sum of weighted squared distances of p to the planes
+		double eval(const glm::vec3 & p) const {
+			double x = p.x, y = p.y, z = p.z;
+			double e = aa*x*x + 2.*ab*x*y + 2.*ac*x*z + 2.*ad*x
+				+ bb*y*y + 2.*bc*y*z + 2.*bd*y
+				+ cc*z*z + 2.*cd*z
+				+ dd;
+			return e > 0. ? e : 0.;
+		}
+	};
+
+	struct Collapse {
+		uint32_t from, to;
+		float cost;
+	};
+
+	uint64_t edgeKey(uint32_t a, uint32_t b) {
+		return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+	}
+
+	// Vertices sharing the exact position get the same canonical id
+	std::vector<uint32_t> canonicalPositions(const Geometry & g) {
+		struct Hash {
+			size_t operator()(const glm::vec3 & p) const {
+				// + 0 turns -0 into 0, which compare equal and must hash the same
+				float c[3] = {p.x + 0.f, p.y + 0.f, p.z + 0.f};
+				uint32_t h[3];
+				std::memcpy(h, c, sizeof(h));
+				return (size_t)(h[0]*73856093u ^ h[1]*19349663u ^ h[2]*83492791u);
+			}
+		};
+		struct Equal {
+			bool operator()(const glm::vec3 & a, const glm::vec3 & b) const { return a.x==b.x && a.y==b.y && a.z==b.z; }
+		};
+		std::unordered_map<glm::vec3, uint32_t, Hash, Equal> first;
+		first.reserve(g.numVertices);
+		std::vector<uint32_t> canonical(g.numVertices);
+		for(uint32_t v = 0; v < g.numVertices; ++v)
+			canonical[v] = first.emplace(g.positions[v], v).first->second;
+		return canonical;
+	}
+
+	// Borders, seams and non-manifold edges must stay where they are
+	std::vector<bool> lockedVertices(const Geometry & g, const std::vector<uint32_t> & canonical, const std::vector<uint32_t> & indices) {
+		std::vector<bool> locked(g.numVertices, false);
+
+		std::vector<uint32_t> sharing(g.numVertices, 0);
+		for(uint32_t v = 0; v < g.numVertices; ++v)
+			++sharing[canonical[v]];
+
+		std::unordered_map<uint64_t, uint32_t> edges;
+		edges.reserve(indices.size());
+		for(size_t i = 0; i < indices.size(); i += 3)
+			for(int k = 0; k < 3; ++k)
+				++edges[edgeKey(canonical[indices[i+k]], canonical[indices[i + (k+1)%3]])];
+		std::vector<bool> lockedPosition(g.numVertices, false);
+		for(const auto & [key, count] : edges)
+			if(count!=2) {
+				lockedPosition[key >> 32] = true;
+				lockedPosition[key & 0xFFFFFFFFu] = true;
+			}
+
+		for(uint32_t v = 0; v < g.numVertices; ++v)
+			locked[v] = lockedPosition[canonical[v]] || sharing[canonical[v]] > 1;
+		return locked;
+	}
+
+	float meshRadius(const Geometry & g) {
+		glm::vec3 lo(INFINITY), hi(-INFINITY);
+		for(size_t v = 0; v < g.numVertices; ++v) {
+			lo = glm::min(lo, g.positions[v]);
+			hi = glm::max(hi, g.positions[v]);
+		}
+		return g.numVertices ? glm::length(hi - lo) * .5f : 0.f;
+	}
+
+	glm::vec3 triangleNormal(const glm::vec3 & a, const glm::vec3 & b, const glm::vec3 & c) {
+		return glm::cross(b - a, c - a);
+	}
+}
+
+std::vector<uint32_t> lod::simplify(const Geometry & g, const std::vector<uint32_t> & input,
+																		size_t targetIndexCount, float maxError, float & error) {
+	std::vector<uint32_t> indices = input;
+	error = 0.f;
+	if(indices.size() <= targetIndexCount || g.numVertices==0)
+		return indices;
+
+	std::vector<uint32_t> canonical = canonicalPositions(g);
+	std::vector<bool> locked = lockedVertices(g, canonical, indices);
+
+	std::vector<Quadric> quadrics(g.numVertices);
+	for(size_t i = 0; i < indices.size(); i += 3) {
+		const glm::vec3 & a = g.positions[indices[i]];
+		const glm::vec3 & b = g.positions[indices[i+1]];
+		const glm::vec3 & c = g.positions[indices[i+2]];
+		glm::vec3 n = triangleNormal(a, b, c);
+		float doubleArea = glm::length(n);
+		if(doubleArea <= 0.f)
+			continue;
+		n = n / doubleArea;
+		for(int k = 0; k < 3; ++k)
+			quadrics[indices[i+k]].addPlane(n, -glm::dot(n, a), doubleArea * .5);
+	}
+
+	float radius = meshRadius(g);
+	float attributeScale = g.attributeWeight * radius;
+	auto attributeCost = [&](uint32_t a, uint32_t b) {
+		double sum = 0.;
+		for(size_t k = 0; k < g.attributeCount; ++k) {
+			double d = g.attributes[a*g.attributeCount + k] - g.attributes[b*g.attributeCount + k];
+			sum += d*d;
+		}
+		return sum * attributeScale * attributeScale;
+	};
+	// Mean squared distance to the planes of both vertices, plus the attribute penalty
+	auto collapseCost = [&](uint32_t from, uint32_t to) {
+		Quadric q = quadrics[from];
+		q.add(quadrics[to]);
+		double e = q.weight > 0. ? q.eval(g.positions[to]) / q.weight : 0.;
+		return (float)(e + attributeCost(from, to));
+	};
+
+	float maxCost = maxError * maxError;
+	std::vector<Collapse> candidates;
+	std::vector<uint32_t> adjacencyStart(g.numVertices + 1), adjacency;
+	std::vector<uint32_t> collapseTo(g.numVertices);
+	std::vector<bool> touched(g.numVertices);
+
+	while(indices.size() > targetIndexCount) {
+		// Triangles around every vertex (compressed rows)
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for(uint32_t v : indices)
+			++adjacencyStart[v + 1];
+		for(size_t v = 0; v < g.numVertices; ++v)
+			adjacencyStart[v + 1] += adjacencyStart[v];
+		adjacency.resize(indices.size());
+		{
+			std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for(size_t i = 0; i < indices.size(); ++i)
+				adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+		}
+
+		candidates.clear();
+		for(size_t i = 0; i < indices.size(); i += 3)
+			for(int k = 0; k < 3; ++k) {
+				uint32_t a = indices[i+k], b = indices[i + (k+1)%3];
+				if(!locked[a])
+					candidates.push_back(Collapse{a, b, collapseCost(a, b)});
+				if(!locked[b])
+					candidates.push_back(Collapse{b, a, collapseCost(b, a)});
+			}
+		std::sort(candidates.begin(), candidates.end(), [](const Collapse & x, const Collapse & y) { return x.cost < y.cost; });
+
+		// Independent collapses: a vertex and it's neighbours change at most once per pass
+		for(uint32_t v = 0; v < g.numVertices; ++v)
+			collapseTo[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+		size_t remaining = indices.size();
+		size_t collapsed = 0;
+		for(const Collapse & c : candidates) {
+			if(remaining <= targetIndexCount || c.cost > maxCost)
+				break;
+			if(touched[c.from] || touched[c.to])
+				continue;
+
+			// Reject collapses flipping or degenerating the triangles that stay
+			bool valid = true;
+			size_t removed = 0;
+			const glm::vec3 & target = g.positions[c.to];
+			for(uint32_t t = adjacencyStart[c.from]; t < adjacencyStart[c.from + 1] && valid; ++t) {
+				const uint32_t * tri = &indices[adjacency[t] * 3];
+				if(tri[0]==c.to || tri[1]==c.to || tri[2]==c.to) {
+					++removed;
+					continue;
+				}
+				glm::vec3 p[3], q[3];
+				for(int k = 0; k < 3; ++k) {
+					p[k] = g.positions[tri[k]];
+					q[k] = tri[k]==c.from ? target : p[k];
+				}
+				glm::vec3 before = triangleNormal(p[0], p[1], p[2]);
+				glm::vec3 after = triangleNormal(q[0], q[1], q[2]);
+				if(glm::dot(before, after) <= .25f * glm::length(before) * glm::length(after))
+					valid = false;
+			}
+			if(!valid)
+				continue;
+
+			collapseTo[c.from] = c.to;
+			quadrics[c.to].add(quadrics[c.from]);
+			error = std::max(error, std::sqrt(c.cost));
+			remaining -= removed * 3;
+			++collapsed;
+			for(uint32_t t = adjacencyStart[c.from]; t < adjacencyStart[c.from + 1]; ++t)
+				for(int k = 0; k < 3; ++k)
+					touched[indices[adjacency[t]*3 + k]] = true;
+		}
+		if(collapsed==0)
+			break;
+
+		// Apply the collapses and drop triangles that became degenerate
+		size_t out = 0;
+		for(size_t i = 0; i < indices.size(); i += 3) {
+			uint32_t a = collapseTo[indices[i]], b = collapseTo[indices[i+1]], c = collapseTo[indices[i+2]];
+			if(a==b || b==c || c==a)
+				continue;
+			indices[out++] = a;
+			indices[out++] = b;
+			indices[out++] = c;
+		}
+		indices.resize(out);
+	}
+	return indices;
+}
+
+std::vector<Level> lod::buildChain(const Geometry & g, const std::vector<uint32_t> & indices,
+																	 size_t maxLevels, size_t minTriangles) {
+	std::vector<Level> chain;
+	chain.push_back(Level{indices, 0.f});
+	float maxError = meshRadius(g) * .25f;
+	while(chain.size() < maxLevels) {
+		const Level & last = chain.back();
+		size_t triangles = last.indices.size() / 3;
+		if(triangles / 2 < minTriangles)
+			break;
+		float error;
+		std::vector<uint32_t> next = simplify(g, last.indices, triangles / 2 * 3, maxError, error);
+		// Not worth another draw range unless it saves at least a fifth of the triangles
+		if(next.size() > last.indices.size() * 4 / 5)
+			break;
+		// Errors are measured against the previous level, so they add up along the chain
+		float total = last.error + error;
+		chain.push_back(Level{std::move(next), total});
+	}
+	return chain;
+}
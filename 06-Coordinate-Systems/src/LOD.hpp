@@ -0,0 +1,90 @@
+/*
+ * Levels of detail: mesh simplification at import time and selection at runtime.
+ *
+ * The simplifier collapses edges of an indexed triangle list ordered by
+ * quadric error (Garland-Heckbert) plus a penalty for the difference of
+ * vertex attributes (texture coordinates, normals...) between the two ends.
+ * A vertex is only ever moved onto one of it's neighbours, so every level
+ * indexes the same vertex buffer and a LOD chain is just more index ranges.
+ * Vertices on open borders, UV/normal seams (same position, different
+ * attributes) and non-manifold edges are locked, and collapses flipping a
+ * triangle are rejected.
+ *
+ * Each level records it's error: the object space distance to the original
+ * surface. At runtime a level is acceptable when that error, projected to
+ * the screen, stays below a pixel tolerance. Comparing squared errors with a
+ * squared, scaled distance needs no square roots nor projections per object;
+ * a margin (hysteresis) around every switch point keeps objects near it from
+ * flipping between two levels every frame.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef LOD_HPP
+#define LOD_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+
+namespace lod {
+	struct Level {
+		std::vector<uint32_t> indices;
+		// Object space error compared to the original mesh
+		float error;
+	};
+
+	// Vertex data seen by the simplifier; attributes are `attributeCount` floats per vertex
+	struct Geometry {
+		const glm::vec3 * positions;
+		size_t numVertices;
+		const float * attributes = nullptr;
+		size_t attributeCount = 0;
+		// Weight of attribute differences; 1 means a difference of 1 costs as much as the mesh radius
+		float attributeWeight = .05f;
+	};
+
+	// Collapse edges of the triangle list until at most targetIndexCount indices are left
+	// or every collapse would cost more than maxError; `error` receives the largest error made
+	std::vector<uint32_t> simplify(const Geometry & geometry, const std::vector<uint32_t> & indices,
+																 size_t targetIndexCount, float maxError, float & error);
+
+	// LOD chain of up to maxLevels levels, each with about half the triangles of the previous one.
+	// Level 0 is the input; the chain ends early when simplification stops making progress.
+	std::vector<Level> buildChain(const Geometry & geometry, const std::vector<uint32_t> & indices,
+																size_t maxLevels = 5, size_t minTriangles = 32);
+
+	// How the camera sees errors this frame
+	struct Settings {
+		glm::vec3 cameraPosition = glm::vec3(0.f);
+		// Pixels per object space unit at distance 1: viewportHeight / (2 * tan(fovY / 2))
+		float pixelsPerUnit = 1.f;
+		// Largest acceptable error on the screen, in pixels
+		float pixelTolerance = 1.f;
+		// Relative margin around switch points
+		float hysteresis = .15f;
+	};
+
+	// Level to draw next, starting from the current one;
+	// allowedErrorSq is the squared object space error acceptable at the object's distance
+	inline uint32_t select(const Mesh::LOD * levels, uint32_t numLevels, uint32_t current,
+												 float allowedErrorSq, float hysteresisSq) {
+		if(numLevels < 2)
+			return 0;
+		if(current >= numLevels)
+			current = numLevels-1;
+		// Coarser only once clearly acceptable, finer as soon as clearly not
+		while(current+1 < numLevels && levels[current+1].error*levels[current+1].error*hysteresisSq <= allowedErrorSq)
+			++current;
+		while(current > 0 && levels[current].error*levels[current].error > allowedErrorSq*hysteresisSq)
+			--current;
+		return current;
+	}
+}
+
+#endif /* LOD_HPP */
@@ -0,0 +1,89 @@
+#include "LateLatch.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+	// Pitch stays off the poles, where yaw loses it's meaning
+	const float MaxPitch = glm::radians(89.f);
+}
+
+glm::vec3 latch::Pose::forward() const {
+	return glm::vec3(std::sin(yaw) * std::cos(pitch), std::sin(pitch), -std::cos(yaw) * std::cos(pitch));
+}
+
+glm::vec3 latch::Pose::right() const {
+	return glm::vec3(std::cos(yaw), 0.f, std::sin(yaw));
+}
+
+glm::mat4 latch::Pose::view() const {
+	return glm::lookAt(position, position + forward(), glm::vec3(0.f, 1.f, 0.f));
+}
+
+latch::Pose latch::fly(const Pose & pose, const glm::vec3 & move, const glm::vec2 & turn, float dt,
+											 const Limits & limits) {
+	Pose next = pose;
+	glm::vec3 direction = pose.right() * move.x + glm::vec3(0.f, 1.f, 0.f) * move.y + pose.forward() * move.z;
+	// Diagonal moves aren't faster than the limit
+	float length = glm::length(direction);
+	if(length > 1.f)
+		direction /= length;
+	next.position += direction * limits.speed * dt;
+	glm::vec2 rotation = turn;
+	if(glm::length(rotation) > 1.f)
+		rotation = glm::normalize(rotation);
+	next.yaw += rotation.x * limits.turnRate * dt;
+	next.pitch = glm::clamp(next.pitch + rotation.y * limits.turnRate * dt, -MaxPitch, MaxPitch);
+	return next;
+}
+
+latch::Pose latch::clamp(const Pose & recorded, const Pose & latest, const Limits & limits) {
+	Pose pose = latest;
+	glm::vec3 moved = latest.position - recorded.position;
+	float distance = glm::length(moved);
+	if(distance > limits.maxDistance())
+		pose.position = recorded.position + moved * (limits.maxDistance() / distance);
+
+	// Yaw and pitch together turn any view direction by at most the sum of their changes
+	float yaw = latest.yaw - recorded.yaw;
+	float pitch = latest.pitch - recorded.pitch;
+	float angle = std::fabs(yaw) + std::fabs(pitch);
+	if(angle > limits.maxAngle()) {
+		float scale = limits.maxAngle() / angle;
+		pose.yaw = recorded.yaw + yaw * scale;
+		pose.pitch = recorded.pitch + pitch * scale;
+	}
+	return pose;
+}
+
+Frustum latch::expandedFrustum(const Pose & pose, float fovY, float aspect, float zNear, float zFar, const Limits & limits) {
+	// Directions turned by up to `angle` stay within the planes widened by it, except near the
+	// corners, where a plane is further from the view axis: there the margin shrinks by the cosine
+	// of the corner's elevation above the plane's middle, so the widening grows by as much
+	float angle = limits.maxAngle();
+	float tanX = std::tan(fovY * .5f) * aspect, tanY = std::tan(fovY * .5f);
+	float cornerX = 1.f / std::sqrt(1.f + tanY*tanY / (1.f + tanX*tanX));
+	float cornerY = 1.f / std::sqrt(1.f + tanX*tanX / (1.f + tanY*tanY));
+	float widenX = std::asin(std::min(1.f, std::sin(angle) / cornerX));
+	float widenY = std::asin(std::min(1.f, std::sin(angle) / cornerY));
+	// Kept short of 90 degrees, where the projection breaks down
+	float halfX = std::min(std::atan(tanX) + widenX, glm::radians(89.f));
+	float halfY = std::min(std::atan(tanY) + widenY, glm::radians(89.f));
+	float distance = limits.maxDistance();
+	glm::mat4 projection = glm::perspective(2.f * halfY, std::tan(halfX) / std::tan(halfY),
+																					zNear, zFar + distance);
+	// Planes pushed out by the move; the near plane too, the camera may back off
+	return Frustum::fromMatrix(projection * pose.view()).expanded(distance);
+}
+
+void latch::PoseLatch::publish(const Pose & pose) {
+	std::lock_guard<std::mutex> lock(mutex);
+	this->pose = pose;
+}
+
+latch::Pose latch::PoseLatch::read() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return pose;
+}
@@ -0,0 +1,87 @@
+/*
+ * Late latching of the camera.
+ *
+ * A frame is recorded with the camera pose of the input read at it's start,
+ * but with a render thread it's executed a frame or two later - that much
+ * older is the view on screen. The simulation publishes every new pose to a
+ * PoseLatch; right before the frame's draws are submitted the render thread
+ * reads the newest one and writes the Camera block from it instead.
+ *
+ * Everything decided on the CPU with the recorded pose must then hold for
+ * the latched one too. The camera's speed and turn rate are bounded
+ * (Limits), and the latched pose is clamped to what the camera could reach
+ * from the recorded one within maxDelay. Culling uses a frustum containing
+ * the views of all these poses: the field of view widened by the largest
+ * turn (a bit more towards the corners) and every plane pushed out by the
+ * largest move.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef LATE_LATCH_HPP
+#define LATE_LATCH_HPP
+
+#include <mutex>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+
+namespace latch {
+	typedef std::chrono::steady_clock Clock;
+
+	// Fly camera: position, yaw and pitch (radians; yaw 0 looks down -z) and when the input it
+	// follows from was read
+	struct Pose {
+		glm::vec3 position;
+		float yaw;
+		float pitch;
+		Clock::time_point time;
+
+		glm::vec3 forward() const;
+		glm::vec3 right() const;
+		glm::mat4 view() const;
+	};
+
+	// How fast the camera can move and turn, and how much newer than the recorded pose a
+	// latched one may be
+	struct Limits {
+		float speed;
+		float turnRate;
+		double maxDelay;
+
+		float maxDistance() const { return speed * (float)maxDelay; }
+		float maxAngle() const { return turnRate * (float)maxDelay; }
+	};
+
+	// Move along the camera's axes (x right, y up, z forward, each in [-1, 1]) and turn (x yaw,
+	// y pitch) for dt seconds at the speeds of the limits
+	Pose fly(const Pose & pose, const glm::vec3 & move, const glm::vec2 & turn, float dt, const Limits & limits);
+
+	// `latest`, limited to what the camera can reach from `recorded` within the limits
+	Pose clamp(const Pose & recorded, const Pose & latest, const Limits & limits);
+
+	// Frustum containing the views of all poses clamp() can return for `pose`
+	Frustum expandedFrustum(const Pose & pose, float fovY, float aspect, float zNear, float zFar, const Limits & limits);
+
+	// Newest pose: published by the simulation thread, read by the render thread
+	class PoseLatch {
+	public:
+		explicit PoseLatch(const Pose & pose) : pose(pose) {}
+
+		// Delete copy and assignment constructors
+		PoseLatch(const PoseLatch &) = delete;
+		PoseLatch & operator=(const PoseLatch &) = delete;
+
+		void publish(const Pose & pose);
+		Pose read() const;
+
+	private:
+		mutable std::mutex mutex;
+		Pose pose;
+	};
+}
+
+#endif /* LATE_LATCH_HPP */
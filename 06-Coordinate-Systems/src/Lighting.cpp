@@ -0,0 +1,371 @@
+#include "Lighting.hpp"
+
+#include <cmath>
+#include <chrono>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#endif
+
+#include "Jobs.hpp"
+#include "Material.hpp"
+
+using namespace light;
+
+namespace {
+	// The widest vector type available at compile time
+#if defined(__AVX__)
+	typedef __m256 Vec;
+	constexpr size_t WIDTH = 8;
+	inline Vec load(const float * p) { return _mm256_loadu_ps(p); }
+	inline Vec splat(float v) { return _mm256_set1_ps(v); }
+	inline Vec zero() { return _mm256_setzero_ps(); }
+	inline Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+	inline Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+	inline Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+	inline Vec maximum(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+	inline unsigned lessEqual(Vec a, Vec b) { return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+#elif defined(__SSE__) || defined(_M_X64)
+	typedef __m128 Vec;
+	constexpr size_t WIDTH = 4;
+	inline Vec load(const float * p) { return _mm_loadu_ps(p); }
+	inline Vec splat(float v) { return _mm_set1_ps(v); }
+	inline Vec zero() { return _mm_setzero_ps(); }
+	inline Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+	inline Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+	inline Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+	inline Vec maximum(Vec a, Vec b) { return _mm_max_ps(a, b); }
+	inline unsigned lessEqual(Vec a, Vec b) { return (unsigned)_mm_movemask_ps(_mm_cmple_ps(a, b)); }
+#else
+	typedef float Vec;
+	constexpr size_t WIDTH = 1;
+	inline Vec load(const float * p) { return *p; }
+	inline Vec splat(float v) { return v; }
+	inline Vec zero() { return 0.f; }
+	inline Vec add(Vec a, Vec b) { return a+b; }
+	inline Vec sub(Vec a, Vec b) { return a-b; }
+	inline Vec mul(Vec a, Vec b) { return a*b; }
+	inline Vec maximum(Vec a, Vec b) { return std::max(a, b); }
+	inline unsigned lessEqual(Vec a, Vec b) { return a<=b ? 1u : 0u; }
+#endif
+
+	// Distance of coordinates to the range [min, max] (0 inside), squared
+	inline Vec distance2(Vec c, Vec min, Vec max) {
+		Vec d = maximum(maximum(sub(min, c), sub(c, max)), zero());
+		return mul(d, d);
+	}
+
+	// Fill to a multiple of the vector width with spheres no box can reach
+	void pad(std::vector<float> & x, std::vector<float> & y, std::vector<float> & z, std::vector<float> & radius2) {
+		while(x.size() % WIDTH) {
+			x.push_back(0.f); y.push_back(0.f); z.push_back(0.f);
+			radius2.push_back(-1.f);
+		}
+	}
+
+	// Range of a coordinate over a frustum slab's edge: c from a plane at c/d = tangent, d in [d0, d1]
+	inline void slabRange(float tangent0, float tangent1, float d0, float d1, float & min, float & max) {
+		min = std::min(tangent0 * d0, tangent0 * d1);
+		max = std::max(tangent1 * d0, tangent1 * d1);
+	}
+
+	typedef std::chrono::steady_clock Clock;
+}
+
+Light light::point(const glm::vec3 & position, float radius, const glm::vec3 & color) {
+	return Light{position, radius, color, -2.f, glm::vec3(0.f, 0.f, -1.f), -1.f};
+}
+
+Light light::spot(const glm::vec3 & position, const glm::vec3 & direction, float radius, const glm::vec3 & color,
+									float innerAngle, float outerAngle) {
+	return Light{position, radius, color, std::cos(outerAngle), glm::normalize(direction), std::cos(innerAngle)};
+}
+
+ClusterGrid::ClusterGrid(const Settings & settings) : settings(settings) {
+	this->settings.tilesX = std::max(1u, settings.tilesX);
+	this->settings.tilesY = std::max(1u, settings.tilesY);
+	this->settings.slices = std::max(1u, settings.slices);
+	slices.resize(this->settings.slices);
+}
+
+void ClusterGrid::build(const std::vector<Light> & lights, const glm::mat4 & view, float fovY, float aspect, float zNear,
+												float zFar, unsigned numThreads) {
+	auto start = Clock::now();
+	this->view = view;
+	this->zNear = zNear;
+	this->zFar = zFar;
+	tanHalfY = std::tan(fovY * .5f);
+	tanHalfX = tanHalfY * aspect;
+
+	// Spheres to view space; padding lies far in front of the camera, outside of every slice
+	numLights = std::min(lights.size(), MaxLights);
+	size_t padded = (numLights + WIDTH-1) / WIDTH * WIDTH;
+	for(auto * v : {&centerX, &centerY, &centerZ, &radius, &radius2})
+		v->resize(padded);
+	for(size_t i = 0; i < padded; ++i) {
+		if(i < numLights) {
+			glm::vec3 c = glm::vec3(view * glm::vec4(lights[i].position, 1.f));
+			centerX[i] = c.x; centerY[i] = c.y; centerZ[i] = c.z;
+			radius[i] = lights[i].radius;
+			radius2[i] = lights[i].radius * lights[i].radius;
+		}
+		else {
+			centerX[i] = 0.f; centerY[i] = 0.f; centerZ[i] = 1e30f;
+			radius[i] = 0.f;
+			radius2[i] = -1.f;
+		}
+	}
+
+	if(numThreads <= 1)
+		for(unsigned s = 0; s < settings.slices; ++s)
+			binSlice(s);
+	else
+		job::parallelFor(0, settings.slices, job::grainFor(settings.slices, numThreads), [this](size_t first, size_t last) {
+			for(size_t s = first; s < last; ++s)
+				binSlice((unsigned)s);
+		});
+
+	// Concatenate the slices' lists in order
+	size_t tiles = (size_t)settings.tilesX * settings.tilesY;
+	size_t total = 0;
+	for(const Slice & slice : slices)
+		total += slice.indices.size();
+	clusters.resize(getNumClusters());
+	indices.clear();
+	indices.reserve(total);
+	stats.maxPerCluster = 0;
+	for(unsigned s = 0; s < settings.slices; ++s) {
+		const Slice & slice = slices[s];
+		uint32_t offset = (uint32_t)indices.size();
+		for(size_t t = 0; t < tiles; ++t) {
+			clusters[s * tiles + t] = glm::uvec2(offset, slice.counts[t]);
+			offset += slice.counts[t];
+			stats.maxPerCluster = std::max<size_t>(stats.maxPerCluster, slice.counts[t]);
+		}
+		indices.insert(indices.end(), slice.indices.begin(), slice.indices.end());
+	}
+
+	stats.lights = numLights;
+	stats.clusters = clusters.size();
+	stats.references = indices.size();
+	stats.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void ClusterGrid::binSlice(unsigned s) {
+	Slice & slice = slices[s];
+	slice.indices.clear();
+	slice.counts.assign((size_t)settings.tilesX * settings.tilesY, 0);
+
+	// Exponential depth range of the slice; the camera looks down -z
+	float ratio = zFar / zNear;
+	float d0 = zNear * std::pow(ratio, (float)s / settings.slices);
+	float d1 = zNear * std::pow(ratio, (float)(s+1) / settings.slices);
+	Vec zMin = splat(-d1), zMax = splat(-d0);
+
+	// Lights overlapping the depth range
+	for(auto * v : {&slice.x, &slice.y, &slice.z, &slice.radius2})
+		v->clear();
+	slice.lights.clear();
+	for(size_t i = 0; i < centerZ.size(); i += WIDTH) {
+		Vec cz = load(&centerZ[i]), r = load(&radius[i]);
+		unsigned overlap = lessEqual(sub(cz, r), zMax) & lessEqual(zMin, add(cz, r));
+		while(overlap) {
+			size_t j = i + (size_t)__builtin_ctz(overlap);
+			overlap &= overlap-1;
+			slice.lights.push_back((uint16_t)j);
+			slice.x.push_back(centerX[j]); slice.y.push_back(centerY[j]); slice.z.push_back(centerZ[j]);
+			slice.radius2.push_back(radius2[j]);
+		}
+	}
+	if(slice.lights.empty())
+		return;
+	pad(slice.x, slice.y, slice.z, slice.radius2);
+
+	for(unsigned ty = 0; ty < settings.tilesY; ++ty) {
+		// Lights reaching the row's box (y and z; x spans the whole slice)
+		float yMin, yMax;
+		slabRange((-1.f + 2.f * ty / settings.tilesY) * tanHalfY, (-1.f + 2.f * (ty+1) / settings.tilesY) * tanHalfY, d0, d1,
+							yMin, yMax);
+		Vec rowMin = splat(yMin), rowMax = splat(yMax);
+		for(auto * v : {&slice.rowX, &slice.rowY, &slice.rowZ, &slice.rowRadius2})
+			v->clear();
+		slice.rowLights.clear();
+		for(size_t i = 0; i < slice.x.size(); i += WIDTH) {
+			Vec d2 = add(distance2(load(&slice.y[i]), rowMin, rowMax), distance2(load(&slice.z[i]), zMin, zMax));
+			unsigned reach = lessEqual(d2, load(&slice.radius2[i]));
+			while(reach) {
+				size_t j = i + (size_t)__builtin_ctz(reach);
+				reach &= reach-1;
+				slice.rowLights.push_back(slice.lights[j]);
+				slice.rowX.push_back(slice.x[j]); slice.rowY.push_back(slice.y[j]); slice.rowZ.push_back(slice.z[j]);
+				slice.rowRadius2.push_back(slice.radius2[j]);
+			}
+		}
+		if(slice.rowLights.empty())
+			continue;
+		pad(slice.rowX, slice.rowY, slice.rowZ, slice.rowRadius2);
+
+		// Full sphere against box test per tile
+		for(unsigned tx = 0; tx < settings.tilesX; ++tx) {
+			float xMin, xMax;
+			slabRange((-1.f + 2.f * tx / settings.tilesX) * tanHalfX, (-1.f + 2.f * (tx+1) / settings.tilesX) * tanHalfX, d0, d1,
+								xMin, xMax);
+			Vec tileMin = splat(xMin), tileMax = splat(xMax);
+			uint32_t & count = slice.counts[(size_t)ty * settings.tilesX + tx];
+			for(size_t i = 0; i < slice.rowX.size(); i += WIDTH) {
+				Vec d2 = add(add(distance2(load(&slice.rowX[i]), tileMin, tileMax), distance2(load(&slice.rowY[i]), rowMin, rowMax)),
+										 distance2(load(&slice.rowZ[i]), zMin, zMax));
+				unsigned reach = lessEqual(d2, load(&slice.rowRadius2[i]));
+				while(reach) {
+					slice.indices.push_back(slice.rowLights[i + (size_t)__builtin_ctz(reach)]);
+					reach &= reach-1;
+					++count;
+				}
+			}
+		}
+	}
+}
+
+ubo::Lights ClusterGrid::getBlock(const glm::vec3 & ambient) const {
+	ubo::Lights block;
+	block.clusterView = view;
+	block.clusterScale = glm::vec4(tanHalfX, tanHalfY, zNear, settings.slices / std::log(zFar / zNear));
+	block.tilesX = settings.tilesX;
+	block.tilesY = settings.tilesY;
+	block.slices = settings.slices;
+	block.count = (uint32_t)numLights;
+	block.lightDataOffset = block.lightClustersOffset = block.lightIndicesOffset = 0;
+	block.padding0 = 0;
+	block.ambient = ambient;
+	block.padding = 0.f;
+	return block;
+}
+
+namespace {
+	// Texture units of the light samplers, fixed like the materials' ones
+	struct Units {
+		GLuint lightData, lightClusters, lightIndices;
+	};
+
+	const Units & units() {
+		static const Units fixed{Material::samplerUnit("lightData"), Material::samplerUnit("lightClusters"),
+														 Material::samplerUnit("lightIndices")};
+		return fixed;
+	}
+
+	// The indices' 2 byte texels are the smallest: a buffer of twice the texel limit is addressable as all
+	GLsizeiptr addressableBytes() {
+		GLint maxTexels = 0;
+		glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+		return (GLsizeiptr)std::max(maxTexels, 65536) * (GLsizeiptr)sizeof(uint16_t);
+	}
+}
+
+LightBuffers::LightBuffers(GLsizeiptr capacity) :
+	maxCapacity(addressableBytes()),
+	stream(std::min(capacity, maxCapacity), FramesInFlight) {
+	glGenTextures(1, &lightData);
+	glGenTextures(1, &lightClusters);
+	glGenTextures(1, &lightIndices);
+	attach();
+}
+
+LightBuffers::~LightBuffers() {
+	for(GLuint * texture : {&lightData, &lightClusters, &lightIndices})
+		if(*texture)
+			glDeleteTextures(1, texture);
+}
+
+void LightBuffers::attach() {
+	const std::pair<GLuint, GLenum> views[] = {{lightData, GL_RGBA32F}, {lightClusters, GL_RG32UI}, {lightIndices, GL_R16UI}};
+	for(const auto & [texture, format] : views) {
+		glBindTexture(GL_TEXTURE_BUFFER, texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, stream.getBuffer());
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+bool LightBuffers::upload(const Light * lights, size_t numLights, const glm::uvec2 * clusters, size_t numClusters,
+													const uint16_t * indices, size_t numIndices, ubo::Lights & block) {
+	struct Array {
+		const void * data;
+		size_t size;
+		// Texel size, the alignment of the array in the ring
+		size_t texel;
+		uint32_t & offset;
+	};
+	Array arrays[] = {{lights, numLights * sizeof(Light), sizeof(glm::vec4), block.lightDataOffset},
+										{clusters, numClusters * sizeof(glm::uvec2), sizeof(glm::uvec2), block.lightClustersOffset},
+										{indices, numIndices * sizeof(uint16_t), sizeof(uint16_t), block.lightIndicesOffset}};
+	size_t needed = 0;
+	for(const Array & a : arrays)
+		needed += a.size + a.texel;
+
+	// Every frame in flight needs room for it's own data
+	stream.beginFrame();
+	GLsizeiptr frames = (GLsizeiptr)needed * FramesInFlight;
+	if(frames > stream.getCapacity()) {
+		if(frames > maxCapacity) {
+			std::cerr << "ERROR: (light::LightBuffers::upload) " << needed << " bytes of lights per frame exceed the "
+								<< maxCapacity / FramesInFlight << " the buffer textures can address\n";
+			block.count = 0;
+			return false;
+		}
+		stream.resize(std::min(maxCapacity, std::max(stream.getCapacity() * 2, frames)));
+		attach();
+	}
+
+	for(Array & a : arrays) {
+		if(!a.size) {
+			a.offset = 0;
+			continue;
+		}
+		StreamBuffer::Allocation allocation = stream.allocate((GLsizeiptr)a.size, (GLsizeiptr)a.texel);
+		if(!allocation.ptr) {
+			std::cerr << "ERROR: (light::LightBuffers::upload) No room for " << a.size << " bytes in the light stream\n";
+			block.count = 0;
+			return false;
+		}
+		std::memcpy(allocation.ptr, a.data, a.size);
+		stream.unmap();
+		a.offset = (uint32_t)(allocation.offset / a.texel);
+	}
+	return true;
+}
+
+void LightBuffers::bind() const {
+	const Units & u = units();
+	glActiveTexture(GL_TEXTURE0 + u.lightData);
+	glBindTexture(GL_TEXTURE_BUFFER, lightData);
+	glActiveTexture(GL_TEXTURE0 + u.lightClusters);
+	glBindTexture(GL_TEXTURE_BUFFER, lightClusters);
+	glActiveTexture(GL_TEXTURE0 + u.lightIndices);
+	glBindTexture(GL_TEXTURE_BUFFER, lightIndices);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+void light::bindProgramSamplers(GLuint program) {
+	const Units & u = units();
+	const std::pair<const char *, GLuint> samplers[] = {
+		{"lightData", u.lightData}, {"lightClusters", u.lightClusters}, {"lightIndices", u.lightIndices}};
+	GLint previous = 0;
+	bool used = false;
+	for(const auto & [name, unit] : samplers) {
+		GLint location = glGetUniformLocation(program, name);
+		if(location < 0)
+			continue;
+		if(!used) {
+			glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+			glUseProgram(program);
+			used = true;
+		}
+		glUniform1i(location, (GLint)unit);
+	}
+	if(used)
+		glUseProgram((GLuint)previous);
+}
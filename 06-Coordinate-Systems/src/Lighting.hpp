@@ -0,0 +1,179 @@
+/*
+ * Clustered forward lighting of point and spot lights.
+ *
+ * The view frustum is split into a 3D grid of clusters: tiles uniform in
+ * screen space (x, y), slices exponential in depth (z), so near clusters
+ * are as thin as far ones are wide on screen. Every frame each light's
+ * bounding sphere is tested against the view space box of every cluster
+ * it may touch, and the grid gets a list of the lights reaching each
+ * cluster. A fragment finds it's cluster from it's view space position and
+ * loops over that cluster's lights only, so the cost per fragment follows
+ * the lights nearby, not the lights in the scene.
+ *
+ * Binning runs on the CPU. Lights are moved to view space into a structure
+ * of arrays, so a SIMD register holds the same coordinate of 8 (AVX) or 4
+ * (SSE) lights (like Culling.hpp). Slices are binned in parallel: the
+ * lights overlapping a slice's depth range are gathered first, then those
+ * overlapping a row of tiles, then each tile of the row tests the row's
+ * lights with the full sphere against box test. Every slice writes into
+ * it's own lists, concatenated in order, so the result doesn't depend on
+ * the number of threads.
+ *
+ * The lights, the clusters (offset and count into the index list) and the
+ * index list are streamed to the GPU every frame (LightBuffers, GL thread)
+ * through a StreamBuffer, read by the shaders as buffer textures over the
+ * whole ring; the grid's parameters and where this frame's data starts go
+ * in the Lights uniform block (UniformBlocks.hpp). Light indices are 16
+ * bit, so at most MaxLights lights are binned.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef LIGHTING_HPP
+#define LIGHTING_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "UniformBlocks.hpp"
+#include "StreamBuffer.hpp"
+
+namespace light {
+	constexpr size_t MaxLights = 0xFFFF;
+
+	// As the shaders read it: 3 RGBA32F texels per light. Point lights have an outerCos of -2
+	struct Light {
+		glm::vec3 position;
+		// Where the light fades out completely
+		float radius;
+		// Color times intensity
+		glm::vec3 color;
+		float outerCos;
+		glm::vec3 direction;
+		float innerCos;
+	};
+	static_assert(sizeof(Light)==3 * sizeof(glm::vec4), "Light must be 3 texels of RGBA32F");
+
+	Light point(const glm::vec3 & position, float radius, const glm::vec3 & color);
+	// Full intensity within innerAngle of the direction, none past outerAngle (radians, from the axis)
+	Light spot(const glm::vec3 & position, const glm::vec3 & direction, float radius, const glm::vec3 & color,
+						 float innerAngle, float outerAngle);
+
+	struct Settings {
+		unsigned tilesX = 16;
+		unsigned tilesY = 9;
+		unsigned slices = 24;
+	};
+
+	struct Stats {
+		size_t lights = 0;
+		size_t clusters = 0;
+		// Light indices in all clusters' lists
+		size_t references = 0;
+		size_t maxPerCluster = 0;
+		double ms = 0.;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[lighting|lights:" << s.lights
+				 << "|clusters:" << s.clusters
+				 << "|references:" << s.references
+				 << "|maxPerCluster:" << s.maxPerCluster
+				 << "|ms:" << s.ms
+				 << "]";
+			return os;
+		}
+	};
+
+	// Lists of lights per cluster of a view's frustum, without any GL
+	class ClusterGrid {
+	public:
+		explicit ClusterGrid(const Settings & settings);
+
+		// Delete copy and assignment constructors
+		ClusterGrid(const ClusterGrid &) = delete;
+		ClusterGrid & operator=(const ClusterGrid &) = delete;
+
+		// Bin (the first MaxLights of) the lights into the clusters of the view and projection, slices
+		// spread over numThreads threads of the job pool
+		void build(const std::vector<Light> & lights, const glm::mat4 & view, float fovY, float aspect, float zNear, float zFar,
+							 unsigned numThreads);
+
+		// Offset into getIndices() and count of every cluster, x fastest, then y, then the slice
+		const std::vector<glm::uvec2> & getClusters() const { return clusters; }
+		const std::vector<uint16_t> & getIndices() const { return indices; }
+		size_t getNumClusters() const { return (size_t)settings.tilesX * settings.tilesY * settings.slices; }
+		// Uniform block of the last build, lit by `ambient` besides the lights
+		ubo::Lights getBlock(const glm::vec3 & ambient) const;
+
+		const Stats & getStats() const { return stats; }
+
+	private:
+		// Lights and outputs of one slice, reused every build
+		struct Slice {
+			std::vector<float> x, y, z, radius2;
+			std::vector<float> rowX, rowY, rowZ, rowRadius2;
+			std::vector<uint16_t> lights, rowLights;
+			std::vector<uint16_t> indices;
+			std::vector<uint32_t> counts;
+		};
+
+		Settings settings;
+		// View space spheres of the lights, padded to the vector width
+		std::vector<float> centerX, centerY, centerZ, radius, radius2;
+		std::vector<Slice> slices;
+		std::vector<glm::uvec2> clusters;
+		std::vector<uint16_t> indices;
+
+		glm::mat4 view = glm::mat4(1.f);
+		float tanHalfX = 1.f, tanHalfY = 1.f;
+		float zNear = .1f, zFar = 100.f;
+		size_t numLights = 0;
+		Stats stats;
+
+		void binSlice(unsigned slice);
+	};
+
+	// A grid's lists on the GPU, streamed every frame (GL thread). The ring grows when a frame needs
+	// more, but never beyond what GL_MAX_TEXTURE_BUFFER_SIZE texels can address
+	class LightBuffers {
+	public:
+		explicit LightBuffers(GLsizeiptr capacity);
+		~LightBuffers();
+
+		// Delete copy and assignment constructors
+		LightBuffers(const LightBuffers &) = delete;
+		LightBuffers & operator=(const LightBuffers &) = delete;
+
+		// Stream the frame's data and point the block's offsets at it. False when it doesn't fit the
+		// buffer textures; nothing is written and the block gets no lights
+		bool upload(const Light * lights, size_t numLights, const glm::uvec2 * clusters, size_t numClusters,
+								const uint16_t * indices, size_t numIndices, ubo::Lights & block);
+		// Bind the textures to the units of bindProgramSamplers()
+		void bind() const;
+		// Fence the frame's data (after the last draw reading it)
+		void endFrame() { stream.endFrame(); }
+
+	private:
+		static constexpr unsigned FramesInFlight = 3;
+
+		// Biggest ring whose every texel is addressable
+		GLsizeiptr maxCapacity;
+		StreamBuffer stream;
+		// Views of the whole ring as lights, clusters and indices
+		GLuint lightData = 0, lightClusters = 0, lightIndices = 0;
+
+		// Point the textures at the (new) buffer of the ring
+		void attach();
+	};
+
+	// Point the light samplers of a linked program to their units
+	void bindProgramSamplers(GLuint program);
+}
+
+#endif /* LIGHTING_HPP */
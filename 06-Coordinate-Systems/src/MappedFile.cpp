@@ -0,0 +1,43 @@
+#include "MappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const char * path) {
+	if(path==NULL)
+		throw std::ios_base::failure("MappedFile path is NULL\n");
+	this->path = path;
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) {
+		std::cerr << "ERROR: (MappedFile::MappedFile) Error opening file: " << path << '\n';
+		throw std::ios_base::failure("Error opening file\n");
+	}
+
+	struct stat st;
+	if(fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		std::cerr << "ERROR: (MappedFile::MappedFile) File is empty or can't be inspected: " << path << '\n';
+		throw std::ios_base::failure("Error inspecting file\n");
+	}
+	length = (size_t)st.st_size;
+
+	void * mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping keeps its own reference to the file
+	close(fd);
+	if(mapping == MAP_FAILED) {
+		std::cerr << "ERROR: (MappedFile::MappedFile) Failed to map file: " << path << '\n';
+		throw std::ios_base::failure("Error mapping file\n");
+	}
+
+	// Loaders walk the file front to back
+	madvise(mapping, length, MADV_SEQUENTIAL);
+	bytes = static_cast<const unsigned char *>(mapping);
+}
+
+MappedFile::~MappedFile() {
+	if(bytes)
+		munmap(const_cast<unsigned char *>(bytes), length);
+}
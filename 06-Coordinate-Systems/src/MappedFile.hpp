@@ -0,0 +1,45 @@
+/*
+ * Read-only memory mapping of a whole file.
+ * The mapping lives as long as the MappedFile object, so any pointer
+ * obtained with data() stays valid only for that long.
+ *
+ * It lets loaders (e.g. the glTF one) hand parts of the file straight
+ * to OpenGL without copying them into intermediate buffers first.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <cstddef>
+#include <exception>
+#include <iostream>
+
+class MappedFile {
+public:
+	// Map the whole file; throws std::ios_base::failure if it can't be done
+	MappedFile(const char * path);
+	~MappedFile();
+
+	// Delete copy and assignment constructors
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	// Beginning of the mapped file contents
+	const unsigned char * data() const { return bytes; }
+
+	// Size of the mapped file in bytes
+	size_t size() const { return length; }
+
+	const std::string & getPath() const { return path; }
+
+private:
+	const unsigned char * bytes = nullptr;
+	size_t length = 0;
+	std::string path;
+};
+
+#endif /* MAPPED_FILE_HPP */
@@ -0,0 +1,152 @@
+#include "Material.hpp"
+
+#include <map>
+
+#include "Texture.hpp"
+#include "UniformBlocks.hpp"
+
+Material::BindStats Material::bindStats;
+
+Material::Material(glm::vec4 baseColorFactor, u64 baseColorTexture,
+									 float metallicFactor, float roughnessFactor) :
+	baseColorFactor(baseColorFactor),
+	baseColorTexture(baseColorTexture),
+	metallicFactor(metallicFactor),
+	roughnessFactor(roughnessFactor) {
+	// Resource type
+	type = Resource::Type::Material;
+	resID = 0;
+	if(baseColorTexture)
+		setTexture("texture0", baseColorTexture);
+}
+
+void Material::setShader(u64 shader) {
+	if(resolved)
+		std::cerr << "ERROR: (Material::setShader) The material is already in use\n";
+	else
+		this->shader = shader;
+}
+
+void Material::setDoubleSided(bool doubleSided) {
+	if(resolved)
+		std::cerr << "ERROR: (Material::setDoubleSided) The material is already in use\n";
+	else
+		this->doubleSided = doubleSided;
+}
+
+void Material::setTexture(const std::string & sampler, u64 texture) {
+	if(resolved) {
+		std::cerr << "ERROR: (Material::setTexture) The material is already in use\n";
+		return;
+	}
+	for(Sampler & s : samplers)
+		if(s.name==sampler) {
+			s.texture = texture;
+			return;
+		}
+	samplers.push_back(Sampler{sampler, texture, samplerUnit(sampler), GL_TEXTURE_2D, 0});
+}
+
+GLuint Material::samplerUnit(const std::string & sampler) {
+	static std::map<std::string, GLuint> units;
+	auto it = units.find(sampler);
+	if(it==units.end())
+		it = units.emplace(sampler, (GLuint)units.size()).first;
+	return it->second;
+}
+
+uint64_t Material::getSortKey() const {
+	// Textures hashed in unit order; collisions only cost a state change
+	uint64_t textures = 0;
+	for(const Sampler & s : samplers)
+		textures = textures * 31 + s.texture + s.unit;
+	return ((uint64_t)(shader & 0xFFFF) << 48) | ((textures & 0xFFFFFF) << 24) | (resID & 0xFFFFFF);
+}
+
+Material & Material::fallback() {
+	static Material material;
+	return material;
+}
+
+void Material::resolve(ResourceManager & resMan) {
+	resolved = true;
+	if(shader) {
+		program = std::static_pointer_cast<Shader>(resMan.find(shader));
+		if(!program)
+			std::cerr << "ERROR: (Material::resolve) Shader " << shader << " not found, using the default\n";
+	}
+	for(Sampler & s : samplers) {
+		auto texture = std::static_pointer_cast<Texture>(resMan.find(s.texture));
+		if(texture) {
+			s.target = texture->getTarget();
+			s.glID = texture->getGLID();
+		}
+	}
+
+	ubo::MaterialBlock block{baseColorFactor, metallicFactor, roughnessFactor, {0.f, 0.f}};
+	glGenBuffers(1, &uniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(block), &block, GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+GLuint Material::textureAt(GLuint unit) const {
+	for(const Sampler & s : samplers)
+		if(s.unit==unit)
+			return s.glID;
+	return 0;
+}
+
+const Shader & Material::bind(ResourceManager & resMan, const Shader & fallback, const Material * previous) {
+	if(!resolved)
+		resolve(resMan);
+	bindStats.binds++;
+
+	const Shader & current = program ? *program : fallback;
+	if(!previous || previous->boundProgram!=&current) {
+		current.activate();
+		// Units are fixed per sampler name, so after the first time these are skipped as unchanged
+		for(const Sampler & s : samplers)
+			current.setInt(s.name.c_str(), (int)s.unit);
+		bindStats.programs++;
+	}
+	boundProgram = &current;
+
+	for(const Sampler & s : samplers) {
+		if(previous && previous->textureAt(s.unit)==s.glID)
+			continue;
+		glActiveTexture(GL_TEXTURE0 + s.unit);
+		glBindTexture(s.target, s.glID);
+		bindStats.textures++;
+	}
+
+	if(!previous || previous->doubleSided!=doubleSided) {
+		if(doubleSided)
+			glDisable(GL_CULL_FACE);
+		else
+			glEnable(GL_CULL_FACE);
+	}
+
+	if(!previous || previous->uniformBuffer!=uniformBuffer) {
+		glBindBufferBase(GL_UNIFORM_BUFFER, ubo::MaterialBinding, uniformBuffer);
+		bindStats.blocks++;
+	}
+	return current;
+}
+
+void Material::print(std::ostream & os) const {
+	os << "[type:Material"
+		 << "|resID:" << resID
+		 << "|name:" << friendlyName
+		 << "|base color:" << baseColorFactor.x << ',' << baseColorFactor.y << ','
+		 << baseColorFactor.z << ',' << baseColorFactor.w
+		 << "|base color texture resID:" << baseColorTexture
+		 << "|metallic:" << metallicFactor
+		 << "|roughness:" << roughnessFactor
+		 << "|shader resID:" << shader
+		 << "|double-sided:" << doubleSided
+		 << "|samplers:";
+	for(size_t i = 0; i < samplers.size(); ++i)
+		os << (i ? "," : "") << samplers[i].name << '=' << samplers[i].texture << "@unit" << samplers[i].unit;
+	os << "]";
+}
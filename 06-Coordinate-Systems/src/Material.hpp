@@ -0,0 +1,143 @@
+/*
+ * Surface description of a mesh primitive: what program draws it, which
+ * textures it samples and the values of it's uniforms.
+ *
+ * Parameters follow the glTF 2.0 metallic-roughness model:
+ * - base color factor and an optional base color texture,
+ * - metallic and roughness factors.
+ * They live in a `uniform Material` block (see UniformBlocks.hpp) held in a
+ * buffer of the material's own, so binding a material is a buffer binding
+ * rather than a round of glUniform calls.
+ *
+ * Textures are assigned to sampler names. Every sampler name gets a texture
+ * unit once, for the whole program run (texture0 -> 0, texture1 -> 1, ... in
+ * order of first use), so sampler uniforms never change after they're set
+ * and materials sharing a texture on the same sampler share the unit.
+ *
+ * Materials are double-sided by default: drawn without face culling. Single-
+ * sided ones (glTF's default, see GltfLoader.hpp) turn GL_CULL_FACE on while
+ * they are bound; drawers turn it back off after their last material.
+ *
+ * The shader is a resID of a Shader (e.g. a ShaderVariants permutation);
+ * 0 means the renderer's default one. Materials are drawn in order of their
+ * sort key (shader, then textures), and bind() takes the previously bound
+ * material so only the program, units and block that differ are touched.
+ *
+ * Textures and shaders are referenced by their resID in the ResourceManager.
+ * resID 0 means "none" (it's reserved for the ResourceManager itself). They
+ * are resolved, and the uniform buffer created, on the first bind().
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef MATERIAL_HPP
+#define MATERIAL_HPP
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "Resource.hpp"
+#include "ResourceManager.hpp"
+#include "Shader.hpp"
+
+class Material: public Resource {
+public:
+	// The base color texture is sampled by `texture0`
+	Material(glm::vec4 baseColorFactor = glm::vec4(1.f), u64 baseColorTexture = 0,
+					 float metallicFactor = 1.f, float roughnessFactor = 1.f);
+
+	// Delete copy and assignment constructors
+	Material(const Material &) = delete;
+	Material & operator=(const Material &) = delete;
+
+	glm::vec4 getBaseColorFactor() const { return baseColorFactor; }
+	u64 getBaseColorTexture() const { return baseColorTexture; }
+	float getMetallicFactor() const { return metallicFactor; }
+	float getRoughnessFactor() const { return roughnessFactor; }
+
+	// Program to draw with, 0 for the renderer's default (before the first bind())
+	void setShader(u64 shader);
+	u64 getShader() const { return shader; }
+
+	// Cull back faces of what's drawn with this material unless it's double-sided (before the first bind())
+	void setDoubleSided(bool doubleSided);
+	bool isDoubleSided() const { return doubleSided; }
+
+	// Sample the texture through the named sampler (before the first bind())
+	void setTexture(const std::string & sampler, u64 texture);
+
+	// Shader in the high bits, then the textures, then the material itself
+	uint64_t getSortKey() const;
+
+	// Make this material current, issuing GL calls only for the state that differs from
+	// `previous` (null when unknown); returns the program now in use
+	const Shader & bind(ResourceManager & resMan, const Shader & fallback, const Material * previous = nullptr);
+
+	// White material without textures, for primitives without one
+	static Material & fallback();
+
+	// Texture unit of a sampler name, the same during the whole run
+	static GLuint samplerUnit(const std::string & sampler);
+
+	// GL state changes made by bind() since the last reset (e.g. per frame)
+	struct BindStats {
+		size_t binds = 0;
+		size_t programs = 0;
+		size_t textures = 0;
+		size_t blocks = 0;
+
+		friend std::ostream & operator<<(std::ostream & os, const BindStats & s) {
+			os << "[materials|binds:" << s.binds
+				 << "|programs:" << s.programs
+				 << "|textures:" << s.textures
+				 << "|blocks:" << s.blocks
+				 << "]";
+			return os;
+		}
+	};
+	static const BindStats & getBindStats() { return bindStats; }
+	static void resetBindStats() { bindStats = BindStats(); }
+
+private:
+	glm::vec4 baseColorFactor;
+	u64 baseColorTexture;
+	float metallicFactor;
+	float roughnessFactor;
+
+	struct Sampler {
+		std::string name;
+		u64 texture;
+		GLuint unit;
+		// Resolved on the first bind()
+		GLenum target;
+		GLuint glID;
+	};
+	std::vector<Sampler> samplers;
+	u64 shader = 0;
+	bool doubleSided = true;
+
+	// GL side, created by the first bind()
+	bool resolved = false;
+	std::shared_ptr<Shader> program;
+	GLuint uniformBuffer = 0;
+	// Program the last bind() made current
+	const Shader * boundProgram = nullptr;
+
+	static BindStats bindStats;
+
+	void resolve(ResourceManager & resMan);
+	// GL name bound to the unit by this material, 0 if it doesn't use the unit
+	GLuint textureAt(GLuint unit) const;
+
+	virtual void print(std::ostream & os) const override;
+};
+
+#endif /* MATERIAL_HPP */
@@ -0,0 +1,52 @@
+#include "Mesh.hpp"
+
+#include <algorithm>
+
+Mesh::Mesh(std::vector<GLuint> buffers, std::vector<Primitive> primitives) :
+	buffers(std::move(buffers)),
+	primitives(std::move(primitives)) {
+	// Resource type
+	type = Resource::Type::Mesh;
+}
+
+void Mesh::draw() const {
+	for(size_t i = 0; i < primitives.size(); ++i)
+		draw(i);
+}
+
+void Mesh::draw(size_t primitive, uint32_t lod) const {
+	const Primitive & p = primitives[primitive];
+	glBindVertexArray(p.VAO);
+	if(!p.lods.empty()) {
+		const LOD & level = p.lods[std::min<size_t>(lod, p.lods.size()-1)];
+		glDrawElements(p.mode, level.count, p.indexType, (void*)level.indexOffset);
+	}
+	else if(p.indexed)
+		glDrawElements(p.mode, p.count, p.indexType, (void*)p.indexOffset);
+	else
+		glDrawArrays(p.mode, 0, p.count);
+}
+
+void Mesh::draw(size_t primitive, GLuint indexBuffer, GLsizei count, size_t indexOffset, GLint baseVertex) const {
+	const Primitive & p = primitives[primitive];
+	glBindVertexArray(p.VAO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glDrawElementsBaseVertex(p.mode, count, GL_UNSIGNED_INT, (void*)indexOffset, baseVertex);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p.elementBuffer);
+}
+
+GLsizei Mesh::getCount(size_t primitive, uint32_t lod) const {
+	const Primitive & p = primitives[primitive];
+	if(!p.lods.empty())
+		return p.lods[std::min<size_t>(lod, p.lods.size()-1)].count;
+	return p.count;
+}
+
+void Mesh::print(std::ostream & os) const {
+	os << "[type:Mesh"
+		 << "|resID:" << resID
+		 << "|name:" << friendlyName
+		 << "|number of buffers:" << buffers.size()
+		 << "|number of primitives:" << primitives.size()
+		 << "]";
+}
@@ -0,0 +1,107 @@
+/*
+ * This class holds the GPU side of a mesh: OpenGL buffers with vertex/index data
+ * and one Vertex Array Object per primitive describing how to read them.
+ *
+ * A mesh is made of primitives, each one drawn with a single draw call
+ * and with it's own material (referenced by resID in the ResourceManager).
+ * The Mesh doesn't know where the data came from - it's filled by loaders
+ * (e.g. gltf::loadGLB) which create the GL objects and pass them in.
+ *
+ * A primitive may carry a level of detail chain (see LOD.hpp): coarser index
+ * ranges over the same vertices, in the element buffer bound to it's VAO.
+ * Big primitives may also be split into meshlets (see Meshlets.hpp), culled
+ * per frame and drawn from indices written into a streamed buffer.
+ *
+ * Vertex attribute locations used across the project's shaders:
+ * 0 - position, 1 - color, 2 - texture coordinates, 3 - normal
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <iostream>
+#include <vector>
+#include <memory>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "Resource.hpp"
+#include "Meshlets.hpp"
+
+class Mesh: public Resource {
+public:
+	// Attribute locations shared with the shaders
+	enum Attribute {
+		Position = 0,
+		Color = 1,
+		TexCoord = 2,
+		Normal = 3
+	};
+
+	// Index range of one level of detail of a primitive
+	struct LOD {
+		GLsizei count = 0;
+		// Byte offset of the first index in the element buffer
+		size_t indexOffset = 0;
+		// Object space distance to the full detail surface
+		float error = 0.f;
+	};
+
+	struct Primitive {
+		GLuint VAO = 0;
+		GLenum mode = GL_TRIANGLES;
+		// Number of indices (or vertices if not indexed)
+		GLsizei count = 0;
+		bool indexed = false;
+		GLenum indexType = GL_UNSIGNED_INT;
+		// Byte offset of the first index in the element buffer
+		size_t indexOffset = 0;
+		// Material resID, 0 if none
+		u64 material = 0;
+		// Object space bounds
+		glm::vec3 boundsMin = glm::vec3(0.f);
+		glm::vec3 boundsMax = glm::vec3(0.f);
+		// Finest first, level 0 is the full primitive; empty when there is no chain
+		std::vector<LOD> lods;
+		// Clusters of the full detail triangles, null if not split
+		std::shared_ptr<const meshlet::Set> meshlets;
+		// Element buffer bound to the VAO, 0 if none
+		GLuint elementBuffer = 0;
+	};
+
+	// Take over already created GL buffers and primitives' VAOs
+	Mesh(std::vector<GLuint> buffers, std::vector<Primitive> primitives);
+
+	// Delete copy and assignment constructors
+	Mesh(const Mesh &) = delete;
+	Mesh & operator=(const Mesh &) = delete;
+
+	// Issue draw calls for all primitives (shader and textures must be bound by the caller)
+	void draw() const;
+
+	// Issue a draw call for a single primitive, at the given level of detail if it has a chain
+	void draw(size_t primitive, uint32_t lod = 0) const;
+
+	// Draw a primitive with 32 bit indices taken from another element buffer
+	// (e.g. indices of visible meshlets); the VAO's own element buffer is restored afterwards
+	void draw(size_t primitive, GLuint indexBuffer, GLsizei count, size_t indexOffset, GLint baseVertex = 0) const;
+
+	// Number of indices (or vertices) a draw of the primitive at the given level submits
+	GLsizei getCount(size_t primitive, uint32_t lod = 0) const;
+
+	const std::vector<Primitive> & getPrimitives() const { return primitives; }
+
+private:
+	// OpenGL buffers holding data of all primitives
+	std::vector<GLuint> buffers;
+	std::vector<Primitive> primitives;
+
+	virtual void print(std::ostream & os) const override;
+};
+
+#endif /* MESH_HPP */
@@ -0,0 +1,258 @@
+#include "Meshlets.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define MESHLETS_SSE
+#endif
+
+#include "Jobs.hpp"
+
+using namespace meshlet;
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	// Sphere around the meshlet's vertices and the cone around it's triangle normals
+	void computeBounds(Set & set, const Meshlet & m, const glm::vec3 * positions, bool backFacesCulled) {
+		glm::vec3 lo(INFINITY), hi(-INFINITY);
+		for(uint32_t v = 0; v < m.vertexCount; ++v) {
+			const glm::vec3 & p = positions[set.vertices[m.vertexOffset + v]];
+			lo = glm::min(lo, p);
+			hi = glm::max(hi, p);
+		}
+		glm::vec3 center = (lo + hi) * .5f;
+		float radius = 0.f;
+		for(uint32_t v = 0; v < m.vertexCount; ++v)
+			radius = std::max(radius, glm::length(positions[set.vertices[m.vertexOffset + v]] - center));
+		set.spheres.push(center, radius);
+
+		std::vector<glm::vec3> normals;
+		glm::vec3 axis(0.f);
+		for(uint32_t t = 0; t < m.triangleCount; ++t) {
+			const uint8_t * tri = &set.triangles[(m.triangleOffset + t) * 3];
+			const glm::vec3 & a = positions[set.vertices[m.vertexOffset + tri[0]]];
+			const glm::vec3 & b = positions[set.vertices[m.vertexOffset + tri[1]]];
+			const glm::vec3 & c = positions[set.vertices[m.vertexOffset + tri[2]]];
+			glm::vec3 n = glm::cross(b - a, c - a);
+			float length = glm::length(n);
+			if(length <= 0.f)
+				continue;
+			normals.push_back(n / length);
+			axis += normals.back();
+		}
+
+		float axisLength = glm::length(axis);
+		float cutoff = 2.f;
+		if(axisLength > 0.f)
+			axis = axis / axisLength;
+		// A unit axis and a cutoff of 2 never cull
+		if(backFacesCulled && axisLength > 0.f) {
+			float minDot = 1.f;
+			for(const glm::vec3 & n : normals)
+				minDot = std::min(minDot, glm::dot(n, axis));
+			if(minDot > 0.f)
+				cutoff = std::sqrt(1.f - minDot*minDot);
+		}
+		set.coneX.push_back(axis.x);
+		set.coneY.push_back(axis.y);
+		set.coneZ.push_back(axis.z);
+		set.coneCutoff.push_back(cutoff);
+	}
+
+	// Scalar version of the culling test, for the tail that doesn't fill a vector
+	bool visibleMeshlet(const Set & set, const Frustum & frustum, const glm::vec3 & camera, size_t i) {
+		glm::vec3 center(set.spheres.centerX[i], set.spheres.centerY[i], set.spheres.centerZ[i]);
+		float radius = set.spheres.radius[i];
+		if(!frustum.intersects(center, radius))
+			return false;
+		// All triangles face away when the view direction to every point of the sphere is within
+		// 90 degrees minus the cone's half angle of the cone axis
+		glm::vec3 view = center - camera;
+		float cutoff = set.coneCutoff[i];
+		float along = view.x*set.coneX[i] + view.y*set.coneY[i] + view.z*set.coneZ[i];
+		return along <= cutoff * glm::length(view) + radius * (1.f + cutoff);
+	}
+}
+
+Set meshlet::build(const glm::vec3 * positions, size_t numVertices, const std::vector<uint32_t> & indices,
+									bool backFacesCulled) {
+	Set set;
+	size_t numTriangles = indices.size() / 3;
+
+	// Triangles around every vertex (compressed rows)
+	std::vector<uint32_t> adjacencyStart(numVertices + 1, 0), adjacency(numTriangles * 3);
+	for(size_t i = 0; i < numTriangles*3; ++i)
+		++adjacencyStart[indices[i] + 1];
+	for(size_t v = 0; v < numVertices; ++v)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+	{
+		std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for(size_t i = 0; i < numTriangles*3; ++i)
+			adjacency[fill[indices[i]]++] = (uint32_t)(i / 3);
+	}
+
+	std::vector<bool> emitted(numTriangles, false);
+	// Local index of a vertex in the meshlet being built, -1 if not in it
+	std::vector<int16_t> local(numVertices, -1);
+	std::vector<uint32_t> candidates;
+	size_t seed = 0;
+
+	Meshlet current{0, 0, 0, 0};
+	auto finish = [&]() {
+		if(current.triangleCount==0)
+			return;
+		for(uint32_t v = 0; v < current.vertexCount; ++v)
+			local[set.vertices[current.vertexOffset + v]] = -1;
+		set.meshlets.push_back(current);
+		computeBounds(set, current, positions, backFacesCulled);
+		current = Meshlet{(uint32_t)set.vertices.size(), (uint32_t)(set.triangles.size() / 3), 0, 0};
+		candidates.clear();
+	};
+	auto newVertices = [&](uint32_t t) {
+		return (local[indices[t*3]] < 0) + (local[indices[t*3 + 1]] < 0) + (local[indices[t*3 + 2]] < 0);
+	};
+	auto emit = [&](uint32_t t) {
+		for(int k = 0; k < 3; ++k) {
+			uint32_t v = indices[t*3 + k];
+			if(local[v] < 0) {
+				local[v] = (int16_t)current.vertexCount++;
+				set.vertices.push_back(v);
+			}
+			set.triangles.push_back((uint8_t)local[v]);
+			for(uint32_t a = adjacencyStart[v]; a < adjacencyStart[v + 1]; ++a)
+				if(!emitted[adjacency[a]])
+					candidates.push_back(adjacency[a]);
+		}
+		emitted[t] = true;
+		++current.triangleCount;
+	};
+
+	for(size_t done = 0; done < numTriangles; ++done) {
+		// Neighbour adding the fewest new vertices; drop stale candidates on the way
+		uint32_t best = UINT32_MAX;
+		int bestScore = 4;
+		size_t kept = 0;
+		for(uint32_t t : candidates) {
+			if(emitted[t])
+				continue;
+			candidates[kept++] = t;
+			int score = newVertices(t);
+			if(score < bestScore) {
+				best = t;
+				bestScore = score;
+			}
+		}
+		candidates.resize(kept);
+
+		if(best==UINT32_MAX) {
+			// Nothing connected is left: continue at the next free triangle
+			finish();
+			while(emitted[seed])
+				++seed;
+			best = (uint32_t)seed;
+		}
+		else if((size_t)(current.vertexCount + bestScore) > MAX_VERTICES || current.triangleCount + 1u > MAX_TRIANGLES)
+			// Full: the next meshlet starts right next to this one
+			finish();
+		emit(best);
+	}
+	finish();
+	return set;
+}
+
+void meshlet::cull(const Set & set, const Frustum & frustum, const glm::vec3 & camera, size_t begin, size_t end,
+									 std::vector<uint32_t> & visible) {
+	size_t i = begin;
+#ifdef MESHLETS_SSE
+	__m128 planes[6][4];
+	for(int p = 0; p < 6; ++p)
+		for(int k = 0; k < 4; ++k)
+			planes[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+	const __m128 camX = _mm_set1_ps(camera.x), camY = _mm_set1_ps(camera.y), camZ = _mm_set1_ps(camera.z);
+	const __m128 one = _mm_set1_ps(1.f);
+
+	for(; i + 4 <= end; i += 4) {
+		__m128 cx = _mm_loadu_ps(&set.spheres.centerX[i]);
+		__m128 cy = _mm_loadu_ps(&set.spheres.centerY[i]);
+		__m128 cz = _mm_loadu_ps(&set.spheres.centerZ[i]);
+		__m128 r = _mm_loadu_ps(&set.spheres.radius[i]);
+		__m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+		__m128 culled = _mm_setzero_ps();
+		for(int p = 0; p < 6; ++p) {
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planes[p][0], cx), _mm_mul_ps(planes[p][1], cy)),
+				_mm_add_ps(_mm_mul_ps(planes[p][2], cz), planes[p][3]));
+			culled = _mm_or_ps(culled, _mm_cmplt_ps(d, negR));
+		}
+
+		__m128 vx = _mm_sub_ps(cx, camX), vy = _mm_sub_ps(cy, camY), vz = _mm_sub_ps(cz, camZ);
+		__m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&set.coneX[i])), _mm_mul_ps(vy, _mm_loadu_ps(&set.coneY[i]))),
+			_mm_mul_ps(vz, _mm_loadu_ps(&set.coneZ[i])));
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz)));
+		__m128 cutoff = _mm_loadu_ps(&set.coneCutoff[i]);
+		__m128 limit = _mm_add_ps(_mm_mul_ps(cutoff, distance), _mm_mul_ps(r, _mm_add_ps(one, cutoff)));
+		culled = _mm_or_ps(culled, _mm_cmpgt_ps(along, limit));
+
+		unsigned mask = ~(unsigned)_mm_movemask_ps(culled) & 0xF;
+		while(mask) {
+			visible.push_back((uint32_t)(i + __builtin_ctz(mask)));
+			mask &= mask-1;
+		}
+	}
+#endif
+	for(; i < end; ++i)
+		if(visibleMeshlet(set, frustum, camera, i))
+			visible.push_back((uint32_t)i);
+}
+
+cull::Stats meshlet::cull(const Set & set, const Frustum & frustum, const glm::vec3 & camera,
+													std::vector<uint32_t> & visible, unsigned numThreads) {
+	auto start = Clock::now();
+	size_t n = set.size();
+	visible.clear();
+
+	// A thread gets at least 1024 meshlets; ranges are 4 aligned and concatenated in order
+	numThreads = (unsigned)std::max<size_t>(1, std::min<size_t>(numThreads, n / 1024));
+	if(numThreads==1)
+		cull(set, frustum, camera, 0, n, visible);
+	else {
+		std::vector<std::vector<uint32_t>> partial(numThreads);
+		size_t perThread = ((n + numThreads-1) / numThreads + 3) & ~size_t(3);
+		job::parallelFor(0, numThreads, 1, [&](size_t first, size_t last) {
+			for(size_t t = first; t < last; ++t) {
+				size_t begin = std::min(n, t * perThread);
+				cull(set, frustum, camera, begin, std::min(n, begin + perThread), partial[t]);
+			}
+		});
+		for(const auto & p : partial)
+			visible.insert(visible.end(), p.begin(), p.end());
+	}
+
+	cull::Stats stats;
+	stats.tested = n;
+	stats.visible = visible.size();
+	stats.ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	return stats;
+}
+
+size_t meshlet::writeIndices(const Set & set, const std::vector<uint32_t> & visible, std::vector<uint32_t> & out) {
+	size_t first = out.size();
+	size_t count = 0;
+	for(uint32_t i : visible)
+		count += set.meshlets[i].triangleCount * 3;
+	out.resize(first + count);
+
+	uint32_t * dst = out.data() + first;
+	for(uint32_t i : visible) {
+		const Meshlet & m = set.meshlets[i];
+		const uint32_t * vertices = &set.vertices[m.vertexOffset];
+		const uint8_t * triangles = &set.triangles[m.triangleOffset * 3];
+		for(uint32_t k = 0; k < m.triangleCount * 3u; ++k)
+			*dst++ = vertices[triangles[k]];
+	}
+	return count;
+}
@@ -0,0 +1,79 @@
+/*
+ * Meshlets: a triangle mesh split into small clusters of at most 64 vertices
+ * and 124 triangles, each with a bounding sphere and a normal cone.
+ *
+ * Clusters are grown greedily over shared vertices, so they are compact and
+ * their triangles face similar directions. Each cluster lists the (global)
+ * vertices it uses and it's triangles as local 8 bit indices into that list.
+ *
+ * Per frame the clusters of an object are culled in object space: against
+ * the frustum with the sphere, and as a whole when the camera sees all of
+ * the cluster's triangles from behind (the cone test, only for meshes whose
+ * back faces GL culls as well, see build()). Bounds are kept as
+ * structures of arrays and tested 4 at a time with SSE, over worker threads
+ * for big meshes. Indices of the surviving triangles are then written out
+ * for a single draw call.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef MESHLETS_HPP
+#define MESHLETS_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.hpp"
+#include "Culling.hpp"
+
+namespace meshlet {
+	constexpr size_t MAX_VERTICES = 64;
+	constexpr size_t MAX_TRIANGLES = 124;
+
+	struct Meshlet {
+		// First entry in Set::vertices and Set::triangles (in triangles, not indices)
+		uint32_t vertexOffset;
+		uint32_t triangleOffset;
+		uint8_t vertexCount;
+		uint8_t triangleCount;
+	};
+
+	struct Set {
+		std::vector<Meshlet> meshlets;
+		// Global vertex indices used by the meshlets
+		std::vector<uint32_t> vertices;
+		// 3 local indices per triangle, into the meshlet's range of `vertices`
+		std::vector<uint8_t> triangles;
+
+		// Bounding spheres and normal cones, one per meshlet;
+		// coneCutoff is the sine of the cone's half angle, above 1 when the cone can't cull
+		cull::SphereArray spheres;
+		std::vector<float> coneX, coneY, coneZ, coneCutoff;
+
+		size_t size() const { return meshlets.size(); }
+		size_t numTriangles() const { return triangles.size() / 3; }
+	};
+
+	// Split an indexed triangle list into meshlets; the cones cull only when back faces are culled
+	// anyway (GL_CULL_FACE is on for it's material), otherwise just the spheres do
+	Set build(const glm::vec3 * positions, size_t numVertices, const std::vector<uint32_t> & indices,
+						bool backFacesCulled = true);
+
+	// Append indices (in [begin, end)) of meshlets in the frustum and not facing away from the camera;
+	// the frustum and camera position are in the mesh's object space
+	void cull(const Set & set, const Frustum & frustum, const glm::vec3 & camera, size_t begin, size_t end,
+						std::vector<uint32_t> & visible);
+
+	// Cull all meshlets, splitting the work over up to numThreads threads; `visible` is overwritten
+	cull::Stats cull(const Set & set, const Frustum & frustum, const glm::vec3 & camera,
+									 std::vector<uint32_t> & visible, unsigned numThreads = 1);
+
+	// Append the global vertex indices of the triangles of the listed meshlets; returns the number written
+	size_t writeIndices(const Set & set, const std::vector<uint32_t> & visible, std::vector<uint32_t> & out);
+}
+
+#endif /* MESHLETS_HPP */
@@ -0,0 +1,362 @@
+#include "Occlusion.hpp"
+
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define OCCLUSION_SSE
+#endif
+
+#include "Jobs.hpp"
+
+using namespace cull;
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsedMs(Clock::time_point since) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+	}
+
+	// Run f(t) for t in [0, numThreads) as jobs of the pool
+	template<typename F>
+	void runThreads(unsigned numThreads, F f) {
+		job::parallelFor(0, numThreads, 1, [&](size_t first, size_t last) {
+			for(size_t t = first; t < last; ++t)
+				f((unsigned)t);
+		});
+	}
+}
+
+OcclusionBuffer::OcclusionBuffer(int width, int height)
+	: width(width), height(height), viewProjection(1.f)
+{
+	if(width <= 0 || height <= 0 || width % BLOCK_WIDTH || height % BLOCK_HEIGHT)
+		throw std::runtime_error("OcclusionBuffer: size must be a positive multiple of 8x4\n");
+	binsX = (width + BIN_WIDTH-1) / BIN_WIDTH;
+	binsY = (height + BIN_HEIGHT-1) / BIN_HEIGHT;
+	blocksX = width / BLOCK_WIDTH;
+	blocksY = height / BLOCK_HEIGHT;
+	depth.assign((size_t)width*height, 1.f);
+	blockMaxDepth.assign((size_t)blocksX*blocksY, 1.f);
+}
+
+void OcclusionBuffer::begin(const glm::mat4 & viewProjection) {
+	this->viewProjection = viewProjection;
+	occluders.clear();
+}
+
+void OcclusionBuffer::addOccluder(const OccluderMesh & mesh, const glm::mat4 & model) {
+	occluders.push_back(Occluder{&mesh, viewProjection * model});
+}
+
+void OcclusionBuffer::rasterize(unsigned numThreads) {
+	auto start = Clock::now();
+	std::fill(depth.begin(), depth.end(), 1.f);
+	std::fill(blockMaxDepth.begin(), blockMaxDepth.end(), 1.f);
+
+	numThreads = (unsigned)std::max<size_t>(1, std::min<size_t>(numThreads, occluders.size()));
+	if(threadBins.size() < numThreads)
+		threadBins.resize(numThreads);
+	for(ThreadBins & tb : threadBins) {
+		tb.triangles.clear();
+		tb.bins.resize((size_t)binsX*binsY);
+		for(auto & bin : tb.bins)
+			bin.clear();
+	}
+
+	// Set up and bin contiguous ranges of occluders
+	size_t perThread = (occluders.size() + numThreads-1) / numThreads;
+	runThreads(numThreads, [&](unsigned t) {
+		size_t first = std::min(occluders.size(), t * perThread);
+		size_t end = std::min(occluders.size(), first + perThread);
+		setupTriangles(first, end, threadBins[t]);
+	});
+
+	// Every bin is rasterized by one job, so pixels are written without synchronization;
+	// bins differ a lot in cost, one bin per job lets idle threads steal the rest
+	int numBins = binsX*binsY;
+	if(numThreads==1)
+		for(int bin = 0; bin < numBins; ++bin)
+			rasterizeBin(bin);
+	else
+		job::parallelFor(0, (size_t)numBins, 1, [&](size_t first, size_t last) {
+			for(size_t bin = first; bin < last; ++bin)
+				rasterizeBin((int)bin);
+		});
+
+	stats = OcclusionStats();
+	stats.occluders = occluders.size();
+	for(const ThreadBins & tb : threadBins)
+		stats.triangles += tb.triangles.size();
+	stats.rasterMs = elapsedMs(start);
+}
+
+void OcclusionBuffer::setupTriangles(size_t firstOccluder, size_t endOccluder, ThreadBins & out) const {
+	for(size_t o = firstOccluder; o < endOccluder; ++o) {
+		const OccluderMesh & mesh = *occluders[o].mesh;
+		const glm::mat4 & mvp = occluders[o].modelViewProjection;
+
+		out.clip.resize(mesh.vertices.size());
+		for(size_t v = 0; v < mesh.vertices.size(); ++v)
+			out.clip[v] = mvp * glm::vec4(mesh.vertices[v], 1.f);
+
+		for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+			glm::vec3 screen[3];
+			bool nearClipped = false;
+			for(int k = 0; k < 3; ++k) {
+				const glm::vec4 & c = out.clip[mesh.indices[i+k]];
+				// Dropping an occluder triangle only makes the buffer less occluding, never wrong
+				if(c.w <= 0.f || c.z < -c.w) {
+					nearClipped = true;
+					break;
+				}
+				float invW = 1.f / c.w;
+				screen[k] = glm::vec3((c.x*invW*.5f + .5f) * width, (c.y*invW*.5f + .5f) * height, c.z*invW*.5f + .5f);
+			}
+			if(nearClipped)
+				continue;
+
+			// Occluders are two-sided: flip clockwise triangles instead of culling them
+			float area = (screen[1].x-screen[0].x)*(screen[2].y-screen[0].y) - (screen[2].x-screen[0].x)*(screen[1].y-screen[0].y);
+			if(std::fabs(area) < 1e-6f)
+				continue;
+			if(area < 0.f) {
+				std::swap(screen[1], screen[2]);
+				area = -area;
+			}
+
+			// Pixels whose centers can lie inside
+			float xMin = std::min({screen[0].x, screen[1].x, screen[2].x});
+			float xMax = std::max({screen[0].x, screen[1].x, screen[2].x});
+			float yMin = std::min({screen[0].y, screen[1].y, screen[2].y});
+			float yMax = std::max({screen[0].y, screen[1].y, screen[2].y});
+			Triangle tri;
+			tri.minX = std::max(0, (int)std::ceil(xMin - .5f));
+			tri.maxX = std::min(width-1, (int)std::floor(xMax - .5f));
+			tri.minY = std::max(0, (int)std::ceil(yMin - .5f));
+			tri.maxY = std::min(height-1, (int)std::floor(yMax - .5f));
+			if(tri.minX > tri.maxX || tri.minY > tri.maxY)
+				continue;
+
+			for(int e = 0; e < 3; ++e) {
+				const glm::vec3 & a = screen[e];
+				const glm::vec3 & b = screen[(e+1) % 3];
+				tri.edgeA[e] = a.y - b.y;
+				tri.edgeB[e] = b.x - a.x;
+				tri.edgeC[e] = -(tri.edgeA[e]*a.x + tri.edgeB[e]*a.y);
+			}
+
+			// Window depth is linear in screen space
+			float dz1 = screen[1].z - screen[0].z, dz2 = screen[2].z - screen[0].z;
+			tri.depthDx = (dz1*(screen[2].y-screen[0].y) - dz2*(screen[1].y-screen[0].y)) / area;
+			tri.depthDy = (dz2*(screen[1].x-screen[0].x) - dz1*(screen[2].x-screen[0].x)) / area;
+			tri.depth0 = screen[0].z - tri.depthDx*screen[0].x - tri.depthDy*screen[0].y;
+
+			uint32_t index = (uint32_t)out.triangles.size();
+			out.triangles.push_back(tri);
+			for(int by = tri.minY / BIN_HEIGHT; by <= tri.maxY / BIN_HEIGHT; ++by)
+				for(int bx = tri.minX / BIN_WIDTH; bx <= tri.maxX / BIN_WIDTH; ++bx)
+					out.bins[(size_t)by*binsX + bx].push_back(index);
+		}
+	}
+}
+
+void OcclusionBuffer::rasterizeBin(int bin) {
+	int x0 = (bin % binsX) * BIN_WIDTH, y0 = (bin / binsX) * BIN_HEIGHT;
+	int x1 = std::min(width, x0 + BIN_WIDTH) - 1, y1 = std::min(height, y0 + BIN_HEIGHT) - 1;
+
+	bool any = false;
+	for(const ThreadBins & tb : threadBins)
+		for(uint32_t index : tb.bins[bin]) {
+			const Triangle & tri = tb.triangles[index];
+			rasterizeTriangle(tri, std::max(x0, tri.minX), std::max(y0, tri.minY), std::min(x1, tri.maxX), std::min(y1, tri.maxY));
+			any = true;
+		}
+	if(any)
+		updateBlocks(x0, y0, x1, y1);
+}
+
+void OcclusionBuffer::rasterizeTriangle(const Triangle & tri, int x0, int y0, int x1, int y1) {
+	// Whole 4 pixel groups; bins are 8 aligned, so a group never leaves the bin
+	x0 &= ~3;
+#ifdef OCCLUSION_SSE
+	const __m128 laneOffset = _mm_set_ps(3.5f, 2.5f, 1.5f, .5f);
+	const __m128 far = _mm_set1_ps(1.f);
+	__m128 a[3], step[3];
+	for(int e = 0; e < 3; ++e) {
+		a[e] = _mm_set1_ps(tri.edgeA[e]);
+		step[e] = _mm_set1_ps(4.f * tri.edgeA[e]);
+	}
+	const __m128 depthStep = _mm_set1_ps(4.f * tri.depthDx);
+	const __m128 px0 = _mm_add_ps(_mm_set1_ps((float)x0), laneOffset);
+
+	for(int y = y0; y <= y1; ++y) {
+		float py = (float)y + .5f;
+		__m128 edge[3];
+		for(int e = 0; e < 3; ++e)
+			edge[e] = _mm_add_ps(_mm_mul_ps(a[e], px0), _mm_set1_ps(tri.edgeB[e]*py + tri.edgeC[e]));
+		__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri.depthDx), px0), _mm_set1_ps(tri.depthDy*py + tri.depth0));
+
+		float * row = &depth[(size_t)y*width];
+		for(int x = x0; x <= x1; x += 4) {
+			__m128 inside = _mm_and_ps(_mm_cmpge_ps(edge[0], _mm_setzero_ps()),
+				_mm_and_ps(_mm_cmpge_ps(edge[1], _mm_setzero_ps()), _mm_cmpge_ps(edge[2], _mm_setzero_ps())));
+			if(_mm_movemask_ps(inside)) {
+				__m128 covered = _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, far));
+				_mm_storeu_ps(row + x, _mm_min_ps(_mm_loadu_ps(row + x), covered));
+			}
+			for(int e = 0; e < 3; ++e)
+				edge[e] = _mm_add_ps(edge[e], step[e]);
+			z = _mm_add_ps(z, depthStep);
+		}
+	}
+#else
+	for(int y = y0; y <= y1; ++y) {
+		float py = (float)y + .5f;
+		float * row = &depth[(size_t)y*width];
+		for(int x = x0; x <= std::min(x1 | 3, width-1); ++x) {
+			float px = (float)x + .5f;
+			bool inside = true;
+			for(int e = 0; e < 3; ++e)
+				inside = inside && tri.edgeA[e]*px + tri.edgeB[e]*py + tri.edgeC[e] >= 0.f;
+			if(inside)
+				row[x] = std::min(row[x], tri.depthDx*px + tri.depthDy*py + tri.depth0);
+		}
+	}
+#endif
+}
+
+void OcclusionBuffer::updateBlocks(int x0, int y0, int x1, int y1) {
+	for(int by = y0 / BLOCK_HEIGHT; by <= y1 / BLOCK_HEIGHT; ++by)
+		for(int bx = x0 / BLOCK_WIDTH; bx <= x1 / BLOCK_WIDTH; ++bx) {
+			const float * p = &depth[(size_t)by*BLOCK_HEIGHT*width + bx*BLOCK_WIDTH];
+#ifdef OCCLUSION_SSE
+			__m128 m = _mm_max_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + 4));
+			for(int r = 1; r < BLOCK_HEIGHT; ++r)
+				m = _mm_max_ps(m, _mm_max_ps(_mm_loadu_ps(p + r*width), _mm_loadu_ps(p + r*width + 4)));
+			m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+			m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+			blockMaxDepth[(size_t)by*blocksX + bx] = _mm_cvtss_f32(m);
+#else
+			float m = 0.f;
+			for(int r = 0; r < BLOCK_HEIGHT; ++r)
+				for(int c = 0; c < BLOCK_WIDTH; ++c)
+					m = std::max(m, p[r*width + c]);
+			blockMaxDepth[(size_t)by*blocksX + bx] = m;
+#endif
+		}
+}
+
+bool OcclusionBuffer::isOccluded(const glm::vec3 & min, const glm::vec3 & max) const {
+	return occludedBox((min + max) * .5f, (max - min) * .5f);
+}
+
+bool OcclusionBuffer::occludedBox(const glm::vec3 & center, const glm::vec3 & extent) const {
+	// Corners in clip space as the projected center plus/minus the projected half axes
+	glm::vec4 c = viewProjection * glm::vec4(center, 1.f);
+	glm::vec4 ax = viewProjection[0] * extent.x;
+	glm::vec4 ay = viewProjection[1] * extent.y;
+	glm::vec4 az = viewProjection[2] * extent.z;
+
+	float xMin = INFINITY, xMax = -INFINITY, yMin = INFINITY, yMax = -INFINITY;
+	float nearest = INFINITY;
+	for(int i = 0; i < 8; ++i) {
+		glm::vec4 p = c + ax * ((i & 1) ? 1.f : -1.f) + ay * ((i & 2) ? 1.f : -1.f) + az * ((i & 4) ? 1.f : -1.f);
+		if(p.w <= 0.f || p.z < -p.w)
+			return false;
+		float invW = 1.f / p.w;
+		float x = (p.x*invW*.5f + .5f) * width;
+		float y = (p.y*invW*.5f + .5f) * height;
+		xMin = std::min(xMin, x); xMax = std::max(xMax, x);
+		yMin = std::min(yMin, y); yMax = std::max(yMax, y);
+		nearest = std::min(nearest, p.z*invW*.5f + .5f);
+	}
+
+	// Every pixel the box touches; off screen boxes are left to frustum culling
+	int x0 = std::max(0, (int)std::floor(xMin)), x1 = std::min(width-1, (int)std::floor(xMax));
+	int y0 = std::max(0, (int)std::floor(yMin)), y1 = std::min(height-1, (int)std::floor(yMax));
+	if(x0 > x1 || y0 > y1)
+		return false;
+
+	for(int by = y0 / BLOCK_HEIGHT; by <= y1 / BLOCK_HEIGHT; ++by)
+		for(int bx = x0 / BLOCK_WIDTH; bx <= x1 / BLOCK_WIDTH; ++bx) {
+			if(blockMaxDepth[(size_t)by*blocksX + bx] < nearest)
+				continue;
+
+			int bx0 = bx*BLOCK_WIDTH, by0 = by*BLOCK_HEIGHT;
+			int cx0 = std::max(x0, bx0), cx1 = std::min(x1, bx0 + BLOCK_WIDTH-1);
+			int cy0 = std::max(y0, by0), cy1 = std::min(y1, by0 + BLOCK_HEIGHT-1);
+			// Fully covered block with a pixel at or behind the box
+			if(cx0==bx0 && cx1==bx0 + BLOCK_WIDTH-1 && cy0==by0 && cy1==by0 + BLOCK_HEIGHT-1)
+				return false;
+
+			// Partially covered block: look at the covered pixels
+#ifdef OCCLUSION_SSE
+			const __m128 lane = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+			const __m128 lo = _mm_set1_ps((float)cx0), hi = _mm_set1_ps((float)cx1);
+			const __m128 z = _mm_set1_ps(nearest);
+			for(int y = cy0; y <= cy1; ++y)
+				for(int x = bx0; x < bx0 + BLOCK_WIDTH; x += 4) {
+					__m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+					__m128 inRect = _mm_and_ps(_mm_cmpge_ps(px, lo), _mm_cmple_ps(px, hi));
+					__m128 behind = _mm_cmpge_ps(_mm_loadu_ps(&depth[(size_t)y*width + x]), z);
+					if(_mm_movemask_ps(_mm_and_ps(inRect, behind)))
+						return false;
+				}
+#else
+			for(int y = cy0; y <= cy1; ++y)
+				for(int x = cx0; x <= cx1; ++x)
+					if(depth[(size_t)y*width + x] >= nearest)
+						return false;
+#endif
+		}
+	return true;
+}
+
+void OcclusionBuffer::test(const AABBArray & boxes, std::vector<uint32_t> & visible, unsigned numThreads) {
+	auto start = Clock::now();
+	size_t n = visible.size();
+	stats.tested = n;
+	stats.occluded = 0;
+	if(stats.triangles==0 || n==0) {
+		stats.testMs = elapsedMs(start);
+		return;
+	}
+
+	auto occluded = [&](uint32_t i) {
+		return occludedBox(glm::vec3(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]),
+											 glm::vec3(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]));
+	};
+
+	numThreads = (unsigned)std::max<size_t>(1, std::min<size_t>(numThreads, n / 256));
+	if(numThreads==1)
+		visible.erase(std::remove_if(visible.begin(), visible.end(), occluded), visible.end());
+	else {
+		// Compact contiguous ranges in parallel, then concatenate them in order
+		std::vector<size_t> kept(numThreads);
+		size_t perThread = (n + numThreads-1) / numThreads;
+		runThreads(numThreads, [&](unsigned t) {
+			size_t first = std::min(n, t * perThread);
+			size_t end = std::min(n, first + perThread);
+			size_t out = first;
+			for(size_t i = first; i < end; ++i)
+				if(!occluded(visible[i]))
+					visible[out++] = visible[i];
+			kept[t] = out - first;
+		});
+		size_t out = kept[0];
+		for(unsigned t = 1; t < numThreads; ++t) {
+			size_t first = std::min(n, t * perThread);
+			std::copy(visible.begin() + first, visible.begin() + first + kept[t], visible.begin() + out);
+			out += kept[t];
+		}
+		visible.resize(out);
+	}
+
+	stats.occluded = n - visible.size();
+	stats.testMs = elapsedMs(start);
+}
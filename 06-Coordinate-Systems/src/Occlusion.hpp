@@ -0,0 +1,140 @@
+/*
+ * Software occlusion culling on the CPU.
+ *
+ * Selected occluders (simple, closed stand-ins of big objects like buildings
+ * and walls) are rasterized into a small depth buffer, e.g. 256x128. The
+ * screen is split into bins. Triangles are set up and binned per thread, then
+ * every bin is rasterized by exactly one thread, 4 pixels at a time with SSE.
+ * Each bin reduces it's pixels into a coarse level holding the farthest depth
+ * of every 8x4 pixel block.
+ *
+ * A box is occluded when it's nearest depth is behind the depth of every
+ * pixel it covers. Most boxes are decided by the coarse level alone; only
+ * blocks on the edge of the box fall back to the pixels. Anything crossing
+ * the near plane is treated as visible, so the test is conservative.
+ *
+ * Depth is window depth in [0, 1], 0 at the near plane; the buffer is
+ * cleared to 1.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef OCCLUSION_HPP
+#define OCCLUSION_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+#include "Culling.hpp"
+
+namespace cull {
+	// Triangle list used only for occlusion
+	struct OccluderMesh {
+		std::vector<glm::vec3> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	struct OcclusionStats {
+		size_t occluders = 0;
+		size_t triangles = 0;
+		size_t tested = 0;
+		size_t occluded = 0;
+		double rasterMs = 0.;
+		double testMs = 0.;
+
+		double ms() const { return rasterMs + testMs; }
+
+		friend std::ostream & operator<<(std::ostream & os, const OcclusionStats & s) {
+			os << "[occlusion|occluders:" << s.occluders
+				 << "|triangles:" << s.triangles
+				 << "|tested:" << s.tested
+				 << "|occluded:" << s.occluded
+				 << "|rasterMs:" << s.rasterMs
+				 << "|testMs:" << s.testMs
+				 << "]";
+			return os;
+		}
+	};
+
+	class OcclusionBuffer {
+	public:
+		static constexpr int BLOCK_WIDTH = 8;
+		static constexpr int BLOCK_HEIGHT = 4;
+
+		// Width must be a multiple of 8 and height of 4
+		OcclusionBuffer(int width = 256, int height = 128);
+
+		// Delete copy and assignment constructors
+		OcclusionBuffer(const OcclusionBuffer &) = delete;
+		OcclusionBuffer & operator=(const OcclusionBuffer &) = delete;
+
+		// Start a frame: forget the occluders and set the camera used by everything that follows
+		void begin(const glm::mat4 & viewProjection);
+
+		// Queue an occluder for rasterize(); the mesh must stay alive until then
+		void addOccluder(const OccluderMesh & mesh, const glm::mat4 & model);
+
+		// Clear the depth buffer and rasterize the queued occluders using up to numThreads threads
+		void rasterize(unsigned numThreads = 1);
+
+		// True when the world space box is hidden behind the rasterized occluders
+		bool isOccluded(const glm::vec3 & min, const glm::vec3 & max) const;
+
+		// Remove occluded boxes from `visible` (indices into `boxes`), keeping the order
+		void test(const AABBArray & boxes, std::vector<uint32_t> & visible, unsigned numThreads = 1);
+
+		// Occluders, triangles and timings of the last rasterize() and test()
+		const OcclusionStats & getStats() const { return stats; }
+
+		int getWidth() const { return width; }
+		int getHeight() const { return height; }
+		float getDepth(int x, int y) const { return depth[(size_t)y*width + x]; }
+
+	private:
+		// Screen space triangle: edge functions (>= 0 inside) and depth plane at pixel coordinates
+		struct Triangle {
+			float edgeA[3], edgeB[3], edgeC[3];
+			float depthDx, depthDy, depth0;
+			int minX, minY, maxX, maxY;
+		};
+
+		struct Occluder {
+			const OccluderMesh * mesh;
+			glm::mat4 modelViewProjection;
+		};
+
+		// Scratch space of one setup thread: it's triangles and their indices per bin
+		struct ThreadBins {
+			std::vector<Triangle> triangles;
+			std::vector<std::vector<uint32_t>> bins;
+			std::vector<glm::vec4> clip;
+		};
+
+		static constexpr int BIN_WIDTH = 64;
+		static constexpr int BIN_HEIGHT = 32;
+
+		int width, height;
+		int binsX, binsY;
+		int blocksX, blocksY;
+		glm::mat4 viewProjection;
+
+		std::vector<float> depth;
+		std::vector<float> blockMaxDepth;
+		std::vector<Occluder> occluders;
+		std::vector<ThreadBins> threadBins;
+		OcclusionStats stats;
+
+		bool occludedBox(const glm::vec3 & center, const glm::vec3 & extent) const;
+		void setupTriangles(size_t firstOccluder, size_t endOccluder, ThreadBins & out) const;
+		void rasterizeBin(int bin);
+		void rasterizeTriangle(const Triangle & tri, int x0, int y0, int x1, int y1);
+		void updateBlocks(int x0, int y0, int x1, int y1);
+	};
+}
+
+#endif /* OCCLUSION_HPP */
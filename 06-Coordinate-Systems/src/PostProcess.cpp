@@ -0,0 +1,188 @@
+#include "PostProcess.hpp"
+
+#include <vector>
+#include <algorithm>
+
+#include "Material.hpp"
+
+namespace {
+	enum CompositeFeature : uint32_t {
+		CompositeSharpen = 1 << 0,
+		CompositeBloom = 1 << 1,
+		CompositeTonemap = 1 << 2,
+		CompositeVignette = 1 << 3,
+		CompositeColorGrade = 1 << 4
+	};
+
+	enum BloomFeature : uint32_t {
+		BloomPrefilter = 1 << 0,
+		BloomUpsample = 1 << 1
+	};
+}
+
+PostProcess::PostProcess(ResourceManager & resMan, const Settings & settings) :
+	settings(settings),
+	compositeShaders(resMan, "../shader/fullscreen.vert", "../shader/post.frag",
+									 {"SHARPEN", "BLOOM", "TONEMAP", "VIGNETTE", "COLOR_GRADE"}),
+	bloomShaders(resMan, "../shader/fullscreen.vert", "../shader/bloom.frag", {"PREFILTER", "UPSAMPLE"}),
+	sourceUnit(Material::samplerUnit("source")),
+	bloomUnit(Material::samplerUnit("bloom")),
+	baseUnit(Material::samplerUnit("base")) {
+	auto program = [&resMan](u64 shader) { return std::static_pointer_cast<Shader>(resMan.find(shader)).get(); };
+	// One program for all the enabled per pixel effects
+	uint32_t features = (settings.sharpness > 0.f ? CompositeSharpen : 0u) | (settings.bloom ? CompositeBloom : 0u)
+		| (settings.tonemap ? CompositeTonemap : 0u) | (settings.vignette ? CompositeVignette : 0u)
+		| (settings.colorGrade ? CompositeColorGrade : 0u);
+	composite = program(compositeShaders.get(features));
+	if(settings.bloom) {
+		prefilter = program(bloomShaders.get(BloomPrefilter));
+		downsample = program(bloomShaders.get(0));
+		upsample = program(bloomShaders.get(BloomUpsample));
+	}
+}
+
+bool PostProcess::hasEffects() const {
+	return settings.bloom || settings.tonemap || settings.vignette || settings.colorGrade || settings.sharpness > 0.f;
+}
+
+void PostProcess::addPasses(FrameGraph & graph, RenderTargetPool * targets, FrameGraph::TextureID sceneColor,
+														const DynamicResolution * dynres) {
+	PostProcess * post = this;
+	// Part of the scene's target drawn into
+	auto sceneUsed = [](const RenderTargetPool * targets, const DynamicResolution * dynres, uint32_t slot) {
+		return dynres ? glm::ivec2(dynres->getStats().width, dynres->getStats().height)
+									: glm::ivec2(targets->getWidth(slot), targets->getHeight(slot));
+	};
+
+	// Bloom: the bright parts downsampled level by level, then added back up; the last pass stops the timer
+	FrameGraph::TextureID bloom = FrameGraph::Backbuffer;
+	if(settings.bloom) {
+		unsigned levels = std::max(1u, settings.bloomLevels);
+		std::vector<FrameGraph::TextureID> down(levels);
+		for(unsigned i = 0; i < levels; ++i)
+			down[i] = graph.create("bloom down", RenderTargetDesc{settings.bloomScale / (float)(1u << i), 0, 0,
+																														GL_R11F_G11F_B10F});
+
+		graph.addPass("bloom prefilter", {sceneColor}, {down[0]}, [=, &graph](CommandBuffer & commands) {
+			uint32_t source = graph.getSlot(sceneColor);
+			bool last = levels==1;
+			commands.record([=]() {
+				post->bloomTimer.begin();
+				post->drawBloom(*post->prefilter, targets->getTexture(source), targets->getWidth(source),
+												targets->getHeight(source), sceneUsed(targets, dynres, source), 0);
+				if(last)
+					post->bloomTimer.end();
+			});
+		});
+		for(unsigned i = 1; i < levels; ++i)
+			graph.addPass("bloom down", {down[i-1]}, {down[i]}, [=, &graph](CommandBuffer & commands) {
+				uint32_t source = graph.getSlot(down[i-1]);
+				commands.record([=]() {
+					glm::ivec2 size(targets->getWidth(source), targets->getHeight(source));
+					post->drawBloom(*post->downsample, targets->getTexture(source), size.x, size.y, size, 0);
+				});
+			});
+		FrameGraph::TextureID smaller = down[levels-1];
+		for(int i = (int)levels - 2; i >= 0; --i) {
+			FrameGraph::TextureID up = graph.create("bloom up", RenderTargetDesc{settings.bloomScale / (float)(1u << i), 0, 0,
+																																	 GL_R11F_G11F_B10F});
+			graph.addPass("bloom up", {smaller, down[i]}, {up}, [=, &graph](CommandBuffer & commands) {
+				uint32_t source = graph.getSlot(smaller), base = graph.getSlot(down[i]);
+				bool last = i==0;
+				commands.record([=]() {
+					glm::ivec2 size(targets->getWidth(source), targets->getHeight(source));
+					post->drawBloom(*post->upsample, targets->getTexture(source), size.x, size.y, size, targets->getTexture(base));
+					if(last)
+						post->bloomTimer.end();
+				});
+			});
+			smaller = up;
+		}
+		bloom = smaller;
+	}
+
+	// Everything else in one pass to the window
+	std::vector<FrameGraph::TextureID> reads{sceneColor};
+	if(bloom!=FrameGraph::Backbuffer)
+		reads.push_back(bloom);
+	graph.addPass("post", reads, {FrameGraph::Backbuffer}, [=, &graph](CommandBuffer & commands) {
+		uint32_t source = graph.getSlot(sceneColor);
+		uint32_t bloomSlot = bloom!=FrameGraph::Backbuffer ? graph.getSlot(bloom) : FrameGraph::NoSlot;
+		commands.record([=]() {
+			post->compositeTimer.begin();
+			post->drawComposite(targets->getTexture(source), targets->getWidth(source), targets->getHeight(source),
+													sceneUsed(targets, dynres, source),
+													bloomSlot!=FrameGraph::NoSlot ? targets->getTexture(bloomSlot) : 0);
+			post->compositeTimer.end();
+		});
+	});
+}
+
+void PostProcess::drawBloom(const Shader & program, GLuint source, int width, int height, glm::ivec2 used, GLuint base) {
+	glActiveTexture(GL_TEXTURE0 + sourceUnit);
+	glBindTexture(GL_TEXTURE_2D, source);
+	program.setInt("source", (int)sourceUnit);
+	program.setVec2("uvScale", glm::vec2((float)used.x / width, (float)used.y / height));
+	program.setVec2("texelSize", glm::vec2(1.f / width, 1.f / height));
+	if(&program==prefilter) {
+		program.setFloat("threshold", settings.bloomThreshold);
+		program.setFloat("knee", settings.bloomKnee);
+	}
+	if(base) {
+		glActiveTexture(GL_TEXTURE0 + baseUnit);
+		glBindTexture(GL_TEXTURE_2D, base);
+		program.setInt("base", (int)baseUnit);
+	}
+	program.activate();
+	program.flush();
+	drawFullscreen();
+}
+
+void PostProcess::drawComposite(GLuint source, int width, int height, glm::ivec2 used, GLuint bloom) {
+	glActiveTexture(GL_TEXTURE0 + sourceUnit);
+	glBindTexture(GL_TEXTURE_2D, source);
+	composite->setInt("source", (int)sourceUnit);
+	composite->setVec2("uvScale", glm::vec2((float)used.x / width, (float)used.y / height));
+	composite->setVec2("texelSize", glm::vec2(1.f / width, 1.f / height));
+	if(settings.sharpness > 0.f)
+		composite->setFloat("sharpness", settings.sharpness);
+	if(settings.bloom) {
+		glActiveTexture(GL_TEXTURE0 + bloomUnit);
+		glBindTexture(GL_TEXTURE_2D, bloom);
+		composite->setInt("bloom", (int)bloomUnit);
+		composite->setFloat("bloomIntensity", settings.bloomIntensity);
+	}
+	if(settings.tonemap)
+		composite->setFloat("exposure", settings.exposure);
+	if(settings.vignette)
+		composite->setFloat("vignetteStrength", settings.vignetteStrength);
+	if(settings.colorGrade) {
+		composite->setFloat("saturation", settings.saturation);
+		composite->setFloat("contrast", settings.contrast);
+		composite->setVec3("tint", settings.tint);
+	}
+	composite->activate();
+	composite->flush();
+	drawFullscreen();
+}
+
+void PostProcess::drawFullscreen() {
+	// One triangle covering the screen, made by the vertex shader from gl_VertexID; no depth
+	if(!emptyVAO)
+		glGenVertexArrays(1, &emptyVAO);
+	glDisable(GL_DEPTH_TEST);
+	glBindVertexArray(emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	glEnable(GL_DEPTH_TEST);
+	glActiveTexture(GL_TEXTURE0);
+}
+
+PostProcess::Stats PostProcess::getStats() const {
+	return Stats{bloomTimer.getMs(), compositeTimer.getMs()};
+}
+
+void PostProcess::resetStats() {
+	bloomTimer.resetStats();
+	compositeTimer.resetStats();
+}
@@ -0,0 +1,124 @@
+/*
+ * Post-processing: bloom, tone mapping, vignette and color grading of the
+ * scene on it's way to the window.
+ *
+ * An effect per pass would read and write the whole screen once for every
+ * effect. Here the per pixel effects are fused into one fragment shader -
+ * the ShaderVariants program with a feature for each enabled effect - that
+ * reads the scene once (upscaling it with dynamic resolution, see
+ * DynamicResolution.hpp) and writes the window once. Only bloom, which has
+ * to blur over a wide area, gets passes of it's own, and at low resolution:
+ * the bright parts are downsampled to half (or quarter) of the window,
+ * then halved again a few times, and the levels are added back up with a
+ * tent filter - a wide blur from a few cheap taps per level. Fullscreen
+ * passes draw a single triangle covering the screen, without buffers.
+ *
+ * The passes go into the frame graph (see FrameGraph.hpp); the bloom levels
+ * are it's transients. The GPU time of the bloom passes and of the fused
+ * pass are measured separately.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef POST_PROCESS_HPP
+#define POST_PROCESS_HPP
+
+#include <cstddef>
+#include <iostream>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "Shader.hpp"
+#include "ResourceManager.hpp"
+#include "ShaderVariants.hpp"
+#include "FrameGraph.hpp"
+#include "RenderTargetPool.hpp"
+#include "GPUTimer.hpp"
+#include "DynamicResolution.hpp"
+
+class PostProcess {
+public:
+	struct Settings {
+		bool bloom = false;
+		// Part of the window's resolution the first bloom level has (.5 half, .25 quarter)
+		float bloomScale = .5f;
+		unsigned bloomLevels = 5;
+		// Brightness where bloom starts, softened over `bloomKnee` below it
+		float bloomThreshold = .8f;
+		float bloomKnee = .2f;
+		float bloomIntensity = .6f;
+
+		bool tonemap = false;
+		float exposure = 1.f;
+
+		bool vignette = false;
+		float vignetteStrength = .35f;
+
+		bool colorGrade = false;
+		float saturation = 1.15f;
+		float contrast = 1.05f;
+		glm::vec3 tint = glm::vec3(1.f, .98f, .94f);
+
+		// Unsharp mask strength of the scene's upscale, 0 for plain bilinear
+		float sharpness = 0.f;
+	};
+
+	// GPU milliseconds per frame, averaged since the last reset
+	struct Stats {
+		double bloomMs = 0.;
+		double compositeMs = 0.;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[post|bloomMs:" << s.bloomMs
+				 << "|compositeMs:" << s.compositeMs
+				 << "]";
+			return os;
+		}
+	};
+
+	// Compiles the programs of the enabled effects (needs a current context)
+	PostProcess(ResourceManager & resMan, const Settings & settings);
+
+	// Delete copy and assignment constructors
+	PostProcess(const PostProcess &) = delete;
+	PostProcess & operator=(const PostProcess &) = delete;
+
+	// An effect besides the upscale is enabled
+	bool hasEffects() const;
+
+	// Declare the bloom passes and the fused pass from `sceneColor` to the Backbuffer. With dynamic
+	// resolution only it's rendered part of the scene's target is read
+	void addPasses(FrameGraph & graph, RenderTargetPool * targets, FrameGraph::TextureID sceneColor,
+								 const DynamicResolution * dynres);
+
+	// GL thread
+	Stats getStats() const;
+	void resetStats();
+
+private:
+	Settings settings;
+	ShaderVariants compositeShaders;
+	ShaderVariants bloomShaders;
+	const Shader * composite = nullptr;
+	const Shader * prefilter = nullptr;
+	const Shader * downsample = nullptr;
+	const Shader * upsample = nullptr;
+	// Texture units of the samplers
+	GLuint sourceUnit;
+	GLuint bloomUnit;
+	GLuint baseUnit;
+
+	GLuint emptyVAO = 0;
+	GPUTimer bloomTimer;
+	GPUTimer compositeTimer;
+
+	// GL thread: one bloom level from `source` (of the given size, read in it's lower left `used`
+	// part) into the bound target
+	void drawBloom(const Shader & program, GLuint source, int width, int height, glm::ivec2 used, GLuint base);
+	void drawComposite(GLuint source, int width, int height, glm::ivec2 used, GLuint bloom);
+	void drawFullscreen();
+};
+
+#endif /* POST_PROCESS_HPP */
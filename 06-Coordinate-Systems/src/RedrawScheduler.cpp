@@ -0,0 +1,37 @@
+#include "RedrawScheduler.hpp"
+
+RedrawScheduler::RedrawScheduler(const Settings & settings) : settings(settings) {
+}
+
+bool RedrawScheduler::shouldDraw(double now, bool pendingEvents, bool animating, bool iconified, bool focused,
+																 double & wait) {
+	wait = settings.maxWait;
+	if(pendingEvents)
+		dirty = true;
+	// Nothing is visible: stay dirty for when it's restored. The window state comes from drained events,
+	// so queued ones (maybe the restore) are drawn, which drains them
+	else if(iconified)
+		return false;
+	if(!dirty && !animating)
+		return false;
+
+	if(!focused && settings.backgroundFps > 0.) {
+		double next = lastFrame + 1. / settings.backgroundFps;
+		if(now < next) {
+			wait = next - now;
+			return false;
+		}
+	}
+	return true;
+}
+
+void RedrawScheduler::frameDrawn(double now) {
+	dirty = false;
+	lastFrame = now;
+	stats.frames++;
+}
+
+void RedrawScheduler::waited(double ms) {
+	stats.waits++;
+	stats.idleMs += ms;
+}
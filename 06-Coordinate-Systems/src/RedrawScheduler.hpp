@@ -0,0 +1,80 @@
+/*
+ * Render on demand: frames are drawn only when something changed.
+ *
+ * Every loop iteration draws a frame even when it looks just like the last
+ * one, which keeps a core (and the GPU) busy for nothing while the scene
+ * stands still, or even while the window is iconified. The scheduler
+ * decides before each iteration whether a frame is due:
+ * - queued events (input, resizes, damage, requestRedraw() of a loader)
+ *   and invalidate() make the next frame dirty;
+ * - while anything animates (an animation runs, a key is held) every
+ *   iteration draws;
+ * - an iconified window draws nothing, and an unfocused one at most
+ *   backgroundFps frames per second.
+ * Otherwise the main thread sleeps in the event wait, which any event ends
+ * right away (see Context::waitEvents() and Context::requestRedraw()).
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef REDRAW_SCHEDULER_HPP
+#define REDRAW_SCHEDULER_HPP
+
+#include <cstddef>
+#include <iostream>
+
+class RedrawScheduler {
+public:
+	struct Settings {
+		// Frame rate of an unfocused window, 0 for no limit
+		double backgroundFps = 10.;
+		// Longest sleep in the event wait, so a frame is never more than this late
+		double maxWait = 1.;
+	};
+
+	// Totals since the last reset
+	struct Stats {
+		size_t frames = 0;
+		size_t waits = 0;
+		// Time slept in the event wait
+		double idleMs = 0.;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[idle|frames:" << s.frames
+				 << "|waits:" << s.waits
+				 << "|idleMs:" << s.idleMs
+				 << "]";
+			return os;
+		}
+	};
+
+	explicit RedrawScheduler(const Settings & settings);
+
+	// Delete copy and assignment constructors
+	RedrawScheduler(const RedrawScheduler &) = delete;
+	RedrawScheduler & operator=(const RedrawScheduler &) = delete;
+
+	// Something changed that the next frame has to show
+	void invalidate() { dirty = true; }
+
+	// Whether to draw a frame at `now` (seconds); if not, `wait` is how long to sleep in the event wait.
+	// `pendingEvents`: events are queued, `animating`: the frame changes even without them
+	bool shouldDraw(double now, bool pendingEvents, bool animating, bool iconified, bool focused, double & wait);
+	// A frame was drawn at `now`
+	void frameDrawn(double now);
+	// The event wait took `ms`
+	void waited(double ms);
+
+	const Stats & getStats() const { return stats; }
+	void resetStats() { stats = Stats(); }
+
+private:
+	Settings settings;
+	// The first frame is always drawn
+	bool dirty = true;
+	double lastFrame = 0.;
+	Stats stats;
+};
+
+#endif /* REDRAW_SCHEDULER_HPP */
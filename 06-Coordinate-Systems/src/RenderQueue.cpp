@@ -0,0 +1,342 @@
+#include "RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <chrono>
+#include <array>
+#include <iostream>
+
+#include "Components.hpp"
+#include "Mesh.hpp"
+#include "Material.hpp"
+#include "UniformBlocks.hpp"
+#include "Jobs.hpp"
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsedMs(Clock::time_point since) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+	}
+
+	// Run f(first, last) over [0, n) on the pool in pieces of grain, or inline for one thread
+	template<typename F>
+	void forRange(size_t n, size_t grain, unsigned numThreads, const F & f) {
+		if(numThreads <= 1)
+			f(0, n);
+		else
+			job::parallelFor(0, n, grain, f);
+	}
+}
+
+void RenderQueue::build(ecs::World & world, const Frustum & frustum, unsigned numThreads,
+												cull::OcclusionBuffer * occlusion) {
+	auto start = Clock::now();
+	this->numThreads = numThreads;
+	buildStats = BuildStats();
+
+	// Candidates and their bounds are written in place, at positions given by chunk order
+	size_t n = world.countOf<ecs::Transform, ecs::MeshRef, ecs::MaterialRef, ecs::Bounds>();
+	candidates.resize(n);
+	bounds.resize(n);
+	world.parallelEachChunkIndexed<ecs::Transform, ecs::MeshRef, ecs::MaterialRef, ecs::Bounds>(
+		[this](size_t first, size_t count, ecs::Entity *, ecs::Transform * transforms, ecs::MeshRef * meshes,
+					 ecs::MaterialRef * materials, ecs::Bounds * aabbs) {
+			for(size_t i = 0; i < count; ++i) {
+				candidates[first + i] = Item{materials[i].sortKey, materials[i].material, meshes[i].mesh, meshes[i].primitive,
+																		 meshes[i].lod, transforms[i].node};
+				bounds.set(first + i, aabbs[i].worldMin, aabbs[i].worldMax);
+			}
+		}, numThreads);
+	buildStats.candidates = n;
+	buildStats.gatherMs = elapsedMs(start);
+
+	auto step = Clock::now();
+	cullStats = cull::frustumAABBs(frustum, bounds, visible, numThreads);
+	occlusionStats = cull::OcclusionStats();
+	if(occlusion) {
+		occlusion->test(bounds, visible, numThreads);
+		occlusionStats = occlusion->getStats();
+	}
+	buildStats.cullMs = elapsedMs(step);
+
+	// Every job appends packets to the buffer of the thread it runs on
+	step = Clock::now();
+	job::Scheduler & pool = job::global();
+	threadPackets.resize(std::max<size_t>(threadPackets.size(), pool.size()));
+	for(auto & buffer : threadPackets) {
+		buffer.packets.clear();
+		buffer.runs.clear();
+	}
+	forRange(visible.size(), job::grainFor(visible.size(), numThreads), numThreads, [&](size_t first, size_t last) {
+		int thread = pool.threadIndex();
+		ThreadPackets & out = threadPackets[thread < 0 ? 0 : thread];
+		out.runs.push_back(Run{first, last - first, out.packets.size()});
+		for(size_t k = first; k < last; ++k)
+			out.packets.push_back(Packet{packetKey(candidates[visible[k]]), visible[k]});
+	});
+
+	// Runs go back to their place in item order, so which thread recorded what doesn't matter
+	packets.resize(visible.size());
+	forRange(threadPackets.size(), 1, numThreads, [&](size_t first, size_t last) {
+		for(size_t t = first; t < last; ++t)
+			for(const Run & run : threadPackets[t].runs)
+				std::copy_n(threadPackets[t].packets.begin() + run.offset, run.count, packets.begin() + run.first);
+	});
+	buildStats.packets = packets.size();
+	buildStats.recordMs = elapsedMs(step);
+
+	step = Clock::now();
+	sortPackets(packets, packetScratch, numThreads);
+	items.resize(packets.size());
+	forRange(packets.size(), job::grainFor(packets.size(), numThreads), numThreads, [&](size_t first, size_t last) {
+		for(size_t k = first; k < last; ++k)
+			items[k] = candidates[packets[k].index];
+	});
+	buildStats.sortMs = elapsedMs(step);
+	buildStats.ms = elapsedMs(start);
+}
+
+uint64_t RenderQueue::packetKey(const Item & item) {
+	// Bits don't need to be unique: equal keys only cost state changes, never correctness
+	return (item.materialKey & 0xFFFFFFFF00000000ull)
+		| ((uint64_t)(item.material & 0xFFF) << 20)
+		| ((uint64_t)(item.mesh & 0xFFF) << 8)
+		| ((uint64_t)(item.primitive & 0xF) << 4)
+		| (uint64_t)(item.lod & 0xF);
+}
+
+void RenderQueue::sortPackets(std::vector<Packet> & packets, std::vector<Packet> & scratch, unsigned numThreads) {
+	const size_t n = packets.size();
+	scratch.resize(n);
+	// Blocks are fixed, not per thread, so the same packets land in the same places for any thread count
+	const size_t blockSize = 8192;
+	size_t numBlocks = (n + blockSize-1) / blockSize;
+	std::vector<std::array<uint32_t, 256>> counts(numBlocks);
+
+	// Bytes all keys share don't reorder anything: find them with one read of the keys
+	std::vector<std::array<std::array<uint32_t, 256>, 8>> histograms(numBlocks);
+	forRange(numBlocks, 1, numThreads, [&](size_t first, size_t last) {
+		for(size_t b = first; b < last; ++b) {
+			for(auto & h : histograms[b])
+				h.fill(0);
+			for(size_t i = b*blockSize, end = std::min(n, i + blockSize); i < end; ++i)
+				for(int d = 0; d < 8; ++d)
+					histograms[b][d][(packets[i].key >> (8*d)) & 0xFF]++;
+		}
+	});
+	std::vector<int> digits;
+	for(int d = 0; d < 8; ++d) {
+		bool trivial = false;
+		for(uint32_t v = 0; v < 256 && !trivial; ++v) {
+			size_t total = 0;
+			for(size_t b = 0; b < numBlocks; ++b)
+				total += histograms[b][d][v];
+			trivial = total==n;
+		}
+		if(!trivial)
+			digits.push_back(d);
+	}
+
+	// Least significant byte first
+	Packet * src = packets.data();
+	Packet * dst = scratch.data();
+	for(size_t pass = 0; pass < digits.size(); ++pass) {
+		int shift = 8 * digits[pass];
+		// Block counts of the first pass are known already, later passes see the blocks reordered
+		forRange(numBlocks, 1, numThreads, [&](size_t first, size_t last) {
+			for(size_t b = first; b < last; ++b) {
+				if(pass==0) {
+					counts[b] = histograms[b][digits[pass]];
+					continue;
+				}
+				counts[b].fill(0);
+				for(size_t i = b*blockSize, end = std::min(n, i + blockSize); i < end; ++i)
+					counts[b][(src[i].key >> shift) & 0xFF]++;
+			}
+		});
+
+		// Exclusive offsets, digit major and block minor, so equal digits keep their input order
+		uint32_t offset = 0;
+		for(uint32_t v = 0; v < 256; ++v)
+			for(size_t b = 0; b < numBlocks; ++b) {
+				uint32_t count = counts[b][v];
+				counts[b][v] = offset;
+				offset += count;
+			}
+
+		forRange(numBlocks, 1, numThreads, [&](size_t first, size_t last) {
+			for(size_t b = first; b < last; ++b)
+				for(size_t i = b*blockSize, end = std::min(n, i + blockSize); i < end; ++i)
+					dst[counts[b][(src[i].key >> shift) & 0xFF]++] = src[i];
+		});
+		std::swap(src, dst);
+	}
+	if(src!=packets.data())
+		packets.swap(scratch);
+}
+
+void RenderQueue::submit(ResourceManager & resMan, const SceneGraph & scene, const Shader & shader,
+												 StreamBuffer & uniforms, const glm::mat4 & viewProjection, const glm::vec3 & cameraPosition) {
+	models.resize(items.size());
+	for(size_t i = 0; i < items.size(); ++i)
+		models[i] = scene.getWorldMatrix(items[i].node);
+	submit(resMan, items.data(), models.data(), items.size(), shader, uniforms, viewProjection, cameraPosition, numThreads);
+}
+
+void RenderQueue::record(CommandBuffer & commands, ResourceManager & resMan, const SceneGraph & scene, const Shader & shader,
+												 StreamBuffer & uniforms, const glm::mat4 & viewProjection, const glm::vec3 & cameraPosition,
+												 const ubo::Camera * camera) {
+	// The items and their transforms are copied, the next build() may run before the frame is drawn
+	size_t count = items.size();
+	Item * drawItems = commands.allocate<Item>(count);
+	glm::mat4 * drawModels = commands.allocate<glm::mat4>(count);
+	if(count)
+		std::memcpy(drawItems, items.data(), count * sizeof(Item));
+	for(size_t i = 0; i < count; ++i)
+		drawModels[i] = scene.getWorldMatrix(items[i].node);
+
+	RenderQueue * queue = this;
+	ResourceManager * manager = &resMan;
+	const Shader * program = &shader;
+	StreamBuffer * stream = &uniforms;
+	unsigned threads = numThreads;
+	commands.record([=]() {
+		if(camera)
+			queue->submit(*manager, drawItems, drawModels, count, *program, *stream, camera->viewProjection, camera->position, threads);
+		else
+			queue->submit(*manager, drawItems, drawModels, count, *program, *stream, viewProjection, cameraPosition, threads);
+	});
+}
+
+void RenderQueue::submit(ResourceManager & resMan, const Item * drawItems, const glm::mat4 * drawModels, size_t count,
+												 const Shader & shader, StreamBuffer & uniforms, const glm::mat4 & viewProjection,
+												 const glm::vec3 & cameraPosition, unsigned numThreads) {
+	submittedTriangles = 0;
+	clusterStats = cull::Stats();
+	if(count==0)
+		return;
+	cullClusters(resMan, drawItems, drawModels, count, viewProjection, cameraPosition, numThreads);
+
+	// Resources are looked up once per run of equal material/mesh
+	u64 boundMaterial = UINT64_MAX;
+	std::shared_ptr<Material> material;
+	// Materials are bound against the previous one, none before the first
+	Material * previous = nullptr;
+	const Shader * program = &shader;
+	u64 boundMesh = UINT64_MAX;
+	std::shared_ptr<Mesh> mesh;
+	// Draw blocks are written a chunk of items at a time, then bound per draw
+	ubo::BlockArray<ubo::Draw> drawBlocks;
+	const size_t chunk = 1024;
+	size_t chunkBegin = 0;
+	// Draws of chunks the stream had no room for; the rest of the queue is still drawn
+	size_t skipped = 0;
+	for(size_t i = 0; i < count; ++i) {
+		const Item & item = drawItems[i];
+		if(i % chunk==0) {
+			chunkBegin = i;
+			size_t chunkEnd = std::min(count, i + chunk);
+			if(!drawBlocks.begin(uniforms, chunkEnd - i)) {
+				skipped += chunkEnd - i;
+				i = chunkEnd - 1;
+				continue;
+			}
+			for(size_t k = i; k < chunkEnd; ++k)
+				drawBlocks[k - i].model = drawModels[k];
+			drawBlocks.end();
+		}
+		if(item.material!=boundMaterial) {
+			material = std::static_pointer_cast<Material>(resMan.find(item.material));
+			Material & current = material ? *material : Material::fallback();
+			program = &current.bind(resMan, shader, previous);
+			previous = &current;
+			boundMaterial = item.material;
+		}
+		if(item.mesh!=boundMesh) {
+			mesh = std::static_pointer_cast<Mesh>(resMan.find(item.mesh));
+			boundMesh = item.mesh;
+		}
+		if(!mesh)
+			continue;
+
+		drawBlocks.bind(ubo::DrawBinding, i - chunkBegin);
+		// Sampler uniforms only go up when they changed
+		program->flush();
+		const ClusterDraw & clusters = clusterDraws[i];
+		if(clusters.count >= 0 && clusterBuffer) {
+			if(clusters.count > 0)
+				mesh->draw(item.primitive, clusterBuffer, clusters.count, clusters.offset);
+			submittedTriangles += clusters.count / 3;
+			continue;
+		}
+		mesh->draw(item.primitive, item.lod);
+		if(mesh->getPrimitives()[item.primitive].mode==GL_TRIANGLES)
+			submittedTriangles += mesh->getCount(item.primitive, item.lod) / 3;
+	}
+	glBindVertexArray(0);
+	// Single-sided materials leave face culling on
+	glDisable(GL_CULL_FACE);
+	if(clusterBuffer)
+		clusterStream->endFrame();
+	if(skipped)
+		std::cerr << "ERROR: (RenderQueue::submit) Uniform stream out of room, skipped " << skipped << " of " << count
+							<< " draws\n";
+}
+
+void RenderQueue::cullClusters(ResourceManager & resMan, const Item * drawItems, const glm::mat4 * drawModels, size_t count,
+															 const glm::mat4 & viewProjection, const glm::vec3 & cameraPosition, unsigned numThreads) {
+	clusterDraws.assign(count, ClusterDraw{0, -1});
+	clusterIndices.clear();
+
+	u64 boundMesh = UINT64_MAX;
+	std::shared_ptr<Mesh> mesh;
+	for(size_t i = 0; i < count; ++i) {
+		const Item & item = drawItems[i];
+		if(item.mesh!=boundMesh) {
+			mesh = std::static_pointer_cast<Mesh>(resMan.find(item.mesh));
+			boundMesh = item.mesh;
+		}
+		if(!mesh || item.lod!=0)
+			continue;
+		const Mesh::Primitive & p = mesh->getPrimitives()[item.primitive];
+		if(!p.meshlets)
+			continue;
+
+		// Frustum and camera in the object space of the item
+		const glm::mat4 & model = drawModels[i];
+		Frustum frustum = Frustum::fromMatrix(viewProjection * model);
+		glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.f));
+
+		cull::Stats stats = meshlet::cull(*p.meshlets, frustum, camera, visibleClusters, numThreads);
+		clusterStats.tested += stats.tested;
+		clusterStats.visible += stats.visible;
+		clusterStats.ms += stats.ms;
+
+		size_t offset = clusterIndices.size();
+		size_t written = meshlet::writeIndices(*p.meshlets, visibleClusters, clusterIndices);
+		clusterDraws[i] = ClusterDraw{offset * sizeof(uint32_t), (GLsizei)written};
+	}
+	clusterBuffer = 0;
+	if(clusterIndices.empty())
+		return;
+
+	// Written straight into the ring; the fence after this frame's draws guards the range
+	GLsizeiptr bytes = clusterIndices.size() * sizeof(uint32_t);
+	if(!clusterStream)
+		clusterStream = std::make_unique<StreamBuffer>(std::max<GLsizeiptr>(4 << 20, bytes * 3));
+	else if(bytes * 3 > clusterStream->getCapacity())
+		clusterStream->resize(bytes * 3);
+	clusterStream->beginFrame();
+	StreamBuffer::Allocation allocation = clusterStream->allocate(bytes, sizeof(uint32_t));
+	if(!allocation.ptr) {
+		clusterStream->endFrame();
+		return;
+	}
+	std::memcpy(allocation.ptr, clusterIndices.data(), bytes);
+	clusterStream->unmap();
+	clusterBuffer = allocation.buffer;
+	for(ClusterDraw & draw : clusterDraws)
+		if(draw.count >= 0)
+			draw.offset += allocation.offset;
+}
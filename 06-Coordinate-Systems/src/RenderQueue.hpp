@@ -0,0 +1,201 @@
+/*
+ * List of draws for a frame.
+ *
+ * It's built from an ECS query over renderable entities (Transform, MeshRef,
+ * MaterialRef, Bounds) instead of hand-written draw code. World bounds of the
+ * entities are frustum culled (see Culling.hpp), optionally tested against
+ * the software occlusion buffer (see Occlusion.hpp), and only the visible ones
+ * are kept, sorted by the material sort key (shader, then textures) and mesh
+ * so consecutive draws share as much GL state as possible, and then
+ * submitted.
+ *
+ * Frame preparation runs on the job pool (see Jobs.hpp). Chunks of entities
+ * are gathered in parallel into place (their position is fixed by chunk
+ * order), and visible items are turned into draw packets - a 64 bit sort key
+ * and the item's index - by jobs that each append to the buffer of the
+ * thread they run on, without locks. Each job notes the range of items it
+ * recorded, so merging puts the packets back in item order, whichever thread
+ * recorded them. A parallel LSD radix sort on the key, stable and split into
+ * fixed size blocks, then orders them: equal keys stay in item order, so the
+ * draw order is the same for any number of threads. Only submit() makes GL
+ * calls. Each material is bound against the previous one, so only the
+ * program, texture units and uniform block that differ are changed.
+ *
+ * Items drawn at full detail whose primitive is split into meshlets are
+ * culled cluster by cluster at submit time. The indices of all surviving
+ * clusters of the frame are written into one range of a ring buffer (see
+ * StreamBuffer.hpp), and every such item is drawn from it's part of the
+ * range with a single call.
+ *
+ * With a render thread (see RenderThread.hpp) the queue is recorded
+ * instead of submitted: a snapshot of the items and their transforms goes
+ * into the frame's command buffer and is drawn by the render thread, while
+ * build() already runs for the next frame. Submit-side state (cluster
+ * culling, it's stream and stats) is then only touched by the render thread.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <iostream>
+
+#include "Resource.hpp"
+#include "ResourceManager.hpp"
+#include "SceneGraph.hpp"
+#include "Shader.hpp"
+#include "ECS.hpp"
+#include "Frustum.hpp"
+#include "Culling.hpp"
+#include "Occlusion.hpp"
+#include "StreamBuffer.hpp"
+#include "CommandBuffer.hpp"
+#include "UniformBlocks.hpp"
+
+class RenderQueue {
+public:
+	struct Item {
+		uint64_t materialKey;
+		u64 material;
+		u64 mesh;
+		uint32_t primitive;
+		uint32_t lod;
+		SceneGraph::NodeID node;
+	};
+
+	// Draw packet: sort key of an item and it's index among the candidates
+	struct Packet {
+		uint64_t key;
+		uint32_t index;
+	};
+
+	// Time spent in the steps of the last build()
+	struct BuildStats {
+		size_t candidates = 0;
+		size_t packets = 0;
+		double gatherMs = 0.;
+		double cullMs = 0.;
+		double recordMs = 0.;
+		double sortMs = 0.;
+		double ms = 0.;
+
+		friend std::ostream & operator<<(std::ostream & os, const BuildStats & s) {
+			os << "[packets|candidates:" << s.candidates
+				 << "|packets:" << s.packets
+				 << "|gatherMs:" << s.gatherMs
+				 << "|cullMs:" << s.cullMs
+				 << "|recordMs:" << s.recordMs
+				 << "|sortMs:" << s.sortMs
+				 << "|ms:" << s.ms
+				 << "]";
+			return os;
+		}
+	};
+
+	RenderQueue() = default;
+
+	// Delete copy and assignment constructors
+	RenderQueue(const RenderQueue &) = delete;
+	RenderQueue & operator=(const RenderQueue &) = delete;
+
+	// Refill the queue with renderable entities of the world visible in the frustum and sort it,
+	// using up to numThreads threads of the job pool; with an occlusion buffer (already rasterized
+	// for this frame) hidden entities are dropped too
+	void build(ecs::World & world, const Frustum & frustum, unsigned numThreads = 1,
+						 cull::OcclusionBuffer * occlusion = nullptr);
+
+	// Draw all items with their materials' shaders (`shader` for materials without one), each at
+	// it's selected level of detail. Items' Draw blocks are written into `uniforms`; the Camera
+	// block must already be bound (see UniformBlocks.hpp)
+	void submit(ResourceManager & resMan, const SceneGraph & scene, const Shader & shader,
+							StreamBuffer & uniforms, const glm::mat4 & viewProjection, const glm::vec3 & cameraPosition);
+
+	// Record submit() into a frame for the render thread: the items and their world matrices are
+	// copied into the command buffer, so the queue can be rebuilt while the frame waits. With a
+	// camera (filled by an earlier command of the frame, e.g. a late latched one, see LateLatch.hpp)
+	// it's view is used for culling clusters instead of the given one
+	void record(CommandBuffer & commands, ResourceManager & resMan, const SceneGraph & scene, const Shader & shader,
+							StreamBuffer & uniforms, const glm::mat4 & viewProjection, const glm::vec3 & cameraPosition,
+							const ubo::Camera * camera = nullptr);
+
+	// Draw count items with the given world matrices (a snapshot taken by record())
+	void submit(ResourceManager & resMan, const Item * drawItems, const glm::mat4 * drawModels, size_t count,
+							const Shader & shader, StreamBuffer & uniforms, const glm::mat4 & viewProjection,
+							const glm::vec3 & cameraPosition, unsigned numThreads = 1);
+
+	// Shader and texture bits of the material key, then material, mesh, primitive and level of detail
+	static uint64_t packetKey(const Item & item);
+
+	// Sort packets by key with a stable LSD radix sort over fixed size blocks (in parallel
+	// for numThreads > 1; the result doesn't depend on it)
+	static void sortPackets(std::vector<Packet> & packets, std::vector<Packet> & scratch, unsigned numThreads = 1);
+
+	const std::vector<Item> & getItems() const { return items; }
+	size_t size() const { return items.size(); }
+
+	// Timings of the last build()
+	const BuildStats & getBuildStats() const { return buildStats; }
+	// Culling results of the last build()
+	const cull::Stats & getCullStats() const { return cullStats; }
+	// Occlusion results of the last build() (empty without an occlusion buffer)
+	const cull::OcclusionStats & getOcclusionStats() const { return occlusionStats; }
+	// Triangles drawn by the last submit()
+	size_t getSubmittedTriangles() const { return submittedTriangles; }
+	// Meshlet culling results of the last submit(), summed over all clustered items
+	const cull::Stats & getClusterStats() const { return clusterStats; }
+	// Streamed cluster indices of the last submit() (empty before the first clustered item)
+	StreamBuffer::Stats getStreamStats() const { return clusterStream ? clusterStream->getStats() : StreamBuffer::Stats(); }
+
+private:
+	std::vector<Item> items;
+
+	// Scratch space of build(): all candidates and their bounds
+	std::vector<Item> candidates;
+	cull::AABBArray bounds;
+	std::vector<uint32_t> visible;
+	// Packets recorded by each thread of the pool and the item ranges they cover, then all of them in draw order
+	struct Run {
+		size_t first;
+		size_t count;
+		size_t offset;
+	};
+	struct ThreadPackets {
+		std::vector<Packet> packets;
+		std::vector<Run> runs;
+	};
+	std::vector<ThreadPackets> threadPackets;
+	std::vector<Packet> packets;
+	std::vector<Packet> packetScratch;
+	BuildStats buildStats;
+	cull::Stats cullStats;
+	cull::OcclusionStats occlusionStats;
+	size_t submittedTriangles = 0;
+	unsigned numThreads = 1;
+	// World matrices of the items, gathered by submit()
+	std::vector<glm::mat4> models;
+
+	// Index range in the cluster stream for every item; count is -1 for items drawn as usual
+	struct ClusterDraw {
+		size_t offset;
+		GLsizei count;
+	};
+	std::vector<ClusterDraw> clusterDraws;
+	std::vector<uint32_t> clusterIndices;
+	std::vector<uint32_t> visibleClusters;
+	// Created with the first clustered item, grows to fit 3 frames of the biggest one seen
+	std::unique_ptr<StreamBuffer> clusterStream;
+	// Buffer holding this frame's cluster indices, 0 if there are none
+	GLuint clusterBuffer = 0;
+	cull::Stats clusterStats;
+
+	// Cull meshlets of clustered items and stream the indices of the visible ones
+	void cullClusters(ResourceManager & resMan, const Item * drawItems, const glm::mat4 * drawModels, size_t count,
+										const glm::mat4 & viewProjection, const glm::vec3 & cameraPosition, unsigned numThreads);
+};
+
+#endif /* RENDER_QUEUE_HPP */
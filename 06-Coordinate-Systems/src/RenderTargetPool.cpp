@@ -0,0 +1,151 @@
+#include "RenderTargetPool.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	struct Format {
+		GLenum internalFormat;
+		GLenum format;
+		GLenum type;
+		size_t bytesPerPixel;
+	};
+
+	const Format formats[] = {
+		{GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4},
+		{GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8},
+		{GL_R11F_G11F_B10F, GL_RGB, GL_FLOAT, 4},
+		{GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4},
+		{GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4},
+	};
+
+	const Format & findFormat(GLenum internalFormat) {
+		for(const Format & f : formats)
+			if(f.internalFormat==internalFormat)
+				return f;
+		std::cerr << "ERROR: (RenderTargetPool) Unsupported format " << internalFormat << ", using GL_RGBA8\n";
+		return formats[0];
+	}
+}
+
+int RenderTargetDesc::getWidth(int referenceWidth) const {
+	return width ? width : std::max(1, (int)std::ceil(referenceWidth * scale));
+}
+
+int RenderTargetDesc::getHeight(int referenceHeight) const {
+	return height ? height : std::max(1, (int)std::ceil(referenceHeight * scale));
+}
+
+size_t RenderTargetDesc::getBytes(int referenceWidth, int referenceHeight) const {
+	return (size_t)getWidth(referenceWidth) * getHeight(referenceHeight) * findFormat(format).bytesPerPixel;
+}
+
+RenderTargetPool::RenderTargetPool(const Settings & settings) : settings(settings) {
+}
+
+void RenderTargetPool::beginFrame(const RenderTargetDesc * slots, size_t count, int framebufferWidth,
+																	int framebufferHeight) {
+	this->framebufferWidth = framebufferWidth;
+	this->framebufferHeight = framebufferHeight;
+
+	// A size (not 0 - iconified) becomes the reference after it held long enough; the first one right away
+	Clock::time_point now = Clock::now();
+	if(framebufferWidth!=pendingWidth || framebufferHeight!=pendingHeight) {
+		pendingWidth = framebufferWidth;
+		pendingHeight = framebufferHeight;
+		pendingSince = now;
+	}
+	bool changed = pendingWidth!=referenceWidth || pendingHeight!=referenceHeight;
+	bool settled = !referenceWidth || std::chrono::duration<double>(now - pendingSince).count() >= settings.resizeDelay;
+	if(changed && settled && pendingWidth > 0 && pendingHeight > 0) {
+		referenceWidth = pendingWidth;
+		referenceHeight = pendingHeight;
+		stats.resizes++;
+	}
+
+	// Targets no frame asks for anymore are freed
+	while(targets.size() > count) {
+		glDeleteTextures(1, &targets.back().texture);
+		targets.pop_back();
+		releaseFramebuffers();
+	}
+	targets.resize(count);
+	for(size_t i = 0; i < count; ++i) {
+		Target & target = targets[i];
+		if(target.texture && target.desc==slots[i] && target.width==slots[i].getWidth(referenceWidth)
+			 && target.height==slots[i].getHeight(referenceHeight))
+			continue;
+		target.desc = slots[i];
+		allocate(target);
+	}
+
+	stats.targets = targets.size();
+	stats.framebuffers = framebuffers.size();
+	stats.bytes = 0;
+	for(const Target & target : targets)
+		stats.bytes += (size_t)target.width * target.height * findFormat(target.desc.format).bytesPerPixel;
+	stats.peakBytes = std::max(stats.peakBytes, stats.bytes);
+}
+
+void RenderTargetPool::allocate(Target & target) {
+	const Format & format = findFormat(target.desc.format);
+	target.width = target.desc.getWidth(referenceWidth);
+	target.height = target.desc.getHeight(referenceHeight);
+	if(!target.texture)
+		glGenTextures(1, &target.texture);
+	glBindTexture(GL_TEXTURE_2D, target.texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, format.internalFormat, target.width, target.height, 0, format.format, format.type,
+							 nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	stats.allocations++;
+	releaseFramebuffers();
+}
+
+void RenderTargetPool::releaseFramebuffers() {
+	for(auto & framebuffer : framebuffers)
+		glDeleteFramebuffers(1, &framebuffer.second);
+	framebuffers.clear();
+}
+
+void RenderTargetPool::bind(const uint32_t * slots, size_t count) {
+	if(!count) {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, framebufferWidth, framebufferHeight);
+		return;
+	}
+
+	std::vector<GLuint> textures(count);
+	for(size_t i = 0; i < count; ++i)
+		textures[i] = targets[slots[i]].texture;
+	auto found = framebuffers.find(textures);
+	if(found!=framebuffers.end())
+		glBindFramebuffer(GL_FRAMEBUFFER, found->second);
+	else {
+		GLuint framebuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		std::vector<GLenum> drawBuffers;
+		for(size_t i = 0; i < count; ++i) {
+			const Target & target = targets[slots[i]];
+			GLenum attachment = target.desc.format==GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT
+				: target.desc.isDepth() ? GL_DEPTH_ATTACHMENT
+				: GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+			if(!target.desc.isDepth())
+				drawBuffers.push_back(attachment);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, target.texture, 0);
+		}
+		if(drawBuffers.empty())
+			glDrawBuffer(GL_NONE);
+		else
+			glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+		if(glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE)
+			std::cerr << "ERROR: (RenderTargetPool::bind) Framebuffer with " << count << " targets is incomplete\n";
+		framebuffers.emplace(textures, framebuffer);
+		stats.framebuffers = framebuffers.size();
+	}
+	glViewport(0, 0, targets[slots[0]].width, targets[slots[0]].height);
+}
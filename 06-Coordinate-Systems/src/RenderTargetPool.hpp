@@ -0,0 +1,138 @@
+/*
+ * Pool of the textures transient render targets live in.
+ *
+ * A frame (see FrameGraph.hpp) asks for a list of slots, each a size and a
+ * format; textures made for a slot are kept as long as the next frames ask
+ * for the same, so after the first frame nothing is allocated. Sizes are
+ * relative to the pool's reference size, the framebuffer's - but while the
+ * window is being resized the framebuffer changes every frame, and
+ * reallocating every target as often would stall the drag. A new size
+ * only becomes the reference after it held for resizeDelay; until then
+ * frames render at the old one (and are scaled to the window when they are
+ * presented).
+ *
+ * Framebuffer objects are cached per set of attached textures. Everything
+ * but the constructor is called on the GL thread.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef RENDER_TARGET_POOL_HPP
+#define RENDER_TARGET_POOL_HPP
+
+#include <map>
+#include <vector>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#include <glad/glad.h>
+
+// Size and format of a render target: a scale of the reference size, or a fixed size
+struct RenderTargetDesc {
+	float scale = 1.f;
+	// Fixed size when not 0
+	int width = 0;
+	int height = 0;
+	GLenum format = GL_RGBA8;
+
+	int getWidth(int referenceWidth) const;
+	int getHeight(int referenceHeight) const;
+	size_t getBytes(int referenceWidth, int referenceHeight) const;
+	bool isDepth() const { return format==GL_DEPTH24_STENCIL8 || format==GL_DEPTH_COMPONENT24; }
+
+	bool operator==(const RenderTargetDesc & other) const {
+		return scale==other.scale && width==other.width && height==other.height && format==other.format;
+	}
+	bool operator!=(const RenderTargetDesc & other) const { return !(*this==other); }
+};
+
+class RenderTargetPool {
+public:
+	struct Settings {
+		// Seconds a new framebuffer size has to hold before targets are reallocated for it
+		double resizeDelay = .25;
+	};
+
+	struct Stats {
+		size_t targets = 0;
+		size_t framebuffers = 0;
+		// Memory of the targets, now and the most ever (estimated from their formats)
+		size_t bytes = 0;
+		size_t peakBytes = 0;
+		// Times the reference size changed
+		size_t resizes = 0;
+		// Textures (re)allocated
+		size_t allocations = 0;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[render targets|targets:" << s.targets
+				 << "|framebuffers:" << s.framebuffers
+				 << "|MB:" << s.bytes / (1024.*1024.)
+				 << "|peakMB:" << s.peakBytes / (1024.*1024.)
+				 << "|resizes:" << s.resizes
+				 << "|allocations:" << s.allocations
+				 << "]";
+			return os;
+		}
+	};
+
+	explicit RenderTargetPool(const Settings & settings);
+
+	// Delete copy and assignment constructors
+	RenderTargetPool(const RenderTargetPool &) = delete;
+	RenderTargetPool & operator=(const RenderTargetPool &) = delete;
+
+	// Start a frame for a framebuffer of the given size with these slots (see the class comment)
+	void beginFrame(const RenderTargetDesc * slots, size_t count, int framebufferWidth, int framebufferHeight);
+
+	// Bind a framebuffer with the slots' textures attached (depth formats to the depth attachment,
+	// the rest to color attachments in order) and set the viewport to their size. No slots binds
+	// the default framebuffer
+	void bind(const uint32_t * slots, size_t count);
+
+	GLuint getTexture(uint32_t slot) const { return targets[slot].texture; }
+	int getWidth(uint32_t slot) const { return targets[slot].width; }
+	int getHeight(uint32_t slot) const { return targets[slot].height; }
+
+	// Size the targets are allocated for, and the framebuffer's this frame
+	int getReferenceWidth() const { return referenceWidth; }
+	int getReferenceHeight() const { return referenceHeight; }
+	int getFramebufferWidth() const { return framebufferWidth; }
+	int getFramebufferHeight() const { return framebufferHeight; }
+
+	const Stats & getStats() const { return stats; }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Target {
+		RenderTargetDesc desc;
+		GLuint texture = 0;
+		int width = 0;
+		int height = 0;
+	};
+
+	Settings settings;
+	std::vector<Target> targets;
+	std::map<std::vector<GLuint>, GLuint> framebuffers;
+
+	int referenceWidth = 0;
+	int referenceHeight = 0;
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	// Size waiting for the delay, and since when
+	int pendingWidth = 0;
+	int pendingHeight = 0;
+	Clock::time_point pendingSince;
+
+	Stats stats;
+
+	void allocate(Target & target);
+	// Drop the cached framebuffers (some attachment changed)
+	void releaseFramebuffers();
+};
+
+#endif /* RENDER_TARGET_POOL_HPP */
@@ -0,0 +1,152 @@
+#include "RenderThread.hpp"
+
+#include <algorithm>
+
+RenderThread::RenderThread(Context & context, unsigned numBuffers, bool threaded, FramePacer * pacer) :
+	context(context),
+	threaded(threaded),
+	pacer(pacer) {
+	numBuffers = std::max(1u, numBuffers);
+	for(unsigned i = 0; i < numBuffers; ++i)
+		frames.push_back(std::make_unique<Frame>());
+	if(threaded) {
+		context.releaseCurrent();
+		thread = std::thread(&RenderThread::loop, this);
+	}
+}
+
+RenderThread::~RenderThread() {
+	if(!threaded)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	frameQueued.notify_one();
+	thread.join();
+	context.makeCurrent();
+}
+
+CommandBuffer & RenderThread::beginFrame() {
+	return *acquire(nullptr);
+}
+
+CommandBuffer * RenderThread::beginFrame(double timeout) {
+	Clock::time_point until = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeout));
+	return acquire(&until);
+}
+
+CommandBuffer * RenderThread::acquire(const Clock::time_point * until) {
+	Frame & frame = *frames[recordIndex];
+	Clock::time_point start = Clock::now();
+	bool free;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		auto isFree = [&]() { return frame.state==State::Free; };
+		if(until)
+			free = frameFreed.wait_until(lock, *until, isFree);
+		else {
+			frameFreed.wait(lock, isFree);
+			free = true;
+		}
+		if(free)
+			frame.state = State::Recording;
+	}
+	Clock::time_point now = Clock::now();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.waitMs += std::chrono::duration<double, std::milli>(now - start).count();
+	}
+	if(!free)
+		return nullptr;
+	frame.begin = now;
+	return &frame.commands;
+}
+
+void RenderThread::endFrame() {
+	Frame & frame = *frames[recordIndex];
+	recordIndex = (recordIndex + 1) % frames.size();
+	if(!threaded) {
+		execute(frame);
+		frame.state = State::Free;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		frame.state = State::Queued;
+	}
+	frameQueued.notify_one();
+}
+
+void RenderThread::loop() {
+	context.makeCurrent();
+	while(true) {
+		Frame & frame = *frames[executeIndex];
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			// Queued frames are finished before stopping
+			frameQueued.wait(lock, [&]() { return frame.state==State::Queued || !running; });
+			if(frame.state!=State::Queued)
+				break;
+		}
+		execute(frame);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			frame.state = State::Free;
+		}
+		frameFreed.notify_one();
+		executeIndex = (executeIndex + 1) % frames.size();
+	}
+	context.releaseCurrent();
+}
+
+void RenderThread::execute(Frame & frame) {
+	if(pacer)
+		pacer->beginGPUFrame();
+	Clock::time_point start = Clock::now();
+	executing = &frame;
+	frame.commands.execute();
+	executing = nullptr;
+	Clock::time_point executed = Clock::now();
+	context.swapBuffers();
+	Clock::time_point swapped = Clock::now();
+	if(pacer)
+		pacer->endGPUFrame();
+
+	double latency = std::chrono::duration<double, std::milli>(swapped - frame.begin).count();
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.frames++;
+	stats.latencyMs += latency;
+	stats.maxLatencyMs = std::max(stats.maxLatencyMs, latency);
+	stats.executeMs += std::chrono::duration<double, std::milli>(executed - start).count();
+	stats.swapMs += std::chrono::duration<double, std::milli>(swapped - executed).count();
+	if(frame.hasInput) {
+		double motion = std::chrono::duration<double, std::milli>(swapped - frame.input).count();
+		stats.motionFrames++;
+		stats.motionLatencyMs += motion;
+		stats.maxMotionLatencyMs = std::max(stats.maxMotionLatencyMs, motion);
+		frame.hasInput = false;
+	}
+	stats.commands += frame.commands.getNumCommands();
+	stats.bytes += frame.commands.getBytes();
+	frame.commands.reset();
+}
+
+void RenderThread::markInput(std::chrono::steady_clock::time_point time) {
+	if(!executing) {
+		std::cerr << "ERROR: (RenderThread::markInput) No frame is being executed\n";
+		return;
+	}
+	executing->input = time;
+	executing->hasInput = true;
+}
+
+RenderThread::Stats RenderThread::getStats() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void RenderThread::resetStats() {
+	std::lock_guard<std::mutex> lock(mutex);
+	stats = Stats();
+}
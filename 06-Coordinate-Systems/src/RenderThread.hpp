@@ -0,0 +1,152 @@
+/*
+ * Render thread executing frames recorded by the simulation thread.
+ *
+ * The simulation thread takes a free CommandBuffer with beginFrame(),
+ * records the frame's GL work into it (see CommandBuffer.hpp) and hands it
+ * over with endFrame(). The render thread, which owns the Context's GL
+ * context from construction to destruction, executes the frames in order
+ * and swaps buffers after each. While the driver blocks in the swap (or in
+ * any GL call) of frame N, the simulation already runs frame N+1.
+ *
+ * With numBuffers frames the simulation can be at most numBuffers-1 frames
+ * ahead: beginFrame() waits for a buffer when all of them are in flight.
+ * Every frame takes latency with it - the time from beginFrame() (before
+ * input is read) to the end of it's swap is measured and reported, so
+ * double and triple buffering can be compared against the single threaded
+ * path. Without threading frames are executed by endFrame() on the calling
+ * thread, measured the same way. A FramePacer (see FramePacer.hpp) given to
+ * it limits how far the GPU may fall behind the frames executed here.
+ *
+ * GLFW events are still polled by the simulation (main) thread, which must
+ * not make GL calls while the render thread runs. The timed beginFrame()
+ * lets it poll events while it waits for a buffer.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef RENDER_THREAD_HPP
+#define RENDER_THREAD_HPP
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <iostream>
+
+#include "Context.hpp"
+#include "CommandBuffer.hpp"
+#include "FramePacer.hpp"
+
+class RenderThread {
+public:
+	// Totals since the last reset
+	struct Stats {
+		size_t frames = 0;
+		// Input read to end of swap
+		double latencyMs = 0.;
+		double maxLatencyMs = 0.;
+		// Simulation waiting for a free buffer
+		double waitMs = 0.;
+		// Render thread executing commands and swapping
+		double executeMs = 0.;
+		double swapMs = 0.;
+		// Input the image follows from (see markInput()) to end of swap
+		size_t motionFrames = 0;
+		double motionLatencyMs = 0.;
+		double maxMotionLatencyMs = 0.;
+		size_t commands = 0;
+		size_t bytes = 0;
+
+		double avgLatencyMs() const { return frames ? latencyMs / frames : 0.; }
+		double avgMotionLatencyMs() const { return motionFrames ? motionLatencyMs / motionFrames : 0.; }
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[render thread|frames:" << s.frames
+				 << "|latencyMs:" << s.avgLatencyMs()
+				 << "|maxLatencyMs:" << s.maxLatencyMs
+				 << "|waitMs:" << s.waitMs
+				 << "|executeMs:" << s.executeMs
+				 << "|swapMs:" << s.swapMs
+				 << "|motionLatencyMs:" << s.avgMotionLatencyMs()
+				 << "|maxMotionLatencyMs:" << s.maxMotionLatencyMs
+				 << "|commands:" << s.commands
+				 << "|bytes:" << s.bytes
+				 << "]";
+			return os;
+		}
+	};
+
+	// The context is released by the calling thread and made current on the render thread
+	// (with threaded=false it stays with the calling thread); with a pacer every frame is throttled
+	// and fenced by it on the GL thread
+	RenderThread(Context & context, unsigned numBuffers = 2, bool threaded = true, FramePacer * pacer = nullptr);
+	// Executes the frames still queued, then makes the context current on the calling thread again
+	~RenderThread();
+
+	// Delete copy and assignment constructors
+	RenderThread(const RenderThread &) = delete;
+	RenderThread & operator=(const RenderThread &) = delete;
+
+	// Buffer to record the next frame into; waits while all buffers are in flight
+	CommandBuffer & beginFrame();
+	// Same, but gives up after timeout seconds and returns null (e.g. to poll events meanwhile)
+	CommandBuffer * beginFrame(double timeout);
+	// Queue the recorded frame (without threading: execute it and swap)
+	void endFrame();
+
+	// Called by a frame's commands while it executes: the input it's image follows from (e.g. a
+	// camera pose) was read at `time`; the time from then to the end of the swap is reported as
+	// motion-to-photon latency
+	void markInput(std::chrono::steady_clock::time_point time);
+
+	bool isThreaded() const { return threaded; }
+	unsigned getNumBuffers() const { return (unsigned)frames.size(); }
+
+	Stats getStats() const;
+	void resetStats();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	enum class State {
+		Free,
+		Recording,
+		Queued
+	};
+	struct Frame {
+		CommandBuffer commands;
+		State state = State::Free;
+		Clock::time_point begin;
+		Clock::time_point input;
+		bool hasInput = false;
+	};
+
+	Context & context;
+	bool threaded;
+	FramePacer * pacer;
+	std::vector<std::unique_ptr<Frame>> frames;
+	// Next frame to record and to execute; both go around the ring in order
+	size_t recordIndex = 0;
+	size_t executeIndex = 0;
+	bool running = true;
+	// Frame being executed (by the GL thread)
+	Frame * executing = nullptr;
+
+	mutable std::mutex mutex;
+	std::condition_variable frameQueued;
+	std::condition_variable frameFreed;
+	Stats stats;
+	std::thread thread;
+
+	// Wait for the next frame to be free, at most until `until`
+	CommandBuffer * acquire(const Clock::time_point * until);
+	void loop();
+	// Execute, swap and measure one frame
+	void execute(Frame & frame);
+};
+
+#endif /* RENDER_THREAD_HPP */
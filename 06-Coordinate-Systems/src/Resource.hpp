@@ -21,7 +21,9 @@ public:
 		ResourceManager,
 		Shader,
 		Texture,
-		Context
+		Context,
+		Mesh,
+		Material
 	};
 
 	// Print information about a resource
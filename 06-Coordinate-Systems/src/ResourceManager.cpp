@@ -26,6 +26,13 @@ u64 ResourceManager::insert(Resource * const res) {
 		break;
 	case Resource::Type::Context:
 		name = "Context-";
+		break;
+	case Resource::Type::Mesh:
+		name = "Mesh-";
+		break;
+	case Resource::Type::Material:
+		name = "Material-";
+		break;
 	default:
 		name = "Unknown-";
 	}
@@ -0,0 +1,224 @@
+#include "SceneGraph.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SCENE_GRAPH_SSE
+#endif
+
+#include "Jobs.hpp"
+
+SceneGraph::SceneGraph(size_t reserve) {
+	for(auto * v : {&posX, &posY, &posZ, &rotX, &rotY, &rotZ, &rotW, &sclX, &sclY, &sclZ})
+		v->reserve(reserve);
+	parents.reserve(reserve);
+	depths.reserve(reserve);
+	firstChild.reserve(reserve);
+	nextSibling.reserve(reserve);
+	worldMatrices.reserve(reserve);
+	states.reserve(reserve);
+}
+
+SceneGraph::NodeID SceneGraph::createNode(NodeID parent) {
+	NodeID node = (NodeID)parents.size();
+	if(parent!=NO_PARENT && parent >= node) {
+		std::cerr << "ERROR: (SceneGraph::createNode) Parent " << parent << " doesn't exist, creating a root node\n";
+		parent = NO_PARENT;
+	}
+
+	posX.push_back(0.f); posY.push_back(0.f); posZ.push_back(0.f);
+	rotX.push_back(0.f); rotY.push_back(0.f); rotZ.push_back(0.f); rotW.push_back(1.f);
+	sclX.push_back(1.f); sclY.push_back(1.f); sclZ.push_back(1.f);
+
+	parents.push_back(parent);
+	depths.push_back(parent==NO_PARENT ? 0 : depths[parent]+1);
+	firstChild.push_back(NO_PARENT);
+	nextSibling.push_back(NO_PARENT);
+	if(parent!=NO_PARENT) {
+		nextSibling[node] = firstChild[parent];
+		firstChild[parent] = node;
+	}
+
+	worldMatrices.push_back(glm::mat4(1.f));
+	states.push_back(Clean);
+	markDirty(node);
+
+	return node;
+}
+
+void SceneGraph::setTranslation(NodeID node, const glm::vec3 & translation) {
+	posX[node] = translation.x;
+	posY[node] = translation.y;
+	posZ[node] = translation.z;
+	markDirty(node);
+}
+
+void SceneGraph::setRotation(NodeID node, const glm::quat & rotation) {
+	rotX[node] = rotation.x;
+	rotY[node] = rotation.y;
+	rotZ[node] = rotation.z;
+	rotW[node] = rotation.w;
+	markDirty(node);
+}
+
+void SceneGraph::setScale(NodeID node, const glm::vec3 & scale) {
+	sclX[node] = scale.x;
+	sclY[node] = scale.y;
+	sclZ[node] = scale.z;
+	markDirty(node);
+}
+
+glm::vec3 SceneGraph::getTranslation(NodeID node) const {
+	return glm::vec3(posX[node], posY[node], posZ[node]);
+}
+
+glm::quat SceneGraph::getRotation(NodeID node) const {
+	return glm::quat(rotW[node], rotX[node], rotY[node], rotZ[node]);
+}
+
+glm::vec3 SceneGraph::getScale(NodeID node) const {
+	return glm::vec3(sclX[node], sclY[node], sclZ[node]);
+}
+
+void SceneGraph::markDirty(NodeID node) {
+	if(states[node]==Clean) {
+		states[node] = Dirty;
+		dirtyNodes.push_back(node);
+	}
+}
+
+void SceneGraph::update() {
+	lastUpdateCount = 0;
+	if(dirtyNodes.empty())
+		return;
+
+	// Gather dirty subtrees, bucketed by depth. A subtree reached from an
+	// already queued ancestor is skipped, so each node is queued once.
+	for(NodeID root : dirtyNodes) {
+		if(states[root]==Queued)
+			continue;
+		stack.push_back(root);
+		while(!stack.empty()) {
+			NodeID node = stack.back();
+			stack.pop_back();
+			if(states[node]==Queued)
+				continue;
+			states[node] = Queued;
+			if(depths[node] >= levels.size())
+				levels.resize(depths[node]+1);
+			levels[depths[node]].push_back(node);
+			for(NodeID child = firstChild[node]; child!=NO_PARENT; child = nextSibling[child])
+				stack.push_back(child);
+		}
+	}
+	dirtyNodes.clear();
+
+	// Parents are finished one level before their children
+	for(auto & level : levels) {
+		if(level.empty())
+			continue;
+		// Walk the SoA arrays front to back
+		std::sort(level.begin(), level.end());
+		// Nodes of a level don't depend on each other: wide levels are split into jobs of whole batches
+		size_t numBatches = (level.size() + 3) / 4;
+		job::parallelFor(0, numBatches, std::max<size_t>(256, job::grainFor(numBatches, job::global().size())),
+										 [&](size_t first, size_t last) {
+			for(size_t b = first; b < last; ++b) {
+				size_t i = b * 4;
+				updateBatch(&level[i], std::min<size_t>(4, level.size()-i));
+			}
+		});
+		for(NodeID node : level)
+			states[node] = Clean;
+		lastUpdateCount += level.size();
+		level.clear();
+	}
+}
+
+#ifdef SCENE_GRAPH_SSE
+
+void SceneGraph::updateBatch(const NodeID * nodes, size_t count) {
+	// Gather 4 nodes into SSE lanes; missing lanes repeat the first node
+	NodeID n[4];
+	for(size_t i = 0; i < 4; ++i)
+		n[i] = nodes[i < count ? i : 0];
+	auto gather = [&n](const std::vector<float> & v) {
+		return _mm_setr_ps(v[n[0]], v[n[1]], v[n[2]], v[n[3]]);
+	};
+
+	__m128 qx = gather(rotX), qy = gather(rotY), qz = gather(rotZ), qw = gather(rotW);
+	__m128 sx = gather(sclX), sy = gather(sclY), sz = gather(sclZ);
+	__m128 one = _mm_set1_ps(1.f), two = _mm_set1_ps(2.f);
+
+	__m128 xx = _mm_mul_ps(qx, qx), yy = _mm_mul_ps(qy, qy), zz = _mm_mul_ps(qz, qz);
+	__m128 xy = _mm_mul_ps(qx, qy), xz = _mm_mul_ps(qx, qz), yz = _mm_mul_ps(qy, qz);
+	__m128 wx = _mm_mul_ps(qw, qx), wy = _mm_mul_ps(qw, qy), wz = _mm_mul_ps(qw, qz);
+
+	// Rotation matrix columns scaled by the scale, one node per lane
+	__m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+	__m128 c0y = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+	__m128 c0z = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+	__m128 c1x = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+	__m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+	__m128 c1z = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+	__m128 c2x = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+	__m128 c2y = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+	__m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+	__m128 c3x = gather(posX), c3y = gather(posY), c3z = gather(posZ);
+	__m128 zero = _mm_setzero_ps();
+
+	// Transpose lanes into per node columns: local[column][node]
+	__m128 local[4][4];
+	_MM_TRANSPOSE4_PS(c0x, c0y, c0z, zero);
+	local[0][0] = c0x; local[0][1] = c0y; local[0][2] = c0z; local[0][3] = zero;
+	zero = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(c1x, c1y, c1z, zero);
+	local[1][0] = c1x; local[1][1] = c1y; local[1][2] = c1z; local[1][3] = zero;
+	zero = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(c2x, c2y, c2z, zero);
+	local[2][0] = c2x; local[2][1] = c2y; local[2][2] = c2z; local[2][3] = zero;
+	__m128 ones = one;
+	_MM_TRANSPOSE4_PS(c3x, c3y, c3z, ones);
+	local[3][0] = c3x; local[3][1] = c3y; local[3][2] = c3z; local[3][3] = ones;
+
+	for(size_t i = 0; i < count; ++i) {
+		float * world = &worldMatrices[n[i]][0][0];
+		NodeID parent = parents[n[i]];
+		if(parent==NO_PARENT) {
+			for(int c = 0; c < 4; ++c)
+				_mm_storeu_ps(world + 4*c, local[c][i]);
+			continue;
+		}
+
+		// world = parentWorld * local, column by column
+		const float * p = &worldMatrices[parent][0][0];
+		__m128 p0 = _mm_loadu_ps(p), p1 = _mm_loadu_ps(p+4), p2 = _mm_loadu_ps(p+8), p3 = _mm_loadu_ps(p+12);
+		for(int c = 0; c < 4; ++c) {
+			__m128 l = local[c][i];
+			__m128 r = _mm_mul_ps(p0, _mm_shuffle_ps(l, l, _MM_SHUFFLE(0,0,0,0)));
+			r = _mm_add_ps(r, _mm_mul_ps(p1, _mm_shuffle_ps(l, l, _MM_SHUFFLE(1,1,1,1))));
+			r = _mm_add_ps(r, _mm_mul_ps(p2, _mm_shuffle_ps(l, l, _MM_SHUFFLE(2,2,2,2))));
+			r = _mm_add_ps(r, _mm_mul_ps(p3, _mm_shuffle_ps(l, l, _MM_SHUFFLE(3,3,3,3))));
+			_mm_storeu_ps(world + 4*c, r);
+		}
+	}
+}
+
+#else
+
+void SceneGraph::updateBatch(const NodeID * nodes, size_t count) {
+	for(size_t i = 0; i < count; ++i) {
+		NodeID node = nodes[i];
+		glm::mat4 local = glm::mat4_cast(getRotation(node));
+		local[0] *= sclX[node];
+		local[1] *= sclY[node];
+		local[2] *= sclZ[node];
+		local[3] = glm::vec4(posX[node], posY[node], posZ[node], 1.f);
+		NodeID parent = parents[node];
+		worldMatrices[node] = parent==NO_PARENT ? local : worldMatrices[parent] * local;
+	}
+}
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ * Transform hierarchy of the scene.
+ *
+ * Node data is kept in structure-of-arrays form: local translation, rotation
+ * and scale components each live in their own contiguous array, next to the
+ * array of world matrices. A node can only be created as a child of an already
+ * existing node, so nodes are always sorted parent-before-child.
+ *
+ * Changing a node's local transform marks it dirty. update() recomputes world
+ * matrices only for dirty nodes and their descendants, so the cost is
+ * proportional to the number of changed nodes, not to the size of the graph.
+ * Nodes to update are grouped by depth: a node never shares a batch with it's
+ * parent, and each batch of 4 nodes is composed and multiplied with SSE.
+ * Levels with many nodes are split over the job pool (see Jobs.hpp).
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef SCENE_GRAPH_HPP
+#define SCENE_GRAPH_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+class SceneGraph {
+public:
+	typedef uint32_t NodeID;
+	static constexpr NodeID NO_PARENT = UINT32_MAX;
+
+	SceneGraph(size_t reserve = 0);
+
+	// Delete copy and assignment constructors
+	SceneGraph(const SceneGraph &) = delete;
+	SceneGraph & operator=(const SceneGraph &) = delete;
+
+	// Create a node with identity local transform; the parent must already exist
+	NodeID createNode(NodeID parent = NO_PARENT);
+
+	// Local transform setters; each marks the node dirty
+	void setTranslation(NodeID node, const glm::vec3 & translation);
+	void setRotation(NodeID node, const glm::quat & rotation);
+	void setScale(NodeID node, const glm::vec3 & scale);
+
+	glm::vec3 getTranslation(NodeID node) const;
+	glm::quat getRotation(NodeID node) const;
+	glm::vec3 getScale(NodeID node) const;
+	NodeID getParent(NodeID node) const { return parents[node]; }
+
+	// World matrix as of the last update()
+	const glm::mat4 & getWorldMatrix(NodeID node) const { return worldMatrices[node]; }
+
+	// Recompute world matrices of dirty nodes and their subtrees
+	void update();
+
+	size_t size() const { return parents.size(); }
+
+	// Number of world matrices recomputed by the last update()
+	size_t getLastUpdateCount() const { return lastUpdateCount; }
+
+private:
+	// Node update state
+	enum State : uint8_t {
+		Clean,
+		Dirty,
+		Queued
+	};
+
+	// Local TRS, structure of arrays
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> rotX, rotY, rotZ, rotW;
+	std::vector<float> sclX, sclY, sclZ;
+
+	// Hierarchy
+	std::vector<NodeID> parents;
+	std::vector<uint32_t> depths;
+	std::vector<NodeID> firstChild;
+	std::vector<NodeID> nextSibling;
+
+	std::vector<glm::mat4> worldMatrices;
+
+	std::vector<uint8_t> states;
+	// Nodes changed since the last update (their subtrees are implicitly dirty)
+	std::vector<NodeID> dirtyNodes;
+
+	// Scratch space of update(), kept to avoid reallocations
+	std::vector<std::vector<NodeID>> levels;
+	std::vector<NodeID> stack;
+
+	size_t lastUpdateCount = 0;
+
+	void markDirty(NodeID node);
+
+	// Compose local matrices of up to 4 nodes and multiply them by their parents' world matrices
+	void updateBatch(const NodeID * nodes, size_t count);
+};
+
+#endif /* SCENE_GRAPH_HPP */
@@ -1,6 +1,15 @@
 #include "Shader.hpp"
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+#include <cstring>
+
+#include "UniformBlocks.hpp"
+#include "GlslPreprocessor.hpp"
+#include "Lighting.hpp"
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath) : Shader(vertexPath, fragmentPath, {}) {
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> & defines) {
 	if(vertexPath==NULL)
 		throw std::ios_base::failure("vertexPath is NULL\n");
 	if(fragmentPath==NULL)
@@ -8,14 +17,16 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 
 	this->vertexPath = vertexPath;
 	this->fragmentPath = fragmentPath;
+	this->defines = defines;
 
 	// Resource type
 	type = Resource::Type::Shader;
 
-	// Read sources from files
+	// Read sources from files, with includes expanded and defines injected
 	std::string vertexSource;
+	std::vector<std::string> vertexFiles, fragmentFiles;
 	try {
-		utls::readFile(vertexPath, vertexSource);
+		vertexSource = glsl::preprocess(vertexPath, defines, vertexFiles);
 	}
 	catch(const std::ios_base::failure & e) {
 		std::cout << "Caught an std::ios_base::failure\n"
@@ -26,7 +37,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 
 	std::string fragmentSource;
 	try {
-		utls::readFile(fragmentPath, fragmentSource);
+		fragmentSource = glsl::preprocess(fragmentPath, defines, fragmentFiles);
 	}
 	catch(const std::ios_base::failure & e) {
 		std::cout << "Caught an std::ios_base::failure\n"
@@ -36,12 +47,21 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 	}
 
 	// Compile shaders
+	// Messages refer to files by their index in the list printed along
+	auto printFiles = [](const std::vector<std::string> & files) {
+		for(size_t i = 0; i < files.size(); ++i)
+			std::cerr << "  " << i << ": " << files[i] << '\n';
+	};
 	GLuint vertexShader;
-	if(!(vertexShader = buildShader(vertexSource, Type::Vertex)))
+	if(!(vertexShader = buildShader(vertexSource, Type::Vertex))) {
 		std::cerr << "ERROR: (Shader::Shader) Vertex shader " << vertexPath << " compilation failed\n";
+		printFiles(vertexFiles);
+	}
 	GLuint fragmentShader;
-	if(!(fragmentShader = buildShader(fragmentSource, Type::Fragment)))
+	if(!(fragmentShader = buildShader(fragmentSource, Type::Fragment))) {
 		std::cerr << "ERROR: (Shader::Shader) Fragment shader " << fragmentPath << " compilation failed\n";
+		printFiles(fragmentFiles);
+	}
 	assert(((vertexShader!=0) && (fragmentShader!=0)));
 
 	// Create shader program object and link shaders
@@ -58,31 +78,130 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 		glGetProgramInfoLog(ID, 512, NULL, infoLog);
 		std::cerr << "ERROR: (Shader::Shader) Shader program linking failed\n" << infoLog << '\n';
 	}
+	else {
+		ubo::bindProgramBlocks(ID);
+		light::bindProgramSamplers(ID);
+	}
 
 	// Clean created shaders and leave only the shader program
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
 }
 
+Shader::UniformStats Shader::uniformStats;
+
 void Shader::setFloat(const char * uniformName, float value) const {
-	activate();
-	glUniform1f(glGetUniformLocation(ID, uniformName), value);
-	}
+	stage(uniformName, GL_FLOAT, 1, &value, sizeof(value));
+}
 
 void Shader::setInt(const char * uniformName, int value) const {
-	activate();
-	glUniform1i(glGetUniformLocation(ID, uniformName), value);
+	stage(uniformName, GL_INT, 1, &value, sizeof(value));
 }
 
 void Shader::setBool(const char * uniformName, bool value) const {
-	activate();
-	glUniform1i(glGetUniformLocation(ID, uniformName), (int)value);
+	setInt(uniformName, (int)value);
+}
+
+void Shader::setVec2(const char * uniformName, const glm::vec2 & vec) const {
+	stage(uniformName, GL_FLOAT_VEC2, 1, glm::value_ptr(vec), sizeof(vec));
 }
 
-void Shader::setMat4(const char * uniformName, glm::mat4 & mat) const {
+void Shader::setVec3(const char * uniformName, const glm::vec3 & vec) const {
+	stage(uniformName, GL_FLOAT_VEC3, 1, glm::value_ptr(vec), sizeof(vec));
+}
+
+void Shader::setVec4(const char * uniformName, const glm::vec4 & vec) const {
+	stage(uniformName, GL_FLOAT_VEC4, 1, glm::value_ptr(vec), sizeof(vec));
+}
+
+void Shader::setMat4(const char * uniformName, const glm::mat4 & mat) const {
+	stage(uniformName, GL_FLOAT_MAT4, 1, glm::value_ptr(mat), sizeof(mat));
+}
+
+void Shader::setFloatArray(const char * uniformName, const float * values, GLsizei count) const {
+	stage(uniformName, GL_FLOAT, count, values, count * sizeof(float));
+}
+
+void Shader::setVec4Array(const char * uniformName, const glm::vec4 * values, GLsizei count) const {
+	stage(uniformName, GL_FLOAT_VEC4, count, values, count * sizeof(glm::vec4));
+}
+
+void Shader::setMat4Array(const char * uniformName, const glm::mat4 * values, GLsizei count) const {
+	stage(uniformName, GL_FLOAT_MAT4, count, values, count * sizeof(glm::mat4));
+}
+
+void Shader::stage(const char * uniformName, GLenum type, GLsizei count, const void * value, size_t bytes) const {
+	auto it = uniformSlots.find(std::string_view(uniformName));
+	if(it==uniformSlots.end()) {
+		Uniform u{glGetUniformLocation(ID, uniformName), type, count, staged.size(), bytes, false, false};
+		staged.resize(staged.size() + bytes);
+		current.resize(staged.size());
+		uniforms.push_back(u);
+		it = uniformSlots.emplace(uniformName, uniforms.size()-1).first;
+	}
+
+	Uniform & u = uniforms[it->second];
+	if(u.type!=type || u.count!=count) {
+		std::cerr << "ERROR: (Shader::stage) Uniform " << uniformName << " set with another type or count than before\n";
+		return;
+	}
+	// Not used by the program
+	if(u.location < 0)
+		return;
+	if(!u.dirty && u.uploaded && std::memcmp(&current[u.offset], value, bytes)==0) {
+		uniformStats.skipped++;
+		uniformStats.skippedBytes += bytes;
+		return;
+	}
+	std::memcpy(&staged[u.offset], value, bytes);
+	if(!u.dirty) {
+		u.dirty = true;
+		dirty.push_back(it->second);
+	}
+}
+
+void Shader::flush() const {
+	if(dirty.empty())
+		return;
 	activate();
-	glUniformMatrix4fv(glGetUniformLocation(ID, uniformName), 1, GL_FALSE, glm::value_ptr(mat));
-};
+	for(size_t slot : dirty) {
+		Uniform & u = uniforms[slot];
+		u.dirty = false;
+		const unsigned char * value = &staged[u.offset];
+		// Set to something else and back before the draw
+		if(u.uploaded && std::memcmp(&current[u.offset], value, u.bytes)==0) {
+			uniformStats.skipped++;
+			uniformStats.skippedBytes += u.bytes;
+			continue;
+		}
+
+		switch(u.type) {
+		case GL_FLOAT:
+			glUniform1fv(u.location, u.count, reinterpret_cast<const GLfloat *>(value));
+			break;
+		case GL_INT:
+			glUniform1iv(u.location, u.count, reinterpret_cast<const GLint *>(value));
+			break;
+		case GL_FLOAT_VEC2:
+			glUniform2fv(u.location, u.count, reinterpret_cast<const GLfloat *>(value));
+			break;
+		case GL_FLOAT_VEC3:
+			glUniform3fv(u.location, u.count, reinterpret_cast<const GLfloat *>(value));
+			break;
+		case GL_FLOAT_VEC4:
+			glUniform4fv(u.location, u.count, reinterpret_cast<const GLfloat *>(value));
+			break;
+		case GL_FLOAT_MAT4:
+			glUniformMatrix4fv(u.location, u.count, GL_FALSE, reinterpret_cast<const GLfloat *>(value));
+			break;
+		}
+		std::memcpy(&current[u.offset], value, u.bytes);
+		u.uploaded = true;
+		uniformStats.uploads++;
+		uniformStats.uploadedBytes += u.bytes;
+	}
+	dirty.clear();
+}
 
 GLuint Shader::buildShader(std::string source, Type type) {
 	// Create vertex shader object
@@ -127,6 +246,9 @@ void Shader::print(std::ostream & os) const {
 		 << "|OpenGL_ID:" << ID
 		 << "|vert path:" << vertexPath
 		 << "|frag path:" << fragmentPath
-		 << "]";
+		 << "|defines:";
+	for(size_t i = 0; i < defines.size(); ++i)
+		os << (i ? "," : "") << defines[i];
+	os << "]";
 }
 
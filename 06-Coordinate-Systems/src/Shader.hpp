@@ -9,7 +9,11 @@
  * The class allows to:
  * - create a shader program
  * - use a shader program
- * - set uniforms inside shaders
+ * - set uniforms inside shaders: setters only stage values in a CPU copy,
+ *   flush() (right before a draw) uploads those that differ from what the
+ *   program already holds; arrays go up in one call
+ * - use shared uniform blocks: blocks known by name (see UniformBlocks.hpp)
+ *   are bound to their fixed binding points when the program is linked
  *
  * 2022
  * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
@@ -22,6 +26,9 @@
 #include <iostream>
 #include <cassert>
 #include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <string_view>
 
 #include <glad/glad.h>
 
@@ -39,6 +46,9 @@ public:
 	// .vert for a vertex shader
 	// .frag for a fragment shader
 	Shader(const char* vertexPath, const char* fragmentPath);
+	// Sources are preprocessed (see GlslPreprocessor.hpp): includes expanded and the defines
+	// ("NAME" or "NAME value") injected after #version
+	Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> & defines);
 
 	// Delete copy and assignment constructors
 	Shader(const Shader &) = delete;
@@ -47,11 +57,40 @@ public:
 	// Activate this Shader
 	void activate() const { glUseProgram(ID); }
 
-	// Setters for uniforms in shaders
+	// Setters for uniforms in shaders (staged until flush())
 	void setFloat(const char * uniformName, float value) const;
 	void setInt(const char * uniformName, int value) const;
 	void setBool(const char * uniformName, bool value) const;
-	void setMat4(const char * uniformName, glm::mat4 & mat) const;
+	void setVec2(const char * uniformName, const glm::vec2 & vec) const;
+	void setVec3(const char * uniformName, const glm::vec3 & vec) const;
+	void setVec4(const char * uniformName, const glm::vec4 & vec) const;
+	void setMat4(const char * uniformName, const glm::mat4 & mat) const;
+	// Whole uniform arrays, e.g. `uniform mat4 bones[32]` (count may be less than declared)
+	void setFloatArray(const char * uniformName, const float * values, GLsizei count) const;
+	void setVec4Array(const char * uniformName, const glm::vec4 * values, GLsizei count) const;
+	void setMat4Array(const char * uniformName, const glm::mat4 * values, GLsizei count) const;
+
+	// Upload staged uniforms that changed (activates the program if there are any)
+	void flush() const;
+
+	// Uniform traffic of all programs since the last reset (e.g. per frame)
+	struct UniformStats {
+		size_t uploads = 0;
+		size_t uploadedBytes = 0;
+		size_t skipped = 0;
+		size_t skippedBytes = 0;
+
+		friend std::ostream & operator<<(std::ostream & os, const UniformStats & s) {
+			os << "[uniforms|uploads:" << s.uploads
+				 << "|uploadedBytes:" << s.uploadedBytes
+				 << "|skipped:" << s.skipped
+				 << "|skippedBytes:" << s.skippedBytes
+				 << "]";
+			return os;
+		}
+	};
+	static const UniformStats & getUniformStats() { return uniformStats; }
+	static void resetUniformStats() { uniformStats = UniformStats(); }
 
 	// Get OpenGL specific ID of this type of resource
 	GLuint getGLID() const { return ID; };
@@ -69,6 +108,32 @@ private:
 	// Shader info
 	std::string vertexPath;
 	std::string fragmentPath;
+	std::vector<std::string> defines;
+
+	// Staged uniform: values live at offset in `staged`, and in `current` once uploaded
+	struct Uniform {
+		GLint location;
+		GLenum type;
+		GLsizei count;
+		size_t offset;
+		size_t bytes;
+		bool dirty;
+		bool uploaded;
+	};
+	// Lookup by name without building a std::string
+	struct NameHash {
+		using is_transparent = void;
+		size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+	};
+	mutable std::unordered_map<std::string, size_t, NameHash, std::equal_to<>> uniformSlots;
+	mutable std::vector<Uniform> uniforms;
+	mutable std::vector<unsigned char> staged;
+	mutable std::vector<unsigned char> current;
+	mutable std::vector<size_t> dirty;
+	static UniformStats uniformStats;
+
+	// Copy a value into the staging area, marking it dirty unless the program already holds it
+	void stage(const char * uniformName, GLenum type, GLsizei count, const void * value, size_t bytes) const;
 
 	// Create and complie a shader
 	GLuint buildShader(std::string source, Type type);
@@ -0,0 +1,33 @@
+#include "ShaderVariants.hpp"
+
+#include <stdexcept>
+
+#include "Shader.hpp"
+
+ShaderVariants::ShaderVariants(ResourceManager & resMan, std::string vertexPath, std::string fragmentPath,
+															 std::vector<std::string> features, std::vector<std::string> constants) :
+	resMan(resMan),
+	vertexPath(std::move(vertexPath)),
+	fragmentPath(std::move(fragmentPath)),
+	features(std::move(features)),
+	constants(std::move(constants)) {
+	if(this->features.size() > 32)
+		throw std::runtime_error("ShaderVariants: more than 32 features\n");
+}
+
+u64 ShaderVariants::get(uint32_t mask) {
+	auto it = variants.find(mask);
+	if(it!=variants.end())
+		return it->second;
+
+	std::vector<std::string> defines = constants;
+	for(size_t bit = 0; bit < features.size(); ++bit)
+		if(mask & (1u << bit))
+			defines.push_back(features[bit]);
+	if(features.size() < 32 && (mask >> features.size()))
+		std::cerr << "ERROR: (ShaderVariants::get) Mask " << mask << " has bits without a feature\n";
+
+	u64 resID = resMan.insert(new Shader(vertexPath.c_str(), fragmentPath.c_str(), defines));
+	variants.emplace(mask, resID);
+	return resID;
+}
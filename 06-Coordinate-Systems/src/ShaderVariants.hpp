@@ -0,0 +1,54 @@
+/*
+ * Permutations of one vertex/fragment shader pair.
+ *
+ * The sources toggle optional parts with #ifdef on feature names. A variant
+ * is selected with a bitmask: bit i set means feature i is defined. Values
+ * that never change while the program runs (e.g. a blend factor) are passed
+ * as constants, "NAME value", defined in every variant - so they are literals
+ * to the compiler instead of uniforms.
+ *
+ * Variants are only compiled when first requested and are then kept by
+ * their mask: every permutation is compiled at most once. Compiled programs
+ * are Shader resources in the ResourceManager.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef SHADER_VARIANTS_HPP
+#define SHADER_VARIANTS_HPP
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "Resource.hpp"
+#include "ResourceManager.hpp"
+
+class ShaderVariants {
+public:
+	// Up to 32 feature names, bit i of a mask stands for features[i]
+	ShaderVariants(ResourceManager & resMan, std::string vertexPath, std::string fragmentPath,
+								 std::vector<std::string> features, std::vector<std::string> constants = {});
+
+	// Delete copy and assignment constructors
+	ShaderVariants(const ShaderVariants &) = delete;
+	ShaderVariants & operator=(const ShaderVariants &) = delete;
+
+	// resID of the Shader with the masked features, compiled on the first request
+	u64 get(uint32_t features);
+
+	// Number of variants compiled so far
+	size_t size() const { return variants.size(); }
+
+private:
+	ResourceManager & resMan;
+	std::string vertexPath;
+	std::string fragmentPath;
+	std::vector<std::string> features;
+	std::vector<std::string> constants;
+	std::unordered_map<uint32_t, u64> variants;
+};
+
+#endif /* SHADER_VARIANTS_HPP */
@@ -0,0 +1,83 @@
+/*
+ * Spatial index of scene objects, answering frustum, ray and region queries.
+ *
+ * Static content (most of a large scene) goes into a BVH built once with SAH
+ * and refitted if it's objects move slightly. Moving objects go into a
+ * DynamicAABBTree which is updated incrementally. Queries search both and
+ * report user object IDs.
+ *
+ * For now only the benchmarks (bench::spatialIndex) use it. The renderer
+ * still culls the ECS' world bounds with the SIMD pass of Culling.hpp
+ * (RenderQueue::build), whose candidates are indexed in chunk order and
+ * rebuilt every frame, and nothing in the scene makes ray or region queries.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <vector>
+#include <cstdint>
+
+#include "AABB.hpp"
+#include "Frustum.hpp"
+#include "BVH.hpp"
+#include "DynamicAABBTree.hpp"
+
+class SpatialIndex {
+public:
+	SpatialIndex(float dynamicMargin = .1f) : dynamicObjects(dynamicMargin) {}
+
+	// Delete copy and assignment constructors
+	SpatialIndex(const SpatialIndex &) = delete;
+	SpatialIndex & operator=(const SpatialIndex &) = delete;
+
+	// Static objects: (re)build all at once; objects[i] is the ID of boxes[i]
+	void buildStatic(const std::vector<AABB> & boxes, const std::vector<uint32_t> & objects) {
+		staticObjects.build(boxes, objects);
+	}
+
+	// Slightly changed static object (index as passed to buildStatic); refitStatic() afterwards
+	void updateStatic(size_t index, const AABB & box) { staticObjects.setBox(index, box); }
+	void refitStatic() { staticObjects.refit(); }
+
+	// Moving objects
+	DynamicAABBTree::ProxyID insertDynamic(uint32_t object, const AABB & box) { return dynamicObjects.insert(object, box); }
+	bool moveDynamic(DynamicAABBTree::ProxyID proxy, const AABB & box, const glm::vec3 & displacement = glm::vec3(0.f)) {
+		return dynamicObjects.move(proxy, box, displacement);
+	}
+	void removeDynamic(DynamicAABBTree::ProxyID proxy) { dynamicObjects.remove(proxy); }
+
+	// Append IDs of objects intersecting the frustum / the region
+	void queryFrustum(const Frustum & frustum, std::vector<uint32_t> & objects) const {
+		staticObjects.queryFrustum(frustum, objects);
+		dynamicObjects.queryFrustum(frustum, objects);
+	}
+	void queryRegion(const AABB & region, std::vector<uint32_t> & objects) const {
+		staticObjects.queryRegion(region, objects);
+		dynamicObjects.queryRegion(region, objects);
+	}
+
+	// Closest object hit by the ray within maxT
+	bool raycast(const Ray & ray, float maxT, RayHit & hit) const {
+		RayHit staticHit, dynamicHit;
+		bool hitStatic = staticObjects.raycast(ray, maxT, staticHit);
+		bool hitDynamic = dynamicObjects.raycast(ray, hitStatic ? staticHit.t : maxT, dynamicHit);
+		if(hitDynamic)
+			hit = dynamicHit;
+		else if(hitStatic)
+			hit = staticHit;
+		return hitStatic || hitDynamic;
+	}
+
+	const BVH & getStatic() const { return staticObjects; }
+	const DynamicAABBTree & getDynamic() const { return dynamicObjects; }
+
+private:
+	BVH staticObjects;
+	DynamicAABBTree dynamicObjects;
+};
+
+#endif /* SPATIAL_INDEX_HPP */
@@ -0,0 +1,152 @@
+#include "StaticGeometry.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Material.hpp"
+#include "UniformBlocks.hpp"
+
+StaticGeometry::StaticGeometry(GeometryPool & pool) : pool(pool) {
+}
+
+void StaticGeometry::add(u64 material, std::vector<GeometryPool::Vertex> vertices, std::vector<uint32_t> indices,
+												 const glm::mat4 & transform) {
+	indices.resize(indices.size() / 3 * 3);
+	for(uint32_t i : indices)
+		if(i >= vertices.size()) {
+			std::cerr << "ERROR: (StaticGeometry::add) Vertex index out of range, object skipped\n";
+			return;
+		}
+	if(indices.empty())
+		return;
+	pending.push_back(Pending{material, std::move(vertices), std::move(indices), transform});
+}
+
+void StaticGeometry::build() {
+	if(pending.empty())
+		return;
+	std::stable_sort(pending.begin(), pending.end(), [](const Pending & a, const Pending & b) {
+		return a.material < b.material;
+	});
+
+	std::vector<GeometryPool::Vertex> vertices;
+	std::vector<uint32_t> indices;
+	for(size_t first = 0; first < pending.size();) {
+		size_t last = first;
+		while(last < pending.size() && pending[last].material==pending[first].material)
+			++last;
+
+		// Bake transforms and rebase indices to the start of the group
+		Batch batch{pending[first].material, {}, (uint32_t)objects.size(), (uint32_t)(last - first)};
+		vertices.clear();
+		indices.clear();
+		std::vector<Range> local;
+		for(size_t o = first; o < last; ++o) {
+			const Pending & p = pending[o];
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(p.transform)));
+			uint32_t base = (uint32_t)vertices.size();
+			glm::vec3 lo(INFINITY), hi(-INFINITY);
+			for(GeometryPool::Vertex v : p.vertices) {
+				v.position = glm::vec3(p.transform * glm::vec4(v.position, 1.f));
+				glm::vec3 n = normalMatrix * v.normal;
+				float length = glm::length(n);
+				v.normal = length > 0.f ? n / length : n;
+				lo = glm::min(lo, v.position);
+				hi = glm::max(hi, v.position);
+				vertices.push_back(v);
+			}
+			local.push_back(Range{(uint32_t)indices.size(), (uint32_t)p.indices.size()});
+			for(uint32_t i : p.indices)
+				indices.push_back(base + i);
+			bounds.push(lo, hi);
+		}
+
+		batch.allocation = pool.allocate((uint32_t)vertices.size(), (uint32_t)indices.size());
+		pool.upload(batch.allocation, vertices.data(), indices.data());
+		for(const Range & r : local)
+			objects.push_back(Range{batch.allocation.firstIndex + r.firstIndex, r.count});
+		batches.push_back(batch);
+		first = last;
+	}
+	pending.clear();
+	pending.shrink_to_fit();
+	stats.objects = objects.size();
+}
+
+std::vector<u64> StaticGeometry::getMaterials() const {
+	// Batches of one build() have distinct materials, but later builds may repeat them
+	std::vector<u64> materials;
+	for(const Batch & batch : batches)
+		if(std::find(materials.begin(), materials.end(), batch.material)==materials.end())
+			materials.push_back(batch.material);
+	return materials;
+}
+
+size_t StaticGeometry::gatherRanges(const Range * ranges, const uint32_t * listed, size_t n,
+																		std::vector<GLsizei> & counts, std::vector<const void *> & offsets) {
+	size_t appended = 0;
+	for(size_t k = 0; k < n;) {
+		const Range & first = ranges[listed[k]];
+		uint32_t end = first.firstIndex + first.count;
+		for(++k; k < n && ranges[listed[k]].firstIndex==end; ++k)
+			end += ranges[listed[k]].count;
+		counts.push_back((GLsizei)(end - first.firstIndex));
+		offsets.push_back((const void *)((size_t)first.firstIndex * sizeof(uint32_t)));
+		++appended;
+	}
+	return appended;
+}
+
+void StaticGeometry::draw(ResourceManager & resMan, const Shader & shader, StreamBuffer & uniforms,
+													const glm::mat4 & viewProjection, unsigned numThreads) {
+	stats.visible = stats.drawCalls = stats.ranges = stats.triangles = 0;
+	if(objects.empty())
+		return;
+
+	cull::Stats cullStats = cull::frustumAABBs(Frustum::fromMatrix(viewProjection), bounds, visible, numThreads);
+	stats.visible = cullStats.visible;
+	stats.cullMs = cullStats.ms;
+	if(visible.empty())
+		return;
+
+	// Vertices are already in world space
+	if(!ubo::bind(uniforms, ubo::DrawBinding, ubo::Draw{glm::mat4(1.f)}))
+		return;
+	Material * previous = nullptr;
+
+	// `visible` is ascending and objects are ordered by batch: walk both together
+	uint32_t boundPage = UINT32_MAX;
+	size_t v = 0;
+	for(const Batch & batch : batches) {
+		uint32_t end = batch.firstObject + batch.numObjects;
+		listed.clear();
+		for(; v < visible.size() && visible[v] < end; ++v)
+			listed.push_back(visible[v]);
+		if(listed.empty())
+			continue;
+
+		counts.clear();
+		offsets.clear();
+		size_t n = gatherRanges(objects.data(), listed.data(), listed.size(), counts, offsets);
+		baseVertices.assign(n, (GLint)batch.allocation.baseVertex);
+
+		auto material = std::static_pointer_cast<Material>(resMan.find(batch.material));
+		Material & current = material ? *material : Material::fallback();
+		const Shader & program = current.bind(resMan, shader, previous);
+		previous = &current;
+		if(batch.allocation.page!=boundPage) {
+			pool.bind(batch.allocation.page);
+			boundPage = batch.allocation.page;
+		}
+		program.flush();
+		GeometryPool::multiDraw(counts, offsets, baseVertices);
+
+		stats.drawCalls++;
+		stats.ranges += n;
+		for(GLsizei c : counts)
+			stats.triangles += c / 3;
+	}
+	glBindVertexArray(0);
+	// Single-sided materials leave face culling on
+	glDisable(GL_CULL_FACE);
+}
@@ -0,0 +1,128 @@
+/*
+ * Static scenery merged at load time and drawn with few multi-draw calls.
+ *
+ * Objects that never move are added with their world transform, which is
+ * baked into their vertices. build() then groups them by material and puts
+ * every group into one GeometryPool allocation, with indices rebased to the
+ * group's first vertex. So a whole material group shares a baseVertex and
+ * it's objects are contiguous index ranges in the page's element buffer.
+ *
+ * Per frame every object is frustum culled on it's own (world bounds as SoA,
+ * see Culling.hpp). For each material the material is bound once and the
+ * visible ranges, with neighbours merged, go into one
+ * glMultiDrawElementsBaseVertex. OpenGL 3.3 has no gl_DrawID, so a multi-draw
+ * can't fetch per-draw data - that's why the transforms are pre-applied and
+ * batches are split by material rather than sharing one call.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef STATIC_GEOMETRY_HPP
+#define STATIC_GEOMETRY_HPP
+
+#include <vector>
+#include <cstdint>
+#include <iostream>
+
+#include <glm/glm.hpp>
+
+#include "Resource.hpp"
+#include "ResourceManager.hpp"
+#include "Shader.hpp"
+#include "Frustum.hpp"
+#include "Culling.hpp"
+#include "GeometryPool.hpp"
+#include "StreamBuffer.hpp"
+
+class StaticGeometry {
+public:
+	// Index range of an object in it's page's element buffer
+	struct Range {
+		uint32_t firstIndex;
+		uint32_t count;
+	};
+
+	struct Stats {
+		size_t objects = 0;
+		size_t visible = 0;
+		// Multi-draw calls and the index ranges they were given
+		size_t drawCalls = 0;
+		size_t ranges = 0;
+		size_t triangles = 0;
+		double cullMs = 0.;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[static|objects:" << s.objects
+				 << "|visible:" << s.visible
+				 << "|drawCalls:" << s.drawCalls
+				 << "|ranges:" << s.ranges
+				 << "|triangles:" << s.triangles
+				 << "|cullMs:" << s.cullMs
+				 << "]";
+			return os;
+		}
+	};
+
+	explicit StaticGeometry(GeometryPool & pool);
+
+	// Delete copy and assignment constructors
+	StaticGeometry(const StaticGeometry &) = delete;
+	StaticGeometry & operator=(const StaticGeometry &) = delete;
+
+	// Queue a triangle list (indices relative to it's vertices) placed in the world by transform
+	void add(u64 material, std::vector<GeometryPool::Vertex> vertices, std::vector<uint32_t> indices,
+					 const glm::mat4 & transform = glm::mat4(1.f));
+
+	// Merge the queued objects by material and upload them to the pool;
+	// objects added later are merged by the next build() into new allocations
+	void build();
+
+	// Draw objects visible in the frustum of viewProjection with their materials' shaders
+	// (`shader` for materials without one, see Material.hpp); an identity Draw block is written into `uniforms`
+	void draw(ResourceManager & resMan, const Shader & shader, StreamBuffer & uniforms, const glm::mat4 & viewProjection,
+						unsigned numThreads = 1);
+
+	size_t size() const { return objects.size(); }
+	// Materials of the built batches, one entry each
+	std::vector<u64> getMaterials() const;
+	const Stats & getStats() const { return stats; }
+
+	// Turn the listed ranges (ascending, of one page) into multi-draw arguments, merging
+	// ranges that continue each other; returns the number of entries appended
+	static size_t gatherRanges(const Range * ranges, const uint32_t * listed, size_t n,
+														 std::vector<GLsizei> & counts, std::vector<const void *> & offsets);
+
+private:
+	struct Pending {
+		u64 material;
+		std::vector<GeometryPool::Vertex> vertices;
+		std::vector<uint32_t> indices;
+		glm::mat4 transform;
+	};
+
+	// Objects of one material in one allocation
+	struct Batch {
+		u64 material;
+		GeometryPool::Allocation allocation;
+		uint32_t firstObject;
+		uint32_t numObjects;
+	};
+
+	GeometryPool & pool;
+	std::vector<Pending> pending;
+	std::vector<Batch> batches;
+	// Ordered by batch
+	std::vector<Range> objects;
+	cull::AABBArray bounds;
+	Stats stats;
+
+	// Scratch space of draw()
+	std::vector<uint32_t> visible;
+	std::vector<uint32_t> listed;
+	std::vector<GLsizei> counts;
+	std::vector<const void *> offsets;
+	std::vector<GLint> baseVertices;
+};
+
+#endif /* STATIC_GEOMETRY_HPP */
@@ -0,0 +1,133 @@
+#include "StreamBuffer.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+StreamBuffer::StreamBuffer(GLsizeiptr capacity, unsigned framesInFlight) :
+	capacity(capacity),
+	framesInFlight(std::max(1u, framesInFlight)) {
+	GLint uboAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+	if(uboAlignment > 0)
+		alignment = uboAlignment;
+	create();
+}
+
+StreamBuffer::~StreamBuffer() {
+	unmap();
+	// GL keeps the buffer alive for queued draws still reading it, no need to wait for them
+	for(const Frame & frame : frames)
+		glDeleteSync(frame.fence);
+	if(buffer)
+		glDeleteBuffers(1, &buffer);
+}
+
+void StreamBuffer::create() {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamBuffer::beginFrame() {
+	stats = Stats();
+	while(frames.size() >= framesInFlight)
+		retireOldest();
+	frameBegin = head;
+	frameWrapped = false;
+}
+
+bool StreamBuffer::overlaps(const Frame & frame, GLintptr begin, GLintptr end) const {
+	if(frame.wrapped)
+		return end > frame.begin || begin < frame.end;
+	return frame.begin < frame.end && begin < frame.end && frame.begin < end;
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(GLsizeiptr size, GLsizeiptr align) {
+	if(align <= 0)
+		align = alignment;
+	if(size <= 0 || size > capacity) {
+		std::cerr << "ERROR: (StreamBuffer::allocate) " << size << " bytes don't fit a buffer of " << capacity << '\n';
+		return Allocation();
+	}
+	unmap();
+
+	GLintptr offset = (head + align-1) / align * align;
+	bool wrap = offset + size > capacity;
+	if(wrap)
+		offset = 0;
+	// Never overwrite earlier allocations of this frame
+	Frame current{nullptr, frameBegin, head, frameWrapped};
+	if((wrap && frameWrapped) || overlaps(current, offset, offset + size)) {
+		std::cerr << "ERROR: (StreamBuffer::allocate) The frame needs more than " << capacity << " bytes\n";
+		return Allocation();
+	}
+	if(wrap) {
+		frameWrapped = true;
+		stats.wraps++;
+	}
+	while(std::any_of(frames.begin(), frames.end(), [&](const Frame & f) { return overlaps(f, offset, offset + size); }))
+		retireOldest();
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	void * ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, size,
+																GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	if(!ptr) {
+		std::cerr << "ERROR: (StreamBuffer::allocate) Mapping failed\n";
+		return Allocation();
+	}
+	mapped = true;
+	head = offset + size;
+	stats.allocations++;
+	stats.bytes += size;
+	return Allocation{buffer, offset, size, ptr};
+}
+
+void StreamBuffer::unmap() {
+	if(!mapped)
+		return;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	mapped = false;
+}
+
+void StreamBuffer::endFrame() {
+	unmap();
+	// Frames without allocations are fenced too, they still count as in flight
+	frames.push_back(Frame{glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), frameBegin, head, frameWrapped});
+	frameBegin = head;
+	frameWrapped = false;
+}
+
+void StreamBuffer::retireOldest() {
+	GLsync fence = frames.front().fence;
+	frames.pop_front();
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if(result==GL_TIMEOUT_EXPIRED) {
+		auto start = std::chrono::steady_clock::now();
+		// The first wait flushes, so the fence is sure to reach the GPU
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do {
+			result = glClientWaitSync(fence, flags, 1000000);
+			flags = 0;
+		} while(result==GL_TIMEOUT_EXPIRED);
+		stats.waits++;
+		stats.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	if(result==GL_WAIT_FAILED)
+		std::cerr << "ERROR: (StreamBuffer::retireOldest) Waiting for a fence failed\n";
+	glDeleteSync(fence);
+}
+
+void StreamBuffer::resize(GLsizeiptr newCapacity) {
+	unmap();
+	while(!frames.empty())
+		retireOldest();
+	glDeleteBuffers(1, &buffer);
+	capacity = newCapacity;
+	create();
+	head = frameBegin = 0;
+	frameWrapped = false;
+}
@@ -0,0 +1,119 @@
+/*
+ * Ring buffer for data written by the CPU every frame (streamed indices,
+ * dynamic vertices, per-draw uniforms).
+ *
+ * One big GL buffer is handed out front to back in sub-allocations aligned
+ * to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT (so any of them can back a uniform
+ * block), wrapping around at the end. A sub-allocation is mapped with
+ * GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT: the driver neither
+ * waits for the GPU nor copies old contents. Safety comes from fences
+ * instead - endFrame() puts a fence after the frame's draws, and space used
+ * by a frame is only reused once it's fence has signaled. Up to
+ * framesInFlight frames may be queued before beginFrame() waits.
+ *
+ * Usage per frame:
+ *   beginFrame(); a = allocate(n); write to a.ptr; unmap(); draw from
+ *   (a.buffer, a.offset) ...; endFrame();
+ * Only one range of a buffer can be mapped at a time, so the pointer is valid
+ * until the next allocate() or unmap(), and unmap() must be called before the
+ * data is used by GL.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef STREAM_BUFFER_HPP
+#define STREAM_BUFFER_HPP
+
+#include <deque>
+#include <iostream>
+
+#include <glad/glad.h>
+
+class StreamBuffer {
+public:
+	struct Allocation {
+		GLuint buffer = 0;
+		GLintptr offset = 0;
+		GLsizeiptr size = 0;
+		// Mapped memory for CPU writes, null if the allocation failed
+		void * ptr = nullptr;
+	};
+
+	// Counters of the current (or last finished) frame
+	struct Stats {
+		size_t allocations = 0;
+		size_t bytes = 0;
+		size_t wraps = 0;
+		// Fence waits that had to block, and the time spent in them
+		size_t waits = 0;
+		double waitMs = 0.;
+
+		friend std::ostream & operator<<(std::ostream & os, const Stats & s) {
+			os << "[stream|allocations:" << s.allocations
+				 << "|bytes:" << s.bytes
+				 << "|wraps:" << s.wraps
+				 << "|waits:" << s.waits
+				 << "|waitMs:" << s.waitMs
+				 << "]";
+			return os;
+		}
+	};
+
+	explicit StreamBuffer(GLsizeiptr capacity = 16 << 20, unsigned framesInFlight = 3);
+	~StreamBuffer();
+
+	// Delete copy and assignment constructors
+	StreamBuffer(const StreamBuffer &) = delete;
+	StreamBuffer & operator=(const StreamBuffer &) = delete;
+
+	// Start a frame; waits when framesInFlight frames are still queued on the GPU
+	void beginFrame();
+
+	// Reserve and map size bytes; alignment 0 means the uniform buffer offset alignment.
+	// Waits for old frames still using the space. Fails (null ptr) when size exceeds the capacity
+	// or the current frame already holds the space needed.
+	Allocation allocate(GLsizeiptr size, GLsizeiptr alignment = 0);
+
+	// Finish CPU writes of the last allocation
+	void unmap();
+
+	// Fence the frame's draws (call after the last draw reading the frame's data)
+	void endFrame();
+
+	// Wait for all frames, then replace the buffer by one of the new capacity
+	void resize(GLsizeiptr capacity);
+
+	GLuint getBuffer() const { return buffer; }
+	GLsizeiptr getCapacity() const { return capacity; }
+	GLsizeiptr getAlignment() const { return alignment; }
+	const Stats & getStats() const { return stats; }
+
+private:
+	// Space used by a queued frame: [begin, end), or [begin, capacity) and [0, end) when it wrapped
+	struct Frame {
+		GLsync fence;
+		GLintptr begin;
+		GLintptr end;
+		bool wrapped;
+	};
+
+	GLuint buffer = 0;
+	GLsizeiptr capacity;
+	GLsizeiptr alignment = 256;
+	unsigned framesInFlight;
+	GLintptr head = 0;
+	GLintptr frameBegin = 0;
+	bool frameWrapped = false;
+	bool mapped = false;
+	std::deque<Frame> frames;
+	Stats stats;
+
+	void create();
+	// Block until the oldest queued frame is done and drop it
+	void retireOldest();
+	// True if the queued frame's space overlaps [begin, end)
+	bool overlaps(const Frame & frame, GLintptr begin, GLintptr end) const;
+};
+
+#endif /* STREAM_BUFFER_HPP */
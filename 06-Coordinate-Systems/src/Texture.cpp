@@ -5,19 +5,100 @@
 
 std::atomic<bool> Texture::imageFlipped(false);
 
+Texture::Image::Image(Image && other) :
+	data(other.data), width(other.width), height(other.height),
+	numberOfChannels(other.numberOfChannels), path(std::move(other.path)) {
+	other.data = nullptr;
+}
+
+Texture::Image & Texture::Image::operator=(Image && other) {
+	if(this!=&other) {
+		if(data)
+			stbi_image_free(data);
+		data = other.data;
+		width = other.width;
+		height = other.height;
+		numberOfChannels = other.numberOfChannels;
+		path = std::move(other.path);
+		other.data = nullptr;
+	}
+	return *this;
+}
+
+Texture::Image::~Image() {
+	if(data)
+		stbi_image_free(data);
+}
+
+Texture::Image Texture::decode(const char * path, bool flipVertically) {
+	setupImageLoader();
+	Image image;
+	image.path = path;
+	// The flip override is thread local, so restore it right away
+	stbi_set_flip_vertically_on_load_thread(flipVertically);
+	image.data = stbi_load(path, &image.width, &image.height, &image.numberOfChannels, 0);
+	stbi_set_flip_vertically_on_load_thread(true);
+	return image;
+}
+
+Texture::Image Texture::decode(const unsigned char * encoded, size_t size, bool flipVertically) {
+	setupImageLoader();
+	Image image;
+	image.path = "<memory>";
+	// The flip override is thread local, so restore it right away
+	stbi_set_flip_vertically_on_load_thread(flipVertically);
+	image.data = stbi_load_from_memory(encoded, (int)size, &image.width, &image.height, &image.numberOfChannels, 0);
+	stbi_set_flip_vertically_on_load_thread(true);
+	return image;
+}
+
 Texture::Texture(const char * path, GLenum target) : target(target) {
 	if(path==NULL)
 		throw std::ios_base::failure("Texture path is NULL\n");
-	texturePath = path;
 
-	// One time switch for STBI settings, change in future if needed
-	bool expected = false;
-	if(imageFlipped.compare_exchange_strong(expected, true))
-		stbi_set_flip_vertically_on_load(true);
+	// Resource type
+	type = Resource::Type::Texture;
+
+	// Load an image/texture
+	Image image = decode(path);
+	if(image.data==NULL)
+		throw std::runtime_error("Couldn't load image\n");
+
+	upload(image);
+}
+
+Texture::Texture(const unsigned char * encoded, size_t size, GLenum target, bool flipVertically) :
+	target(target) {
+	if(encoded==NULL)
+		throw std::runtime_error("Texture data is NULL\n");
 
 	// Resource type
 	type = Resource::Type::Texture;
 
+	// Decode an image/texture
+	Image image = decode(encoded, size, flipVertically);
+	if(image.data==NULL)
+		throw std::runtime_error("Couldn't decode image\n");
+
+	upload(image);
+}
+
+Texture::Texture(Image & image, GLenum target) : target(target) {
+	if(image.data==NULL)
+		throw std::runtime_error("Texture image is empty\n");
+
+	// Resource type
+	type = Resource::Type::Texture;
+
+	upload(image);
+}
+
+void Texture::upload(Image & image) {
+	texturePath = image.path;
+	width = image.width;
+	height = image.height;
+	numberOfChannels = image.numberOfChannels;
+
 	// Generate a texture object and set the parameters
 	glGenTextures(1, &ID);
 	activate();
@@ -27,21 +108,38 @@ Texture::Texture(const char * path, GLenum target) : target(target) {
 	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-	// Load an image/texture
-	unsigned char * data = stbi_load(path, &width, &height, &numberOfChannels, 0);
-	if(data==NULL)
-		throw std::runtime_error("Couldn't load image\n");
-
-	// Generate texture
-	GLenum format = (numberOfChannels==4 ? GL_RGBA : GL_RGB);
-	glTexImage2D(target, 0, GL_RGB, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+	// Generate texture; images of any channel count keep all of them (alpha included)
+	GLenum format, internalFormat;
+	switch(numberOfChannels) {
+	case 1: format = GL_RED; internalFormat = GL_R8; break;
+	case 2: format = GL_RG; internalFormat = GL_RG8; break;
+	case 3: format = GL_RGB; internalFormat = GL_RGB8; break;
+	default: format = GL_RGBA; internalFormat = GL_RGBA8; break;
+	}
+	// Grey (and grey with alpha) images read as grey, not red
+	if(numberOfChannels==1 || numberOfChannels==2) {
+		GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, numberOfChannels==2 ? GL_GREEN : GL_ONE};
+		glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+	}
+	// Rows are tightly packed, whatever the width
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(target, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, image.data);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 	glGenerateMipmap(target);
 
 	// Cleanup
-	stbi_image_free(data);
+	stbi_image_free(image.data);
+	image.data = nullptr;
 	glBindTexture(target, 0);
 }
 
+void Texture::setupImageLoader() {
+	// One time switch for STBI settings, change in future if needed
+	bool expected = false;
+	if(imageFlipped.compare_exchange_strong(expected, true))
+		stbi_set_flip_vertically_on_load(true);
+}
+
 void Texture::print(std::ostream & os) const {
 	os << "[type:Texture"
 		 << "|resID:" << resID
@@ -54,4 +152,3 @@ void Texture::print(std::ostream & os) const {
 		 << "|path:" << texturePath
 		 << "]";
 }
-
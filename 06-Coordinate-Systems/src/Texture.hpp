@@ -10,6 +10,10 @@
  * 4) Generate the texture and mipmaps
  * 5) Free unused data from the memory
  *
+ * Steps 3) and 5) need no OpenGL context: an Image can be decoded on any
+ * thread (e.g. jobs decoding all textures of a model at once) and handed to
+ * the Texture constructor on the GL thread, which does the rest.
+ *
  * Note that currently only 2D textures are supported. If 3D texture used,
  * behavior of the class is not defined.
  *
@@ -31,8 +35,33 @@
 
 class Texture: public Resource {
 public:
+	// Decoded pixels, freed with the Image unless a Texture took them
+	struct Image {
+		unsigned char * data = nullptr;
+		int width = 0;
+		int height = 0;
+		int numberOfChannels = 0;
+		std::string path;
+
+		Image() = default;
+		Image(Image && other);
+		Image & operator=(Image && other);
+		~Image();
+	};
+
+	// Decode an image file or an image held in memory, thread safe; data is null on failure
+	static Image decode(const char * path, bool flipVertically = true);
+	static Image decode(const unsigned char * encoded, size_t size, bool flipVertically = true);
+
 	Texture(const char * path, GLenum target);
 
+	// Decode an image already held in memory (e.g. embedded in a glTF binary chunk).
+	// glTF puts the UV origin in the top left corner, so it's images must not be flipped.
+	Texture(const unsigned char * encoded, size_t size, GLenum target, bool flipVertically = true);
+
+	// Upload an already decoded image (takes it's pixels)
+	Texture(Image & image, GLenum target);
+
 	// Delete copy and assignment constructors
 	Texture(const Texture &) = delete;
 	Texture & operator=(const Texture &) = delete;
@@ -60,6 +89,10 @@ private:
 
 	// STBI imagage global settings
 	static std::atomic<bool> imageFlipped;
+	static void setupImageLoader();
+
+	// Generate the GL texture object from decoded pixels and free them
+	void upload(Image & image);
 
 	// Elevate this Texture if not active. Thread safe.
 	void elevate();
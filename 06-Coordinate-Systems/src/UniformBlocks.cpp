@@ -0,0 +1,28 @@
+#include "UniformBlocks.hpp"
+
+#include <iostream>
+
+const std::array<ubo::BlockInfo, 4> & ubo::blocks() {
+	static const std::array<BlockInfo, 4> known = {{
+		{"Camera", CameraBinding, sizeof(Camera)},
+		{"Draw", DrawBinding, sizeof(Draw)},
+		{"Material", MaterialBinding, sizeof(MaterialBlock)},
+		{"Lights", LightsBinding, sizeof(Lights)},
+	}};
+	return known;
+}
+
+void ubo::bindProgramBlocks(GLuint program) {
+	for(const BlockInfo & block : blocks()) {
+		GLuint index = glGetUniformBlockIndex(program, block.name);
+		if(index==GL_INVALID_INDEX)
+			continue;
+		glUniformBlockBinding(program, index, block.binding);
+
+		GLint size = 0;
+		glGetActiveUniformBlockiv(program, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+		if((size_t)size!=block.size)
+			std::cerr << "ERROR: (ubo::bindProgramBlocks) Block " << block.name << " is " << size
+								<< " bytes in GLSL but " << block.size << " in C++\n";
+	}
+}
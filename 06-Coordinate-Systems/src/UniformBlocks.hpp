@@ -0,0 +1,200 @@
+/*
+ * Uniform blocks shared by the shaders (shader/include/blocks.glsl) and their
+ * C++ mirrors.
+ *
+ * Every block has a fixed binding point. Shader binds blocks it finds by
+ * name to their binding points right after linking, so a block is bound
+ * once per frame (camera) or per draw (glBindBufferRange into a streamed
+ * buffer) instead of being set on every program that uses it.
+ *
+ * The C++ structs must match the GLSL std140 layout byte for byte. Layout
+ * computes std140 offsets of a member list at compile time (vec3 is
+ * aligned like a vec4, a scalar may follow it in it's last 4 bytes, mat4 is
+ * 4 vec4 columns), and UBO_CHECK_MEMBER/UBO_CHECK_SIZE turn any difference
+ * into a compile error. Types std140 pads differently than C++ (mat3, bool,
+ * arrays of scalars) aren't in Std140 on purpose - using them doesn't
+ * compile. At link time Shader also compares the block sizes the driver
+ * reports with sizeof of the structs.
+ *
+ * 2022
+ * Author: KrzysiekGL webmaster@unexpectd.com; All rights reserved.
+ */
+
+#ifndef UNIFORM_BLOCKS_HPP
+#define UNIFORM_BLOCKS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include "StreamBuffer.hpp"
+
+namespace ubo {
+	// std140 base alignment and size of a member type
+	template<typename T> struct Std140;
+	template<> struct Std140<float> { static constexpr size_t align = 4, size = 4; };
+	template<> struct Std140<int32_t> { static constexpr size_t align = 4, size = 4; };
+	template<> struct Std140<uint32_t> { static constexpr size_t align = 4, size = 4; };
+	template<> struct Std140<glm::vec2> { static constexpr size_t align = 8, size = 8; };
+	template<> struct Std140<glm::vec3> { static constexpr size_t align = 16, size = 12; };
+	template<> struct Std140<glm::vec4> { static constexpr size_t align = 16, size = 16; };
+	template<> struct Std140<glm::mat4> { static constexpr size_t align = 16, size = 64; };
+
+	constexpr size_t roundUp(size_t value, size_t alignment) {
+		return (value + alignment-1) / alignment * alignment;
+	}
+
+	// std140 offsets of the members, in declaration order, and the block size
+	// (rounded to 16 bytes, so blocks can follow each other in a buffer)
+	template<typename... Members>
+	struct Layout {
+		static constexpr std::array<size_t, sizeof...(Members)> offsets = [] {
+			std::array<size_t, sizeof...(Members)> o{};
+			size_t at = 0, i = 0;
+			((at = roundUp(at, Std140<Members>::align), o[i++] = at, at += Std140<Members>::size), ...);
+			return o;
+		}();
+		static constexpr size_t size = [] {
+			size_t at = 0;
+			((at = roundUp(at, Std140<Members>::align) + Std140<Members>::size), ...);
+			return roundUp(at, 16);
+		}();
+	};
+
+#define UBO_CHECK_MEMBER(Block, BlockLayout, index, member) \
+	static_assert(offsetof(Block, member)==BlockLayout::offsets[index], #Block "::" #member " is not at it's std140 offset")
+#define UBO_CHECK_SIZE(Block, BlockLayout) \
+	static_assert(sizeof(Block)==BlockLayout::size, #Block " doesn't have the std140 size")
+
+	// Binding points, the same in every program
+	enum Binding : GLuint {
+		CameraBinding = 0,
+		DrawBinding = 1,
+		MaterialBinding = 2,
+		LightsBinding = 3
+	};
+
+	// Per frame: `uniform Camera` in GLSL
+	struct Camera {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
+		glm::vec3 position;
+		float time;
+	};
+	using CameraLayout = Layout<glm::mat4, glm::mat4, glm::mat4, glm::vec3, float>;
+	UBO_CHECK_MEMBER(Camera, CameraLayout, 0, view);
+	UBO_CHECK_MEMBER(Camera, CameraLayout, 1, projection);
+	UBO_CHECK_MEMBER(Camera, CameraLayout, 2, viewProjection);
+	UBO_CHECK_MEMBER(Camera, CameraLayout, 3, position);
+	UBO_CHECK_MEMBER(Camera, CameraLayout, 4, time);
+	UBO_CHECK_SIZE(Camera, CameraLayout);
+
+	// Per draw: `uniform Draw` in GLSL
+	struct Draw {
+		glm::mat4 model;
+	};
+	using DrawLayout = Layout<glm::mat4>;
+	UBO_CHECK_MEMBER(Draw, DrawLayout, 0, model);
+	UBO_CHECK_SIZE(Draw, DrawLayout);
+
+	// Per material: `uniform Material` in GLSL, kept in the material's own buffer (see Material.hpp)
+	struct MaterialBlock {
+		glm::vec4 baseColorFactor;
+		float metallicFactor;
+		float roughnessFactor;
+		float padding[2];
+	};
+	using MaterialLayout = Layout<glm::vec4, float, float>;
+	UBO_CHECK_MEMBER(MaterialBlock, MaterialLayout, 0, baseColorFactor);
+	UBO_CHECK_MEMBER(MaterialBlock, MaterialLayout, 1, metallicFactor);
+	UBO_CHECK_MEMBER(MaterialBlock, MaterialLayout, 2, roughnessFactor);
+	UBO_CHECK_SIZE(MaterialBlock, MaterialLayout);
+
+	// Per frame: `uniform Lights` in GLSL, how to find a fragment's cluster of lights (see Lighting.hpp)
+	struct Lights {
+		// View the clusters were built for
+		glm::mat4 clusterView;
+		// tan of half the field of view (x, y), near plane, slices per log unit of depth
+		glm::vec4 clusterScale;
+		uint32_t tilesX;
+		uint32_t tilesY;
+		uint32_t slices;
+		uint32_t count;
+		// First texel of this frame's lights, clusters and indices in the streamed buffer textures
+		uint32_t lightDataOffset;
+		uint32_t lightClustersOffset;
+		uint32_t lightIndicesOffset;
+		uint32_t padding0;
+		glm::vec3 ambient;
+		float padding;
+	};
+	using LightsLayout = Layout<glm::mat4, glm::vec4, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t,
+															glm::vec3>;
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 0, clusterView);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 1, clusterScale);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 2, tilesX);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 3, tilesY);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 4, slices);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 5, count);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 6, lightDataOffset);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 7, lightClustersOffset);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 8, lightIndicesOffset);
+	UBO_CHECK_MEMBER(Lights, LightsLayout, 9, ambient);
+	UBO_CHECK_SIZE(Lights, LightsLayout);
+
+	// Known block: GLSL name, binding point and C++ size
+	struct BlockInfo {
+		const char * name;
+		GLuint binding;
+		size_t size;
+	};
+	const std::array<BlockInfo, 4> & blocks();
+
+	// Bind known blocks used by a linked program to their binding points
+	void bindProgramBlocks(GLuint program);
+
+	// Write a block into the stream and bind it's range; false if the stream had no room
+	template<typename T>
+	bool bind(StreamBuffer & stream, GLuint binding, const T & block) {
+		StreamBuffer::Allocation a = stream.allocate(sizeof(T));
+		if(!a.ptr)
+			return false;
+		std::memcpy(a.ptr, &block, sizeof(T));
+		stream.unmap();
+		glBindBufferRange(GL_UNIFORM_BUFFER, binding, a.buffer, a.offset, sizeof(T));
+		return true;
+	}
+
+	// A run of blocks written into one stream allocation, each bound on it's own;
+	// stride follows the stream's uniform offset alignment
+	template<typename T>
+	class BlockArray {
+	public:
+		// Map room for count blocks; false if the stream had no room
+		bool begin(StreamBuffer & stream, size_t count) {
+			this->stream = &stream;
+			stride = roundUp(sizeof(T), stream.getAlignment());
+			allocation = stream.allocate(stride * count);
+			return allocation.ptr!=nullptr;
+		}
+		T & operator[](size_t i) { return *reinterpret_cast<T *>(static_cast<unsigned char *>(allocation.ptr) + i*stride); }
+		// Finish writing (before any draw)
+		void end() { stream->unmap(); }
+		void bind(GLuint binding, size_t i) const {
+			glBindBufferRange(GL_UNIFORM_BUFFER, binding, allocation.buffer, allocation.offset + i*stride, sizeof(T));
+		}
+
+	private:
+		StreamBuffer * stream = nullptr;
+		StreamBuffer::Allocation allocation;
+		size_t stride = 0;
+	};
+}
+
+#endif /* UNIFORM_BLOCKS_HPP */
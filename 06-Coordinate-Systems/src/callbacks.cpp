@@ -1,7 +1,54 @@
+// glad before GLFW's own OpenGL header
+#include "Context.hpp"
 #include "callbacks.hpp"
+#include "Input.hpp"
+
+namespace {
+	void push(GLFWwindow * window, input::EventType type, int code, int action, int mods, double x, double y) {
+		Context * context = static_cast<Context *>(glfwGetWindowUserPointer(window));
+		if(context)
+			context->pushEvent(input::Event{type, code, action, mods, x, y, glfwGetTime()});
+	}
+}
 
 void clbck::framebufferSize(GLFWwindow * window, int width, int height) {
-	glViewport(0, 0, width, height);
+	// Events are polled on the main thread; with a render thread the context is current there
+	// and the viewport is set by the recorded frames instead
+	if(window == glfwGetCurrentContext())
+		glViewport(0, 0, width, height);
+	push(window, input::EventType::FramebufferSize, 0, 0, 0, width, height);
+}
+
+void clbck::key(GLFWwindow * window, int key, int scancode, int action, int mods) {
+	push(window, input::EventType::Key, key, action, mods, 0., 0.);
+}
+
+void clbck::mouseButton(GLFWwindow * window, int button, int action, int mods) {
+	push(window, input::EventType::MouseButton, button, action, mods, 0., 0.);
+}
+
+void clbck::cursorPos(GLFWwindow * window, double x, double y) {
+	push(window, input::EventType::CursorPos, 0, 0, 0, x, y);
+}
+
+void clbck::scroll(GLFWwindow * window, double x, double y) {
+	push(window, input::EventType::Scroll, 0, 0, 0, x, y);
+}
+
+void clbck::windowSize(GLFWwindow * window, int width, int height) {
+	push(window, input::EventType::WindowSize, 0, 0, 0, width, height);
+}
+
+void clbck::windowIconify(GLFWwindow * window, int iconified) {
+	push(window, input::EventType::WindowIconify, 0, iconified, 0, 0., 0.);
+}
+
+void clbck::windowFocus(GLFWwindow * window, int focused) {
+	push(window, input::EventType::WindowFocus, 0, focused, 0, 0., 0.);
+}
+
+void clbck::windowRefresh(GLFWwindow * window) {
+	push(window, input::EventType::WindowRefresh, 0, 0, 0, 0., 0.);
 }
 
 void clbck::error(int code, const char *description) {
@@ -16,6 +16,16 @@ namespace clbck {
 	// GLFW sets glViewport when window resizes
 	void framebufferSize(GLFWwindow * window, int width, int height);
 
+	// Input and window events, pushed into the queue of the window's Context (see Input.hpp)
+	void key(GLFWwindow * window, int key, int scancode, int action, int mods);
+	void mouseButton(GLFWwindow * window, int button, int action, int mods);
+	void cursorPos(GLFWwindow * window, double x, double y);
+	void scroll(GLFWwindow * window, double x, double y);
+	void windowSize(GLFWwindow * window, int width, int height);
+	void windowIconify(GLFWwindow * window, int iconified);
+	void windowFocus(GLFWwindow * window, int focused);
+	void windowRefresh(GLFWwindow * window);
+
 	// GLFW error handling
 	void error(int code, const char * description);
 }
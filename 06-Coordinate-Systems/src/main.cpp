@@ -8,6 +8,9 @@
 #include <iostream>
 #include <math.h>
 #include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -21,6 +24,34 @@
 #include "Context.hpp"
 #include "Shader.hpp"
 #include "Texture.hpp"
+#include "Mesh.hpp"
+#include "Material.hpp"
+#include "GltfLoader.hpp"
+#include "SceneGraph.hpp"
+#include "Benchmark.hpp"
+#include "ECS.hpp"
+#include "Components.hpp"
+#include "RenderQueue.hpp"
+#include "Frustum.hpp"
+#include "Culling.hpp"
+#include "Occlusion.hpp"
+#include "LOD.hpp"
+#include "GeometryPool.hpp"
+#include "StaticGeometry.hpp"
+#include "StreamBuffer.hpp"
+#include "UniformBlocks.hpp"
+#include "ShaderVariants.hpp"
+#include "Jobs.hpp"
+#include "CommandBuffer.hpp"
+#include "RenderThread.hpp"
+#include "FramePacer.hpp"
+#include "LateLatch.hpp"
+#include "DynamicResolution.hpp"
+#include "RedrawScheduler.hpp"
+#include "FrameGraph.hpp"
+#include "RenderTargetPool.hpp"
+#include "PostProcess.hpp"
+#include "Lighting.hpp"
 
 const float vertices[] = {
 	// positions		// colors				// texture coordinates
@@ -37,6 +68,97 @@ const GLuint indices[] = {
 int main(int argc, char ** argv, char ** eval) {
 	std::cout << "05-Textures\n";
 
+	// Headless benchmarks of the CPU side systems
+	if(argc > 1 && std::string(argv[1])=="--bench") {
+		bench::run();
+		return 0;
+	}
+
+	// A glTF binary file to load, optionally as static geometry (--static); with --render-thread
+	// frames are drawn by a render thread, --render-thread=3 lets it fall two frames behind;
+	// --poll-input[=Hz] polls input events while waiting for the render thread (1000 Hz by default);
+	// --swap-interval=N, --frames-in-flight=N (0: unlimited) and --fps=N (a frame rate cap) pace frames;
+	// --late-latch writes the newest camera pose just before the frame's draws are submitted;
+	// --dynamic-resolution[=ms] scales the scene's resolution to a GPU time (12 ms by default),
+	// --resolution-scale=F renders at a fixed scale instead, --sharpen[=s] sharpens the upscale;
+	// --post=bloom,tonemap,vignette,grade enables post-processing effects, --bloom-scale=F sets the
+	// resolution of bloom's first level (.5 by default);
+	// --on-demand draws only frames that changed, --background-fps=N (10 by default) while unfocused;
+	// --lights=N lights the meshes with N animated point and spot lights (clustered lighting)
+	std::string modelPath;
+	bool loadStatic = false;
+	unsigned renderBuffers = 0;
+	double pollRate = 0.;
+	FramePacer::Settings pacing;
+	bool lateLatch = false;
+	DynamicResolution::Settings resolution;
+	bool scaleResolution = false;
+	PostProcess::Settings postSettings;
+	RedrawScheduler::Settings redrawSettings;
+	bool onDemand = false;
+	unsigned numLights = 0;
+	for(int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if(arg=="--static")
+			loadStatic = true;
+		else if(arg=="--render-thread")
+			renderBuffers = 2;
+		else if(arg.rfind("--render-thread=", 0)==0)
+			renderBuffers = (unsigned)std::max(2, atoi(arg.c_str() + 16));
+		else if(arg=="--poll-input")
+			pollRate = 1000.;
+		else if(arg.rfind("--poll-input=", 0)==0)
+			pollRate = std::max(1., atof(arg.c_str() + 13));
+		else if(arg.rfind("--swap-interval=", 0)==0)
+			pacing.swapInterval = std::max(0, atoi(arg.c_str() + 16));
+		else if(arg.rfind("--frames-in-flight=", 0)==0)
+			pacing.maxFramesInFlight = (unsigned)std::max(0, atoi(arg.c_str() + 19));
+		else if(arg=="--late-latch")
+			lateLatch = true;
+		else if(arg=="--dynamic-resolution")
+			scaleResolution = true;
+		else if(arg.rfind("--dynamic-resolution=", 0)==0) {
+			scaleResolution = true;
+			resolution.targetMs = std::max(.1, atof(arg.c_str() + 21));
+		}
+		else if(arg.rfind("--resolution-scale=", 0)==0) {
+			scaleResolution = true;
+			resolution.fixedScale = std::clamp((float)atof(arg.c_str() + 19), .1f, 2.f);
+		}
+		else if(arg=="--sharpen")
+			postSettings.sharpness = .5f;
+		else if(arg.rfind("--sharpen=", 0)==0)
+			postSettings.sharpness = std::max(0.f, (float)atof(arg.c_str() + 10));
+		else if(arg.rfind("--post=", 0)==0) {
+			std::string effects = arg.substr(7) + ',';
+			for(size_t begin = 0, end; (end = effects.find(',', begin))!=std::string::npos; begin = end + 1) {
+				std::string effect = effects.substr(begin, end - begin);
+				if(effect=="bloom")
+					postSettings.bloom = true;
+				else if(effect=="tonemap")
+					postSettings.tonemap = true;
+				else if(effect=="vignette")
+					postSettings.vignette = true;
+				else if(effect=="grade")
+					postSettings.colorGrade = true;
+				else if(!effect.empty())
+					std::cerr << "ERROR: (main) Unknown post-processing effect " << effect << '\n';
+			}
+		}
+		else if(arg.rfind("--bloom-scale=", 0)==0)
+			postSettings.bloomScale = std::clamp((float)atof(arg.c_str() + 14), .0625f, 1.f);
+		else if(arg=="--on-demand")
+			onDemand = true;
+		else if(arg.rfind("--background-fps=", 0)==0)
+			redrawSettings.backgroundFps = std::max(0., atof(arg.c_str() + 17));
+		else if(arg.rfind("--lights=", 0)==0)
+			numLights = (unsigned)std::clamp(atoi(arg.c_str() + 9), 0, (int)light::MaxLights);
+		else if(arg.rfind("--fps=", 0)==0)
+			pacing.targetFrameMs = atof(arg.c_str() + 6) > 0. ? 1000. / atof(arg.c_str() + 6) : 0.;
+		else
+			modelPath = arg;
+	}
+
 	{
 		std::cout << "----- GLM demo -----\n";
 		glm::vec4 vec(1.f, 0.f, 0.f, 1.f);
@@ -49,11 +171,16 @@ int main(int argc, char ** argv, char ** eval) {
 
 	glfwInit();
 
+	// Worker pool of the engine's parallel systems; this thread is it's thread 0
+	job::global();
+
 	// Main (for now single) Resource Manager
 	ResourceManager resMan;
 
 	Context context("learnopengl");
 	context.makeCurrent();
+	context.setPollInterval(pollRate > 0. ? 1. / pollRate : 0.);
+	glEnable(GL_DEPTH_TEST);
 
 	// -----------------------------------------------------------------------------------------------
 	// Temp space for rendering stuff
@@ -98,67 +225,387 @@ int main(int argc, char ** argv, char ** eval) {
 	u64 tex1 = resMan.insert(new Texture("../texture/container.jpg", GL_TEXTURE_2D));
 	u64 tex2 = resMan.insert(new Texture("../texture/face.png", GL_TEXTURE_2D));
 	// -----------------------------------------------------------------------------------------------
-	// Shader program
-	u64 shad1 = resMan.insert(new Shader("../shader/transform.vert", "../shader/transform.frag"));
-	std::static_pointer_cast<Shader>(resMan.find(shad1))->setInt("texture0", 0);
-	std::static_pointer_cast<Shader>(resMan.find(shad1))->setInt("texture1", 1);
+	// Shader program - the textured quad variant with a transform and the second texture mixed in
+	enum QuadFeature : uint32_t {
+		QuadTransform = 1 << 0,
+		QuadMixTexture1 = 1 << 1
+	};
+	ShaderVariants quadShaders(resMan, "../shader/textured.vert", "../shader/textured.frag",
+														 {"TRANSFORM", "MIX_TEXTURE1"}, {"MIX_FACTOR 0.2"});
+	u64 shad1 = quadShaders.get(QuadTransform | QuadMixTexture1);
+	// Material of the quads: the program and it's two textures
+	u64 mat1 = resMan.insert(new Material());
+	auto quadMaterial = std::static_pointer_cast<Material>(resMan.find(mat1));
+	quadMaterial->setShader(shad1);
+	quadMaterial->setTexture("texture0", tex1);
+	quadMaterial->setTexture("texture1", tex2);
+	// -----------------------------------------------------------------------------------------------
+	// Meshes from a glTF binary file given as an argument;
+	// with --static the file is merged into pooled static geometry instead
+	std::vector<u64> meshes;
+	GeometryPool geometryPool;
+	StaticGeometry staticGeometry(geometryPool);
+	if(!modelPath.empty()) {
+		try {
+			if(loadStatic)
+				gltf::loadStaticGLB(modelPath.c_str(), resMan, staticGeometry);
+			else
+				meshes = gltf::loadGLB(modelPath.c_str(), resMan);
+		}
+		catch(const std::exception & e) {
+			std::cerr << "ERROR: (main) Loading " << modelPath << " failed\n" << e.what();
+		}
+	}
+	// Mesh materials get the variant matching their textures; ones without a material draw with meshShader
+	enum MeshFeature : uint32_t {
+		MeshBaseColorTexture = 1 << 0
+	};
+	ShaderVariants meshShaders(resMan, "../shader/mesh.vert", "../shader/mesh.frag", {"BASE_COLOR_TEXTURE"});
+	u64 meshShader = meshShaders.get(0);
+	auto assignMeshShader = [&](u64 materialID) {
+		auto material = std::static_pointer_cast<Material>(resMan.find(materialID));
+		if(material && !material->getShader())
+			material->setShader(meshShaders.get(material->getBaseColorTexture() ? MeshBaseColorTexture : 0u));
+	};
+	for(u64 materialID : staticGeometry.getMaterials())
+		assignMeshShader(materialID);
+	// Meshes without vertex colors read the generic attribute value
+	glVertexAttrib4f(Mesh::Attribute::Color, 1.f, 1.f, 1.f, 1.f);
+	// -----------------------------------------------------------------------------------------------
+	// Scene graph - the two quads and the loaded meshes
+	SceneGraph scene;
+	SceneGraph::NodeID quad1 = scene.createNode();
+	scene.setTranslation(quad1, glm::vec3(.5f, -.5f, .0f));
+	SceneGraph::NodeID quad2 = scene.createNode();
+	scene.setTranslation(quad2, glm::vec3(-.5f, .5f, .0f));
+	SceneGraph::NodeID meshRoot = scene.createNode();
 	// -----------------------------------------------------------------------------------------------
-	// Transformations
-	glm::mat4 trans = glm::mat4(1.f);
-	trans = glm::rotate(trans, glm::radians(90.f), glm::vec3(0.f, 0.f, 1.f));
-	trans = glm::scale(trans, glm::vec3(.5f, .5f, .5f));
-	std::static_pointer_cast<Shader>(resMan.find(shad1))->setMat4("transform", trans);
+	// Renderable entities - one per primitive of every loaded mesh
+	ecs::World world;
+	for(u64 meshID : meshes) {
+		SceneGraph::NodeID node = scene.createNode(meshRoot);
+		auto mesh = std::static_pointer_cast<Mesh>(resMan.find(meshID));
+		for(uint32_t i = 0; i < mesh->getPrimitives().size(); ++i) {
+			const Mesh::Primitive & p = mesh->getPrimitives()[i];
+			assignMeshShader(p.material);
+			auto material = std::static_pointer_cast<Material>(resMan.find(p.material));
+			uint64_t sortKey = (material ? *material : Material::fallback()).getSortKey();
+			world.create(ecs::Transform{node}, ecs::MeshRef{meshID, i}, ecs::MaterialRef{p.material, sortKey},
+									 ecs::Bounds{p.boundsMin, p.boundsMax, p.boundsMin, p.boundsMax},
+									 ecs::LODRanges{p.lods.data(), (uint32_t)p.lods.size()});
+		}
+	}
+	auto renderQueue = std::make_unique<RenderQueue>();
+	// Per frame uniform blocks (camera, per draw) are streamed from here
+	auto uniformStream = std::make_unique<StreamBuffer>(8 << 20);
+	// Entities with an ecs::Occluder component hide what's behind them
+	cull::OcclusionBuffer occlusion;
+	unsigned cullThreads = job::global().size();
+	double lastStatsTime = 0.;
+	// Commands capture by value: these outlive every recorded frame
+	ResourceManager * resources = &resMan;
+	Material * quadMat = quadMaterial.get();
+	const Shader * quadProgram = std::static_pointer_cast<Shader>(resMan.find(shad1)).get();
+	const Shader * meshProgram = std::static_pointer_cast<Shader>(resMan.find(meshShader)).get();
+	StreamBuffer * uniforms = uniformStream.get();
+	StaticGeometry * statics = &staticGeometry;
+	GeometryPool * pool = &geometryPool;
+	RenderQueue * queue = renderQueue.get();
+	bool drawsStatic = staticGeometry.size() > 0;
+	bool drawsMeshes = !meshes.empty();
+	// Fly camera (WASD, Q/E down/up, arrows to turn), starting 3 units back looking down -z
+	latch::Limits cameraLimits{2.f, glm::radians(90.f), .05};
+	latch::Pose cameraPose{glm::vec3(0.f, 0.f, 3.f), 0.f, 0.f, latch::Clock::now()};
+	latch::PoseLatch poseLatch(cameraPose);
+	latch::PoseLatch * latestPose = &poseLatch;
+	const float fovY = glm::radians(45.f), zNear = .1f, zFar = 100.f;
+	// The scene is drawn offscreen at a scale following the GPU time and upscaled at the end of the frame
+	std::unique_ptr<DynamicResolution> dynamicResolution;
+	if(scaleResolution)
+		dynamicResolution = std::make_unique<DynamicResolution>(resolution);
+	DynamicResolution * dynres = dynamicResolution.get();
+	// Post-processing effects and the upscale in one pass, bloom at low resolution
+	auto postProcess = std::make_unique<PostProcess>(resMan, postSettings);
+	PostProcess * post = postProcess.get();
+	bool offscreen = dynres || post->hasEffects();
+	// Passes of every frame; their transient targets come from the pool, used on the GL thread
+	FrameGraph frameGraph;
+	RenderTargetPool renderTargets(RenderTargetPool::Settings{});
+	RenderTargetPool * targets = &renderTargets;
+	// Point lights, every 4th a spot pointing down, circling the scene's center; binned into clusters of
+	// the view every frame. Without lights the meshes keep their unlit colors (ambient 1)
+	std::vector<light::Light> sceneLights;
+	std::vector<glm::vec3> lightOrigins;
+	for(unsigned i = 0; i < numLights; ++i) {
+		auto random = [](float lo, float hi) { return lo + (hi-lo) * ((float)rand() / (float)RAND_MAX); };
+		glm::vec3 origin(random(-8.f, 8.f), random(-1.f, 2.f), random(-8.f, 8.f));
+		glm::vec3 color = glm::vec3(random(.2f, 1.f), random(.2f, 1.f), random(.2f, 1.f)) * 4.f;
+		lightOrigins.push_back(origin);
+		sceneLights.push_back(i % 4==3 ? light::spot(origin, glm::vec3(0.f, -1.f, 0.f), random(3.f, 6.f), color,
+																								 glm::radians(20.f), glm::radians(30.f))
+																	 : light::point(origin, random(1.5f, 4.f), color));
+	}
+	glm::vec3 ambient = sceneLights.empty() ? glm::vec3(1.f) : glm::vec3(.1f);
+	light::ClusterGrid clusterGrid(light::Settings{});
+	std::unique_ptr<light::LightBuffers> lightBuffers;
+	if(!sceneLights.empty())
+		lightBuffers = std::make_unique<light::LightBuffers>(1 << 20);
+	light::LightBuffers * gpuLights = lightBuffers.get();
 	// End of temp space for rendering stuff
 	// -----------------------------------------------------------------------------------------------
 
+	// Frames are recorded into command buffers and executed by the render thread, or right away by
+	// this one; either way the latency from input to swap is measured. The pacer caps the frame rate
+	// and keeps the GPU from queueing too many frames
+	FramePacer pacer(pacing);
+	auto renderer = std::make_unique<RenderThread>(context, renderBuffers ? renderBuffers : 1, renderBuffers > 0, &pacer);
+	RenderThread * frames = renderer.get();
+	std::cout << "Render thread: " << (renderer->isThreaded() ? "on" : "off") << ", frames in flight: "
+						<< renderer->getNumBuffers() << ", late latching: " << (lateLatch ? "on" : "off") << '\n';
+	latch::Clock::time_point lastFrame = latch::Clock::now();
+	// The scene's animation (P toggles it) starts paused when drawing on demand, else nothing would idle
+	RedrawScheduler redraw(redrawSettings);
+	bool animate = !onDemand;
+	double animationTime = 0.;
+
 	// Game loop/Render loop
 	while(!context.shouldClose()) {
-		// Input & Context state
-		context.updateContextState();
+		// On demand, with nothing changed the loop sleeps in the event wait; any event wakes it
+		double wait;
+		if(onDemand && !redraw.shouldDraw(glfwGetTime(), context.hasEvents(), animate || context.isAnyKeyDown(),
+																			context.isIconified(), context.isFocused(), wait)) {
+			latch::Clock::time_point start = latch::Clock::now();
+			context.waitEvents(wait);
+			redraw.waited(std::chrono::duration<double, std::milli>(latch::Clock::now() - start).count());
+			continue;
+		}
+
+		pacer.beginFrame();
+
+		// With input polling the wait for a free frame is spent polling events, so they get exact timestamps
+		CommandBuffer * frame = nullptr;
+		if(context.getPollInterval() > 0.)
+			while(!(frame = renderer->beginFrame(context.getPollInterval())))
+				context.pollEvents();
+		else
+			frame = &renderer->beginFrame();
+		CommandBuffer & commands = *frame;
+
+		// Input: events since the last frame, in order and timestamped; resizes update the context
 		context.processInput();
+		latch::Clock::time_point now = latch::Clock::now();
+		// After idling the first frame doesn't move by the whole time slept
+		float dt = std::min(std::chrono::duration<float>(now - lastFrame).count(), .1f);
+		lastFrame = now;
+		for(const input::Event & event : context.getEvents())
+			if(event.type==input::EventType::Key && event.code==GLFW_KEY_P && event.action==GLFW_PRESS)
+				animate = !animate;
+		auto axis = [&context](int positive, int negative) {
+			return (context.isKeyDown(positive) ? 1.f : 0.f) - (context.isKeyDown(negative) ? 1.f : 0.f);
+		};
+		glm::vec3 move(axis(GLFW_KEY_D, GLFW_KEY_A), axis(GLFW_KEY_E, GLFW_KEY_Q), axis(GLFW_KEY_W, GLFW_KEY_S));
+		glm::vec2 turn(axis(GLFW_KEY_RIGHT, GLFW_KEY_LEFT), axis(GLFW_KEY_UP, GLFW_KEY_DOWN));
+		cameraPose = latch::fly(cameraPose, move, turn, dt, cameraLimits);
+		cameraPose.time = now;
+		// Frames still waiting for the render thread may latch this pose
+		poseLatch.publish(cameraPose);
+
+		// Transformations in time, standing still while the animation is paused
+		if(animate)
+			animationTime += dt;
+		float time = (float)animationTime;
+		scene.setRotation(quad1, glm::angleAxis(time, glm::vec3(.0f, .0f, 1.f)));
+		float s = sin(time);
+		scene.setScale(quad2, glm::vec3(s, s, 1.f));
+		scene.setRotation(meshRoot, glm::angleAxis(time, glm::vec3(0.f, 1.f, 0.f)));
+		scene.update();
+		glm::mat4 trans = scene.getWorldMatrix(quad1);
+		glm::mat4 trans2 = scene.getWorldMatrix(quad2);
+		for(size_t i = 0; i < sceneLights.size(); ++i) {
+			glm::vec3 o = lightOrigins[i];
+			float angle = time * .2f;
+			sceneLights[i].position = glm::vec3(o.x * cosf(angle) - o.z * sinf(angle), o.y, o.x * sinf(angle) + o.z * cosf(angle));
+		}
+
+		// Rendering, recorded into the passes of the frame graph; GL calls only happen inside the commands
+		int framebufferWidth = context.getFramebufferWidth();
+		int framebufferHeight = context.getFramebufferHeight();
+		commands.record([=]() {
+			Shader::resetUniformStats();
+			Material::resetBindStats();
+		});
+		frameGraph.reset();
+		auto recordScene = [&](CommandBuffer & commands) {
+			commands.record([=]() {
+				if(dynres)
+					dynres->begin(targets->getReferenceWidth(), targets->getReferenceHeight());
 
-		// Transformations in time
-		glm::mat4 trans = glm::mat4(1.f);
-		trans = glm::translate(trans, glm::vec3(.5f, -.5f, .0f));
-		trans = glm::rotate(trans, (float)glfwGetTime(), glm::vec3(.0f, .0f, 1.f));
+				// Clrear color buffer
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		glm::mat4 trans2 = glm::mat4(1.f);
-		trans2 = glm::translate(trans2, glm::vec3(-.5f, .5f, .0f));
-		float s = sin((float)glfwGetTime());
-		trans2 = glm::scale(trans2, glm::vec3(s, s, 1.f));
+				// Render the rectangle
+				const Shader & quadShader = quadMat->bind(*resources, *quadProgram);
 
-		// Rendering
+				glBindVertexArray(VAO);
 
-		// Clrear color buffer
-		glClear(GL_COLOR_BUFFER_BIT);
+				quadShader.setMat4("transform", trans);
+				quadShader.flush();
+				glDrawElements(GL_TRIANGLES, sizeof(indices)/sizeof(GLuint), GL_UNSIGNED_INT, 0);
 
-		// Render the rectangle
-		glActiveTexture(GL_TEXTURE0);
-		std::static_pointer_cast<Texture>(resMan.find(tex1))->activate();
+				quadShader.setMat4("transform", trans2);
+				quadShader.flush();
+				glDrawElements(GL_TRIANGLES, sizeof(indices)/sizeof(GLuint), GL_UNSIGNED_INT, 0);
+			});
 
-		glActiveTexture(GL_TEXTURE1);
-		std::static_pointer_cast<Texture>(resMan.find(tex2))->activate();
+			// Render loaded meshes with the camera's view
+			glm::mat4 view = cameraPose.view();
+			float aspect = context.getHeight() ? (float)context.getWidth() / (float)context.getHeight() : 1.f;
+			glm::mat4 projection = glm::perspective(fovY, aspect, zNear, zFar);
+			glm::mat4 viewProjection = projection * view;
 
-		std::static_pointer_cast<Shader>(resMan.find(shad1))->activate();
+			ecs::updateBounds(world, scene);
+			lod::Settings lodSettings;
+			lodSettings.cameraPosition = cameraPose.position;
+			lodSettings.pixelsPerUnit = context.getHeight() / (2.f * tanf(fovY * .5f));
+			ecs::selectLODs(world, scene, lodSettings);
+			// A late latched camera may see what this pose doesn't: culling uses a frustum of every pose it
+			// can reach, and occlusion (only valid for this pose) is skipped
+			Frustum frustum = lateLatch ? latch::expandedFrustum(cameraPose, fovY, aspect, zNear, zFar, cameraLimits)
+																 : Frustum::fromMatrix(viewProjection);
+			if(!lateLatch) {
+				occlusion.begin(viewProjection);
+				ecs::addOccluders(world, scene, occlusion);
+				occlusion.rasterize(cullThreads);
+			}
+			renderQueue->build(world, frustum, cullThreads, lateLatch ? nullptr : &occlusion);
 
-		glBindVertexArray(VAO);
+			// Lights of this view's clusters, copied into the frame for the GL thread
+			const light::Light * lights = nullptr;
+			const glm::uvec2 * lightClusters = nullptr;
+			const uint16_t * lightIndices = nullptr;
+			size_t lightCount = sceneLights.size(), numClusters = 0, numIndices = 0;
+			if(lightCount) {
+				clusterGrid.build(sceneLights, view, fovY, aspect, zNear, zFar, cullThreads);
+				numClusters = clusterGrid.getClusters().size();
+				numIndices = clusterGrid.getIndices().size();
+				light::Light * l = commands.allocate<light::Light>(lightCount);
+				std::copy(sceneLights.begin(), sceneLights.end(), l);
+				glm::uvec2 * c = commands.allocate<glm::uvec2>(numClusters);
+				std::copy(clusterGrid.getClusters().begin(), clusterGrid.getClusters().end(), c);
+				uint16_t * n = commands.allocate<uint16_t>(numIndices);
+				std::copy(clusterGrid.getIndices().begin(), clusterGrid.getIndices().end(), n);
+				lights = l; lightClusters = c; lightIndices = n;
+			}
+			// Fragments find their cluster with the view binned for, also when the camera is late latched
+			ubo::Lights lightsBlock = clusterGrid.getBlock(ambient);
+			lightsBlock.count = (uint32_t)lightCount;
 
-		std::static_pointer_cast<Shader>(resMan.find(shad1))->setMat4("transform", trans);
-		glDrawElements(GL_TRIANGLES, sizeof(indices)/sizeof(GLuint), GL_UNSIGNED_INT, 0);
+			// Camera block, written right before the draws that read it: bound once, read by every program
+			// that declares it. With late latching it's the newest pose within reach of the recorded one
+			ubo::Camera * camera = commands.allocate<ubo::Camera>(1);
+			latch::Pose recordedPose = cameraPose;
+			commands.record([=]() {
+				latch::Pose pose = lateLatch ? latch::clamp(recordedPose, latestPose->read(), cameraLimits) : recordedPose;
+				glm::mat4 poseView = pose.view();
+				*camera = ubo::Camera{poseView, projection, projection * poseView, pose.position, time};
+				frames->markInput(pose.time);
+				uniforms->beginFrame();
+				ubo::bind(*uniforms, ubo::CameraBinding, *camera);
+				ubo::Lights block = lightsBlock;
+				if(lightCount && gpuLights->upload(lights, lightCount, lightClusters, numClusters, lightIndices, numIndices, block))
+					gpuLights->bind();
+				ubo::bind(*uniforms, ubo::LightsBinding, block);
+			});
+			renderQueue->record(commands, resMan, scene, *meshProgram, *uniformStream, viewProjection, lodSettings.cameraPosition,
+												 camera);
+			commands.record([=]() {
+				statics->draw(*resources, *meshProgram, *uniforms, camera->viewProjection, cullThreads);
+				uniforms->endFrame();
+				if(lightCount)
+					gpuLights->endFrame();
+				if(dynres)
+					dynres->end();
+			});
+		};
+		// With dynamic resolution or post-processing the scene goes to transient targets (with headroom
+		// for bloom and tone mapping), post-processed and upscaled to the window by the passes after it
+		if(offscreen) {
+			float sceneScale = dynres ? dynres->getMaxScale() : 1.f;
+			GLenum sceneFormat = post->hasEffects() ? GL_RGBA16F : GL_RGBA8;
+			FrameGraph::TextureID sceneColor = frameGraph.create("scene color", RenderTargetDesc{sceneScale, 0, 0, sceneFormat});
+			FrameGraph::TextureID sceneDepth = frameGraph.create("scene depth",
+																													 RenderTargetDesc{sceneScale, 0, 0, GL_DEPTH24_STENCIL8});
+			frameGraph.addPass("scene", {}, {sceneColor, sceneDepth}, recordScene);
+			post->addPasses(frameGraph, targets, sceneColor, dynres);
+		}
+		else
+			frameGraph.addPass("scene", {}, {FrameGraph::Backbuffer}, recordScene);
+		frameGraph.compile(framebufferWidth, framebufferHeight);
+		frameGraph.record(commands, targets, framebufferWidth, framebufferHeight);
 
-		std::static_pointer_cast<Shader>(resMan.find(shad1))->setMat4("transform", trans2);
-		glDrawElements(GL_TRIANGLES, sizeof(indices)/sizeof(GLuint), GL_UNSIGNED_INT, 0);
+		// Stats of the render side are printed by the commands, after the frame was drawn
+		double wallTime = glfwGetTime();
+		if(wallTime - lastStatsTime >= 1.) {
+			RenderQueue::BuildStats buildStats = renderQueue->getBuildStats();
+			cull::Stats cullStats = renderQueue->getCullStats();
+			cull::OcclusionStats occlusionStats = renderQueue->getOcclusionStats();
+			RenderThread::Stats frameStats = renderer->getStats();
+			renderer->resetStats();
+			input::Stats inputStats = context.getInputStats();
+			context.resetInputStats();
+			FramePacer::Stats pacingStats = pacer.getStats();
+			pacer.resetStats();
+			FrameGraph::Stats graphStats = frameGraph.getStats();
+			RedrawScheduler::Stats idleStats = redraw.getStats();
+			light::Stats lightStats = clusterGrid.getStats();
+			bool lit = !sceneLights.empty();
+			redraw.resetStats();
+			commands.record([=]() {
+				if(onDemand)
+					std::cout << idleStats << ' ';
+				if(dynres)
+					std::cout << dynres->getStats() << ' ';
+				if(lit)
+					std::cout << lightStats << ' ';
+				if(offscreen) {
+					std::cout << post->getStats() << ' ' << graphStats << ' ' << targets->getStats() << ' ';
+					post->resetStats();
+				}
+				if(drawsStatic)
+					std::cout << statics->getStats() << ' ' << pool->getStats() << ' ' << Shader::getUniformStats() << ' '
+										<< Material::getBindStats() << ' ' << frameStats << ' ' << pacingStats << ' ' << inputStats << '\n';
+				else if(drawsMeshes)
+					std::cout << buildStats << ' ' << cullStats << ' ' << occlusionStats
+										<< " clusters:" << queue->getClusterStats()
+										<< " triangles:" << queue->getSubmittedTriangles() << ' ' << queue->getStreamStats() << ' '
+										<< Shader::getUniformStats() << ' ' << Material::getBindStats() << ' ' << frameStats << ' ' << pacingStats << ' '
+										<< inputStats << '\n';
+				else
+					std::cout << frameStats << ' ' << pacingStats << ' ' << inputStats << '\n';
+			});
+			lastStatsTime = wallTime;
+		}
 
-		glBindVertexArray(0);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glUseProgram(0);
+		commands.record([=]() {
+			glBindVertexArray(0);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			glUseProgram(0);
+		});
 
-		// Events & Swap buffers
-		context.swapBuffers();
-		glfwPollEvents();
+		// Hand the frame over (swaps buffers) & Events
+		pacer.endFrame();
+		redraw.frameDrawn(glfwGetTime());
+		renderer->endFrame();
+		context.pollEvents();
 	}
 
-	// Clean-up
+	// Clean-up: the render thread finishes it's frames and gives the context back first
+	renderer.reset();
+	postProcess.reset();
+	dynamicResolution.reset();
+	lightBuffers.reset();
+	renderQueue.reset();
+	uniformStream.reset();
 	glfwTerminate();
 
 	return 0;